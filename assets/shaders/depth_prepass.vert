@@ -0,0 +1,16 @@
+#version 450
+// Depth-only pre-pass (see occRecordDepthPrepass in OcclusionCulling.cpp): the pipeline has no fragment shader.
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform PushConstants {
+	mat4 clipFromObject;
+} pc;
+
+// The main pass's vertex shader (e.g., scene.vert) must produce bit-identical positions:
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = pc.clipFromObject * vec4(position, 1.0);
+}
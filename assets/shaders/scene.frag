@@ -0,0 +1,14 @@
+#version 450
+// Main pass (see scene.vert): not all meshes have normals, hence faces are shaded with normals from the position's derivatives.
+
+layout(location = 0) in vec3 worldPosition;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	const vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+	const vec3 lightDirection = normalize(vec3(0.3, 1.0, 0.5));
+	const float diffuse = abs(dot(normal, lightDirection));
+	color = vec4(vec3(0.1 + 0.9 * diffuse), 1.0);
+}
@@ -0,0 +1,24 @@
+#version 450
+// Main pass (see occRegisterMainPassPipeline in OcclusionCulling.cpp): gl_Position is computed exactly like in depth_prepass.vert,
+// so that the depth test with LESS_OR_EQUAL passes for the surfaces which the pre-pass has left in the depth buffer.
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform PushConstants {
+	mat4 clipFromObject;
+} pc;
+
+// The instance's chunk of the uniform ring, selected by the descriptor set's dynamic offset (see ringAllocate):
+layout(set = 0, binding = 0) uniform Instance {
+	mat4 worldFromObject;
+} instance;
+
+layout(location = 0) out vec3 worldPosition;
+
+invariant gl_Position;
+
+void main()
+{
+	worldPosition = (instance.worldFromObject * vec4(position, 1.0)).xyz;
+	gl_Position = pc.clipFromObject * vec4(position, 1.0);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+
+// Offline tool which packs everything below an assets directory into one archive.
+// Usage: VulkanLaunchpadCooker [assets directory] [output archive]
+//        Defaults to "assets" and "assets.pack".
+
+// Include our framework (for loading OBJ files) and local helpers:
+#include "VulkanLaunchpad.h"
+#include "AssetPack.h"
+#include "GeometryCodec.h"
+
+// Include functionality from the standard library:
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/* ------------------------------------------------ */
+// Some little helpers directly declared here:
+/* ------------------------------------------------ */
+
+/*!
+ *	Reads the whole file at the given path into memory.
+ */
+std::vector<uint8_t> readFileBytes(const std::filesystem::path& path);
+
+/*!
+ *	Creates an archive entry for the given file: OBJ files are loaded and stored as encoded geometry,
+ *	DDS files and everything else are stored as they are.
+ *	@param	path	Path of the file
+ *	@param	name	Name of the entry, i.e., the path relative to the assets directory with forward slashes
+ */
+PackWriterEntry cookFile(const std::filesystem::path& path, const std::string& name);
+
+/* ------------------------------------------------ */
+// Main
+/* ------------------------------------------------ */
+
+int main(int argc, char** argv)
+{
+	const std::filesystem::path assets_directory = argc > 1 ? argv[1] : "assets";
+	const std::string output_path = argc > 2 ? argv[2] : "assets.pack";
+
+	if (!std::filesystem::is_directory(assets_directory)) {
+		VKL_EXIT_WITH_ERROR("Assets directory \"" << assets_directory.string() << "\" does not exist.");
+	}
+
+	// Collect all files, sorted by name so that the archive's layout is deterministic:
+	std::vector<std::filesystem::path> files;
+	for (const auto& directory_entry : std::filesystem::recursive_directory_iterator(assets_directory)) {
+		if (directory_entry.is_regular_file()) {
+			files.push_back(directory_entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	std::vector<PackWriterEntry> entries;
+	size_t source_bytes = 0;
+	for (const auto& file : files) {
+		const std::string name = std::filesystem::relative(file, assets_directory).generic_string();
+		entries.push_back(cookFile(file, name));
+		source_bytes += static_cast<size_t>(std::filesystem::file_size(file));
+		VKL_LOG("Cooked \"" << name << "\" (" << entries.back().data.size() << " bytes)");
+	}
+
+	if (!packWriteArchive(output_path.c_str(), entries)) {
+		VKL_EXIT_WITH_ERROR("Failed to write archive \"" << output_path << "\", or an entry name occurs more than once.");
+	}
+	VKL_LOG("Wrote " << entries.size() << " entries from " << source_bytes << " source bytes into \""
+		<< output_path << "\" (" << std::filesystem::file_size(output_path) << " bytes)");
+
+	return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------ */
+// Definitions of little helpers defined above main:
+/* ------------------------------------------------ */
+
+std::vector<uint8_t> readFileBytes(const std::filesystem::path& path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream) {
+		VKL_EXIT_WITH_ERROR("Unable to open \"" << path.string() << "\".");
+	}
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+PackWriterEntry cookFile(const std::filesystem::path& path, const std::string& name)
+{
+	PackWriterEntry entry;
+	entry.name = name;
+
+	const std::string extension = path.extension().string();
+	if (extension == ".obj") {
+		VklGeometryData geometry = vklLoadModelGeometry(path.string());
+		entry.type = PACK_ENTRY_GEOMETRY;
+		entry.data = codecEncodeGeometry(geometry.positions, geometry.normals, geometry.textureCoordinates, geometry.indices);
+	}
+	else if (extension == ".dds") {
+		entry.type = PACK_ENTRY_DDS;
+		entry.data = readFileBytes(path);
+	}
+	else {
+		entry.type = PACK_ENTRY_RAW;
+		entry.data = readFileBytes(path);
+	}
+	return entry;
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "AssetPack.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* --------------------------------------------- */
+// Internal definitions of the archive format
+/* --------------------------------------------- */
+
+namespace {
+
+	constexpr char     kMagic[4]     = { 'V', 'L', 'P', 'K' };
+	constexpr uint32_t kVersion      = 1u;
+	constexpr uint64_t kAlignment    = 256u;
+
+	// Layout: [PackHeader][entry data, each aligned][PackSlot table][names]
+	struct PackHeader {
+		char     magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		//! Number of slots of the hash table; a power of two, at least twice the entry count.
+		uint32_t slotCount;
+		uint64_t slotsOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+		uint64_t fileSize;
+	};
+
+	struct PackSlot {
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t type;
+		uint32_t used;
+	};
+
+	uint64_t alignUp(uint64_t value) {
+		return (value + kAlignment - 1) & ~(kAlignment - 1);
+	}
+}
+
+/* --------------------------------------------- */
+// Asset Pack Function Definitions
+/* --------------------------------------------- */
+
+bool packWriteArchive(const char* path, const std::vector<PackWriterEntry>& entries)
+{
+	PackHeader header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.slotCount = 1u;
+	while (header.slotCount < 2u * header.entryCount) {
+		header.slotCount <<= 1;
+	}
+
+	// Place the entries' data and build the hash table of contents (open addressing, linear probing):
+	std::vector<PackSlot> slots(header.slotCount, PackSlot{});
+	std::string names;
+	uint64_t offset = alignUp(sizeof(PackHeader));
+	std::vector<uint64_t> offsets(entries.size());
+	for (size_t e = 0; e < entries.size(); ++e) {
+		const PackWriterEntry& entry = entries[e];
+		offsets[e] = offset;
+
+		PackSlot slot = {};
+		slot.hash = hashFnv1a(entry.name.data(), entry.name.size());
+		slot.offset = offset;
+		slot.size = entry.data.size();
+		slot.nameOffset = static_cast<uint32_t>(names.size());
+		slot.nameLength = static_cast<uint32_t>(entry.name.size());
+		slot.type = entry.type;
+		slot.used = 1u;
+
+		// Entries with the same name would shadow each other, i.e., all but one could never be found:
+		uint32_t i = static_cast<uint32_t>(slot.hash) & (header.slotCount - 1u);
+		while (slots[i].used) {
+			if (slots[i].hash == slot.hash && 0 == names.compare(slots[i].nameOffset, slots[i].nameLength, entry.name)) {
+				return false;
+			}
+			i = (i + 1u) & (header.slotCount - 1u);
+		}
+		slots[i] = slot;
+		names += entry.name;
+
+		offset = alignUp(offset + entry.data.size());
+	}
+	header.slotsOffset = offset;
+	header.namesOffset = header.slotsOffset + sizeof(PackSlot) * slots.size();
+	header.namesSize = names.size();
+	header.fileSize = header.namesOffset + header.namesSize;
+
+	FILE* file = fopen(path, "wb");
+	if (nullptr == file) {
+		return false;
+	}
+
+	// Everything is written sequentially, i.e., the position is tracked here instead of querying it with ftell,
+	// whose long result cannot represent offsets beyond 2 GiB where long has 32 bits (e.g., on Windows):
+	bool success = true;
+	uint64_t current = 0;
+	auto write_at = [&](uint64_t position, const void* data, size_t size) {
+		static const uint8_t zeros[kAlignment] = {};
+		// Pad up to the given position:
+		while (success && current < position) {
+			const size_t n = static_cast<size_t>(std::min<uint64_t>(kAlignment, position - current));
+			success = fwrite(zeros, 1, n, file) == n;
+			current += n;
+		}
+		if (success && size > 0) {
+			success = fwrite(data, 1, size, file) == size;
+			current += size;
+		}
+	};
+
+	write_at(0, &header, sizeof(PackHeader));
+	for (size_t e = 0; e < entries.size(); ++e) {
+		write_at(offsets[e], entries[e].data.data(), entries[e].data.size());
+	}
+	write_at(header.slotsOffset, slots.data(), sizeof(PackSlot) * slots.size());
+	write_at(header.namesOffset, names.data(), names.size());
+
+	success = (0 == fclose(file)) && success;
+	return success;
+}
+
+bool packOpenArchive(const char* path, PackArchive& archive)
+{
+	archive = {};
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == file) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (nullptr == mapping) {
+		CloseHandle(file);
+		return false;
+	}
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (nullptr == data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	archive.data = static_cast<const uint8_t*>(data);
+	archive.size = static_cast<size_t>(file_size.QuadPart);
+	archive.fileHandle = file;
+	archive.mappingHandle = mapping;
+#else
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping stays valid after closing the file descriptor
+	if (MAP_FAILED == data) {
+		return false;
+	}
+	archive.data = static_cast<const uint8_t*>(data);
+	archive.size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+	// Validate the header, so that packFind can rely on it:
+	PackHeader header;
+	bool valid = archive.size >= sizeof(PackHeader);
+	if (valid) {
+		memcpy(&header, archive.data, sizeof(PackHeader));
+		valid = 0 == memcmp(header.magic, kMagic, sizeof(kMagic))
+			&& kVersion == header.version
+			&& header.fileSize == archive.size
+			&& header.slotCount > 0u && 0u == (header.slotCount & (header.slotCount - 1u))
+			&& header.slotsOffset + sizeof(PackSlot) * static_cast<uint64_t>(header.slotCount) <= header.namesOffset
+			&& header.namesOffset + header.namesSize <= archive.size;
+	}
+	if (!valid) {
+		packCloseArchive(archive);
+		return false;
+	}
+	return true;
+}
+
+void packCloseArchive(PackArchive& archive)
+{
+	if (nullptr == archive.data) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(archive.data);
+	CloseHandle(static_cast<HANDLE>(archive.mappingHandle));
+	CloseHandle(static_cast<HANDLE>(archive.fileHandle));
+#else
+	munmap(const_cast<uint8_t*>(archive.data), archive.size);
+#endif
+	archive = {};
+}
+
+PackSpan packFind(const PackArchive& archive, const char* name)
+{
+	PackSpan span = {};
+	if (nullptr == archive.data) {
+		return span;
+	}
+
+	PackHeader header;
+	memcpy(&header, archive.data, sizeof(PackHeader));
+	const PackSlot* slots = reinterpret_cast<const PackSlot*>(archive.data + header.slotsOffset);
+	const char* names = reinterpret_cast<const char*>(archive.data + header.namesOffset);
+
+	const size_t length = strlen(name);
+	const uint64_t hash = hashFnv1a(name, length);
+	const uint32_t mask = header.slotCount - 1u;
+	for (uint32_t i = static_cast<uint32_t>(hash) & mask, probes = 0u; slots[i].used && probes < header.slotCount; i = (i + 1u) & mask, ++probes) {
+		const PackSlot& slot = slots[i];
+		if (slot.hash != hash || slot.nameLength != length
+			|| static_cast<uint64_t>(slot.nameOffset) + slot.nameLength > header.namesSize
+			|| 0 != memcmp(names + slot.nameOffset, name, length)) {
+			continue;
+		}
+		if (slot.offset + slot.size > header.slotsOffset) {
+			return span; // Corrupt entry
+		}
+		span.data = archive.data + slot.offset;
+		span.size = static_cast<size_t>(slot.size);
+		span.type = static_cast<PackEntryType>(slot.type);
+		return span;
+	}
+	return span;
+}
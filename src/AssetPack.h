@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Asset Pack Struct Definitions
+// As a convention, their names start with `Pack`.
+/* --------------------------------------------- */
+
+/*!
+ * Describes how the data of an entry is to be interpreted.
+ */
+enum PackEntryType : uint32_t {
+	//! Bytes of the source file, unmodified (e.g., license texts)
+	PACK_ENTRY_RAW      = 0,
+	//! Geometry encoded with codecEncodeGeometry; decode with codecDecodeGeometry or codecCreateGeometryAndBuffers.
+	PACK_ENTRY_GEOMETRY = 1,
+	//! A DDS image file, unmodified
+	PACK_ENTRY_DDS      = 2,
+};
+
+/*!
+ * An entry to be written into an archive by packWriteArchive.
+ */
+struct PackWriterEntry {
+	//! The name under which the entry can be found, e.g., "vespa/vespa.obj"
+	std::string name;
+
+	//! How the data is to be interpreted
+	PackEntryType type;
+
+	//! The entry's data
+	std::vector<uint8_t> data;
+};
+
+/*!
+ * A view onto an entry's data inside a memory-mapped archive. The data stays valid as long as the archive is open.
+ */
+struct PackSpan {
+	//! Pointer to the first byte of the entry, or nullptr if no such entry exists. Aligned to 256 bytes.
+	const uint8_t* data;
+
+	//! Size of the entry in bytes
+	size_t size;
+
+	//! How the data is to be interpreted
+	PackEntryType type;
+};
+
+/*!
+ * An archive which has been opened with packOpenArchive.
+ */
+struct PackArchive {
+	//! The whole archive file, mapped into memory
+	const uint8_t* data;
+
+	//! The size of the archive file in bytes
+	size_t size;
+
+	//! Platform-specific handles of the file and its mapping
+	void* fileHandle;
+	void* mappingHandle;
+};
+
+/* --------------------------------------------- */
+// Asset Pack Function Definitions
+// As a convention, their names start with `pack`.
+/* --------------------------------------------- */
+
+/*!
+ *	Writes the given entries into one archive file. Every entry's data is aligned to 256 bytes, so that it can be
+ *	copied into (or used as) upload memory directly. Entries are found through a hash table of contents.
+ *	@param		path		Path of the archive file to be written
+ *	@param		entries		The entries to be written; their names must be unique.
+ *	@return		True on success, false if a name occurs more than once (nothing is written then) or the file could not be written.
+ */
+bool packWriteArchive(const char* path, const std::vector<PackWriterEntry>& entries);
+
+/*!
+ *	Opens an archive by mapping the whole file into memory at once.
+ *	@param		path		Path of the archive file
+ *	@param		archive		Receives the opened archive
+ *	@return		True on success, false if the file could not be opened/mapped or is not a valid archive.
+ */
+bool packOpenArchive(const char* path, PackArchive& archive);
+
+/*!
+ *	Unmaps an archive which was opened with packOpenArchive. All spans returned by packFind become invalid.
+ */
+void packCloseArchive(PackArchive& archive);
+
+/*!
+ *	Looks up an entry by name in constant time.
+ *	@param		archive		An archive opened with packOpenArchive
+ *	@param		name		The entry's name, e.g., "cubemap/posx.dds"
+ *	@return		A span of the entry's data; PackSpan::data is nullptr if there is no entry with the given name.
+ */
+PackSpan packFind(const PackArchive& archive, const char* name);
@@ -0,0 +1,766 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+
+// Deterministic microbenchmarks of CPU hot paths, which run without a GPU: teapot geometry generation, OBJ parsing,
+// index and vertex processing, geometry decoding and encoded sizes (compared to zlib, if found), BVH construction and ray queries, hierarchical-Z occlusion culling, draw queue sorting and bind counts, DDS parsing, texture block compression, and the hlp* create info helpers.
+// Every benchmark runs a fixed number of iterations on fixed inputs, and reports the minimum and median time per iteration
+// and a checksum of its results. Results are written as JSON, and compared against a baseline JSON file if one is given.
+// Usage: VulkanLaunchpadBench [results JSON] [baseline JSON] [regression threshold in percent]
+//        Defaults to "bench_results.json", no baseline, and 10 %. Returns EXIT_FAILURE if any benchmark regressed.
+
+// Include our framework (for loading OBJ files) and local helpers:
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include "Hash.h"
+#include "Teapot.h"
+#include "AssetPack.h"
+#include "DdsImage.h"
+#include "BlockCompression.h"
+#include "GeometryCodec.h"
+#include "MeshLod.h"
+#include "Bvh.h"
+#include "OcclusionCulling.h"
+#include "SoftwareRasterizer.h"
+#include "DrawQueue.h"
+#ifdef BENCH_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+// Include functionality from the standard library:
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* ------------------------------------------------ */
+// Some little helpers directly declared here:
+/* ------------------------------------------------ */
+
+/*!
+ *	Result of one benchmark. Times are per iteration.
+ */
+struct BenchResult {
+	std::string name;
+	uint32_t iterations;
+	uint32_t repetitions;
+	double minNanoseconds;
+	double medianNanoseconds;
+	double meanNanoseconds;
+
+	//! Items (e.g., triangles or bytes) processed per second, based on the median
+	double itemsPerSecond;
+	std::string itemUnit;
+
+	//! Hash of the benchmark's results, which must not change between runs or commits unless the output changes
+	uint64_t checksum;
+};
+
+/*!
+ *	Runs `body` for `repetitions` times `iterations` times after one warm-up iteration, and measures the time of every
+ *	repetition. `body` returns a checksum of its results, which must be the same for every invocation.
+ */
+BenchResult runBenchmark(const std::string& name, uint32_t iterations, uint32_t repetitions, double items_per_iteration,
+	const std::string& item_unit, const std::function<uint64_t()>& body);
+
+/*!
+ *	Hashes the contents of a vector, see hashFnv1a.
+ */
+template <typename T>
+uint64_t hashVector(const std::vector<T>& values, uint64_t hash = kHashFnv1aSeed)
+{
+	return hashFnv1a(values.data(), values.size() * sizeof(T), hash);
+}
+
+/*!
+ *	Reads the whole file at the given path into memory.
+ */
+std::vector<uint8_t> readFileBytes(const std::filesystem::path& path);
+
+/*!
+ *	Creates the rays of a pinhole camera with resolution x resolution pixels, which looks at the center of the given
+ *	positions' bounds from outside, so that the bounds fill the view. Rays are ordered by 2x2 pixel quads.
+ */
+std::vector<BvhRay> createCameraRays(const std::vector<glm::vec3>& positions, uint32_t resolution);
+
+/*!
+ *	Creates rays from random points around the given positions' bounds towards random points inside them.
+ */
+std::vector<BvhRay> createRandomRays(const std::vector<glm::vec3>& positions, uint32_t count);
+
+/*!
+ *	Escapes quotes, backslashes and control characters, so that the string can be written as a JSON string.
+ */
+std::string escapeJson(const std::string& value);
+
+/*!
+ *	Reverses escapeJson.
+ */
+std::string unescapeJson(const std::string& value);
+
+/*!
+ *	Writes the results as JSON, with one benchmark per line.
+ */
+std::string escapeJson(const std::string& value)
+{
+	std::string escaped;
+	escaped.reserve(value.size());
+	for (const char c : value) {
+		switch (c) {
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\r': escaped += "\\r"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char code[7];
+				std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(c));
+				escaped += code;
+			}
+			else {
+				escaped += c;
+			}
+		}
+	}
+	return escaped;
+}
+
+std::string unescapeJson(const std::string& value)
+{
+	std::string unescaped;
+	unescaped.reserve(value.size());
+	for (size_t i = 0; i < value.size(); ++i) {
+		if ('\\' != value[i] || i + 1 == value.size()) {
+			unescaped += value[i];
+			continue;
+		}
+		const char c = value[++i];
+		switch (c) {
+		case 'n': unescaped += '\n'; break;
+		case 'r': unescaped += '\r'; break;
+		case 't': unescaped += '\t'; break;
+		case 'b': unescaped += '\b'; break;
+		case 'f': unescaped += '\f'; break;
+		case 'u':
+			// escapeJson only writes control characters this way:
+			if (i + 4 < value.size()) {
+				unescaped += static_cast<char>(std::stoul(value.substr(i + 1, 4), nullptr, 16));
+				i += 4;
+			}
+			break;
+		default: unescaped += c; // Quotes, backslashes and slashes
+		}
+	}
+	return unescaped;
+}
+
+bool writeResults(const std::string& path, const std::vector<BenchResult>& results);
+
+/*!
+ *	Reads results which have been written with writeResults.
+ */
+std::vector<BenchResult> readResults(const std::string& path);
+
+/*!
+ *	Logs every benchmark's change compared to the baseline, and returns the number of regressions,
+ *	i.e., benchmarks whose minimum time increased by more than the threshold or whose checksum changed.
+ *	The minimum is compared since it is least affected by other processes competing for the CPU.
+ */
+uint32_t reportRegressions(const std::vector<BenchResult>& results, const std::vector<BenchResult>& baseline, double threshold_percent);
+
+/* ------------------------------------------------ */
+// Main
+/* ------------------------------------------------ */
+
+int main(int argc, char** argv)
+{
+	const std::string results_path = argc > 1 ? argv[1] : "bench_results.json";
+	const std::string baseline_path = argc > 2 ? argv[2] : "";
+	const double threshold_percent = argc > 3 ? std::stod(argv[3]) : 10.0;
+
+	std::vector<BenchResult> results;
+
+	// Teapot geometry generation:
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		teapotGetGeometryData(positions, indices);
+		results.push_back(runBenchmark("teapot/get_geometry_data", 20, 9, static_cast<double>(indices.size() / 3), "triangles", [] {
+			std::vector<glm::vec3> positions;
+			std::vector<uint32_t> indices;
+			teapotGetGeometryData(positions, indices);
+			return hashVector(indices, hashVector(positions));
+		}));
+	}
+
+	// OBJ parsing of every model in assets/, sorted by path so that the order is deterministic:
+	std::vector<std::filesystem::path> obj_paths;
+	if (std::filesystem::is_directory("assets")) {
+		for (const auto& directory_entry : std::filesystem::recursive_directory_iterator("assets")) {
+			if (directory_entry.is_regular_file() && ".obj" == directory_entry.path().extension()) {
+				obj_paths.push_back(directory_entry.path());
+			}
+		}
+	}
+	std::sort(obj_paths.begin(), obj_paths.end());
+	if (obj_paths.empty()) {
+		VKL_LOG("WARNING: No OBJ files found in \"assets\". Run the benchmarks from the repository's root directory.");
+	}
+	std::map<std::string, VklGeometryData> models;
+	for (const std::filesystem::path& path : obj_paths) {
+		const std::string name = path.lexically_relative("assets").generic_string();
+		VklGeometryData& model = models[name];
+		model = vklLoadModelGeometry(path.string());
+		results.push_back(runBenchmark("obj/load/" + name, 3, 5, static_cast<double>(std::filesystem::file_size(path)), "bytes", [path] {
+			const VklGeometryData geometry = vklLoadModelGeometry(path.string());
+			return hashVector(geometry.indices, hashVector(geometry.textureCoordinates, hashVector(geometry.normals, hashVector(geometry.positions))));
+		}));
+	}
+
+	// Index and vertex processing of the teapot and of every model:
+	std::vector<std::pair<std::string, VklGeometryData>> meshes;
+	{
+		VklGeometryData teapot;
+		teapotGetGeometryData(teapot.positions, teapot.indices);
+		meshes.emplace_back("teapot", std::move(teapot));
+	}
+	for (auto& model : models) {
+		meshes.emplace_back(model.first, model.second);
+	}
+	for (const auto& mesh : meshes) {
+		const std::vector<glm::vec3>& positions = mesh.second.positions;
+		const std::vector<uint32_t>& indices = mesh.second.indices;
+		const double triangles = static_cast<double>(indices.size() / 3);
+
+		results.push_back(runBenchmark("vertex/compute_normals/" + mesh.first, 10, 9, triangles, "triangles", [&] {
+			return hashVector(rasterComputeVertexNormals(positions, indices));
+		}));
+
+		const std::vector<uint8_t> encoded_indices = codecEncodeIndices(indices.data(), indices.size());
+		results.push_back(runBenchmark("index/encode/" + mesh.first, 10, 9, triangles, "triangles", [&] {
+			return hashVector(codecEncodeIndices(indices.data(), indices.size()));
+		}));
+		std::vector<uint32_t> decoded_indices(indices.size());
+		results.push_back(runBenchmark("index/decode/" + mesh.first, 10, 9, triangles, "triangles", [&] {
+			codecDecodeIndices(encoded_indices.data(), encoded_indices.size(), decoded_indices.data(), decoded_indices.size());
+			return hashVector(decoded_indices);
+		}));
+
+		const std::vector<uint8_t> encoded_positions = codecEncodeVertexStream(positions.data(), positions.size(), sizeof(glm::vec3));
+		const double position_bytes = static_cast<double>(positions.size() * sizeof(glm::vec3));
+		results.push_back(runBenchmark("vertex/encode_positions/" + mesh.first, 10, 9, position_bytes, "bytes", [&] {
+			return hashVector(codecEncodeVertexStream(positions.data(), positions.size(), sizeof(glm::vec3)));
+		}));
+		std::vector<glm::vec3> decoded_positions(positions.size());
+		results.push_back(runBenchmark("vertex/decode_positions/" + mesh.first, 10, 9, position_bytes, "bytes", [&] {
+			codecDecodeVertexStream(encoded_positions.data(), encoded_positions.size(), decoded_positions.data(), decoded_positions.size(), sizeof(glm::vec3));
+			return hashVector(decoded_positions);
+		}));
+
+		results.push_back(runBenchmark("geometry/encode_filtered/" + mesh.first, 3, 5, triangles, "triangles", [&] {
+			return hashVector(codecEncodeGeometry(positions, mesh.second.normals, mesh.second.textureCoordinates, indices,
+				CODEC_FILTER_QUANTIZE_POSITIONS | CODEC_FILTER_OCTAHEDRAL_NORMALS));
+		}));
+
+		// Decoding of whole blobs, and their sizes compared to the raw data as loaded, i.e., float attributes and uint32
+		// indices, and to the raw data compressed with zlib's deflate (which gzip uses as well) if zlib has been found:
+		std::vector<uint8_t> raw;
+		for (const std::pair<const void*, size_t>& stream : std::initializer_list<std::pair<const void*, size_t>>{
+				{ positions.data(), positions.size() * sizeof(glm::vec3) },
+				{ mesh.second.normals.data(), mesh.second.normals.size() * sizeof(glm::vec3) },
+				{ mesh.second.textureCoordinates.data(), mesh.second.textureCoordinates.size() * sizeof(glm::vec2) },
+				{ indices.data(), indices.size() * sizeof(uint32_t) } }) {
+			raw.insert(raw.end(), static_cast<const uint8_t*>(stream.first), static_cast<const uint8_t*>(stream.first) + stream.second);
+		}
+		const std::vector<uint8_t> encoded = codecEncodeGeometry(positions, mesh.second.normals, mesh.second.textureCoordinates, indices);
+		const std::vector<uint8_t> encoded_filtered = codecEncodeGeometry(positions, mesh.second.normals, mesh.second.textureCoordinates, indices,
+			CODEC_FILTER_QUANTIZE_POSITIONS | CODEC_FILTER_OCTAHEDRAL_NORMALS);
+		const auto percent_of_raw = [&raw](size_t size) {
+			return 100.0 * static_cast<double>(size) / static_cast<double>(std::max<size_t>(raw.size(), 1));
+		};
+		std::ostringstream sizes;
+		sizes << std::fixed << std::setprecision(1) << "geometry/size/" << mesh.first << ": raw " << raw.size() << " B, codec " << encoded.size()
+			<< " B (" << percent_of_raw(encoded.size()) << " %), filtered " << encoded_filtered.size() << " B (" << percent_of_raw(encoded_filtered.size()) << " %)";
+
+		CodecGeometryInfo info;
+		if (!codecGetGeometryInfo(encoded.data(), encoded.size(), info)) {
+			VKL_EXIT_WITH_ERROR("Failed to read the header of encoded geometry.");
+		}
+		std::vector<glm::vec3> decoded_vertex_positions(info.vertexCount), decoded_normals(info.hasNormals ? info.vertexCount : 0u);
+		std::vector<glm::vec2> decoded_texture_coordinates(info.hasTextureCoordinates ? info.vertexCount : 0u);
+		std::vector<uint32_t> decoded_geometry_indices(info.indexCount);
+		const double decoded_bytes = static_cast<double>(decoded_vertex_positions.size() * sizeof(glm::vec3) + decoded_normals.size() * sizeof(glm::vec3)
+			+ decoded_texture_coordinates.size() * sizeof(glm::vec2) + decoded_geometry_indices.size() * sizeof(uint32_t));
+		results.push_back(runBenchmark("geometry/decode/" + mesh.first, 10, 9, decoded_bytes, "bytes", [&] {
+			codecDecodeGeometry(encoded.data(), encoded.size(), decoded_vertex_positions.data(), info.hasNormals ? decoded_normals.data() : nullptr,
+				info.hasTextureCoordinates ? decoded_texture_coordinates.data() : nullptr, decoded_geometry_indices.data());
+			return hashVector(decoded_geometry_indices, hashVector(decoded_texture_coordinates, hashVector(decoded_normals, hashVector(decoded_vertex_positions))));
+		}));
+
+#ifdef BENCH_HAS_ZLIB
+		std::vector<uint8_t> deflated(compressBound(static_cast<uLong>(raw.size())));
+		uLongf deflated_size = static_cast<uLongf>(deflated.size());
+		if (Z_OK != compress2(deflated.data(), &deflated_size, raw.data(), static_cast<uLong>(raw.size()), Z_BEST_COMPRESSION)) {
+			VKL_EXIT_WITH_ERROR("Failed to compress geometry with zlib.");
+		}
+		deflated.resize(deflated_size);
+		sizes << ", zlib -9 " << deflated.size() << " B (" << percent_of_raw(deflated.size()) << " %)";
+		std::vector<uint8_t> inflated(raw.size());
+		results.push_back(runBenchmark("zlib/uncompress/" + mesh.first, 10, 9, static_cast<double>(raw.size()), "bytes", [&] {
+			uLongf inflated_size = static_cast<uLongf>(inflated.size());
+			uncompress(inflated.data(), &inflated_size, deflated.data(), static_cast<uLong>(deflated.size()));
+			return hashVector(inflated);
+		}));
+#endif
+		VKL_LOG(sizes.str());
+
+		results.push_back(runBenchmark("index/lod_chain/" + mesh.first, 1, 3, triangles, "triangles", [&] {
+			const LodChain chain = lodGenerateChain(positions, mesh.second.normals, mesh.second.textureCoordinates, indices);
+			return hashVector(chain.indices, static_cast<uint64_t>(chain.levels.size()));
+		}));
+
+		// BVH construction and ray queries (on the calling thread, like all benchmarks):
+		BvhBuildStats bvh_stats;
+		const Bvh bvh = bvhBuild(positions, indices, &bvh_stats);
+		bvhLogStats(("bvh/build/" + mesh.first).c_str(), bvh_stats);
+		results.push_back(runBenchmark("bvh/build/" + mesh.first, 3, 5, triangles, "triangles", [&] {
+			const Bvh built = bvhBuild(positions, indices);
+			return hashVector(built.packets, hashVector(built.nodes));
+		}));
+		const std::vector<BvhRay> camera_rays = createCameraRays(positions, 256);
+		const std::vector<BvhRay> random_rays = createRandomRays(positions, 65536);
+		std::vector<BvhHit> hits(camera_rays.size());
+		results.push_back(runBenchmark("bvh/intersect_camera_packets/" + mesh.first, 3, 9, static_cast<double>(camera_rays.size()), "rays", [&] {
+			bvhIntersectRayPackets(bvh, camera_rays.data(), static_cast<uint32_t>(camera_rays.size()), hits.data());
+			return hashVector(hits);
+		}));
+		results.push_back(runBenchmark("bvh/intersect_camera/" + mesh.first, 3, 9, static_cast<double>(camera_rays.size()), "rays", [&] {
+			bvhIntersectRays(bvh, camera_rays.data(), static_cast<uint32_t>(camera_rays.size()), hits.data());
+			return hashVector(hits);
+		}));
+		hits.resize(random_rays.size());
+		results.push_back(runBenchmark("bvh/intersect_random/" + mesh.first, 3, 9, static_cast<double>(random_rays.size()), "rays", [&] {
+			bvhIntersectRays(bvh, random_rays.data(), static_cast<uint32_t>(random_rays.size()), hits.data());
+			return hashVector(hits);
+		}));
+	}
+
+	// Hierarchical-Z pyramid of a synthetic 1280x720 depth buffer (a wall close to the camera covering the left half, and
+	// a wall in the distance with a gap in its center covering the right half), and occlusion culling of a 64x64 grid of boxes against it:
+	{
+		const uint32_t width = 1280, height = 720;
+		std::vector<float> depth(static_cast<size_t>(width) * height);
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				const bool gap = x >= width * 3 / 4 - 64 && x < width * 3 / 4 + 64;
+				depth[static_cast<size_t>(y) * width + x] = x < width / 2 ? 0.9f : (gap ? 1.0f : 0.9995f);
+			}
+		}
+		OccDepthPyramid pyramid;
+		std::vector<float> texels;
+		results.push_back(runBenchmark("occlusion/build_pyramid", 10, 9, static_cast<double>(depth.size()), "pixels", [&] {
+			occBuildDepthPyramidOnCpu(depth.data(), width, height, pyramid, texels);
+			return hashVector(texels);
+		}));
+
+		glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), static_cast<float>(width) / height, 0.1f, 100.0f);
+		projection[1][1] *= -1.0f;
+		const glm::mat4 view_projection = projection * glm::lookAt(glm::vec3(0.0f, 4.0f, 8.0f), glm::vec3(0.0f, 0.0f, -16.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		std::vector<OccInstance> instances;
+		for (uint32_t z = 0; z < 64; ++z) {
+			for (uint32_t x = 0; x < 64; ++x) {
+				const glm::vec3 center(static_cast<float>(x) - 31.5f, 0.5f, -static_cast<float>(z));
+				instances.push_back(OccInstance{ view_projection, center - glm::vec3(0.4f), center + glm::vec3(0.4f) });
+			}
+		}
+		std::vector<uint8_t> visible(instances.size());
+		occLogStats(occCullInstances(&pyramid, instances.data(), static_cast<uint32_t>(instances.size()), visible.data()));
+		results.push_back(runBenchmark("occlusion/cull_instances", 10, 9, static_cast<double>(instances.size()), "instances", [&] {
+			occCullInstances(&pyramid, instances.data(), static_cast<uint32_t>(instances.size()), visible.data());
+			return hashVector(visible);
+		}));
+	}
+
+	// DDS parsing of the cubemap's faces:
+	std::vector<std::vector<uint8_t>> dds_files;
+	for (const char* face : { "posx", "negx", "posy", "negy", "posz", "negz" }) {
+		const std::filesystem::path path = std::filesystem::path("assets/cubemap") / (std::string(face) + ".dds");
+		if (std::filesystem::is_regular_file(path)) {
+			dds_files.push_back(readFileBytes(path));
+		}
+	}
+	if (!dds_files.empty()) {
+		results.push_back(runBenchmark("dds/parse/cubemap", 10000, 9, static_cast<double>(dds_files.size()), "files", [&] {
+			uint64_t hash = kHashFnv1aSeed;
+			DdsImageInfo info;
+			for (const std::vector<uint8_t>& file : dds_files) {
+				if (!ddsParse(file.data(), file.size(), info)) {
+					VKL_EXIT_WITH_ERROR("Failed to parse a cubemap face.");
+				}
+				hash = hashVector(info.subresources, hashFnv1a(&info.format, sizeof(info.format), hash));
+			}
+			return hash;
+		}));
+
+		// Block compression of the first face, decoded to RGBA8 (runs on the calling thread, since no job system is started):
+		BcRgbaTexture face;
+		if (!bcDecodeDds(dds_files[0].data(), dds_files[0].size(), face)) {
+			VKL_EXIT_WITH_ERROR("Failed to decode a cubemap face.");
+		}
+		results.push_back(runBenchmark("dds/decode/cubemap_face", 10, 9, static_cast<double>(face.texels.size() / 4), "texels", [&] {
+			BcRgbaTexture decoded;
+			bcDecodeDds(dds_files[0].data(), dds_files[0].size(), decoded);
+			return hashVector(decoded.texels);
+		}));
+		const std::pair<BcFormat, const char*> formats[] = { { BC_FORMAT_BC1, "bc1" }, { BC_FORMAT_BC3, "bc3" }, { BC_FORMAT_BC7, "bc7" } };
+		const std::pair<BcPreset, const char*> presets[] = { { BC_PRESET_FAST, "fast" }, { BC_PRESET_QUALITY, "quality" } };
+		for (const auto& format : formats) {
+			for (const auto& preset : presets) {
+				const std::string name = std::string("bc/encode_") + format.second + "_" + preset.second + "/cubemap_face";
+				BcStats stats;
+				bcEncodeTexture(face, format.first, preset.first, &stats);
+				bcLogStats(name.c_str(), stats);
+				results.push_back(runBenchmark(name, 1, 5, static_cast<double>(face.texels.size() / 4), "texels", [&] {
+					return hashVector(bcEncodeTexture(face, format.first, preset.first));
+				}));
+			}
+		}
+	}
+
+	// Asset pack lookups of the scene's entries, if the archive has been cooked (see VulkanLaunchpadCooker):
+	PackArchive archive = {};
+	if (packOpenArchive("assets.pack", archive)) {
+		const char* names[] = {
+			"vespa/vespa.obj", "sphere/sphere.obj", "cube/cube.obj",
+			"cubemap/posx.dds", "cubemap/negx.dds", "cubemap/posy.dds", "cubemap/negy.dds", "cubemap/posz.dds", "cubemap/negz.dds",
+			"missing/entry.obj"
+		};
+		const size_t name_count = sizeof(names) / sizeof(names[0]);
+		results.push_back(runBenchmark("pack/find", 100000, 9, static_cast<double>(name_count), "lookups", [&] {
+			uint64_t hash = kHashFnv1aSeed;
+			for (const char* name : names) {
+				const PackSpan span = packFind(archive, name);
+				// Offsets instead of pointers, since the mapping's address differs between runs:
+				const uint64_t offset = nullptr == span.data ? 0 : static_cast<uint64_t>(span.data - archive.data);
+				hash = hashFnv1a(&offset, sizeof(offset), hashFnv1a(&span.size, sizeof(span.size), hash));
+			}
+			return hash;
+		}));
+		packCloseArchive(archive);
+	}
+
+	// hlp* create info helpers (the hlp* functions which query the driver need a device and are not measured here):
+	{
+		// Non-dispatchable handles are 64 bit integers on 32 bit platforms, hence a C-style cast:
+		const VkImage image = (VkImage)1;
+		results.push_back(runBenchmark("hlp/get_create_infos", 100000, 9, 3.0, "create infos", [&] {
+			const VkImageViewCreateInfo view = hlpGetImageViewCreateInfo(image, VK_FORMAT_R8G8B8A8_SRGB);
+			const VkImageViewCreateInfo cube_view = hlpGetCubeImageViewCreateInfo(image, VK_FORMAT_BC2_UNORM_BLOCK, 9);
+			const VkSamplerCreateInfo sampler = hlpGetSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
+			return static_cast<uint64_t>(view.viewType) + cube_view.subresourceRange.levelCount + static_cast<uint64_t>(sampler.magFilter);
+		}));
+	}
+
+	// Draw queue: 4096 draws of 32 meshes with 8 pipelines and 64 descriptor sets, pushed in a fixed pseudo-random order.
+	// Sorting and counting binds runs without a GPU (handles are fake); the counts are logged in submission order and sorted:
+	{
+		const uint32_t draw_count = 4096, pipeline_count = 8, descriptor_set_count = 64, mesh_count = 32;
+		std::vector<HlpGeometryHandles> geometries(mesh_count);
+		for (uint32_t i = 0; i < mesh_count; ++i) {
+			// Non-dispatchable handles are 64 bit integers on 32 bit platforms, hence C-style casts:
+			geometries[i].positionsBuffer = (VkBuffer)(uintptr_t)(3 * i + 1);
+			geometries[i].normalsBuffer = (VkBuffer)(uintptr_t)(3 * i + 2);
+			geometries[i].indicesBuffer = (VkBuffer)(uintptr_t)(3 * i + 3);
+			geometries[i].indexType = VK_INDEX_TYPE_UINT32;
+			geometries[i].numberOfIndices = 3;
+		}
+		uint32_t state = 12345u;
+		const auto random = [&state](uint32_t count) {
+			state = state * 1664525u + 1013904223u;
+			return (state >> 8) % count;
+		};
+		std::vector<DrawItem> items(draw_count);
+		for (uint32_t i = 0; i < draw_count; ++i) {
+			const uint32_t pipeline = random(pipeline_count), descriptor_set = random(descriptor_set_count), mesh = random(mesh_count);
+			const float view_depth = static_cast<float>(random(1000)) * 0.1f;
+			items[i] = { drawMakeSortKey(pipeline, descriptor_set, mesh, view_depth, 100.0f), (VkPipeline)(uintptr_t)(pipeline + 1),
+				(VkDescriptorSet)(uintptr_t)(descriptor_set + 1), &geometries[mesh], 0u, 0u, VK_NULL_HANDLE, 0u, nullptr, 0u };
+		}
+
+		DrawQueue queue;
+		for (uint32_t i = 0; i < draw_count; ++i) {
+			DrawItem item = items[i];
+			item.sortKey = i;
+			drawQueuePush(queue, item);
+		}
+		drawQueueSort(queue);
+		VKL_LOG("draw/count_binds in submission order:");
+		drawLogQueueStats(drawQueueCountBinds(queue));
+		queue = {};
+		for (const DrawItem& item : items) {
+			drawQueuePush(queue, item);
+		}
+		drawQueueSort(queue);
+		VKL_LOG("draw/count_binds sorted:");
+		drawLogQueueStats(drawQueueCountBinds(queue));
+
+		results.push_back(runBenchmark("draw/sort_and_count_binds", 100, 9, static_cast<double>(draw_count), "draws", [&] {
+			queue.items.clear();
+			for (const DrawItem& item : items) {
+				drawQueuePush(queue, item);
+			}
+			drawQueueSort(queue);
+			const DrawQueueStats stats = drawQueueCountBinds(queue);
+			return hashVector(queue.order, static_cast<uint64_t>(stats.pipelineBinds + stats.descriptorSetBinds + stats.vertexBufferBinds + stats.indexBufferBinds));
+		}));
+	}
+
+	for (const BenchResult& result : results) {
+		VKL_LOG(std::left << std::setw(48) << result.name << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+			<< result.medianNanoseconds << " ns (min " << result.minNanoseconds << ", mean " << result.meanNanoseconds << "), "
+			<< std::setprecision(3) << result.itemsPerSecond * 1e-6 << " M " << result.itemUnit << "/s" << std::defaultfloat);
+	}
+
+	if (!writeResults(results_path, results)) {
+		VKL_EXIT_WITH_ERROR("Failed to write results to \"" << results_path << "\".");
+	}
+	VKL_LOG("Wrote " << results.size() << " results to \"" << results_path << "\"");
+
+	if (!baseline_path.empty()) {
+		const std::vector<BenchResult> baseline = readResults(baseline_path);
+		if (baseline.empty()) {
+			VKL_EXIT_WITH_ERROR("No results found in baseline \"" << baseline_path << "\".");
+		}
+		const uint32_t regressions = reportRegressions(results, baseline, threshold_percent);
+		if (regressions > 0) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------ */
+// Definitions of little helpers defined above main:
+/* ------------------------------------------------ */
+
+BenchResult runBenchmark(const std::string& name, uint32_t iterations, uint32_t repetitions, double items_per_iteration,
+	const std::string& item_unit, const std::function<uint64_t()>& body)
+{
+	BenchResult result = {};
+	result.name = name;
+	result.iterations = iterations;
+	result.repetitions = repetitions;
+	result.itemUnit = item_unit;
+	result.checksum = body(); // Warm-up
+
+	std::vector<double> nanoseconds(repetitions);
+	for (uint32_t repetition = 0; repetition < repetitions; ++repetition) {
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+			if (body() != result.checksum) {
+				VKL_EXIT_WITH_ERROR("Benchmark \"" << name << "\" is not deterministic: its checksum changed between iterations.");
+			}
+		}
+		const auto end = std::chrono::steady_clock::now();
+		nanoseconds[repetition] = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+	}
+
+	std::sort(nanoseconds.begin(), nanoseconds.end());
+	result.minNanoseconds = nanoseconds.front();
+	result.medianNanoseconds = nanoseconds[nanoseconds.size() / 2];
+	for (double value : nanoseconds) {
+		result.meanNanoseconds += value / repetitions;
+	}
+	result.itemsPerSecond = result.medianNanoseconds > 0.0 ? items_per_iteration / (result.medianNanoseconds * 1e-9) : 0.0;
+	return result;
+}
+
+std::vector<uint8_t> readFileBytes(const std::filesystem::path& path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream) {
+		VKL_EXIT_WITH_ERROR("Unable to open \"" << path.string() << "\".");
+	}
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+std::vector<BvhRay> createCameraRays(const std::vector<glm::vec3>& positions, uint32_t resolution)
+{
+	glm::vec3 lo(std::numeric_limits<float>::max());
+	glm::vec3 hi(-std::numeric_limits<float>::max());
+	for (const glm::vec3& position : positions) {
+		lo = glm::min(lo, position);
+		hi = glm::max(hi, position);
+	}
+	const glm::vec3 center = (lo + hi) * 0.5f;
+	const float radius = glm::length(hi - lo) * 0.5f;
+
+	// Look at the center from a fixed direction, far enough away that the bounding sphere fits into a 60 degree field of view:
+	const glm::vec3 forward = glm::normalize(glm::vec3(-1.0f, -0.6f, -0.8f));
+	const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 up = glm::cross(right, forward);
+	const glm::vec3 eye = center - forward * (radius * 2.0f);
+	const float extent = std::tan(0.5f * glm::radians(60.0f));
+
+	std::vector<BvhRay> rays;
+	rays.reserve(static_cast<size_t>(resolution) * resolution);
+	for (uint32_t quad_y = 0; quad_y < resolution; quad_y += 2) {
+		for (uint32_t quad_x = 0; quad_x < resolution; quad_x += 2) {
+			for (uint32_t i = 0; i < 4; ++i) {
+				const float x = ((quad_x + (i & 1u) + 0.5f) / resolution * 2.0f - 1.0f) * extent;
+				const float y = ((quad_y + (i >> 1u) + 0.5f) / resolution * 2.0f - 1.0f) * extent;
+				rays.push_back({ eye, glm::normalize(forward + right * x - up * y), 0.0f, std::numeric_limits<float>::max() });
+			}
+		}
+	}
+	return rays;
+}
+
+std::vector<BvhRay> createRandomRays(const std::vector<glm::vec3>& positions, uint32_t count)
+{
+	glm::vec3 lo(std::numeric_limits<float>::max());
+	glm::vec3 hi(-std::numeric_limits<float>::max());
+	for (const glm::vec3& position : positions) {
+		lo = glm::min(lo, position);
+		hi = glm::max(hi, position);
+	}
+	const glm::vec3 center = (lo + hi) * 0.5f;
+	const float radius = glm::length(hi - lo);
+
+	// A linear congruential generator, so that the rays are the same on every platform:
+	uint32_t state = 12345u;
+	const auto random = [&state] {
+		state = state * 1664525u + 1013904223u;
+		return static_cast<float>(state >> 8) / 16777216.0f;
+	};
+
+	std::vector<BvhRay> rays(count);
+	for (BvhRay& ray : rays) {
+		const glm::vec3 offset(random() * 2.0f - 1.0f, random() * 2.0f - 1.0f, random() * 2.0f - 1.0f);
+		ray.origin = center + glm::normalize(offset) * radius;
+		const glm::vec3 target(lo.x + (hi.x - lo.x) * random(), lo.y + (hi.y - lo.y) * random(), lo.z + (hi.z - lo.z) * random());
+		ray.direction = glm::normalize(target - ray.origin);
+		ray.tMin = 0.0f;
+		ray.tMax = std::numeric_limits<float>::max();
+	}
+	return rays;
+}
+
+bool writeResults(const std::string& path, const std::vector<BenchResult>& results)
+{
+	std::ofstream stream(path);
+	if (!stream) {
+		return false;
+	}
+	stream << "{\n  \"benchmarks\": [\n" << std::setprecision(17);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchResult& result = results[i];
+		std::ostringstream checksum;
+		checksum << std::hex << std::setw(16) << std::setfill('0') << result.checksum;
+		stream << "    { \"name\": \"" << escapeJson(result.name) << "\", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+			<< ", \"min_ns\": " << result.minNanoseconds << ", \"median_ns\": " << result.medianNanoseconds << ", \"mean_ns\": " << result.meanNanoseconds
+			<< ", \"items_per_second\": " << result.itemsPerSecond << ", \"item_unit\": \"" << escapeJson(result.itemUnit) << "\", \"checksum\": \"" << checksum.str() << "\" }"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	stream << "  ]\n}\n";
+	return static_cast<bool>(stream);
+}
+
+std::vector<BenchResult> readResults(const std::string& path)
+{
+	std::ifstream stream(path);
+	if (!stream) {
+		VKL_EXIT_WITH_ERROR("Unable to open \"" << path << "\".");
+	}
+
+	const auto find_value = [](const std::string& line, const std::string& key) -> std::string {
+		const std::string pattern = "\"" + key + "\": ";
+		const size_t start = line.find(pattern);
+		if (std::string::npos == start) {
+			return "";
+		}
+		size_t begin = start + pattern.size();
+		if ('"' == line[begin]) {
+			// Find the closing quote, skipping escaped characters:
+			size_t end = ++begin;
+			while (end < line.size() && '"' != line[end]) {
+				end += '\\' == line[end] ? 2 : 1;
+			}
+			return unescapeJson(line.substr(begin, end - begin));
+		}
+		return line.substr(begin, line.find_first_of(",}", begin) - begin);
+	};
+
+	std::vector<BenchResult> results;
+	std::string line;
+	while (std::getline(stream, line)) {
+		const std::string name = find_value(line, "name");
+		if (name.empty()) {
+			continue;
+		}
+		BenchResult result = {};
+		result.name = name;
+		result.medianNanoseconds = std::stod(find_value(line, "median_ns"));
+		result.minNanoseconds = std::stod(find_value(line, "min_ns"));
+		result.checksum = std::stoull(find_value(line, "checksum"), nullptr, 16);
+		results.push_back(result);
+	}
+	return results;
+}
+
+uint32_t reportRegressions(const std::vector<BenchResult>& results, const std::vector<BenchResult>& baseline, double threshold_percent)
+{
+	std::map<std::string, const BenchResult*> baseline_by_name;
+	for (const BenchResult& result : baseline) {
+		baseline_by_name[result.name] = &result;
+	}
+
+	VKL_LOG("Comparison with the baseline (regression threshold " << threshold_percent << " %):");
+	uint32_t regressions = 0;
+	uint32_t improvements = 0;
+	for (const BenchResult& result : results) {
+		const auto it = baseline_by_name.find(result.name);
+		if (baseline_by_name.end() == it) {
+			VKL_LOG("  " << std::left << std::setw(48) << result.name << std::right << " new");
+			continue;
+		}
+		const BenchResult& previous = *it->second;
+		baseline_by_name.erase(it);
+
+		const double change_percent = previous.minNanoseconds > 0.0 ? 100.0 * (result.minNanoseconds / previous.minNanoseconds - 1.0) : 0.0;
+		std::string status = "ok";
+		if (result.checksum != previous.checksum) {
+			status = "CHECKSUM CHANGED (results differ)";
+			++regressions;
+		}
+		else if (change_percent > threshold_percent) {
+			status = "REGRESSION";
+			++regressions;
+		}
+		else if (change_percent < -threshold_percent) {
+			status = "improved";
+			++improvements;
+		}
+		VKL_LOG("  " << std::left << std::setw(48) << result.name << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+			<< previous.minNanoseconds << " ns -> " << std::setw(14) << result.minNanoseconds << " ns (" << std::showpos
+			<< change_percent << std::noshowpos << " %) " << status << std::defaultfloat);
+	}
+	for (const auto& removed : baseline_by_name) {
+		VKL_LOG("  " << std::left << std::setw(48) << removed.first << std::right << " removed");
+	}
+	VKL_LOG(regressions << " regressions, " << improvements << " improvements");
+	return regressions;
+}
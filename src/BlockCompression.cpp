@@ -0,0 +1,894 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Increment whenever the encoded output changes, so that stale cache files are not used anymore:
+	constexpr uint32_t kEncoderVersion = 1u;
+
+	// Block rows per job of bcEncodeTexture:
+	constexpr uint32_t kRowsPerJob = 2u;
+
+	constexpr uint32_t kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// The 16 texels of a 4x4 block, or the entries of a palette, as structure of arrays (in row-major order):
+	struct alignas(16) Block {
+		float r[16];
+		float g[16];
+		float b[16];
+		float a[16];
+	};
+
+	uint32_t blocksPerRow(uint32_t width) { return std::max(1u, (width + 3) / 4); }
+	uint32_t blocksPerColumn(uint32_t height) { return std::max(1u, (height + 3) / 4); }
+
+	uint32_t bytesPerBlock(BcFormat format)
+	{
+		return BC_FORMAT_BC1 == format ? 8u : 16u;
+	}
+
+	void setEntry(Block& block, uint32_t index, const float rgba[4])
+	{
+		block.r[index] = rgba[0];
+		block.g[index] = rgba[1];
+		block.b[index] = rgba[2];
+		block.a[index] = rgba[3];
+	}
+
+	// Finds the nearest palette entry for every texel, and returns the sum of squared errors.
+	// Alpha is only taken into account if with_alpha is true.
+	float fitIndices(const Block& block, const Block& palette, uint32_t palette_size, bool with_alpha, uint8_t indices[16])
+	{
+#if BC_USE_SSE2
+		const __m128 alpha_mask = _mm_castsi128_ps(_mm_set1_epi32(with_alpha ? -1 : 0));
+		__m128 total_error = _mm_setzero_ps();
+		for (uint32_t group = 0; group < 16; group += 4) {
+			const __m128 r = _mm_load_ps(block.r + group);
+			const __m128 g = _mm_load_ps(block.g + group);
+			const __m128 b = _mm_load_ps(block.b + group);
+			const __m128 a = _mm_load_ps(block.a + group);
+			__m128 best_error = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i best_index = _mm_setzero_si128();
+			for (uint32_t i = 0; i < palette_size; ++i) {
+				const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette.r[i]));
+				const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette.g[i]));
+				const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette.b[i]));
+				const __m128 da = _mm_and_ps(_mm_sub_ps(a, _mm_set1_ps(palette.a[i])), alpha_mask);
+				const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best_error));
+				best_error = _mm_min_ps(error, best_error);
+				best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(i))), _mm_andnot_si128(closer, best_index));
+			}
+			alignas(16) int32_t group_indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(group_indices), best_index);
+			for (uint32_t k = 0; k < 4; ++k) {
+				indices[group + k] = static_cast<uint8_t>(group_indices[k]);
+			}
+			total_error = _mm_add_ps(total_error, best_error);
+		}
+		alignas(16) float errors[4];
+		_mm_store_ps(errors, total_error);
+		return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+		float total_error = 0.0f;
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			float best_error = std::numeric_limits<float>::max();
+			for (uint32_t i = 0; i < palette_size; ++i) {
+				const float dr = block.r[texel] - palette.r[i];
+				const float dg = block.g[texel] - palette.g[i];
+				const float db = block.b[texel] - palette.b[i];
+				const float da = with_alpha ? block.a[texel] - palette.a[i] : 0.0f;
+				const float error = dr * dr + dg * dg + db * db + da * da;
+				if (error < best_error) {
+					best_error = error;
+					indices[texel] = static_cast<uint8_t>(i);
+				}
+			}
+			total_error += best_error;
+		}
+		return total_error;
+#endif
+	}
+
+	// Computes endpoints at the extent of the block along its principal axis (of RGB, or of RGBA if channel_count is 4).
+	void computePrincipalEndpoints(const Block& block, uint32_t channel_count, uint32_t power_iterations, float endpoint0[4], float endpoint1[4])
+	{
+		const float* channels[4] = { block.r, block.g, block.b, block.a };
+		float mean[4] = {};
+		float minimum[4], maximum[4];
+		for (uint32_t c = 0; c < 4; ++c) {
+			minimum[c] = *std::min_element(channels[c], channels[c] + 16);
+			maximum[c] = *std::max_element(channels[c], channels[c] + 16);
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				mean[c] += channels[c][texel];
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			for (uint32_t i = 0; i < channel_count; ++i) {
+				for (uint32_t j = i; j < channel_count; ++j) {
+					covariance[i][j] += (channels[i][texel] - mean[i]) * (channels[j][texel] - mean[j]);
+				}
+			}
+		}
+		for (uint32_t i = 0; i < channel_count; ++i) {
+			for (uint32_t j = 0; j < i; ++j) {
+				covariance[i][j] = covariance[j][i];
+			}
+		}
+
+		// Power iteration, starting with the diagonal of the bounding box:
+		float axis[4] = {};
+		for (uint32_t c = 0; c < channel_count; ++c) {
+			axis[c] = maximum[c] - minimum[c];
+		}
+		for (uint32_t iteration = 0; iteration < power_iterations; ++iteration) {
+			float next[4] = {};
+			float length = 0.0f;
+			for (uint32_t i = 0; i < channel_count; ++i) {
+				for (uint32_t j = 0; j < channel_count; ++j) {
+					next[i] += covariance[i][j] * axis[j];
+				}
+				length = std::max(length, std::abs(next[i]));
+			}
+			if (length <= 0.0f) {
+				break;
+			}
+			for (uint32_t c = 0; c < channel_count; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float axis_length_squared = 0.0f;
+		for (uint32_t c = 0; c < channel_count; ++c) {
+			axis_length_squared += axis[c] * axis[c];
+		}
+		float t_min = 0.0f, t_max = 0.0f;
+		if (axis_length_squared > 0.0f) {
+			t_min = std::numeric_limits<float>::max();
+			t_max = -std::numeric_limits<float>::max();
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				float t = 0.0f;
+				for (uint32_t c = 0; c < channel_count; ++c) {
+					t += (channels[c][texel] - mean[c]) * axis[c];
+				}
+				t /= axis_length_squared;
+				t_min = std::min(t_min, t);
+				t_max = std::max(t_max, t);
+			}
+		}
+		for (uint32_t c = 0; c < 4; ++c) {
+			if (c < channel_count) {
+				endpoint0[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+				endpoint1[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+			}
+			else {
+				endpoint0[c] = maximum[c];
+				endpoint1[c] = minimum[c];
+			}
+		}
+	}
+
+	// Solves for the endpoints which minimize the squared error, given the weight of endpoint1 for every texel.
+	// Returns false if the weights do not determine both endpoints.
+	bool fitLeastSquaresEndpoints(const Block& block, uint32_t channel_count, const float weights[16], float endpoint0[4], float endpoint1[4])
+	{
+		const float* channels[4] = { block.r, block.g, block.b, block.a };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			const float w1 = weights[texel];
+			const float w0 = 1.0f - w1;
+			aa += w0 * w0;
+			ab += w0 * w1;
+			bb += w1 * w1;
+			for (uint32_t c = 0; c < channel_count; ++c) {
+				ax[c] += w0 * channels[c][texel];
+				bx[c] += w1 * channels[c][texel];
+			}
+		}
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f) {
+			return false;
+		}
+		for (uint32_t c = 0; c < channel_count; ++c) {
+			endpoint0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+			endpoint1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t packRgb565(const float rgb[4])
+	{
+		const uint32_t r = static_cast<uint32_t>(std::lround(rgb[0] * 31.0f / 255.0f));
+		const uint32_t g = static_cast<uint32_t>(std::lround(rgb[1] * 63.0f / 255.0f));
+		const uint32_t b = static_cast<uint32_t>(std::lround(rgb[2] * 31.0f / 255.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(uint16_t color, uint32_t rgb[3])
+	{
+		const uint32_t r = (color >> 11) & 0x1f, g = (color >> 5) & 0x3f, b = color & 0x1f;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// Palette of a BC1-BC3 color block. The 3-color mode (with transparent black) is only used by BC1 if color0 <= color1.
+	void decodeColorPalette(uint16_t color0, uint16_t color1, bool allow_three_color_mode, uint32_t palette[4][4])
+	{
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		const bool three_color_mode = allow_three_color_mode && color0 <= color1;
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (three_color_mode) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = three_color_mode ? 0 : 255;
+	}
+
+	void decodeColorBlock(const uint8_t* data, bool allow_three_color_mode, uint8_t texels[16][4])
+	{
+		uint16_t color0, color1;
+		uint32_t indices;
+		std::memcpy(&color0, data, 2);
+		std::memcpy(&color1, data + 2, 2);
+		std::memcpy(&indices, data + 4, 4);
+		uint32_t palette[4][4];
+		decodeColorPalette(color0, color1, allow_three_color_mode, palette);
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			const uint32_t index = (indices >> (2 * texel)) & 0x3;
+			for (uint32_t c = 0; c < 4; ++c) {
+				texels[texel][c] = static_cast<uint8_t>(palette[index][c]);
+			}
+		}
+	}
+
+	void decodeAlphaPalette(uint32_t alpha0, uint32_t alpha1, uint32_t palette[8])
+	{
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1) {
+			for (uint32_t i = 2; i < 8; ++i) {
+				palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+			}
+		}
+		else {
+			for (uint32_t i = 2; i < 6; ++i) {
+				palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// Encodes the RGB channels of a block into 8 bytes in 4-color mode, and returns the decoded texels.
+	void encodeColorBlock(const Block& block, BcPreset preset, uint8_t* destination, uint8_t decoded[16][4])
+	{
+		float endpoint0[4], endpoint1[4];
+		computePrincipalEndpoints(block, 3, BC_PRESET_QUALITY == preset ? 8 : 4, endpoint0, endpoint1);
+
+		// Index order of the 4-color mode is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1:
+		static const float kWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float best_error = std::numeric_limits<float>::max();
+		uint16_t best_colors[2] = {};
+		uint8_t best_indices[16] = {};
+		const uint32_t passes = BC_PRESET_QUALITY == preset ? 3 : 1;
+		for (uint32_t pass = 0; pass < passes; ++pass) {
+			uint16_t color0 = packRgb565(endpoint0);
+			uint16_t color1 = packRgb565(endpoint1);
+			if (color0 < color1) {
+				std::swap(color0, color1);
+			}
+			uint32_t palette[4][4];
+			decodeColorPalette(color0, color1, false, palette);
+			Block palette_block;
+			for (uint32_t i = 0; i < 4; ++i) {
+				const float entry[4] = { float(palette[i][0]), float(palette[i][1]), float(palette[i][2]), 255.0f };
+				setEntry(palette_block, i, entry);
+			}
+			uint8_t indices[16];
+			// Equal colors would select the 3-color mode in BC1, whose last entry is transparent => only use the first one:
+			const float error = fitIndices(block, palette_block, color0 == color1 ? 1 : 4, false, indices);
+			if (error < best_error) {
+				best_error = error;
+				best_colors[0] = color0;
+				best_colors[1] = color1;
+				std::memcpy(best_indices, indices, sizeof(indices));
+			}
+			if (0.0f == error || color0 == color1) {
+				break;
+			}
+			float weights[16];
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				weights[texel] = kWeights[indices[texel]];
+			}
+			if (!fitLeastSquaresEndpoints(block, 3, weights, endpoint0, endpoint1)) {
+				break;
+			}
+		}
+
+		uint32_t packed_indices = 0;
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			packed_indices |= static_cast<uint32_t>(best_indices[texel]) << (2 * texel);
+		}
+		std::memcpy(destination, &best_colors[0], 2);
+		std::memcpy(destination + 2, &best_colors[1], 2);
+		std::memcpy(destination + 4, &packed_indices, 4);
+		decodeColorBlock(destination, false, decoded);
+	}
+
+	// Encodes the alpha channel of a block into 8 bytes in 8-value mode, and writes it into the decoded texels.
+	void encodeAlphaBlock(const Block& block, BcPreset preset, uint8_t* destination, uint8_t decoded[16][4])
+	{
+		int32_t alpha0 = static_cast<int32_t>(*std::max_element(block.a, block.a + 16));
+		int32_t alpha1 = static_cast<int32_t>(*std::min_element(block.a, block.a + 16));
+		uint32_t best_error = std::numeric_limits<uint32_t>::max();
+		uint32_t best_alphas[2] = {};
+		uint8_t best_indices[16] = {};
+		const uint32_t passes = BC_PRESET_QUALITY == preset ? 2 : 1;
+		for (uint32_t pass = 0; pass < passes && alpha0 > alpha1; ++pass) {
+			uint32_t palette[8];
+			decodeAlphaPalette(alpha0, alpha1, palette);
+			uint32_t error = 0;
+			uint8_t indices[16];
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				const int32_t alpha = static_cast<int32_t>(block.a[texel]);
+				uint32_t best_texel_error = std::numeric_limits<uint32_t>::max();
+				for (uint32_t i = 0; i < 8; ++i) {
+					const uint32_t texel_error = static_cast<uint32_t>((alpha - static_cast<int32_t>(palette[i])) * (alpha - static_cast<int32_t>(palette[i])));
+					if (texel_error < best_texel_error) {
+						best_texel_error = texel_error;
+						indices[texel] = static_cast<uint8_t>(i);
+					}
+				}
+				error += best_texel_error;
+			}
+			if (error < best_error) {
+				best_error = error;
+				best_alphas[0] = alpha0;
+				best_alphas[1] = alpha1;
+				std::memcpy(best_indices, indices, sizeof(indices));
+			}
+
+			// Least squares refinement; entries 2-7 interpolate from alpha0 to alpha1 in steps of 1/7:
+			float weights[16];
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				weights[texel] = indices[texel] < 2 ? static_cast<float>(indices[texel]) : (indices[texel] - 1) / 7.0f;
+			}
+			float endpoint0[4], endpoint1[4];
+			Block alpha_block;
+			std::memcpy(alpha_block.r, block.a, sizeof(block.a));
+			if (0 == error || !fitLeastSquaresEndpoints(alpha_block, 1, weights, endpoint0, endpoint1)) {
+				break;
+			}
+			alpha0 = static_cast<int32_t>(std::lround(endpoint0[0]));
+			alpha1 = static_cast<int32_t>(std::lround(endpoint1[0]));
+		}
+		if (std::numeric_limits<uint32_t>::max() == best_error) {
+			// All texels have the same alpha value:
+			best_alphas[0] = best_alphas[1] = static_cast<uint32_t>(block.a[0]);
+		}
+
+		uint64_t packed = static_cast<uint64_t>(best_alphas[0]) | (static_cast<uint64_t>(best_alphas[1]) << 8);
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			packed |= static_cast<uint64_t>(best_indices[texel]) << (16 + 3 * texel);
+		}
+		std::memcpy(destination, &packed, 8);
+		uint32_t palette[8];
+		decodeAlphaPalette(best_alphas[0], best_alphas[1], palette);
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			decoded[texel][3] = static_cast<uint8_t>(palette[best_indices[texel]]);
+		}
+	}
+
+	// Quantizes an endpoint to 7 bit per channel plus the p-bit (shared by all channels) which minimizes the error.
+	void quantizeBc7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& p_bit)
+	{
+		float best_error = std::numeric_limits<float>::max();
+		for (uint32_t p = 0; p < 2; ++p) {
+			uint32_t candidate[4];
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c) {
+				candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((endpoint[c] - p) / 2.0f), 0l, 127l));
+				const float difference = static_cast<float>(candidate[c] * 2 + p) - endpoint[c];
+				error += difference * difference;
+			}
+			if (error < best_error) {
+				best_error = error;
+				std::memcpy(quantized, candidate, sizeof(candidate));
+				p_bit = p;
+			}
+		}
+	}
+
+	// Writes bits into a 128 bit block, starting at the least significant bit of the first byte
+	struct BitWriter {
+		uint8_t* destination;
+		uint32_t position;
+
+		void write(uint32_t value, uint32_t bit_count)
+		{
+			for (uint32_t bit = 0; bit < bit_count; ++bit, ++position) {
+				destination[position / 8] |= static_cast<uint8_t>(((value >> bit) & 0x1) << (position % 8));
+			}
+		}
+	};
+
+	// Encodes a block into 16 bytes with BC7 mode 6, i.e., one subset with RGBA endpoints and 4 bit indices.
+	void encodeBc7Block(const Block& block, BcPreset preset, uint8_t* destination, uint8_t decoded[16][4])
+	{
+		float endpoint0[4], endpoint1[4];
+		computePrincipalEndpoints(block, 4, BC_PRESET_QUALITY == preset ? 8 : 4, endpoint0, endpoint1);
+
+		float best_error = std::numeric_limits<float>::max();
+		uint32_t best_endpoints[2][4] = {};
+		uint32_t best_p_bits[2] = {};
+		uint8_t best_indices[16] = {};
+		const uint32_t passes = BC_PRESET_QUALITY == preset ? 3 : 1;
+		for (uint32_t pass = 0; pass < passes; ++pass) {
+			uint32_t quantized[2][4], p_bits[2];
+			quantizeBc7Endpoint(endpoint0, quantized[0], p_bits[0]);
+			quantizeBc7Endpoint(endpoint1, quantized[1], p_bits[1]);
+			Block palette_block;
+			for (uint32_t i = 0; i < 16; ++i) {
+				float entry[4];
+				for (uint32_t c = 0; c < 4; ++c) {
+					const uint32_t value0 = quantized[0][c] * 2 + p_bits[0];
+					const uint32_t value1 = quantized[1][c] * 2 + p_bits[1];
+					entry[c] = static_cast<float>(((64 - kBc7Weights[i]) * value0 + kBc7Weights[i] * value1 + 32) >> 6);
+				}
+				setEntry(palette_block, i, entry);
+			}
+			uint8_t indices[16];
+			const float error = fitIndices(block, palette_block, 16, true, indices);
+			if (error < best_error) {
+				best_error = error;
+				std::memcpy(best_endpoints, quantized, sizeof(quantized));
+				std::memcpy(best_p_bits, p_bits, sizeof(p_bits));
+				std::memcpy(best_indices, indices, sizeof(indices));
+			}
+			if (0.0f == error) {
+				break;
+			}
+			float weights[16];
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				weights[texel] = kBc7Weights[indices[texel]] / 64.0f;
+			}
+			if (!fitLeastSquaresEndpoints(block, 4, weights, endpoint0, endpoint1)) {
+				break;
+			}
+		}
+
+		// The most significant bit of the first texel's index is implicitly 0. Since the weights are symmetric,
+		// swapping the endpoints and inverting the indices yields the same texels:
+		if (best_indices[0] & 0x8) {
+			std::swap(best_endpoints[0], best_endpoints[1]);
+			std::swap(best_p_bits[0], best_p_bits[1]);
+			for (uint8_t& index : best_indices) {
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		std::memset(destination, 0, 16);
+		BitWriter writer{ destination, 0 };
+		writer.write(1u << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c) {
+			writer.write(best_endpoints[0][c], 7);
+			writer.write(best_endpoints[1][c], 7);
+		}
+		writer.write(best_p_bits[0], 1);
+		writer.write(best_p_bits[1], 1);
+		writer.write(best_indices[0], 3);
+		for (uint32_t texel = 1; texel < 16; ++texel) {
+			writer.write(best_indices[texel], 4);
+		}
+
+		for (uint32_t texel = 0; texel < 16; ++texel) {
+			const uint32_t weight = kBc7Weights[best_indices[texel]];
+			for (uint32_t c = 0; c < 4; ++c) {
+				const uint32_t value0 = best_endpoints[0][c] * 2 + best_p_bits[0];
+				const uint32_t value1 = best_endpoints[1][c] * 2 + best_p_bits[1];
+				decoded[texel][c] = static_cast<uint8_t>(((64 - weight) * value0 + weight * value1 + 32) >> 6);
+			}
+		}
+	}
+
+	// Encodes one block row of a subresource, and returns the squared error over all texels which are inside the subresource.
+	uint64_t encodeBlockRow(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t block_row, BcFormat format, BcPreset preset, uint8_t* destination)
+	{
+		uint64_t squared_error = 0;
+		for (uint32_t block_column = 0; block_column < blocksPerRow(width); ++block_column) {
+			Block block;
+			uint8_t source[16][4];
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				const uint32_t x = std::min(block_column * 4 + texel % 4, width - 1);
+				const uint32_t y = std::min(block_row * 4 + texel / 4, height - 1);
+				std::memcpy(source[texel], rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+				const float entry[4] = { float(source[texel][0]), float(source[texel][1]), float(source[texel][2]), float(source[texel][3]) };
+				setEntry(block, texel, entry);
+			}
+
+			uint8_t decoded[16][4];
+			uint8_t* block_destination = destination + static_cast<size_t>(block_column) * bytesPerBlock(format);
+			switch (format) {
+			case BC_FORMAT_BC1:
+				encodeColorBlock(block, preset, block_destination, decoded);
+				break;
+			case BC_FORMAT_BC3:
+				encodeColorBlock(block, preset, block_destination + 8, decoded);
+				encodeAlphaBlock(block, preset, block_destination, decoded);
+				break;
+			default:
+				encodeBc7Block(block, preset, block_destination, decoded);
+				break;
+			}
+
+			for (uint32_t texel = 0; texel < 16; ++texel) {
+				if (block_column * 4 + texel % 4 >= width || block_row * 4 + texel / 4 >= height) {
+					continue;
+				}
+				for (uint32_t c = 0; c < 4; ++c) {
+					const int32_t difference = static_cast<int32_t>(decoded[texel][c]) - static_cast<int32_t>(source[texel][c]);
+					squared_error += static_cast<uint64_t>(difference * difference);
+				}
+			}
+		}
+		return squared_error;
+	}
+
+	void writeUint32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+	{
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	// Writes the header of a DDS file with the DX10 header extension, followed by space for the given number of bytes
+	std::vector<uint8_t> createDdsFile(const BcRgbaTexture& texture, BcFormat format, size_t data_size)
+	{
+		static const uint32_t kDxgiFormats[] = { 28, 71, 77, 98 };
+		std::vector<uint8_t> file(4 + 124 + 20 + data_size, 0);
+		writeUint32(file, 0, 0x20534444u); // "DDS "
+		writeUint32(file, 4, 124);
+		// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT, plus DDSD_LINEARSIZE or DDSD_PITCH:
+		writeUint32(file, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | (BC_FORMAT_NONE == format ? 0x8 : 0x80000));
+		writeUint32(file, 12, texture.height);
+		writeUint32(file, 16, texture.width);
+		writeUint32(file, 20, static_cast<uint32_t>(BC_FORMAT_NONE == format ? texture.width * 4 : ddsGetSubresourceSize(bcGetVkFormat(format), texture.width, texture.height)));
+		writeUint32(file, 28, texture.mipLevelCount);
+		writeUint32(file, 76, 32);
+		writeUint32(file, 80, 0x4); // DDPF_FOURCC
+		writeUint32(file, 84, 0x30315844u); // "DX10"
+		// DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP, and DDSCAPS2_CUBEMAP with all faces:
+		writeUint32(file, 108, 0x8 | 0x1000 | 0x400000);
+		writeUint32(file, 112, texture.isCubemap ? 0xfe00 : 0);
+		writeUint32(file, 128, kDxgiFormats[format]);
+		writeUint32(file, 132, 3); // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		writeUint32(file, 136, texture.isCubemap ? 0x4 : 0);
+		writeUint32(file, 140, texture.isCubemap ? texture.layerCount / 6 : texture.layerCount);
+		return file;
+	}
+
+	const char* formatName(BcFormat format)
+	{
+		switch (format) {
+		case BC_FORMAT_BC1: return "BC1";
+		case BC_FORMAT_BC3: return "BC3";
+		case BC_FORMAT_BC7: return "BC7";
+		default: return "RGBA8";
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// Block Compression Function Definitions
+/* --------------------------------------------- */
+
+BcRgbaTexture bcCreateRgbaTexture(const uint8_t* rgba, uint32_t width, uint32_t height, bool generate_mip_levels)
+{
+	BcRgbaTexture texture = {};
+	texture.width = width;
+	texture.height = height;
+	texture.layerCount = 1;
+	texture.mipLevelCount = 1;
+	if (generate_mip_levels) {
+		while ((std::max(width, height) >> texture.mipLevelCount) > 0) {
+			++texture.mipLevelCount;
+		}
+	}
+
+	size_t size = 0;
+	for (uint32_t level = 0; level < texture.mipLevelCount; ++level) {
+		const uint32_t level_width = std::max(1u, width >> level);
+		const uint32_t level_height = std::max(1u, height >> level);
+		texture.subresources.push_back(DdsSubresource{ level_width, level_height, size, static_cast<size_t>(level_width) * level_height * 4 });
+		size += texture.subresources.back().size;
+	}
+	texture.texels.resize(size);
+	std::memcpy(texture.texels.data(), rgba, texture.subresources[0].size);
+
+	// 2x2 box filter; the last row or column of odd sizes is clamped:
+	for (uint32_t level = 1; level < texture.mipLevelCount; ++level) {
+		const DdsSubresource& source = texture.subresources[level - 1];
+		const DdsSubresource& destination = texture.subresources[level];
+		const uint8_t* source_texels = texture.texels.data() + source.offset;
+		uint8_t* destination_texels = texture.texels.data() + destination.offset;
+		for (uint32_t y = 0; y < destination.height; ++y) {
+			const uint32_t y0 = std::min(2 * y, source.height - 1), y1 = std::min(2 * y + 1, source.height - 1);
+			for (uint32_t x = 0; x < destination.width; ++x) {
+				const uint32_t x0 = std::min(2 * x, source.width - 1), x1 = std::min(2 * x + 1, source.width - 1);
+				for (uint32_t c = 0; c < 4; ++c) {
+					const uint32_t sum = source_texels[(static_cast<size_t>(y0) * source.width + x0) * 4 + c] + source_texels[(static_cast<size_t>(y0) * source.width + x1) * 4 + c]
+						+ source_texels[(static_cast<size_t>(y1) * source.width + x0) * 4 + c] + source_texels[(static_cast<size_t>(y1) * source.width + x1) * 4 + c];
+					destination_texels[(static_cast<size_t>(y) * destination.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+	return texture;
+}
+
+bool bcDecodeDds(const uint8_t* data, size_t size, BcRgbaTexture& texture)
+{
+	texture = BcRgbaTexture{};
+	DdsImageInfo info;
+	if (!ddsParse(data, size, info)) {
+		return false;
+	}
+	switch (info.format) {
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		break;
+	default:
+		return false;
+	}
+
+	texture.width = info.width;
+	texture.height = info.height;
+	texture.mipLevelCount = info.mipLevelCount;
+	texture.layerCount = info.layerCount;
+	texture.isCubemap = info.isCubemap;
+	size_t texels_size = 0;
+	for (const DdsSubresource& subresource : info.subresources) {
+		texture.subresources.push_back(DdsSubresource{ subresource.width, subresource.height, texels_size, static_cast<size_t>(subresource.width) * subresource.height * 4 });
+		texels_size += texture.subresources.back().size;
+	}
+	texture.texels.resize(texels_size);
+
+	for (size_t i = 0; i < info.subresources.size(); ++i) {
+		const DdsSubresource& source = info.subresources[i];
+		const DdsSubresource& destination = texture.subresources[i];
+		const uint8_t* source_data = data + source.offset;
+		uint8_t* texels = texture.texels.data() + destination.offset;
+		if (!info.isBlockCompressed) {
+			const bool swap_red_and_blue = VK_FORMAT_B8G8R8A8_UNORM == info.format || VK_FORMAT_B8G8R8A8_SRGB == info.format;
+			for (size_t texel = 0; texel < destination.size / 4; ++texel) {
+				texels[texel * 4 + 0] = source_data[texel * 4 + (swap_red_and_blue ? 2 : 0)];
+				texels[texel * 4 + 1] = source_data[texel * 4 + 1];
+				texels[texel * 4 + 2] = source_data[texel * 4 + (swap_red_and_blue ? 0 : 2)];
+				texels[texel * 4 + 3] = source_data[texel * 4 + 3];
+			}
+			continue;
+		}
+
+		for (uint32_t block_row = 0; block_row < blocksPerColumn(source.height); ++block_row) {
+			for (uint32_t block_column = 0; block_column < blocksPerRow(source.width); ++block_column) {
+				const uint8_t* block = source_data + (static_cast<size_t>(block_row) * blocksPerRow(source.width) + block_column) * info.bytesPerBlock;
+				uint8_t decoded[16][4];
+				if (8 == info.bytesPerBlock) {
+					decodeColorBlock(block, true, decoded);
+				}
+				else {
+					decodeColorBlock(block + 8, false, decoded);
+					uint64_t alpha_bits;
+					std::memcpy(&alpha_bits, block, 8);
+					if (VK_FORMAT_BC2_UNORM_BLOCK == info.format || VK_FORMAT_BC2_SRGB_BLOCK == info.format) {
+						for (uint32_t texel = 0; texel < 16; ++texel) {
+							decoded[texel][3] = static_cast<uint8_t>(((alpha_bits >> (4 * texel)) & 0xf) * 17);
+						}
+					}
+					else {
+						uint32_t palette[8];
+						decodeAlphaPalette(alpha_bits & 0xff, (alpha_bits >> 8) & 0xff, palette);
+						for (uint32_t texel = 0; texel < 16; ++texel) {
+							decoded[texel][3] = static_cast<uint8_t>(palette[(alpha_bits >> (16 + 3 * texel)) & 0x7]);
+						}
+					}
+				}
+				for (uint32_t texel = 0; texel < 16; ++texel) {
+					const uint32_t x = block_column * 4 + texel % 4;
+					const uint32_t y = block_row * 4 + texel / 4;
+					if (x < source.width && y < source.height) {
+						std::memcpy(texels + (static_cast<size_t>(y) * source.width + x) * 4, decoded[texel], 4);
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+BcFormat bcSelectFormat(VkPhysicalDevice physical_device, bool needs_alpha, BcPreset preset)
+{
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(physical_device, &features);
+	if (VK_FALSE == features.textureCompressionBC) {
+		return BC_FORMAT_NONE;
+	}
+
+	const BcFormat fast_format = needs_alpha ? BC_FORMAT_BC3 : BC_FORMAT_BC1;
+	const BcFormat candidates[] = {
+		BC_PRESET_QUALITY == preset ? BC_FORMAT_BC7 : fast_format,
+		BC_PRESET_QUALITY == preset ? fast_format : BC_FORMAT_BC7,
+		BC_FORMAT_BC3,
+	};
+	for (BcFormat candidate : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physical_device, bcGetVkFormat(candidate), &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) {
+			return candidate;
+		}
+	}
+	return BC_FORMAT_NONE;
+}
+
+VkFormat bcGetVkFormat(BcFormat format, bool srgb)
+{
+	switch (format) {
+	case BC_FORMAT_BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case BC_FORMAT_BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case BC_FORMAT_BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+std::vector<uint8_t> bcEncodeTexture(const BcRgbaTexture& texture, BcFormat format, BcPreset preset, BcStats* stats)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Encoded subresources are stored in the same order as the texels; jobs process rows of blocks of any subresource:
+	struct BlockRow {
+		uint32_t subresource;
+		uint32_t row;
+		size_t offset;
+	};
+	std::vector<BlockRow> rows;
+	size_t encoded_size = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(texture.subresources.size()); ++i) {
+		const DdsSubresource& subresource = texture.subresources[i];
+		const size_t row_size = BC_FORMAT_NONE == format ? subresource.size : static_cast<size_t>(blocksPerRow(subresource.width)) * bytesPerBlock(format);
+		const uint32_t row_count = BC_FORMAT_NONE == format ? 1 : blocksPerColumn(subresource.height);
+		for (uint32_t row = 0; row < row_count; ++row) {
+			rows.push_back(BlockRow{ i, row, encoded_size });
+			encoded_size += row_size;
+		}
+	}
+
+	std::vector<uint8_t> file = createDdsFile(texture, format, encoded_size);
+	uint8_t* encoded = file.data() + file.size() - encoded_size;
+	std::vector<uint64_t> squared_errors(rows.size(), 0);
+	jobParallelFor(static_cast<uint32_t>(rows.size()), kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			const DdsSubresource& subresource = texture.subresources[rows[i].subresource];
+			const uint8_t* rgba = texture.texels.data() + subresource.offset;
+			if (BC_FORMAT_NONE == format) {
+				std::memcpy(encoded + rows[i].offset, rgba, subresource.size);
+				continue;
+			}
+			squared_errors[i] = encodeBlockRow(rgba, subresource.width, subresource.height, rows[i].row, format, preset, encoded + rows[i].offset);
+		}
+	});
+
+	if (nullptr != stats) {
+		*stats = BcStats{};
+		stats->format = format;
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		stats->rgbaBytes = texture.texels.size();
+		stats->texelCount = static_cast<uint32_t>(texture.texels.size() / 4);
+		stats->encodedBytes = encoded_size;
+		for (uint64_t squared_error : squared_errors) {
+			stats->squaredError += squared_error;
+		}
+	}
+	return file;
+}
+
+std::vector<uint8_t> bcEncodeTextureCached(const BcRgbaTexture& texture, BcFormat format, BcPreset preset, const std::string& cache_directory, BcStats* stats)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const uint32_t parameters[] = { kEncoderVersion, static_cast<uint32_t>(format), static_cast<uint32_t>(preset), texture.width, texture.height, texture.mipLevelCount, texture.layerCount, texture.isCubemap ? 1u : 0u };
+	uint64_t hash = hashFnv1a(parameters, sizeof(parameters));
+	hash = hashFnv1a(texture.texels.data(), texture.texels.size(), hash);
+	std::ostringstream file_name;
+	file_name << std::hex << std::setw(16) << std::setfill('0') << hash << ".dds";
+	const std::filesystem::path path = std::filesystem::path(cache_directory) / file_name.str();
+
+	std::ifstream cached_file(path, std::ios::binary);
+	if (cached_file) {
+		std::vector<uint8_t> file((std::istreambuf_iterator<char>(cached_file)), std::istreambuf_iterator<char>());
+		DdsImageInfo info;
+		if (ddsParse(file.data(), file.size(), info) && bcGetVkFormat(format) == info.format && texture.width == info.width && texture.height == info.height
+			&& texture.mipLevelCount == info.mipLevelCount && texture.layerCount == info.layerCount) {
+			if (nullptr != stats) {
+				*stats = BcStats{};
+				stats->format = format;
+				stats->texelCount = static_cast<uint32_t>(texture.texels.size() / 4);
+				stats->cacheHit = true;
+				stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				stats->rgbaBytes = texture.texels.size();
+				stats->encodedBytes = info.subresources.back().offset + info.subresources.back().size - info.subresources.front().offset;
+			}
+			return file;
+		}
+		VKL_LOG("WARNING: Ignoring invalid cache file \"" << path.string() << "\".");
+	}
+
+	std::vector<uint8_t> file = bcEncodeTexture(texture, format, preset, stats);
+	std::error_code error;
+	std::filesystem::create_directories(cache_directory, error);
+	std::ofstream output(path, std::ios::binary);
+	if (!output.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()))) {
+		VKL_LOG("WARNING: Failed to write cache file \"" << path.string() << "\".");
+	}
+	return file;
+}
+
+double bcGetPsnr(const BcStats& stats)
+{
+	if (0 == stats.squaredError || 0 == stats.texelCount) {
+		return std::numeric_limits<double>::infinity();
+	}
+	const double mean_squared_error = static_cast<double>(stats.squaredError) / (static_cast<double>(stats.texelCount) * 4.0);
+	return 10.0 * std::log10(255.0 * 255.0 / mean_squared_error);
+}
+
+void bcLogStats(const char* name, const BcStats& stats)
+{
+	const double saved_percent = stats.rgbaBytes > 0 ? 100.0 * (1.0 - static_cast<double>(stats.encodedBytes) / stats.rgbaBytes) : 0.0;
+	std::ostringstream sizes;
+	sizes << std::fixed << std::setprecision(2) << stats.rgbaBytes / 1024.0 << " KiB RGBA8 -> " << stats.encodedBytes / 1024.0 << " KiB "
+		<< formatName(stats.format) << " (saves " << std::setprecision(1) << saved_percent << " %)";
+	if (stats.cacheHit) {
+		VKL_LOG(name << ": loaded from cache in " << std::fixed << std::setprecision(2) << stats.milliseconds << " ms, " << sizes.str());
+		return;
+	}
+	const double texels_per_second = stats.milliseconds > 0.0 ? stats.texelCount / (stats.milliseconds * 1e-3) : 0.0;
+	VKL_LOG(name << ": PSNR " << std::fixed << std::setprecision(2) << bcGetPsnr(stats) << " dB, encoded in " << stats.milliseconds << " ms ("
+		<< texels_per_second * 1e-6 << " Mtexels/s), " << sizes.str());
+}
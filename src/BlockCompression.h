@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "DdsImage.h"
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Block Compression Struct Definitions
+// As a convention, their names start with `Bc`.
+/* --------------------------------------------- */
+
+/*!
+ * Formats which textures can be encoded into. All block-compressed formats store 4x4 texel blocks.
+ */
+enum BcFormat {
+	//! Uncompressed RGBA8, for devices which do not support any BC format
+	BC_FORMAT_NONE = 0,
+	//! 8 bytes per block: two RGB565 endpoints and 2 bit indices, no alpha
+	BC_FORMAT_BC1 = 1,
+	//! 16 bytes per block: a BC1 color block and an interpolated 8 bit alpha block
+	BC_FORMAT_BC3 = 2,
+	//! 16 bytes per block: RGBA endpoints with 7 bit plus a shared bit, and 4 bit indices (mode 6 only)
+	BC_FORMAT_BC7 = 3,
+};
+
+/*!
+ * Trade-off between encoding speed and quality.
+ */
+enum BcPreset {
+	//! Endpoints at the extent of each block along its principal axis
+	BC_PRESET_FAST = 0,
+	//! Additionally refines the endpoints by least squares fitting against the chosen indices
+	BC_PRESET_QUALITY = 1,
+};
+
+/*!
+ * RGBA8 texels of a texture, e.g., decoded from a DDS file or loaded from an image file.
+ */
+struct BcRgbaTexture {
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevelCount;
+	uint32_t layerCount;
+	bool isCubemap;
+
+	//! Tightly packed RGBA8 texels of all subresources
+	std::vector<uint8_t> texels;
+
+	//! Locations of the subresources within texels, in the same order as DdsImageInfo::subresources
+	std::vector<DdsSubresource> subresources;
+};
+
+/*!
+ * Statistics of one invocation of bcEncodeTexture.
+ */
+struct BcStats {
+	BcFormat format;
+	uint32_t texelCount;
+
+	//! Whether the result has been loaded from the disk cache. If so, no error has been measured.
+	bool cacheHit;
+
+	//! Wall-clock time of encoding (or of loading from the cache)
+	double milliseconds;
+
+	//! Sum of squared differences of all RGBA channels between the source and the encoded texels
+	uint64_t squaredError;
+
+	//! Sizes of the texels as RGBA8 and as encoded data, excluding file headers
+	size_t rgbaBytes;
+	size_t encodedBytes;
+};
+
+/* --------------------------------------------- */
+// Block Compression Function Definitions
+// As a convention, their names start with `bc`.
+/* --------------------------------------------- */
+
+/*!
+ *	Creates a texture from a single RGBA8 image and, optionally, a full mip chain generated with a box filter.
+ *	@param	rgba				width * height tightly packed RGBA8 texels
+ *	@param	generate_mip_levels	Whether to generate mip levels down to 1x1
+ */
+BcRgbaTexture bcCreateRgbaTexture(const uint8_t* rgba, uint32_t width, uint32_t height, bool generate_mip_levels);
+
+/*!
+ *	Decodes a DDS file into RGBA8 texels, e.g., to transcode DXT3-compressed cubemap faces into a different format.
+ *	Supports BC1, BC2, BC3, and uncompressed RGBA8/BGRA8 data.
+ *	@return	True on success, false if the file could not be parsed or has an unsupported format.
+ */
+bool bcDecodeDds(const uint8_t* data, size_t size, BcRgbaTexture& texture);
+
+/*!
+ *	Selects the format to encode textures into, based on which formats the device can sample from:
+ *	BC_PRESET_QUALITY prefers BC7, BC_PRESET_FAST prefers BC1 or, if alpha is needed, BC3.
+ *	Falls back to the other BC formats, and to BC_FORMAT_NONE if none is supported.
+ */
+BcFormat bcSelectFormat(VkPhysicalDevice physical_device, bool needs_alpha, BcPreset preset);
+
+/*!
+ *	Returns the Vulkan format of textures encoded into the given format.
+ */
+VkFormat bcGetVkFormat(BcFormat format, bool srgb = false);
+
+/*!
+ *	Encodes all subresources of a texture in parallel through the job system (see jobInitSystem), and
+ *	returns them as a DDS file, which can be parsed with ddsParse and uploaded as is.
+ *	Texels at the right and bottom borders of textures whose size is not a multiple of 4 are clamped.
+ *	@param	stats	Optionally receives the size, error, and encoding time
+ *	@return	The contents of a DDS file
+ */
+std::vector<uint8_t> bcEncodeTexture(const BcRgbaTexture& texture, BcFormat format, BcPreset preset, BcStats* stats = nullptr);
+
+/*!
+ *	Like bcEncodeTexture, but looks up the result in a cache directory first. Cache files are named after a hash of
+ *	the texels, the format, the preset, and the encoder's version, and are written after encoding.
+ *	@param	cache_directory	Directory of the cache files; it is created if it does not exist.
+ */
+std::vector<uint8_t> bcEncodeTextureCached(const BcRgbaTexture& texture, BcFormat format, BcPreset preset, const std::string& cache_directory, BcStats* stats = nullptr);
+
+/*!
+ *	Returns the peak signal-to-noise ratio in dB over all RGBA channels, or infinity if the encoding is lossless.
+ */
+double bcGetPsnr(const BcStats& stats);
+
+/*!
+ *	Logs format, PSNR, encoding throughput, and the memory saved compared to RGBA8.
+ */
+void bcLogStats(const char* name, const BcStats& stats);
@@ -0,0 +1,1012 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Bvh.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Number of bins per axis which split candidates are evaluated at:
+	constexpr uint32_t kBinCount = 16u;
+
+	// Nodes with at most kMinLeafTriangles triangles always become leaves, nodes with more than kMaxLeafTriangles never:
+	constexpr uint32_t kMinLeafTriangles = 4u;
+	constexpr uint32_t kMaxLeafTriangles = 8u;
+
+	// Cost of testing a ray against a node, relative to testing it against a triangle packet:
+	constexpr float kTraversalCost = 1.0f;
+
+	// From this depth on, nodes are split at the median instead, which bounds the depth for degenerate inputs:
+	constexpr uint32_t kMaxSahDepth = 64u;
+	constexpr uint32_t kMaxDepth = kMaxSahDepth + 32u;
+
+	// Every node visited during traversal pushes at most three more children than it pops:
+	constexpr uint32_t kStackSize = 3u * kMaxDepth + 4u;
+
+	// Nodes with at least this many triangles are binned by multiple jobs; smaller ones become subtrees built by one job:
+	constexpr uint32_t kParallelBinningThreshold = 65536u;
+	constexpr uint32_t kTrianglesPerBinningJob = 16384u;
+	constexpr uint32_t kSubtreeTriangles = 4096u;
+	constexpr uint32_t kRaysPerJob = 1024u;
+
+	constexpr uint32_t kLeafBit = 0x80000000u;
+	constexpr uint32_t kLeafPacketCountShift = 27u;
+	constexpr uint32_t kLeafFirstPacketMask = 0x7FFFFFFu;
+	constexpr uint32_t kEmptyChild = 0xFFFFFFFFu;
+	constexpr uint32_t kNoTriangle = 0xFFFFFFFFu;
+
+	// Bounding box, padded to four floats per corner so that it can be grown with SSE2:
+	struct alignas(16) Aabb {
+		float lo[4];
+		float hi[4];
+	};
+
+	Aabb emptyAabb()
+	{
+		const float inf = std::numeric_limits<float>::infinity();
+		return { { inf, inf, inf, inf }, { -inf, -inf, -inf, -inf } };
+	}
+
+	void grow(Aabb& aabb, const float point[3])
+	{
+		for (int axis = 0; axis < 3; ++axis) {
+			aabb.lo[axis] = std::min(aabb.lo[axis], point[axis]);
+			aabb.hi[axis] = std::max(aabb.hi[axis], point[axis]);
+		}
+	}
+
+	void grow(Aabb& aabb, const Aabb& other)
+	{
+#if BVH_USE_SSE2
+		_mm_store_ps(aabb.lo, _mm_min_ps(_mm_load_ps(aabb.lo), _mm_load_ps(other.lo)));
+		_mm_store_ps(aabb.hi, _mm_max_ps(_mm_load_ps(aabb.hi), _mm_load_ps(other.hi)));
+#else
+		for (int axis = 0; axis < 3; ++axis) {
+			aabb.lo[axis] = std::min(aabb.lo[axis], other.lo[axis]);
+			aabb.hi[axis] = std::max(aabb.hi[axis], other.hi[axis]);
+		}
+#endif
+	}
+
+	// Half of the surface area, which is all the surface area heuristic needs:
+	float halfArea(const Aabb& aabb)
+	{
+		const float dx = aabb.hi[0] - aabb.lo[0];
+		const float dy = aabb.hi[1] - aabb.lo[1];
+		const float dz = aabb.hi[2] - aabb.lo[2];
+		if (dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+			return 0.0f;
+		}
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	uint32_t packetCount(uint32_t triangle_count)
+	{
+		return (triangle_count + 3u) / 4u;
+	}
+
+	// Node of the binary BVH which is built first, and then collapsed into a BVH with four children per node:
+	struct BuildNode {
+		Aabb bounds;
+		// Indices of the children in the same array, if this is an inner node:
+		uint32_t left;
+		uint32_t right;
+		// Range in the triangle order, if this is a leaf (count > 0):
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct Bin {
+		Aabb bounds;
+		uint32_t count;
+	};
+
+	struct Bins {
+		Bin bins[3][kBinCount];
+	};
+
+	struct Split {
+		// Axis is 3 if no split along any axis separates the triangles:
+		uint32_t axis;
+		uint32_t bin;
+		float cost;
+		Aabb leftBounds;
+		Aabb rightBounds;
+	};
+
+	// Input of the build: bounds and centroids of all triangles, and the order of the triangles, which is
+	// rearranged so that every node's triangles are contiguous.
+	struct BuildInput {
+		std::vector<Aabb> triangleBounds;
+		std::vector<glm::vec3> centroids;
+		std::vector<uint32_t> order;
+	};
+
+	// A node whose subtree is built by one job into its own array, which is appended to the top-level nodes afterwards:
+	struct Subtree {
+		uint32_t node;
+		uint32_t depth;
+		std::vector<BuildNode> nodes;
+	};
+
+	uint32_t binIndex(float centroid, float lo, float scale)
+	{
+		const float bin = (centroid - lo) * scale;
+		return std::min(kBinCount - 1u, static_cast<uint32_t>(std::max(0.0f, bin)));
+	}
+
+	void getBinScales(const Aabb& centroid_bounds, float scales[3])
+	{
+		for (int axis = 0; axis < 3; ++axis) {
+			const float extent = centroid_bounds.hi[axis] - centroid_bounds.lo[axis];
+			scales[axis] = extent > 0.0f ? static_cast<float>(kBinCount) / extent : 0.0f;
+		}
+	}
+
+	void resetBins(Bins& bins)
+	{
+		for (int axis = 0; axis < 3; ++axis) {
+			for (uint32_t i = 0; i < kBinCount; ++i) {
+				bins.bins[axis][i] = { emptyAabb(), 0u };
+			}
+		}
+	}
+
+	void fillBins(const BuildInput& input, uint32_t begin, uint32_t end, const Aabb& centroid_bounds, const float scales[3], Bins& bins)
+	{
+		for (uint32_t i = begin; i < end; ++i) {
+			const uint32_t triangle = input.order[i];
+			for (int axis = 0; axis < 3; ++axis) {
+				Bin& bin = bins.bins[axis][binIndex(input.centroids[triangle][axis], centroid_bounds.lo[axis], scales[axis])];
+				grow(bin.bounds, input.triangleBounds[triangle]);
+				++bin.count;
+			}
+		}
+	}
+
+	// Bins the triangles of a node along all axes. Large nodes are binned by multiple jobs, whose bins are merged.
+	// Since merging counts and bounds does not depend on the order, neither does the result.
+	void binTriangles(const BuildInput& input, uint32_t first, uint32_t count, const Aabb& centroid_bounds, const float scales[3], Bins& bins)
+	{
+		resetBins(bins);
+		if (count < kParallelBinningThreshold) {
+			fillBins(input, first, first + count, centroid_bounds, scales, bins);
+			return;
+		}
+
+		std::vector<Bins> partial_bins((count + kTrianglesPerBinningJob - 1) / kTrianglesPerBinningJob);
+		jobParallelFor(count, kTrianglesPerBinningJob, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t chunk_begin = begin; chunk_begin < end; chunk_begin += kTrianglesPerBinningJob) {
+				Bins& chunk_bins = partial_bins[chunk_begin / kTrianglesPerBinningJob];
+				resetBins(chunk_bins);
+				const uint32_t chunk_end = std::min(end, chunk_begin + kTrianglesPerBinningJob);
+				fillBins(input, first + chunk_begin, first + chunk_end, centroid_bounds, scales, chunk_bins);
+			}
+		});
+		for (const Bins& partial : partial_bins) {
+			for (int axis = 0; axis < 3; ++axis) {
+				for (uint32_t i = 0; i < kBinCount; ++i) {
+					grow(bins.bins[axis][i].bounds, partial.bins[axis][i].bounds);
+					bins.bins[axis][i].count += partial.bins[axis][i].count;
+				}
+			}
+		}
+	}
+
+	// Sweeps over the bins of every axis and returns the split between two bins with the lowest SAH cost,
+	// relative to the node's area. Splits which leave one side empty are not considered.
+	Split findBestSplit(const Bins& bins, const float scales[3])
+	{
+		Split best = { 3u, 0u, std::numeric_limits<float>::infinity(), emptyAabb(), emptyAabb() };
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			if (0.0f == scales[axis]) {
+				continue;
+			}
+			const Bin* axis_bins = bins.bins[axis];
+
+			// Bounds and cost of the triangles left of every split, accumulated from the left:
+			Aabb left_bounds[kBinCount - 1];
+			float left_costs[kBinCount - 1];
+			uint32_t left_counts[kBinCount - 1];
+			Aabb bounds = emptyAabb();
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < kBinCount - 1; ++i) {
+				grow(bounds, axis_bins[i].bounds);
+				count += axis_bins[i].count;
+				left_bounds[i] = bounds;
+				left_costs[i] = halfArea(bounds) * packetCount(count);
+				left_counts[i] = count;
+			}
+
+			bounds = emptyAabb();
+			count = 0;
+			for (uint32_t i = kBinCount - 1; i > 0; --i) {
+				grow(bounds, axis_bins[i].bounds);
+				count += axis_bins[i].count;
+				if (0 == left_counts[i - 1] || 0 == count) {
+					continue;
+				}
+				const float cost = left_costs[i - 1] + halfArea(bounds) * packetCount(count);
+				if (cost < best.cost) {
+					best = { axis, i - 1, cost, left_bounds[i - 1], bounds };
+				}
+			}
+		}
+		return best;
+	}
+
+	Aabb getRangeBounds(const BuildInput& input, uint32_t first, uint32_t count)
+	{
+		Aabb bounds = emptyAabb();
+		for (uint32_t i = first; i < first + count; ++i) {
+			grow(bounds, input.triangleBounds[input.order[i]]);
+		}
+		return bounds;
+	}
+
+	// Splits the triangles at the median of their centroids along the axis of the largest extent, or, if all
+	// centroids are equal, at the middle of the range. Returns the number of triangles in the left half, and sets the
+	// bounds of both halves in `split`.
+	uint32_t splitAtMedian(BuildInput& input, uint32_t first, uint32_t count, const Aabb& centroid_bounds, Split& split)
+	{
+		uint32_t axis = 0;
+		for (uint32_t i = 1; i < 3; ++i) {
+			if (centroid_bounds.hi[i] - centroid_bounds.lo[i] > centroid_bounds.hi[axis] - centroid_bounds.lo[axis]) {
+				axis = i;
+			}
+		}
+		const uint32_t left_count = count / 2;
+		const std::vector<glm::vec3>& centroids = input.centroids;
+		std::nth_element(input.order.begin() + first, input.order.begin() + first + left_count, input.order.begin() + first + count,
+			[&centroids, axis](uint32_t a, uint32_t b) {
+				return centroids[a][axis] < centroids[b][axis] || (centroids[a][axis] == centroids[b][axis] && a < b);
+			});
+		split.leftBounds = getRangeBounds(input, first, left_count);
+		split.rightBounds = getRangeBounds(input, first + left_count, count - left_count);
+		return left_count;
+	}
+
+	// Decides whether nodes[node_index] becomes a leaf or is split. If it is split, its children are appended to `nodes`.
+	// Returns true if the node has been split.
+	bool splitNode(BuildInput& input, std::vector<BuildNode>& nodes, uint32_t node_index, uint32_t depth)
+	{
+		const BuildNode node = nodes[node_index];
+		if (node.count <= kMinLeafTriangles) {
+			return false;
+		}
+
+		Aabb centroid_bounds = emptyAabb();
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			const glm::vec3& centroid = input.centroids[input.order[i]];
+			const float point[3] = { centroid.x, centroid.y, centroid.z };
+			grow(centroid_bounds, point);
+		}
+
+		uint32_t left_count;
+		Split split;
+		float scales[3];
+		getBinScales(centroid_bounds, scales);
+		if (depth < kMaxSahDepth) {
+			Bins bins;
+			binTriangles(input, node.first, node.count, centroid_bounds, scales, bins);
+			split = findBestSplit(bins, scales);
+		}
+		else {
+			split.axis = 3u;
+		}
+
+		if (split.axis > 2) {
+			if (node.count <= kMaxLeafTriangles) {
+				return false;
+			}
+			left_count = splitAtMedian(input, node.first, node.count, centroid_bounds, split);
+		}
+		else {
+			const float node_area = halfArea(node.bounds);
+			const float leaf_cost = node_area * packetCount(node.count);
+			if (node.count <= kMaxLeafTriangles && leaf_cost <= kTraversalCost * node_area + split.cost) {
+				return false;
+			}
+
+			const uint32_t axis = split.axis;
+			const uint32_t split_bin = split.bin;
+			const float lo = centroid_bounds.lo[axis];
+			const float scale = scales[axis];
+			const std::vector<glm::vec3>& centroids = input.centroids;
+			const auto middle = std::partition(input.order.begin() + node.first, input.order.begin() + node.first + node.count,
+				[&centroids, axis, split_bin, lo, scale](uint32_t triangle) {
+					return binIndex(centroids[triangle][axis], lo, scale) <= split_bin;
+				});
+			left_count = static_cast<uint32_t>(middle - (input.order.begin() + node.first));
+		}
+
+		const uint32_t left = static_cast<uint32_t>(nodes.size());
+		nodes.push_back({ split.leftBounds, 0u, 0u, node.first, left_count });
+		nodes.push_back({ split.rightBounds, 0u, 0u, node.first + left_count, node.count - left_count });
+		nodes[node_index].left = left;
+		nodes[node_index].right = left + 1;
+		nodes[node_index].count = 0;
+		return true;
+	}
+
+	// Builds the subtree below nodes[node_index], whose bounds and triangle range have been set, into `nodes`.
+	void buildSubtree(BuildInput& input, std::vector<BuildNode>& nodes, uint32_t node_index, uint32_t depth)
+	{
+		if (splitNode(input, nodes, node_index, depth)) {
+			const uint32_t left = nodes[node_index].left;
+			buildSubtree(input, nodes, left, depth + 1);
+			buildSubtree(input, nodes, left + 1, depth + 1);
+		}
+	}
+
+	// Builds the top levels of the tree, down to nodes with at most kSubtreeTriangles triangles, which are
+	// collected in `subtrees` instead of being built right away.
+	void buildTopLevels(BuildInput& input, std::vector<BuildNode>& nodes, uint32_t node_index, uint32_t depth, std::vector<Subtree>& subtrees)
+	{
+		if (nodes[node_index].count <= kSubtreeTriangles) {
+			subtrees.push_back({ node_index, depth, {} });
+			return;
+		}
+		if (splitNode(input, nodes, node_index, depth)) {
+			const uint32_t left = nodes[node_index].left;
+			buildTopLevels(input, nodes, left, depth + 1, subtrees);
+			buildTopLevels(input, nodes, left + 1, depth + 1, subtrees);
+		}
+	}
+
+	void setChild(BvhNode& node, uint32_t slot, const Aabb& bounds, uint32_t child)
+	{
+		node.minX[slot] = bounds.lo[0];
+		node.minY[slot] = bounds.lo[1];
+		node.minZ[slot] = bounds.lo[2];
+		node.maxX[slot] = bounds.hi[0];
+		node.maxY[slot] = bounds.hi[1];
+		node.maxZ[slot] = bounds.hi[2];
+		node.children[slot] = child;
+	}
+
+	// Copies a leaf's triangles into packets and returns the leaf's child reference.
+	uint32_t createLeaf(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const BuildInput& input,
+		const BuildNode& leaf, Bvh& bvh)
+	{
+		const uint32_t first_packet = static_cast<uint32_t>(bvh.packets.size());
+		for (uint32_t i = 0; i < leaf.count; i += 4) {
+			BvhTrianglePacket packet = {};
+			for (uint32_t lane = 0; lane < 4; ++lane) {
+				packet.triangleIndices[lane] = kNoTriangle;
+				if (i + lane >= leaf.count) {
+					continue;
+				}
+				const uint32_t triangle = input.order[leaf.first + i + lane];
+				const glm::vec3& v0 = positions[indices[3 * triangle + 0]];
+				const glm::vec3& v1 = positions[indices[3 * triangle + 1]];
+				const glm::vec3& v2 = positions[indices[3 * triangle + 2]];
+				packet.v0X[lane] = v0.x;
+				packet.v0Y[lane] = v0.y;
+				packet.v0Z[lane] = v0.z;
+				packet.e1X[lane] = v1.x - v0.x;
+				packet.e1Y[lane] = v1.y - v0.y;
+				packet.e1Z[lane] = v1.z - v0.z;
+				packet.e2X[lane] = v2.x - v0.x;
+				packet.e2Y[lane] = v2.y - v0.y;
+				packet.e2Z[lane] = v2.z - v0.z;
+				packet.triangleIndices[lane] = triangle;
+			}
+			bvh.packets.push_back(packet);
+		}
+		const uint32_t packets = packetCount(leaf.count);
+		return kLeafBit | ((packets - 1u) << kLeafPacketCountShift) | first_packet;
+	}
+
+	// Converts the binary node at `node_index` and up to two levels below it into a node with up to four children
+	// in depth-first order, and returns its index.
+	uint32_t collapseNode(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const BuildInput& input,
+		const std::vector<BuildNode>& nodes, uint32_t node_index, uint32_t depth, Bvh& bvh, BvhBuildStats& stats)
+	{
+		// Gather up to four children by repeatedly opening the inner child with the largest area:
+		uint32_t children[4] = { nodes[node_index].left, nodes[node_index].right, 0u, 0u };
+		uint32_t child_count = 2;
+		while (child_count < 4) {
+			int largest = -1;
+			float largest_area = -1.0f;
+			for (uint32_t i = 0; i < child_count; ++i) {
+				const BuildNode& child = nodes[children[i]];
+				if (0 == child.count && halfArea(child.bounds) > largest_area) {
+					largest = static_cast<int>(i);
+					largest_area = halfArea(child.bounds);
+				}
+			}
+			if (largest < 0) {
+				break;
+			}
+			const BuildNode& opened = nodes[children[largest]];
+			children[largest] = opened.left;
+			children[child_count++] = opened.right;
+		}
+
+		const uint32_t bvh_node_index = static_cast<uint32_t>(bvh.nodes.size());
+		bvh.nodes.push_back({});
+		stats.maxDepth = std::max(stats.maxDepth, depth + 1);
+		stats.sahCost += kTraversalCost * halfArea(nodes[node_index].bounds);
+
+		for (uint32_t slot = 0; slot < 4; ++slot) {
+			if (slot >= child_count) {
+				setChild(bvh.nodes[bvh_node_index], slot, emptyAabb(), kEmptyChild);
+				continue;
+			}
+			const BuildNode& child = nodes[children[slot]];
+			uint32_t reference;
+			if (child.count > 0) {
+				reference = createLeaf(positions, indices, input, child, bvh);
+				++stats.leafCount;
+				stats.sahCost += halfArea(child.bounds) * packetCount(child.count);
+			}
+			else {
+				reference = collapseNode(positions, indices, input, nodes, children[slot], depth + 1, bvh, stats);
+			}
+			setChild(bvh.nodes[bvh_node_index], slot, child.bounds, reference);
+		}
+		return bvh_node_index;
+	}
+
+	struct PreparedRay {
+		float origin[3];
+		float direction[3];
+		float inverseDirection[3];
+		// Offsets of the planes which a ray enters and leaves a child's bounds through, in floats from the start of a BvhNode:
+		uint32_t nearOffsets[3];
+		uint32_t farOffsets[3];
+	};
+
+	PreparedRay prepareRay(const BvhRay& ray)
+	{
+		// Clamp tiny direction components, so that the inverse and the slab distances stay finite:
+		constexpr float kMinComponent = 1e-20f;
+		PreparedRay prepared;
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			prepared.origin[axis] = ray.origin[axis];
+			prepared.direction[axis] = ray.direction[axis];
+			float component = ray.direction[axis];
+			if (std::abs(component) < kMinComponent) {
+				component = std::signbit(component) ? -kMinComponent : kMinComponent;
+			}
+			prepared.inverseDirection[axis] = 1.0f / component;
+			const bool negative = prepared.inverseDirection[axis] < 0.0f;
+			prepared.nearOffsets[axis] = axis * 4u + (negative ? 12u : 0u);
+			prepared.farOffsets[axis] = axis * 4u + (negative ? 0u : 12u);
+		}
+		return prepared;
+	}
+
+	// Intersects the ray with the bounds of all four children and returns a bit mask of the children hit within
+	// [t_min, t_max], and the distances at which the ray enters them.
+	uint32_t intersectChildren(const BvhNode& node, const PreparedRay& ray, float t_min, float t_max, float entry_distances[4])
+	{
+		const float* planes = node.minX;
+#if BVH_USE_SSE2
+		// The distances along every axis are independent, so that they can be computed in parallel:
+		__m128 axis_near[3];
+		__m128 axis_far[3];
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			const __m128 origin = _mm_set1_ps(ray.origin[axis]);
+			const __m128 inverse_direction = _mm_set1_ps(ray.inverseDirection[axis]);
+			axis_near[axis] = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(planes + ray.nearOffsets[axis]), origin), inverse_direction);
+			axis_far[axis] = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(planes + ray.farOffsets[axis]), origin), inverse_direction);
+		}
+		const __m128 t_near = _mm_max_ps(_mm_max_ps(axis_near[0], axis_near[1]), _mm_max_ps(axis_near[2], _mm_set1_ps(t_min)));
+		const __m128 t_far = _mm_min_ps(_mm_min_ps(axis_far[0], axis_far[1]), _mm_min_ps(axis_far[2], _mm_set1_ps(t_max)));
+		_mm_storeu_ps(entry_distances, t_near);
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(t_near, t_far)));
+#else
+		uint32_t mask = 0;
+		for (uint32_t slot = 0; slot < 4; ++slot) {
+			float t_near = t_min;
+			float t_far = t_max;
+			for (uint32_t axis = 0; axis < 3; ++axis) {
+				t_near = std::max(t_near, (planes[ray.nearOffsets[axis] + slot] - ray.origin[axis]) * ray.inverseDirection[axis]);
+				t_far = std::min(t_far, (planes[ray.farOffsets[axis] + slot] - ray.origin[axis]) * ray.inverseDirection[axis]);
+			}
+			entry_distances[slot] = t_near;
+			mask |= t_near <= t_far ? 1u << slot : 0u;
+		}
+		return mask;
+#endif
+	}
+
+	// Intersects the ray with the four triangles of a packet (Moeller-Trumbore) and returns a bit mask of the triangles
+	// hit within [t_min, t_max], and the distances and barycentric coordinates of all hits. The division by the
+	// determinant is deferred until a triangle has been hit; the other lanes of t, u, and v are undefined.
+	uint32_t intersectPacket(const BvhTrianglePacket& packet, const PreparedRay& ray, float t_min, float t_max, float t[4], float u[4], float v[4])
+	{
+#if BVH_USE_SSE2
+		const __m128 dx = _mm_set1_ps(ray.direction[0]);
+		const __m128 dy = _mm_set1_ps(ray.direction[1]);
+		const __m128 dz = _mm_set1_ps(ray.direction[2]);
+		const __m128 e1x = _mm_load_ps(packet.e1X);
+		const __m128 e1y = _mm_load_ps(packet.e1Y);
+		const __m128 e1z = _mm_load_ps(packet.e1Z);
+		const __m128 e2x = _mm_load_ps(packet.e2X);
+		const __m128 e2y = _mm_load_ps(packet.e2Y);
+		const __m128 e2z = _mm_load_ps(packet.e2Z);
+
+		const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+		const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+		// Flip the signs of all numerators along with the determinant's, so that they can be compared without dividing:
+		const __m128 sign = _mm_and_ps(determinant, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+		const __m128 abs_determinant = _mm_xor_ps(determinant, sign);
+
+		const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin[0]), _mm_load_ps(packet.v0X));
+		const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin[1]), _mm_load_ps(packet.v0Y));
+		const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin[2]), _mm_load_ps(packet.v0Z));
+		const __m128 scaled_u = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), sign);
+
+		const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		const __m128 scaled_v = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), sign);
+		const __m128 scaled_t = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), sign);
+
+		// Degenerate triangles, including unused lanes, have a determinant of 0:
+		const __m128 zero = _mm_setzero_ps();
+		__m128 hit = _mm_cmpgt_ps(abs_determinant, zero);
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_u, zero));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_v, zero));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(scaled_u, scaled_v), abs_determinant));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_t, _mm_mul_ps(_mm_set1_ps(t_min), abs_determinant)));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(scaled_t, _mm_mul_ps(_mm_set1_ps(t_max), abs_determinant)));
+		const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(hit));
+		if (0 != mask) {
+			const __m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), abs_determinant);
+			_mm_storeu_ps(t, _mm_mul_ps(scaled_t, inverse_determinant));
+			_mm_storeu_ps(u, _mm_mul_ps(scaled_u, inverse_determinant));
+			_mm_storeu_ps(v, _mm_mul_ps(scaled_v, inverse_determinant));
+		}
+		return mask;
+#else
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			const float px = ray.direction[1] * packet.e2Z[lane] - ray.direction[2] * packet.e2Y[lane];
+			const float py = ray.direction[2] * packet.e2X[lane] - ray.direction[0] * packet.e2Z[lane];
+			const float pz = ray.direction[0] * packet.e2Y[lane] - ray.direction[1] * packet.e2X[lane];
+			const float determinant = packet.e1X[lane] * px + packet.e1Y[lane] * py + packet.e1Z[lane] * pz;
+			const float sign = std::signbit(determinant) ? -1.0f : 1.0f;
+			const float abs_determinant = determinant * sign;
+
+			const float sx = ray.origin[0] - packet.v0X[lane];
+			const float sy = ray.origin[1] - packet.v0Y[lane];
+			const float sz = ray.origin[2] - packet.v0Z[lane];
+			const float scaled_u = (sx * px + sy * py + sz * pz) * sign;
+
+			const float qx = sy * packet.e1Z[lane] - sz * packet.e1Y[lane];
+			const float qy = sz * packet.e1X[lane] - sx * packet.e1Z[lane];
+			const float qz = sx * packet.e1Y[lane] - sy * packet.e1X[lane];
+			const float scaled_v = (ray.direction[0] * qx + ray.direction[1] * qy + ray.direction[2] * qz) * sign;
+			const float scaled_t = (packet.e2X[lane] * qx + packet.e2Y[lane] * qy + packet.e2Z[lane] * qz) * sign;
+
+			if (abs_determinant > 0.0f && scaled_u >= 0.0f && scaled_v >= 0.0f && scaled_u + scaled_v <= abs_determinant
+				&& scaled_t >= t_min * abs_determinant && scaled_t <= t_max * abs_determinant) {
+				const float inverse_determinant = 1.0f / abs_determinant;
+				t[lane] = scaled_t * inverse_determinant;
+				u[lane] = scaled_u * inverse_determinant;
+				v[lane] = scaled_v * inverse_determinant;
+				mask |= 1u << lane;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	struct StackEntry {
+		uint32_t child;
+		float entryDistance;
+	};
+
+	// Traverses the BVH front to back. If any_hit is true, traversal stops at the first intersection found.
+	template <bool any_hit>
+	bool traverse(const Bvh& bvh, const BvhRay& ray, BvhHit& hit)
+	{
+		// Index of the lowest set bit of a 4 bit mask:
+		constexpr uint8_t kLowestBit[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+
+		if (bvh.nodes.empty()) {
+			return false;
+		}
+		const PreparedRay prepared = prepareRay(ray);
+		StackEntry stack[kStackSize];
+		uint32_t stack_size = 0;
+
+		bool found = false;
+		float closest = ray.tMax;
+		uint32_t child = 0u;
+		for (;;) {
+			if (0 == (child & kLeafBit)) {
+				const BvhNode& node = bvh.nodes[child];
+				float entry_distances[4];
+				uint32_t mask = intersectChildren(node, prepared, ray.tMin, closest, entry_distances);
+				if (0 != mask) {
+					uint32_t slot = kLowestBit[mask];
+					mask &= mask - 1u;
+					StackEntry nearest = { node.children[slot], entry_distances[slot] };
+
+					// Continue with the nearest child, and push the others so that the nearer ones are popped first:
+					const uint32_t first_pushed = stack_size;
+					while (0 != mask) {
+						slot = kLowestBit[mask];
+						mask &= mask - 1u;
+						StackEntry other = { node.children[slot], entry_distances[slot] };
+						if (other.entryDistance < nearest.entryDistance) {
+							std::swap(other, nearest);
+						}
+						uint32_t i = stack_size++;
+						for (; i > first_pushed && stack[i - 1].entryDistance < other.entryDistance; --i) {
+							stack[i] = stack[i - 1];
+						}
+						stack[i] = other;
+					}
+					child = nearest.child;
+					continue;
+				}
+			}
+			else {
+				const uint32_t first_packet = child & kLeafFirstPacketMask;
+				const uint32_t packets = ((child & ~kLeafBit) >> kLeafPacketCountShift) + 1u;
+				for (uint32_t p = first_packet; p < first_packet + packets; ++p) {
+					const BvhTrianglePacket& packet = bvh.packets[p];
+					float t[4], u[4], v[4];
+					const uint32_t mask = intersectPacket(packet, prepared, ray.tMin, closest, t, u, v);
+					if (0 == mask) {
+						continue;
+					}
+					if (any_hit) {
+						return true;
+					}
+					for (uint32_t lane = 0; lane < 4; ++lane) {
+						if (0 != (mask & (1u << lane)) && t[lane] <= closest) {
+							found = true;
+							closest = t[lane];
+							hit = { packet.triangleIndices[lane], t[lane], u[lane], v[lane] };
+						}
+					}
+				}
+			}
+
+			// Pop the next child, skipping those which the ray enters behind the closest hit found so far:
+			while (stack_size > 0 && stack[stack_size - 1].entryDistance > closest) {
+				--stack_size;
+			}
+			if (0 == stack_size) {
+				return found;
+			}
+			child = stack[--stack_size].child;
+		}
+	}
+
+#if BVH_USE_SSE2
+	struct alignas(16) PacketStackEntry {
+		// Per ray: the distance at which it enters the child, or infinity if it misses the child
+		__m128 entryDistances;
+		uint32_t child;
+	};
+
+	__m128 selectPs(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Traverses the BVH with four rays at once, one per lane, and writes their closest hits. Children are
+	// visited if any ray hits them, ordered by the smallest distance at which one of the rays enters them.
+	void traversePacket(const Bvh& bvh, const BvhRay* rays, uint32_t ray_count, BvhHit* hits)
+	{
+		const float inf = std::numeric_limits<float>::infinity();
+
+		// Rays as structure of arrays; missing rays of an incomplete packet get an empty interval:
+		alignas(16) float lanes[11][4];
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			const BvhRay& ray = rays[std::min(lane, ray_count - 1u)];
+			const PreparedRay prepared = prepareRay(ray);
+			for (uint32_t axis = 0; axis < 3; ++axis) {
+				lanes[axis][lane] = prepared.origin[axis];
+				lanes[3 + axis][lane] = prepared.direction[axis];
+				lanes[6 + axis][lane] = prepared.inverseDirection[axis];
+			}
+			lanes[9][lane] = lane < ray_count ? ray.tMin : inf;
+			lanes[10][lane] = lane < ray_count ? ray.tMax : -inf;
+		}
+		__m128 origin[3], direction[3], inverse_direction[3];
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			origin[axis] = _mm_load_ps(lanes[axis]);
+			direction[axis] = _mm_load_ps(lanes[3 + axis]);
+			inverse_direction[axis] = _mm_load_ps(lanes[6 + axis]);
+		}
+		const __m128 t_min = _mm_load_ps(lanes[9]);
+		__m128 closest = _mm_load_ps(lanes[10]);
+		__m128 closest_u = _mm_setzero_ps();
+		__m128 closest_v = _mm_setzero_ps();
+		__m128i closest_triangle = _mm_set1_epi32(static_cast<int>(kNoTriangle));
+
+		PacketStackEntry stack[kStackSize];
+		uint32_t stack_size = 0;
+		uint32_t child = bvh.nodes.empty() ? kEmptyChild : 0u;
+		while (kEmptyChild != child) {
+			if (0 == (child & kLeafBit)) {
+				const BvhNode& node = bvh.nodes[child];
+				PacketStackEntry hit_children[4];
+				float hit_distances[4];
+				uint32_t hit_count = 0;
+				for (uint32_t slot = 0; slot < 4 && kEmptyChild != node.children[slot]; ++slot) {
+					const float lo[3] = { node.minX[slot], node.minY[slot], node.minZ[slot] };
+					const float hi[3] = { node.maxX[slot], node.maxY[slot], node.maxZ[slot] };
+					__m128 t_near = t_min;
+					__m128 t_far = closest;
+					for (uint32_t axis = 0; axis < 3; ++axis) {
+						const __m128 t_lo = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(lo[axis]), origin[axis]), inverse_direction[axis]);
+						const __m128 t_hi = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(hi[axis]), origin[axis]), inverse_direction[axis]);
+						t_near = _mm_max_ps(t_near, _mm_min_ps(t_lo, t_hi));
+						t_far = _mm_min_ps(t_far, _mm_max_ps(t_lo, t_hi));
+					}
+					const __m128 hit = _mm_cmple_ps(t_near, t_far);
+					if (0 == _mm_movemask_ps(hit)) {
+						continue;
+					}
+					const __m128 entry_distances = selectPs(hit, t_near, _mm_set1_ps(inf));
+					alignas(16) float distances[4];
+					_mm_store_ps(distances, entry_distances);
+					const float distance = std::min(std::min(distances[0], distances[1]), std::min(distances[2], distances[3]));
+
+					// Insert by distance, the farthest first:
+					uint32_t i = hit_count++;
+					for (; i > 0 && hit_distances[i - 1] < distance; --i) {
+						hit_children[i] = hit_children[i - 1];
+						hit_distances[i] = hit_distances[i - 1];
+					}
+					hit_children[i].entryDistances = entry_distances;
+					hit_children[i].child = node.children[slot];
+					hit_distances[i] = distance;
+				}
+				if (hit_count > 0) {
+					for (uint32_t i = 0; i + 1 < hit_count; ++i) {
+						stack[stack_size++] = hit_children[i];
+					}
+					child = hit_children[hit_count - 1].child;
+					continue;
+				}
+			}
+			else {
+				const uint32_t first_packet = child & kLeafFirstPacketMask;
+				const uint32_t packets = ((child & ~kLeafBit) >> kLeafPacketCountShift) + 1u;
+				for (uint32_t p = first_packet; p < first_packet + packets; ++p) {
+					const BvhTrianglePacket& packet = bvh.packets[p];
+					for (uint32_t lane = 0; lane < 4 && kNoTriangle != packet.triangleIndices[lane]; ++lane) {
+						const __m128 e1x = _mm_set1_ps(packet.e1X[lane]);
+						const __m128 e1y = _mm_set1_ps(packet.e1Y[lane]);
+						const __m128 e1z = _mm_set1_ps(packet.e1Z[lane]);
+						const __m128 e2x = _mm_set1_ps(packet.e2X[lane]);
+						const __m128 e2y = _mm_set1_ps(packet.e2Y[lane]);
+						const __m128 e2z = _mm_set1_ps(packet.e2Z[lane]);
+						const __m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+						const __m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+						const __m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+						const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+						const __m128 sign = _mm_and_ps(determinant, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+						const __m128 abs_determinant = _mm_xor_ps(determinant, sign);
+
+						const __m128 sx = _mm_sub_ps(origin[0], _mm_set1_ps(packet.v0X[lane]));
+						const __m128 sy = _mm_sub_ps(origin[1], _mm_set1_ps(packet.v0Y[lane]));
+						const __m128 sz = _mm_sub_ps(origin[2], _mm_set1_ps(packet.v0Z[lane]));
+						const __m128 scaled_u = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), sign);
+						const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+						const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+						const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+						const __m128 scaled_v = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), sign);
+						const __m128 scaled_t = _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), sign);
+
+						const __m128 zero = _mm_setzero_ps();
+						__m128 hit = _mm_cmpgt_ps(abs_determinant, zero);
+						hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_u, zero));
+						hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_v, zero));
+						hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(scaled_u, scaled_v), abs_determinant));
+						hit = _mm_and_ps(hit, _mm_cmpge_ps(scaled_t, _mm_mul_ps(t_min, abs_determinant)));
+						hit = _mm_and_ps(hit, _mm_cmple_ps(scaled_t, _mm_mul_ps(closest, abs_determinant)));
+						if (0 == _mm_movemask_ps(hit)) {
+							continue;
+						}
+						const __m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), abs_determinant);
+						const __m128 t = _mm_mul_ps(scaled_t, inverse_determinant);
+						hit = _mm_and_ps(hit, _mm_cmple_ps(t, closest));
+						closest = selectPs(hit, t, closest);
+						closest_u = selectPs(hit, _mm_mul_ps(scaled_u, inverse_determinant), closest_u);
+						closest_v = selectPs(hit, _mm_mul_ps(scaled_v, inverse_determinant), closest_v);
+						closest_triangle = _mm_castps_si128(selectPs(hit,
+							_mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(packet.triangleIndices[lane]))), _mm_castsi128_ps(closest_triangle)));
+					}
+				}
+			}
+
+			// Pop the next child which any ray enters before its closest hit found so far:
+			child = kEmptyChild;
+			while (stack_size > 0) {
+				const PacketStackEntry& entry = stack[--stack_size];
+				if (0 != _mm_movemask_ps(_mm_cmple_ps(entry.entryDistances, closest))) {
+					child = entry.child;
+					break;
+				}
+			}
+		}
+
+		alignas(16) float t[4], u[4], v[4];
+		alignas(16) uint32_t triangles[4];
+		_mm_store_ps(t, closest);
+		_mm_store_ps(u, closest_u);
+		_mm_store_ps(v, closest_v);
+		_mm_store_si128(reinterpret_cast<__m128i*>(triangles), closest_triangle);
+		for (uint32_t lane = 0; lane < ray_count; ++lane) {
+			hits[lane] = { triangles[lane], t[lane], u[lane], v[lane] };
+			if (kNoTriangle == triangles[lane]) {
+				hits[lane].u = 0.0f;
+				hits[lane].v = 0.0f;
+			}
+		}
+	}
+#endif
+}
+
+Bvh bvhBuild(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, BvhBuildStats* stats)
+{
+	const auto start = std::chrono::steady_clock::now();
+	Bvh bvh = {};
+	bvh.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	BvhBuildStats build_stats = {};
+	build_stats.triangleCount = bvh.triangleCount;
+
+	if (bvh.triangleCount > 0) {
+		BuildInput input;
+		input.triangleBounds.resize(bvh.triangleCount);
+		input.centroids.resize(bvh.triangleCount);
+		input.order.resize(bvh.triangleCount);
+		jobParallelFor(bvh.triangleCount, kTrianglesPerBinningJob, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t triangle = begin; triangle < end; ++triangle) {
+				Aabb bounds = emptyAabb();
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					const glm::vec3& position = positions[indices[3 * triangle + corner]];
+					const float point[3] = { position.x, position.y, position.z };
+					grow(bounds, point);
+				}
+				input.triangleBounds[triangle] = bounds;
+				input.centroids[triangle] = glm::vec3(
+					0.5f * (bounds.lo[0] + bounds.hi[0]),
+					0.5f * (bounds.lo[1] + bounds.hi[1]),
+					0.5f * (bounds.lo[2] + bounds.hi[2]));
+				input.order[triangle] = triangle;
+			}
+		});
+
+		// Split the upper levels with parallel binning, then build the remaining subtrees in parallel:
+		std::vector<BuildNode> nodes;
+		nodes.push_back({ getRangeBounds(input, 0u, bvh.triangleCount), 0u, 0u, 0u, bvh.triangleCount });
+		std::vector<Subtree> subtrees;
+		buildTopLevels(input, nodes, 0u, 0u, subtrees);
+		jobParallelFor(static_cast<uint32_t>(subtrees.size()), 1u, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				Subtree& subtree = subtrees[i];
+				subtree.nodes.push_back(nodes[subtree.node]);
+				buildSubtree(input, subtree.nodes, 0u, subtree.depth);
+			}
+		});
+
+		// Append every subtree's nodes, and replace the node it has been built for by its root:
+		for (const Subtree& subtree : subtrees) {
+			const uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1u;
+			for (size_t i = 1; i < subtree.nodes.size(); ++i) {
+				BuildNode node = subtree.nodes[i];
+				if (0 == node.count) {
+					node.left += offset;
+					node.right += offset;
+				}
+				nodes.push_back(node);
+			}
+			BuildNode root = subtree.nodes[0];
+			if (0 == root.count) {
+				root.left += offset;
+				root.right += offset;
+			}
+			nodes[subtree.node] = root;
+		}
+
+		// Collapse the binary tree into one with four children per node:
+		if (nodes[0].count > 0) {
+			bvh.nodes.push_back({});
+			for (uint32_t slot = 1; slot < 4; ++slot) {
+				setChild(bvh.nodes[0], slot, emptyAabb(), kEmptyChild);
+			}
+			setChild(bvh.nodes[0], 0, nodes[0].bounds, createLeaf(positions, indices, input, nodes[0], bvh));
+			build_stats.maxDepth = 1;
+			build_stats.leafCount = 1;
+			build_stats.sahCost = (kTraversalCost + packetCount(nodes[0].count)) * halfArea(nodes[0].bounds);
+		}
+		else {
+			collapseNode(positions, indices, input, nodes, 0u, 0u, bvh, build_stats);
+		}
+		const float root_area = halfArea(nodes[0].bounds);
+		build_stats.sahCost = root_area > 0.0f ? build_stats.sahCost / root_area : 0.0f;
+	}
+
+	build_stats.nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+	build_stats.packetCount = static_cast<uint32_t>(bvh.packets.size());
+	build_stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (nullptr != stats) {
+		*stats = build_stats;
+	}
+	return bvh;
+}
+
+bool bvhIntersect(const Bvh& bvh, const BvhRay& ray, BvhHit& hit)
+{
+	return traverse<false>(bvh, ray, hit);
+}
+
+bool bvhOccluded(const Bvh& bvh, const BvhRay& ray)
+{
+	BvhHit hit;
+	return traverse<true>(bvh, ray, hit);
+}
+
+void bvhIntersectRays(const Bvh& bvh, const BvhRay* rays, uint32_t ray_count, BvhHit* hits)
+{
+	jobParallelFor(ray_count, kRaysPerJob, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			if (!traverse<false>(bvh, rays[i], hits[i])) {
+				hits[i] = { kNoTriangle, rays[i].tMax, 0.0f, 0.0f };
+			}
+		}
+	});
+}
+
+void bvhIntersectRayPackets(const Bvh& bvh, const BvhRay* rays, uint32_t ray_count, BvhHit* hits)
+{
+#if BVH_USE_SSE2
+	jobParallelFor((ray_count + 3u) / 4u, kRaysPerJob / 4u, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			traversePacket(bvh, rays + 4u * i, std::min(4u, ray_count - 4u * i), hits + 4u * i);
+		}
+	});
+#else
+	bvhIntersectRays(bvh, rays, ray_count, hits);
+#endif
+}
+
+BvhRay bvhCreatePickingRay(const glm::mat4& inverse_view_projection, float ndc_x, float ndc_y)
+{
+	const glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, 0.0f, 1.0f);
+	const glm::vec4 far_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+	const glm::vec3 origin = glm::vec3(near_point.x, near_point.y, near_point.z) / near_point.w;
+	const glm::vec3 end = glm::vec3(far_point.x, far_point.y, far_point.z) / far_point.w;
+	const float length = glm::length(end - origin);
+
+	BvhRay ray;
+	ray.origin = origin;
+	ray.direction = length > 0.0f ? (end - origin) / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	ray.tMin = 0.0f;
+	ray.tMax = length;
+	return ray;
+}
+
+void bvhLogStats(const char* name, const BvhBuildStats& stats)
+{
+	const double triangles_per_second = stats.milliseconds > 0.0 ? stats.triangleCount / (stats.milliseconds * 1e-3) : 0.0;
+	VKL_LOG(name << ": BVH over " << stats.triangleCount << " triangles with " << stats.nodeCount << " nodes, " << stats.leafCount << " leaves ("
+		<< stats.packetCount << " triangle packets), depth " << stats.maxDepth << ", SAH cost " << std::fixed << std::setprecision(2) << stats.sahCost
+		<< ", built in " << stats.milliseconds << " ms (" << triangles_per_second * 1e-6 << " Mtriangles/s)");
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// Bounding Volume Hierarchy Struct Definitions
+// As a convention, their names start with `Bvh`.
+/* --------------------------------------------- */
+
+/*!
+ * A ray, in the same space as the positions which the BVH has been built from.
+ * Only intersections with a distance t in [tMin, tMax] along the ray are reported;
+ * t is measured in multiples of the direction's length.
+ */
+struct BvhRay {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float tMin;
+	float tMax;
+};
+
+/*!
+ * The closest intersection of a ray with the triangles of a BVH.
+ */
+struct BvhHit {
+	//! Index of the hit triangle, i.e., its indices are at 3 * triangleIndex in the index data;
+	//! UINT32_MAX if the ray has not hit anything.
+	uint32_t triangleIndex;
+
+	//! Distance along the ray
+	float t;
+
+	//! Barycentric coordinates of the hit point w.r.t. the triangle's second and third vertex
+	float u;
+	float v;
+};
+
+/*!
+ * Node of a BVH with up to four children, whose bounds are stored as structure of arrays so that a
+ * ray can be tested against all of them at once.
+ */
+struct alignas(16) BvhNode {
+	float minX[4];
+	float minY[4];
+	float minZ[4];
+	float maxX[4];
+	float maxY[4];
+	float maxZ[4];
+
+	//! Per child: the index of an inner node in Bvh::nodes or, if the highest bit is set, a leaf, which references
+	//! (child >> 27 & 0xF) + 1 triangle packets, starting at (child & 0x7FFFFFF) in Bvh::packets. Unused children
+	//! have empty bounds and are set to UINT32_MAX.
+	uint32_t children[4];
+};
+
+/*!
+ * Four triangles, prepared for intersecting them with a ray at once: their first vertex and the two edges
+ * starting there, as structure of arrays. Lanes which are not used contain degenerate triangles.
+ */
+struct alignas(16) BvhTrianglePacket {
+	float v0X[4];
+	float v0Y[4];
+	float v0Z[4];
+	float e1X[4];
+	float e1Y[4];
+	float e1Z[4];
+	float e2X[4];
+	float e2Y[4];
+	float e2Z[4];
+	uint32_t triangleIndices[4];
+};
+
+/*!
+ * A bounding volume hierarchy over the triangles of a mesh, built with bvhBuild.
+ * It contains copies of all triangles, so that the mesh's data is not needed anymore to query it.
+ */
+struct Bvh {
+	//! All nodes, with the root at index 0, in depth-first order. Empty if the mesh has no triangles.
+	std::vector<BvhNode> nodes;
+
+	//! Triangles of all leaves
+	std::vector<BvhTrianglePacket> packets;
+
+	uint32_t triangleCount;
+};
+
+/*!
+ * Statistics of one invocation of bvhBuild.
+ */
+struct BvhBuildStats {
+	uint32_t triangleCount;
+	uint32_t nodeCount;
+	uint32_t leafCount;
+	uint32_t packetCount;
+	uint32_t maxDepth;
+
+	//! Expected cost of a ray query according to the surface area heuristic, in units of triangle packet tests
+	float sahCost;
+
+	//! Wall-clock time of the build
+	double milliseconds;
+};
+
+/* --------------------------------------------- */
+// Bounding Volume Hierarchy Function Definitions
+// As a convention, their names start with `bvh`.
+/* --------------------------------------------- */
+
+/*!
+ *	Builds a BVH over an indexed triangle mesh, e.g., the data of a VklGeometryData which has been
+ *	(or will be) uploaded as HlpGeometryHandles. Splits are chosen with the binned surface area heuristic.
+ *	The upper levels are split with the binning spread across the job system's workers, and the resulting
+ *	subtrees are then built in parallel (see jobInitSystem). The result does not depend on the number of workers.
+ *	@param	positions	Vertex positions
+ *	@param	indices		Triangle list indices into positions
+ *	@param	stats		Optionally receives statistics about the BVH and the build time
+ *	@return	The BVH, whose leaves contain at most eight triangles
+ */
+Bvh bvhBuild(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, BvhBuildStats* stats = nullptr);
+
+/*!
+ *	Finds the closest intersection of a ray with the BVH's triangles. Both sides of every triangle are hit.
+ *	Children of every node and triangles of every packet are tested with SSE2 where available.
+ *	@return	True if the ray hits a triangle, in which case `hit` has been written.
+ */
+bool bvhIntersect(const Bvh& bvh, const BvhRay& ray, BvhHit& hit);
+
+/*!
+ *	Determines whether a ray hits any triangle, e.g., for visibility queries. Stops at the first intersection
+ *	found, which makes it faster than bvhIntersect.
+ */
+bool bvhOccluded(const Bvh& bvh, const BvhRay& ray);
+
+/*!
+ *	Finds the closest intersections of many rays, spread across the job system's workers.
+ *	@param	hits	Receives one hit per ray; triangleIndex is UINT32_MAX for rays that do not hit anything.
+ */
+void bvhIntersectRays(const Bvh& bvh, const BvhRay* rays, uint32_t ray_count, BvhHit* hits);
+
+/*!
+ *	Like bvhIntersectRays, but traverses groups of four consecutive rays together as one packet, testing every node and
+ *	triangle against all four rays at once with SSE2. This is considerably faster for coherent rays, e.g., camera rays
+ *	through 2x2 pixel quads, but slower for incoherent ones. Without SSE2, the rays are traversed one by one.
+ */
+void bvhIntersectRayPackets(const Bvh& bvh, const BvhRay* rays, uint32_t ray_count, BvhHit* hits);
+
+/*!
+ *	Creates a ray through a point on the screen, e.g., under the mouse cursor, for picking objects.
+ *	@param	inverse_view_projection	The inverse of the projection matrix times the view matrix. Additionally multiply
+ *									by the inverse model matrix to get a ray in an object's space, i.e., in its BVH's space.
+ *	@param	ndc_x					Horizontal position in normalized device coordinates, -1 at the left border, 1 at the right
+ *	@param	ndc_y					Vertical position in normalized device coordinates, -1 at the top border, 1 at the bottom
+ *	@return	A ray with a normalized direction, which starts at the near plane and ends at the far plane (depths 0 and 1).
+ */
+BvhRay bvhCreatePickingRay(const glm::mat4& inverse_view_projection, float ndc_x, float ndc_y);
+
+/*!
+ *	Logs the statistics of a build.
+ */
+void bvhLogStats(const char* name, const BvhBuildStats& stats);
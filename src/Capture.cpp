@@ -0,0 +1,505 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Capture.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+/* --------------------------------------------- */
+// Internal definitions of the capture format
+/* --------------------------------------------- */
+
+namespace {
+
+	constexpr char     kMagic[4] = { 'V', 'L', 'C', 'R' };
+	constexpr uint32_t kVersion  = 1u;
+
+	// Frame flags:
+	constexpr uint8_t kViewMatrixStored       = 0x1;
+	constexpr uint8_t kProjectionMatrixStored = 0x2;
+
+	// Draw flags:
+	constexpr uint8_t kIdsStored          = 0x1;
+	constexpr uint8_t kTransformStored    = 0x2;
+	constexpr uint8_t kTransformIsAffine  = 0x4;
+
+	// Layout: [CaptureHeader][frames]. All members are 4 or 8 bytes in size, in descending order => no padding.
+	// Every frame: time delta, flags, camera matrices (if stored), draw count, draws, input event count, input events.
+	// Integers are zigzag-encoded where they may be negative and stored with 7 bits per byte.
+	struct CaptureHeader {
+		char     magic[4];
+		uint32_t version;
+		uint32_t frameCount;
+		uint32_t reserved;
+		//! Size of the frames following the header
+		uint64_t payloadSize;
+		//! FNV-1a hash of the frames
+		uint64_t checksum;
+	};
+
+	uint64_t zigzag64(int64_t value) {
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	int64_t unzigzag64(uint64_t v) {
+		return static_cast<int64_t>((v >> 1) ^ (0ull - (v & 1ull)));
+	}
+
+	void writeVarint(std::vector<uint8_t>& out, uint64_t v) {
+		while (v >= 0x80u) {
+			out.push_back(static_cast<uint8_t>(v | 0x80u));
+			v >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(v));
+	}
+
+	void writeFloats(std::vector<uint8_t>& out, const float* values, size_t count) {
+		const size_t offset = out.size();
+		out.resize(offset + sizeof(float) * count);
+		memcpy(out.data() + offset, values, sizeof(float) * count);
+	}
+
+	bool isAffine(const glm::mat4& m) {
+		return 0.0f == m[0][3] && 0.0f == m[1][3] && 0.0f == m[2][3] && 1.0f == m[3][3];
+	}
+
+	// Compares bit-exactly, so that -0 and NaNs are preserved by the encoding:
+	bool equalBits(const glm::mat4& a, const glm::mat4& b) {
+		return 0 == memcmp(&a, &b, sizeof(glm::mat4));
+	}
+
+	// State of the previous frame, which frames are delta-encoded against:
+	struct FrameContext {
+		int64_t timeNs = 0;
+		CapCamera camera = { glm::mat4(0.0f), glm::mat4(0.0f) };
+		std::vector<CapDraw> draws;
+	};
+
+	void encodeFrame(const CapFrame& frame, FrameContext& context, std::vector<uint8_t>& out) {
+		writeVarint(out, zigzag64(frame.timeNs - context.timeNs));
+
+		uint8_t frame_flags = 0;
+		frame_flags |= equalBits(frame.camera.viewMatrix, context.camera.viewMatrix) ? 0 : kViewMatrixStored;
+		frame_flags |= equalBits(frame.camera.projectionMatrix, context.camera.projectionMatrix) ? 0 : kProjectionMatrixStored;
+		out.push_back(frame_flags);
+		if (frame_flags & kViewMatrixStored) {
+			writeFloats(out, &frame.camera.viewMatrix[0][0], 16);
+		}
+		if (frame_flags & kProjectionMatrixStored) {
+			writeFloats(out, &frame.camera.projectionMatrix[0][0], 16);
+		}
+
+		writeVarint(out, frame.draws.size());
+		for (size_t i = 0; i < frame.draws.size(); ++i) {
+			const CapDraw& draw = frame.draws[i];
+			const CapDraw* previous = i < context.draws.size() ? &context.draws[i] : nullptr;
+			uint8_t draw_flags = 0;
+			if (nullptr == previous || draw.meshId != previous->meshId || draw.pipelineId != previous->pipelineId) {
+				draw_flags |= kIdsStored;
+			}
+			if (nullptr == previous || !equalBits(draw.modelMatrix, previous->modelMatrix)) {
+				draw_flags |= kTransformStored | (isAffine(draw.modelMatrix) ? kTransformIsAffine : 0);
+			}
+			out.push_back(draw_flags);
+			if (draw_flags & kIdsStored) {
+				writeVarint(out, draw.meshId);
+				writeVarint(out, draw.pipelineId);
+			}
+			if (draw_flags & kTransformIsAffine) {
+				for (int column = 0; column < 4; ++column) {
+					writeFloats(out, &draw.modelMatrix[column][0], 3);
+				}
+			}
+			else if (draw_flags & kTransformStored) {
+				writeFloats(out, &draw.modelMatrix[0][0], 16);
+			}
+		}
+
+		writeVarint(out, frame.inputEvents.size());
+		for (const CapInputEvent& event : frame.inputEvents) {
+			writeVarint(out, zigzag64(event.key));
+			writeVarint(out, zigzag64(event.action));
+			writeVarint(out, zigzag64(event.timeNs - context.timeNs));
+		}
+
+		context.timeNs = frame.timeNs;
+		context.camera = frame.camera;
+		context.draws = frame.draws;
+	}
+
+	struct Reader {
+		const uint8_t* data;
+		const uint8_t* end;
+
+		bool readByte(uint8_t& value) {
+			if (data == end) {
+				return false;
+			}
+			value = *data++;
+			return true;
+		}
+
+		bool readVarint(uint64_t& value) {
+			value = 0;
+			for (uint32_t shift = 0u; shift < 64u; shift += 7u) {
+				uint8_t byte;
+				if (!readByte(byte)) {
+					return false;
+				}
+				value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+				if (0 == (byte & 0x80u)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool readSigned(int64_t& value) {
+			uint64_t v;
+			if (!readVarint(v)) {
+				return false;
+			}
+			value = unzigzag64(v);
+			return true;
+		}
+
+		// Reads a count of items which take at least one byte each, so that corrupt counts cannot cause huge allocations:
+		bool readCount(size_t& count) {
+			uint64_t v;
+			if (!readVarint(v) || v > static_cast<uint64_t>(end - data)) {
+				return false;
+			}
+			count = static_cast<size_t>(v);
+			return true;
+		}
+
+		bool readFloats(float* values, size_t count) {
+			if (static_cast<size_t>(end - data) < sizeof(float) * count) {
+				return false;
+			}
+			memcpy(values, data, sizeof(float) * count);
+			data += sizeof(float) * count;
+			return true;
+		}
+	};
+
+	bool decodeFrame(Reader& reader, FrameContext& context, CapFrame& frame) {
+		int64_t time_delta;
+		uint8_t frame_flags;
+		if (!reader.readSigned(time_delta) || !reader.readByte(frame_flags)) {
+			return false;
+		}
+		frame.timeNs = context.timeNs + time_delta;
+		frame.camera = context.camera;
+		if ((frame_flags & kViewMatrixStored) && !reader.readFloats(&frame.camera.viewMatrix[0][0], 16)) {
+			return false;
+		}
+		if ((frame_flags & kProjectionMatrixStored) && !reader.readFloats(&frame.camera.projectionMatrix[0][0], 16)) {
+			return false;
+		}
+
+		size_t draw_count;
+		if (!reader.readCount(draw_count)) {
+			return false;
+		}
+		frame.draws.resize(draw_count);
+		for (size_t i = 0; i < draw_count; ++i) {
+			CapDraw& draw = frame.draws[i];
+			uint8_t draw_flags;
+			if (!reader.readByte(draw_flags)) {
+				return false;
+			}
+			const bool has_previous = i < context.draws.size();
+			if (!has_previous && (kIdsStored | kTransformStored) != (draw_flags & (kIdsStored | kTransformStored))) {
+				return false;
+			}
+			if (draw_flags & kIdsStored) {
+				uint64_t mesh_id, pipeline_id;
+				if (!reader.readVarint(mesh_id) || !reader.readVarint(pipeline_id) || mesh_id > UINT32_MAX || pipeline_id > UINT32_MAX) {
+					return false;
+				}
+				draw.meshId = static_cast<uint32_t>(mesh_id);
+				draw.pipelineId = static_cast<uint32_t>(pipeline_id);
+			}
+			else {
+				draw.meshId = context.draws[i].meshId;
+				draw.pipelineId = context.draws[i].pipelineId;
+			}
+			if (draw_flags & kTransformIsAffine) {
+				draw.modelMatrix = glm::mat4(1.0f);
+				for (int column = 0; column < 4; ++column) {
+					if (!reader.readFloats(&draw.modelMatrix[column][0], 3)) {
+						return false;
+					}
+				}
+			}
+			else if (draw_flags & kTransformStored) {
+				if (!reader.readFloats(&draw.modelMatrix[0][0], 16)) {
+					return false;
+				}
+			}
+			else {
+				draw.modelMatrix = context.draws[i].modelMatrix;
+			}
+		}
+
+		size_t event_count;
+		if (!reader.readCount(event_count)) {
+			return false;
+		}
+		frame.inputEvents.resize(event_count);
+		for (CapInputEvent& event : frame.inputEvents) {
+			int64_t key, action, event_time_delta;
+			if (!reader.readSigned(key) || !reader.readSigned(action) || !reader.readSigned(event_time_delta)) {
+				return false;
+			}
+			event.key = static_cast<int>(key);
+			event.action = static_cast<int>(action);
+			event.timeNs = context.timeNs + event_time_delta;
+		}
+
+		context.timeNs = frame.timeNs;
+		context.camera = frame.camera;
+		context.draws = frame.draws;
+		return true;
+	}
+
+	// State of the recording in progress:
+	FILE* mFile = nullptr;
+	bool mWriteFailed = false;
+	std::chrono::steady_clock::time_point mStartTime;
+	CapFrame mCurrentFrame;
+	FrameContext mContext;
+	std::vector<uint8_t> mEncodedFrame;
+	CaptureHeader mHeader;
+
+	int64_t nanosecondsSinceStart() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStartTime).count();
+	}
+}
+
+/* --------------------------------------------- */
+// Capture Function Definitions
+/* --------------------------------------------- */
+
+bool capBeginRecording(const char* path)
+{
+	if (nullptr != mFile) {
+		VKL_LOG("Cannot record to \"" << path << "\", since a recording is already in progress.");
+		return false;
+	}
+	mFile = fopen(path, "wb");
+	if (nullptr == mFile) {
+		return false;
+	}
+
+	// The header is written again with the final counts by capEndRecording:
+	mHeader = {};
+	memcpy(mHeader.magic, kMagic, sizeof(kMagic));
+	mHeader.version = kVersion;
+	mHeader.checksum = kHashFnv1aSeed;
+	mWriteFailed = fwrite(&mHeader, sizeof(CaptureHeader), 1, mFile) != 1;
+
+	mCurrentFrame.draws.clear();
+	mCurrentFrame.inputEvents.clear();
+	mContext = FrameContext();
+	mStartTime = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool capIsRecording()
+{
+	return nullptr != mFile;
+}
+
+void capRecordInputEvent(int key, int action)
+{
+	if (nullptr == mFile) {
+		return;
+	}
+	mCurrentFrame.inputEvents.push_back(CapInputEvent{ key, action, nanosecondsSinceStart() });
+}
+
+void capRecordDraws(const CapDraw* draws, uint32_t draw_count)
+{
+	if (nullptr == mFile) {
+		return;
+	}
+	mCurrentFrame.draws.insert(mCurrentFrame.draws.end(), draws, draws + draw_count);
+}
+
+void capEndFrame(const CapCamera& camera)
+{
+	if (nullptr == mFile) {
+		return;
+	}
+	mCurrentFrame.timeNs = nanosecondsSinceStart();
+	mCurrentFrame.camera = camera;
+
+	mEncodedFrame.clear();
+	encodeFrame(mCurrentFrame, mContext, mEncodedFrame);
+	mCurrentFrame.draws.clear();
+	mCurrentFrame.inputEvents.clear();
+
+	mHeader.frameCount += 1;
+	mHeader.payloadSize += mEncodedFrame.size();
+	mHeader.checksum = hashFnv1a(mEncodedFrame.data(), mEncodedFrame.size(), mHeader.checksum);
+	if (!mWriteFailed) {
+		mWriteFailed = fwrite(mEncodedFrame.data(), 1, mEncodedFrame.size(), mFile) != mEncodedFrame.size();
+	}
+}
+
+bool capEndRecording()
+{
+	if (nullptr == mFile) {
+		return false;
+	}
+	bool success = !mWriteFailed;
+	success = success && 0 == fseek(mFile, 0, SEEK_SET);
+	success = success && fwrite(&mHeader, sizeof(CaptureHeader), 1, mFile) == 1;
+	success = (0 == fclose(mFile)) && success;
+	mFile = nullptr;
+
+	if (success) {
+		VKL_LOG("Recorded " << mHeader.frameCount << " frames into " << (sizeof(CaptureHeader) + mHeader.payloadSize) << " bytes.");
+	}
+	else {
+		VKL_LOG("Failed to write the recording.");
+	}
+	return success;
+}
+
+std::vector<uint8_t> capEncodeRecording(const CapRecording& recording)
+{
+	std::vector<uint8_t> out(sizeof(CaptureHeader));
+	FrameContext context;
+	for (const CapFrame& frame : recording.frames) {
+		encodeFrame(frame, context, out);
+	}
+
+	CaptureHeader header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.frameCount = static_cast<uint32_t>(recording.frames.size());
+	header.payloadSize = out.size() - sizeof(CaptureHeader);
+	header.checksum = hashFnv1a(out.data() + sizeof(CaptureHeader), out.size() - sizeof(CaptureHeader));
+	memcpy(out.data(), &header, sizeof(CaptureHeader));
+	return out;
+}
+
+bool capDecodeRecording(const uint8_t* data, size_t size, CapRecording& recording)
+{
+	CaptureHeader header;
+	if (nullptr == data || size < sizeof(CaptureHeader)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(CaptureHeader));
+	if (0 != memcmp(header.magic, kMagic, sizeof(kMagic)) || kVersion != header.version
+		|| header.payloadSize != size - sizeof(CaptureHeader)
+		|| header.checksum != hashFnv1a(data + sizeof(CaptureHeader), size - sizeof(CaptureHeader))) {
+		return false;
+	}
+
+	// Every frame takes at least four bytes (time delta, flags, and two counts):
+	if (header.frameCount > header.payloadSize / 4) {
+		return false;
+	}
+	Reader reader = { data + sizeof(CaptureHeader), data + size };
+	FrameContext context;
+	recording.frames.resize(header.frameCount);
+	for (CapFrame& frame : recording.frames) {
+		if (!decodeFrame(reader, context, frame)) {
+			return false;
+		}
+	}
+	return reader.data == reader.end;
+}
+
+bool capLoadRecording(const char* path, CapRecording& recording)
+{
+	FILE* file = fopen(path, "rb");
+	if (nullptr == file) {
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t chunk[64 * 1024];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		data.insert(data.end(), chunk, chunk + read);
+	}
+	const bool read_failed = 0 != ferror(file);
+	fclose(file);
+
+	return !read_failed && capDecodeRecording(data.data(), data.size(), recording);
+}
+
+CapReplayStats capReplay(const CapRecording& recording, CapReplayMode mode, const CapFrameCallback& callback)
+{
+	CapReplayStats stats = {};
+	stats.frameCount = static_cast<uint32_t>(recording.frames.size());
+	if (recording.frames.empty()) {
+		return stats;
+	}
+
+	std::vector<double> frame_milliseconds(recording.frames.size());
+	const int64_t first_frame_ns = recording.frames.front().timeNs;
+	const auto replay_start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < stats.frameCount; ++i) {
+		const CapFrame& frame = recording.frames[i];
+		if (CAP_REPLAY_MODE_RECORDED_TIMING == mode) {
+			std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(frame.timeNs - first_frame_ns));
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		callback(frame, i);
+		frame_milliseconds[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		stats.drawCount += static_cast<uint32_t>(frame.draws.size());
+		stats.inputEventCount += static_cast<uint32_t>(frame.inputEvents.size());
+		if (i + 1 < stats.frameCount && frame_milliseconds[i] * 1e6 > static_cast<double>(recording.frames[i + 1].timeNs - frame.timeNs)) {
+			stats.lateFrameCount += 1;
+		}
+	}
+	stats.totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replay_start).count();
+
+	double sum = 0.0;
+	for (double milliseconds : frame_milliseconds) {
+		sum += milliseconds;
+	}
+	stats.meanMilliseconds = sum / stats.frameCount;
+	double squared_deviations = 0.0;
+	for (double milliseconds : frame_milliseconds) {
+		squared_deviations += (milliseconds - stats.meanMilliseconds) * (milliseconds - stats.meanMilliseconds);
+	}
+	stats.standardDeviationMilliseconds = std::sqrt(squared_deviations / stats.frameCount);
+
+	std::sort(frame_milliseconds.begin(), frame_milliseconds.end());
+	auto percentile = [&](double p) {
+		return frame_milliseconds[std::min(frame_milliseconds.size() - 1, static_cast<size_t>(p * frame_milliseconds.size()))];
+	};
+	stats.minMilliseconds = frame_milliseconds.front();
+	stats.medianMilliseconds = percentile(0.5);
+	stats.p95Milliseconds = percentile(0.95);
+	stats.p99Milliseconds = percentile(0.99);
+	stats.maxMilliseconds = frame_milliseconds.back();
+
+	if (stats.frameCount > 1) {
+		stats.recordedMeanMilliseconds = static_cast<double>(recording.frames.back().timeNs - first_frame_ns) * 1e-6 / (stats.frameCount - 1);
+	}
+	return stats;
+}
+
+void capLogReplayStats(const CapReplayStats& stats)
+{
+	VKL_LOG("Replayed " << stats.frameCount << " frames (" << stats.drawCount << " draws, " << stats.inputEventCount << " input events) in "
+		<< stats.totalMilliseconds << " ms; frame times: min " << stats.minMilliseconds << " ms, mean " << stats.meanMilliseconds
+		<< " ms (std. dev. " << stats.standardDeviationMilliseconds << " ms), median " << stats.medianMilliseconds << " ms, p95 "
+		<< stats.p95Milliseconds << " ms, p99 " << stats.p99Milliseconds << " ms, max " << stats.maxMilliseconds << " ms");
+	VKL_LOG("Recorded frame interval: " << stats.recordedMeanMilliseconds << " ms on average; " << stats.lateFrameCount
+		<< " frames took longer than their recorded interval.");
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/* --------------------------------------------- */
+// Capture Struct Definitions
+// As a convention, their names start with `Cap`.
+/* --------------------------------------------- */
+
+/*!
+ * One draw of a captured frame. IDs are chosen by the application, e.g., indices into its lists of meshes and pipelines,
+ * so that a replay can map them back to its own resources.
+ */
+struct CapDraw {
+	uint32_t meshId;
+	uint32_t pipelineId;
+	glm::mat4 modelMatrix;
+};
+
+/*!
+ * The camera of a captured frame, following Vulkan's conventions (clip space z in [0, w] and y pointing down).
+ */
+struct CapCamera {
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+};
+
+/*!
+ * A keyboard event of a captured frame, as received by the GLFW key callback.
+ */
+struct CapInputEvent {
+	//! One of the GLFW_KEY_* codes
+	int key;
+
+	//! GLFW_PRESS, GLFW_RELEASE, or GLFW_REPEAT
+	int action;
+
+	//! Time since the start of the recording in nanoseconds
+	int64_t timeNs;
+};
+
+/*!
+ * Everything that has been recorded for one frame.
+ */
+struct CapFrame {
+	//! Time since the start of the recording at which the frame has ended, in nanoseconds
+	int64_t timeNs;
+
+	CapCamera camera;
+	std::vector<CapDraw> draws;
+
+	//! Input events which have been received since the previous frame ended, in the order of their arrival
+	std::vector<CapInputEvent> inputEvents;
+};
+
+/*!
+ * A whole recording, as loaded with capLoadRecording or decoded with capDecodeRecording.
+ */
+struct CapRecording {
+	std::vector<CapFrame> frames;
+};
+
+/*!
+ * How capReplay paces the frames.
+ */
+enum CapReplayMode {
+	//! Every frame starts as soon as the previous one has been executed.
+	CAP_REPLAY_MODE_AS_FAST_AS_POSSIBLE = 0,
+	//! Every frame starts at the same time relative to the first one as during recording, unless the replay has fallen behind.
+	CAP_REPLAY_MODE_RECORDED_TIMING = 1,
+};
+
+/*!
+ * Frame time statistics of one invocation of capReplay. Frame times measure the execution of the frame callback.
+ */
+struct CapReplayStats {
+	uint32_t frameCount;
+	uint32_t drawCount;
+	uint32_t inputEventCount;
+
+	double minMilliseconds;
+	double meanMilliseconds;
+	double medianMilliseconds;
+	double p95Milliseconds;
+	double p99Milliseconds;
+	double maxMilliseconds;
+	double standardDeviationMilliseconds;
+
+	//! Mean time between two frames during recording
+	double recordedMeanMilliseconds;
+
+	//! Wall-clock time of the whole replay, including waiting in CAP_REPLAY_MODE_RECORDED_TIMING
+	double totalMilliseconds;
+
+	//! Number of frames which took longer than their recorded interval to the next frame;
+	//! in CAP_REPLAY_MODE_RECORDED_TIMING, these delay the frames after them.
+	uint32_t lateFrameCount;
+};
+
+/*!
+ * Callback which executes one replayed frame, e.g., by pushing its draws into a DrawQueue or by rendering them
+ * with the software rasterizer.
+ */
+typedef std::function<void(const CapFrame& frame, uint32_t frame_index)> CapFrameCallback;
+
+/* --------------------------------------------- */
+// Capture Function Definitions
+// As a convention, their names start with `cap`.
+/* --------------------------------------------- */
+
+/*!
+ *	Starts recording frames into a file. All recording functions must be invoked from the same thread, i.e., the
+ *	one which polls GLFW events and records frames. Frames are encoded and written as soon as they end.
+ *	@return	False if the file cannot be opened or a recording is already in progress
+ */
+bool capBeginRecording(const char* path);
+
+/*!
+ *	Returns true between capBeginRecording and capEndRecording.
+ */
+bool capIsRecording();
+
+/*!
+ *	Adds a keyboard event to the current frame, with the current time. Does nothing unless recording.
+ */
+void capRecordInputEvent(int key, int action);
+
+/*!
+ *	Adds draws to the current frame, in the order in which they are issued. Does nothing unless recording.
+ */
+void capRecordDraws(const CapDraw* draws, uint32_t draw_count);
+
+/*!
+ *	Ends the current frame, encodes it, and appends it to the file. Does nothing unless recording.
+ *	@param	camera	The camera which the frame's draws have been rendered with
+ */
+void capEndFrame(const CapCamera& camera);
+
+/*!
+ *	Finishes the file (frame count and checksum) and closes it. Frames which have not been ended are discarded.
+ *	@return	False if not recording or if writing has failed at any point
+ */
+bool capEndRecording();
+
+/*!
+ *	Encodes a recording into the same format as the files written by capBeginRecording.
+ *	Per draw, IDs and transforms are only stored if they differ from those of the previous frame's draw at the
+ *	same position, and affine transforms are stored as 4x3 matrices. Floats are stored bit-exactly.
+ */
+std::vector<uint8_t> capEncodeRecording(const CapRecording& recording);
+
+/*!
+ *	Decodes a recording, verifying its header and checksum.
+ *	@return	False if the data is not a valid recording
+ */
+bool capDecodeRecording(const uint8_t* data, size_t size, CapRecording& recording);
+
+/*!
+ *	Loads a recording from a file, see capDecodeRecording.
+ *	@return	False if the file cannot be read or is not a valid recording
+ */
+bool capLoadRecording(const char* path, CapRecording& recording);
+
+/*!
+ *	Executes all frames of a recording in order, on the calling thread. Does not require a window or a GPU unless
+ *	the callback does, so that replays can run headless.
+ *	@param	mode		Whether to replay as fast as possible or at the recorded timing
+ *	@param	callback	Executes one frame
+ *	@return	Frame time statistics
+ */
+CapReplayStats capReplay(const CapRecording& recording, CapReplayMode mode, const CapFrameCallback& callback);
+
+/*!
+ *	Logs the given statistics.
+ */
+void capLogReplayStats(const CapReplayStats& stats);
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "DdsImage.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint32_t kMagic = 0x20534444u; // "DDS "
+	const uint32_t kHeaderSize = 124u;
+	const uint32_t kDx10HeaderSize = 20u;
+
+	const uint32_t kPixelFormatFourCC = 0x4u;
+	const uint32_t kPixelFormatRgb = 0x40u;
+	const uint32_t kCaps2Cubemap = 0x200u;
+	const uint32_t kDx10MiscTextureCube = 0x4u;
+
+	constexpr uint32_t fourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	uint32_t readUint32(const uint8_t* data, size_t offset)
+	{
+		uint32_t value;
+		std::memcpy(&value, data + offset, sizeof(value));
+		return value;
+	}
+
+	VkFormat formatFromFourCC(uint32_t four_cc)
+	{
+		switch (four_cc) {
+		case fourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case fourCC('D', 'X', 'T', '2'):
+		case fourCC('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+		case fourCC('D', 'X', 'T', '4'):
+		case fourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '1'):
+		case fourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '2'):
+		case fourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat formatFromDxgiFormat(uint32_t dxgi_format)
+	{
+		switch (dxgi_format) {
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	// Returns the bytes per 4x4 block of block-compressed formats, or 0 for other formats
+	uint32_t bytesPerCompressedBlock(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			return 8u;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return 16u;
+		default:
+			return 0u;
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// DDS Image Function Definitions
+/* --------------------------------------------- */
+
+size_t ddsGetSubresourceSize(VkFormat format, uint32_t width, uint32_t height)
+{
+	const uint32_t block_bytes = bytesPerCompressedBlock(format);
+	if (block_bytes > 0) {
+		return static_cast<size_t>(std::max(1u, (width + 3) / 4)) * std::max(1u, (height + 3) / 4) * block_bytes;
+	}
+	return static_cast<size_t>(width) * height * 4;
+}
+
+bool ddsParse(const uint8_t* data, size_t size, DdsImageInfo& info)
+{
+	info = DdsImageInfo{};
+	if (nullptr == data || size < 4 + kHeaderSize || kMagic != readUint32(data, 0) || kHeaderSize != readUint32(data, 4)) {
+		return false;
+	}
+
+	// Offsets of DDS_HEADER's fields, relative to the file start (i.e., after the magic number):
+	info.height = readUint32(data, 12);
+	info.width = readUint32(data, 16);
+	info.mipLevelCount = std::max(1u, readUint32(data, 28));
+	const uint32_t pixel_format_flags = readUint32(data, 80);
+	const uint32_t four_cc = readUint32(data, 84);
+	const uint32_t rgb_bit_count = readUint32(data, 88);
+	const uint32_t red_mask = readUint32(data, 92);
+	const uint32_t caps2 = readUint32(data, 112);
+
+	size_t data_offset = 4 + kHeaderSize;
+	uint32_t array_size = 1;
+	info.isCubemap = 0 != (caps2 & kCaps2Cubemap);
+	if ((pixel_format_flags & kPixelFormatFourCC) && fourCC('D', 'X', '1', '0') == four_cc) {
+		if (size < data_offset + kDx10HeaderSize) {
+			return false;
+		}
+		info.format = formatFromDxgiFormat(readUint32(data, data_offset));
+		info.isCubemap = info.isCubemap || 0 != (readUint32(data, data_offset + 8) & kDx10MiscTextureCube);
+		array_size = std::max(1u, readUint32(data, data_offset + 12));
+		data_offset += kDx10HeaderSize;
+	}
+	else if (pixel_format_flags & kPixelFormatFourCC) {
+		info.format = formatFromFourCC(four_cc);
+	}
+	else if ((pixel_format_flags & kPixelFormatRgb) && 32 == rgb_bit_count) {
+		info.format = 0x000000ffu == red_mask ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_B8G8R8A8_UNORM;
+	}
+	if (VK_FORMAT_UNDEFINED == info.format || 0 == info.width || 0 == info.height) {
+		return false;
+	}
+
+	info.bytesPerBlock = bytesPerCompressedBlock(info.format);
+	info.isBlockCompressed = info.bytesPerBlock > 0;
+	if (!info.isBlockCompressed) {
+		info.bytesPerBlock = 4;
+	}
+	info.layerCount = (info.isCubemap ? 6 : 1) * array_size;
+
+	info.subresources.resize(static_cast<size_t>(info.layerCount) * info.mipLevelCount);
+	size_t offset = data_offset;
+	for (uint32_t layer = 0; layer < info.layerCount; ++layer) {
+		for (uint32_t level = 0; level < info.mipLevelCount; ++level) {
+			DdsSubresource& subresource = info.subresources[static_cast<size_t>(layer) * info.mipLevelCount + level];
+			subresource.width = std::max(1u, info.width >> level);
+			subresource.height = std::max(1u, info.height >> level);
+			subresource.offset = offset;
+			subresource.size = ddsGetSubresourceSize(info.format, subresource.width, subresource.height);
+			offset += subresource.size;
+		}
+	}
+	return offset <= size;
+}
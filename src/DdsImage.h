@@ -0,0 +1,67 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// DDS Image Struct Definitions
+// As a convention, their names start with `Dds`.
+/* --------------------------------------------- */
+
+/*!
+ * Location of one mip level of one layer within a DDS file's data.
+ */
+struct DdsSubresource {
+	uint32_t width;
+	uint32_t height;
+
+	//! Offset from the start of the file, and size in bytes
+	size_t offset;
+	size_t size;
+};
+
+/*!
+ * Describes the contents of a DDS file. The data itself stays in the file's memory,
+ * so that it can be copied into a staging buffer directly.
+ */
+struct DdsImageInfo {
+	//! Format of the data, e.g., VK_FORMAT_BC2_UNORM_BLOCK for DXT3-compressed files
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevelCount;
+
+	//! 6 for cubemaps (in the order +x, -x, +y, -y, +z, -z), times the array size for arrays
+	uint32_t layerCount;
+	bool isCubemap;
+
+	//! Bytes per 4x4 block for block-compressed formats, or per texel otherwise
+	uint32_t bytesPerBlock;
+	bool isBlockCompressed;
+
+	//! All mip levels of the first layer, followed by all mip levels of the next layer, and so on
+	std::vector<DdsSubresource> subresources;
+};
+
+/* --------------------------------------------- */
+// DDS Image Function Definitions
+// As a convention, their names start with `dds`.
+/* --------------------------------------------- */
+
+/*!
+ *	Parses the header of a DDS file (including the DX10 header extension) and computes where each
+ *	subresource is located. Supports BC1-BC5 and BC7 compressed as well as RGBA8/BGRA8 uncompressed formats.
+ *	@param	data	The whole file's contents
+ *	@param	size	Size of data in bytes
+ *	@param	info	Receives the description of the file's contents
+ *	@return	True on success, false if the data is not a supported DDS file or truncated.
+ */
+bool ddsParse(const uint8_t* data, size_t size, DdsImageInfo& info);
+
+/*!
+ *	Returns the size in bytes of one subresource with the given format and dimensions.
+ */
+size_t ddsGetSubresourceSize(VkFormat format, uint32_t width, uint32_t height);
@@ -0,0 +1,349 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string>
+
+namespace
+{
+	constexpr uint32_t kMaxSetsPerPool = 4096;
+
+	// Bindings of the bindless table's arrays:
+	constexpr uint32_t kBindlessImages = 0;
+	constexpr uint32_t kBindlessCubeImages = 1;
+	constexpr uint32_t kBindlessSamplers = 2;
+
+	VkDescriptorPool createPool(const std::vector<DescPoolSizeRatio>& ratios, uint32_t set_count)
+	{
+		std::vector<VkDescriptorPoolSize> pool_sizes;
+		for (const DescPoolSizeRatio& ratio : ratios) {
+			pool_sizes.push_back(VkDescriptorPoolSize{ ratio.type, std::max(1u, static_cast<uint32_t>(std::ceil(ratio.ratio * static_cast<float>(set_count)))) });
+		}
+
+		VkDescriptorPoolCreateInfo pool_create_info = {};
+		pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_create_info.maxSets = set_count;
+		pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+		pool_create_info.pPoolSizes = pool_sizes.data();
+
+		VkDescriptorPool pool;
+		VkResult result = vkCreateDescriptorPool(vklGetDevice(), &pool_create_info, nullptr, &pool);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to create descriptor pool with error: ") + std::to_string(result));
+		}
+		return pool;
+	}
+
+	// Makes a reset pool or a new, larger one the current frame slot's pool to allocate from
+	void acquirePool(DescAllocator& allocator)
+	{
+		VkDescriptorPool pool;
+		if (!allocator.freePools.empty()) {
+			pool = allocator.freePools.back();
+			allocator.freePools.pop_back();
+		}
+		else {
+			pool = createPool(allocator.ratios, allocator.setsPerPool);
+			allocator.setsPerPool = std::min(allocator.setsPerPool * 2u, kMaxSetsPerPool);
+			++allocator.stats.poolsCreated;
+		}
+		allocator.slotPools[allocator.currentSlot].push_back(pool);
+	}
+
+	uint32_t arrayIndexOf(VkImageViewType view_type)
+	{
+		if (VK_IMAGE_VIEW_TYPE_2D == view_type) {
+			return kBindlessImages;
+		}
+		if (VK_IMAGE_VIEW_TYPE_CUBE == view_type) {
+			return kBindlessCubeImages;
+		}
+		VKL_EXIT_WITH_ERROR("Bindless table only supports image views of type VK_IMAGE_VIEW_TYPE_2D and VK_IMAGE_VIEW_TYPE_CUBE.");
+		return kBindlessImages;
+	}
+
+	uint32_t allocateIndex(DescBindlessTable& table, uint32_t array)
+	{
+		if (!table.freeIndices[array].empty()) {
+			const uint32_t index = table.freeIndices[array].back();
+			table.freeIndices[array].pop_back();
+			return index;
+		}
+		if (table.nextIndices[array] >= table.capacities[array]) {
+			VKL_EXIT_WITH_ERROR("Bindless table is full: all " << table.capacities[array] << " entries of binding " << array << " are in use.");
+		}
+		return table.nextIndices[array]++;
+	}
+
+	void freeIndex(DescBindlessTable& table, uint32_t array, uint32_t index)
+	{
+		assert(index < table.nextIndices[array]);
+		assert(std::find(table.freeIndices[array].begin(), table.freeIndices[array].end(), index) == table.freeIndices[array].end());
+		table.freeIndices[array].push_back(index);
+	}
+}
+
+/* --------------------------------------------- */
+// Descriptor Allocator Function Definitions
+/* --------------------------------------------- */
+
+DescAllocator descCreateAllocator(const std::vector<DescPoolSizeRatio>& ratios, uint32_t initial_sets_per_pool, uint32_t frame_slot_count)
+{
+	DescAllocator allocator = {};
+	allocator.ratios = ratios;
+	allocator.setsPerPool = std::min(std::max(initial_sets_per_pool, 1u), kMaxSetsPerPool);
+	allocator.slotPools.resize(std::max(frame_slot_count, 1u));
+	return allocator;
+}
+
+void descDestroyAllocator(DescAllocator& allocator)
+{
+	const auto device = vklGetDevice();
+	for (VkDescriptorPool pool : allocator.freePools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	for (const std::vector<VkDescriptorPool>& pools : allocator.slotPools) {
+		for (VkDescriptorPool pool : pools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+	}
+	allocator = DescAllocator{};
+}
+
+void descBeginFrame(DescAllocator& allocator, uint32_t frame_slot)
+{
+	if (frame_slot >= allocator.slotPools.size()) {
+		VKL_EXIT_WITH_ERROR("Frame slot " << frame_slot << " is out of range; the descriptor allocator has " << allocator.slotPools.size() << " frame slots.");
+	}
+
+	const auto device = vklGetDevice();
+	for (VkDescriptorPool pool : allocator.slotPools[frame_slot]) {
+		VkResult result = vkResetDescriptorPool(device, pool, 0);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to reset descriptor pool with error: ") + std::to_string(result));
+		}
+		allocator.freePools.push_back(pool);
+		++allocator.stats.poolResets;
+	}
+	allocator.slotPools[frame_slot].clear();
+	allocator.currentSlot = frame_slot;
+}
+
+VkDescriptorSet descAllocateSet(DescAllocator& allocator, VkDescriptorSetLayout layout)
+{
+	std::vector<VkDescriptorPool>& pools = allocator.slotPools[allocator.currentSlot];
+	if (pools.empty()) {
+		acquirePool(allocator);
+	}
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = pools.back();
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	VkResult result = vkAllocateDescriptorSets(vklGetDevice(), &allocate_info, &set);
+	if (VK_ERROR_OUT_OF_POOL_MEMORY == result || VK_ERROR_FRAGMENTED_POOL == result) {
+		// The pool is exhausted => continue with another one; it stays in this slot until the slot's next frame:
+		acquirePool(allocator);
+		allocate_info.descriptorPool = pools.back();
+		result = vkAllocateDescriptorSets(vklGetDevice(), &allocate_info, &set);
+	}
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to allocate descriptor set with error: ") + std::to_string(result));
+	}
+	++allocator.stats.setsAllocated;
+	return set;
+}
+
+void descLogAllocatorStats(const DescAllocator& allocator)
+{
+	size_t pools_in_use = 0;
+	for (const std::vector<VkDescriptorPool>& pools : allocator.slotPools) {
+		pools_in_use += pools.size();
+	}
+	VKL_LOG("Descriptor allocator: " << allocator.stats.setsAllocated << " sets allocated, " << allocator.stats.poolsCreated << " pools created ("
+		<< pools_in_use << " in use, " << allocator.freePools.size() << " free), " << allocator.stats.poolResets << " pool resets");
+}
+
+bool descIsBindlessSupported(VkPhysicalDevice physical_device)
+{
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+	indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexing_features;
+	vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+	return VK_TRUE == indexing_features.runtimeDescriptorArray
+		&& VK_TRUE == indexing_features.descriptorBindingPartiallyBound
+		&& VK_TRUE == indexing_features.descriptorBindingSampledImageUpdateAfterBind
+		&& VK_TRUE == indexing_features.descriptorBindingUpdateUnusedWhilePending
+		&& VK_TRUE == indexing_features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT descGetBindlessDeviceFeatures()
+{
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+	indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexing_features.runtimeDescriptorArray = VK_TRUE;
+	indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+	indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	return indexing_features;
+}
+
+DescBindlessTable descCreateBindlessTable(VkPhysicalDevice physical_device, uint32_t image_capacity, uint32_t cube_image_capacity, uint32_t sampler_capacity)
+{
+	if (!descIsBindlessSupported(physical_device)) {
+		VKL_EXIT_WITH_ERROR("The physical device does not support the descriptor indexing features required for a bindless table.");
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_properties = {};
+	indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexing_properties;
+	vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+	DescBindlessTable table = {};
+	// Both image arrays count against the per-stage limit, because the fragment shader can access both:
+	const uint32_t max_images = std::min(indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages, indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	table.capacities[kBindlessCubeImages] = std::max(1u, std::min(cube_image_capacity, max_images / 2u));
+	table.capacities[kBindlessImages] = std::max(1u, std::min(image_capacity, max_images - table.capacities[kBindlessCubeImages]));
+	table.capacities[kBindlessSamplers] = std::max(1u, std::min({ sampler_capacity, indexing_properties.maxDescriptorSetUpdateAfterBindSamplers, indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers }));
+
+	const VkDescriptorType types[3] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER };
+	VkDescriptorSetLayoutBinding bindings[3] = {};
+	VkDescriptorBindingFlagsEXT binding_flags[3] = {};
+	VkDescriptorPoolSize pool_sizes[2] = { { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 0 }, { VK_DESCRIPTOR_TYPE_SAMPLER, 0 } };
+	for (uint32_t i = 0; i < 3; ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = types[i];
+		bindings[i].descriptorCount = table.capacities[i];
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+		// Unused entries may stay unwritten, and entries may be written while the set is bound in pending command buffers
+		// (as long as those do not access them):
+		binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+		pool_sizes[VK_DESCRIPTOR_TYPE_SAMPLER == types[i] ? 1 : 0].descriptorCount += table.capacities[i];
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_create_info = {};
+	binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	binding_flags_create_info.bindingCount = 3;
+	binding_flags_create_info.pBindingFlags = binding_flags;
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.pNext = &binding_flags_create_info;
+	layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layout_create_info.bindingCount = 3;
+	layout_create_info.pBindings = bindings;
+
+	const auto device = vklGetDevice();
+	VkResult result = vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &table.layout);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create bindless descriptor set layout with error: ") + std::to_string(result));
+	}
+
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	result = vkCreateDescriptorPool(device, &pool_create_info, nullptr, &table.pool);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create bindless descriptor pool with error: ") + std::to_string(result));
+	}
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = table.pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &table.layout;
+	result = vkAllocateDescriptorSets(device, &allocate_info, &table.set);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to allocate bindless descriptor set with error: ") + std::to_string(result));
+	}
+
+	VKL_LOG("Bindless table created with " << table.capacities[kBindlessImages] << " images, " << table.capacities[kBindlessCubeImages]
+		<< " cube images, and " << table.capacities[kBindlessSamplers] << " samplers.");
+	return table;
+}
+
+void descDestroyBindlessTable(DescBindlessTable& table)
+{
+	const auto device = vklGetDevice();
+	// Destroying the pool frees the set:
+	vkDestroyDescriptorPool(device, table.pool, nullptr);
+	vkDestroyDescriptorSetLayout(device, table.layout, nullptr);
+	table = DescBindlessTable{};
+}
+
+uint32_t descBindlessAddImage(DescBindlessTable& table, VkImageView image_view, VkImageViewType view_type)
+{
+	const uint32_t array = arrayIndexOf(view_type);
+	const uint32_t index = allocateIndex(table, array);
+
+	VkDescriptorImageInfo image_info = {};
+	image_info.imageView = image_view;
+	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = table.set;
+	write.dstBinding = array;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vklGetDevice(), 1, &write, 0, nullptr);
+	return index;
+}
+
+uint32_t descBindlessAddSampler(DescBindlessTable& table, VkSampler sampler)
+{
+	const uint32_t index = allocateIndex(table, kBindlessSamplers);
+
+	VkDescriptorImageInfo image_info = {};
+	image_info.sampler = sampler;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = table.set;
+	write.dstBinding = kBindlessSamplers;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vklGetDevice(), 1, &write, 0, nullptr);
+	return index;
+}
+
+void descBindlessRemoveImage(DescBindlessTable& table, uint32_t index, VkImageViewType view_type)
+{
+	// Partially bound => the stale descriptor may stay in place until the index is reused.
+	freeIndex(table, arrayIndexOf(view_type), index);
+}
+
+void descBindlessRemoveSampler(DescBindlessTable& table, uint32_t index)
+{
+	freeIndex(table, kBindlessSamplers, index);
+}
+
+void descBindlessBind(const DescBindlessTable& table, VkPipelineLayout pipeline_layout, uint32_t set_index)
+{
+	vkCmdBindDescriptorSets(vklGetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_index, 1, &table.set, 0, nullptr);
+}
+
+void descPushMaterialIndex(VkPipelineLayout pipeline_layout, VkShaderStageFlags stages, uint32_t material_index)
+{
+	vkCmdPushConstants(vklGetCurrentCommandBuffer(), pipeline_layout, stages, 0, sizeof(uint32_t), &material_index);
+}
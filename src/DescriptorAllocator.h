@@ -0,0 +1,168 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// Descriptor Allocator Struct Definitions
+// As a convention, their names start with `Desc`.
+/* --------------------------------------------- */
+
+/*!
+ * How many descriptors of a type a pool gets per descriptor set it can hold.
+ * E.g., { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f } if sets have two textures on average.
+ */
+struct DescPoolSizeRatio {
+	VkDescriptorType type;
+	float ratio;
+};
+
+/*!
+ * Statistics of a descriptor allocator.
+ */
+struct DescAllocatorStats {
+	uint32_t poolsCreated;
+	uint32_t poolResets;
+	uint64_t setsAllocated;
+};
+
+/*!
+ * Allocates descriptor sets from pools which are created on demand (each new pool holds twice as many sets as
+ * the previous one, up to 4096). Pools are tracked per frame slot: descBeginFrame resets all pools that the
+ * slot used before and makes them available again, so per-frame sets cost no pool creation in the steady state.
+ */
+struct DescAllocator {
+	std::vector<DescPoolSizeRatio> ratios;
+	uint32_t setsPerPool;
+
+	//! Pools which have been reset and can be used by any frame slot
+	std::vector<VkDescriptorPool> freePools;
+
+	//! Pools in use per frame slot; the last one of each slot is the one allocated from.
+	std::vector<std::vector<VkDescriptorPool>> slotPools;
+	uint32_t currentSlot;
+
+	DescAllocatorStats stats;
+};
+
+/*!
+ * A bindless table: one descriptor set with large, partially bound arrays of sampled 2D images, sampled cube images,
+ * and samplers, which is bound once and indexed from shaders, e.g., by a per-draw material index in a push constant:
+ *
+ *     #extension GL_EXT_nonuniform_qualifier : require
+ *     layout(set = 0, binding = 0) uniform texture2D   textures[];
+ *     layout(set = 0, binding = 1) uniform textureCube cubeTextures[];
+ *     layout(set = 0, binding = 2) uniform sampler     samplers[];
+ *     ... texture(sampler2D(textures[nonuniformEXT(image_index)], samplers[sampler_index]), uv)
+ *
+ * Requires VK_EXT_descriptor_indexing (core in Vulkan 1.2); see descIsBindlessSupported.
+ */
+struct DescBindlessTable {
+	VkDescriptorSetLayout layout;
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+
+	//! Capacities of the arrays at bindings 0 (2D images), 1 (cube images), and 2 (samplers)
+	uint32_t capacities[3];
+
+	//! Next never-used index and freed indices per array
+	uint32_t nextIndices[3];
+	std::vector<uint32_t> freeIndices[3];
+};
+
+/* --------------------------------------------- */
+// Descriptor Allocator Function Definitions
+// As a convention, their names start with `desc`.
+/* --------------------------------------------- */
+
+/*!
+ *	Creates an allocator; no pools are created until the first allocation.
+ *	@param	ratios					Descriptors per set for each type the sets contain
+ *	@param	initial_sets_per_pool	Number of sets the first pool can hold
+ *	@param	frame_slot_count		Number of frame slots, e.g., vklGetNumFramebuffers(), or 1 for sets
+ *									which live until the allocator is destroyed.
+ */
+DescAllocator descCreateAllocator(const std::vector<DescPoolSizeRatio>& ratios, uint32_t initial_sets_per_pool = 64, uint32_t frame_slot_count = 1);
+
+/*!
+ *	Destroys all pools and with them all sets allocated from this allocator.
+ */
+void descDestroyAllocator(DescAllocator& allocator);
+
+/*!
+ *	Switches to the given frame slot and resets all pools this slot has used before, which frees their sets.
+ *	@param	frame_slot	E.g., vklGetCurrentSwapChainImageIndex(), after the framework has waited for that image's previous commands.
+ */
+void descBeginFrame(DescAllocator& allocator, uint32_t frame_slot);
+
+/*!
+ *	Allocates a descriptor set with the given layout from the current frame slot's pool,
+ *	switching to another pool (and creating it if needed) if that pool is exhausted.
+ */
+VkDescriptorSet descAllocateSet(DescAllocator& allocator, VkDescriptorSetLayout layout);
+
+/*!
+ *	Logs the number of pools created, pool resets, and sets allocated.
+ */
+void descLogAllocatorStats(const DescAllocator& allocator);
+
+/*!
+ *	Returns true if the physical device supports everything that the bindless table requires:
+ *	runtime descriptor arrays, non-uniform indexing of sampled images, partially bound descriptors,
+ *	and updates of sampled image descriptors after binding.
+ */
+bool descIsBindlessSupported(VkPhysicalDevice physical_device);
+
+/*!
+ *	Returns the descriptor indexing features that the bindless table requires. Chain them into
+ *	VkDeviceCreateInfo::pNext and enable VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME (unless the
+ *	device is created with Vulkan 1.2 or higher) when creating the device.
+ */
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT descGetBindlessDeviceFeatures();
+
+/*!
+ *	Creates a bindless table. Capacities are clamped to the device's update-after-bind limits.
+ *	@param	physical_device		The physical device the framework has been initialized with
+ */
+DescBindlessTable descCreateBindlessTable(VkPhysicalDevice physical_device, uint32_t image_capacity = 4096, uint32_t cube_image_capacity = 64, uint32_t sampler_capacity = 64);
+
+/*!
+ *	Destroys the table's set, pool, and layout. The images and samplers are not destroyed.
+ */
+void descDestroyBindlessTable(DescBindlessTable& table);
+
+/*!
+ *	Writes an image view into the 2D or cube array, depending on its view type, and returns its index in that array.
+ *	Note: hlpCreateImageView creates 2D views; create cubemap views with hlpCreateCubeImageView.
+ *	@param	image_view		A view of an image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL layout
+ *	@param	view_type		VK_IMAGE_VIEW_TYPE_2D or VK_IMAGE_VIEW_TYPE_CUBE
+ */
+uint32_t descBindlessAddImage(DescBindlessTable& table, VkImageView image_view, VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D);
+
+/*!
+ *	Writes a sampler, e.g., one created with hlpCreateSampler, into the sampler array and returns its index.
+ */
+uint32_t descBindlessAddSampler(DescBindlessTable& table, VkSampler sampler);
+
+/*!
+ *	Makes an image's index available for reuse. Shaders of frames still in flight must not access it anymore.
+ */
+void descBindlessRemoveImage(DescBindlessTable& table, uint32_t index, VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D);
+
+/*!
+ *	Makes a sampler's index available for reuse. Shaders of frames still in flight must not access it anymore.
+ */
+void descBindlessRemoveSampler(DescBindlessTable& table, uint32_t index);
+
+/*!
+ *	Binds the table's set into the current command buffer; once per pipeline layout change is enough.
+ */
+void descBindlessBind(const DescBindlessTable& table, VkPipelineLayout pipeline_layout, uint32_t set_index = 0);
+
+/*!
+ *	Pushes a per-draw material index (a uint32_t at push constant offset 0) into the current command buffer.
+ */
+void descPushMaterialIndex(VkPipelineLayout pipeline_layout, VkShaderStageFlags stages, uint32_t material_index);
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "DrawQueue.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Records the sorted draws into cb, or only counts the binds if cb is VK_NULL_HANDLE:
+	DrawQueueStats processQueue(const DrawQueue& queue, VkCommandBuffer cb)
+	{
+		DrawQueueStats stats = {};
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		VkDescriptorSet bound_descriptor_set = VK_NULL_HANDLE;
+		uint32_t bound_dynamic_offset = 0;
+		VkBuffer bound_vertex_buffers[3] = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+		VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+		VkIndexType bound_index_type = VK_INDEX_TYPE_UINT32;
+
+		for (const uint32_t index : queue.order) {
+			const DrawItem& item = queue.items[index];
+			const HlpGeometryHandles& geometry = *item.geometry;
+
+			const bool pipeline_changed = item.pipeline != bound_pipeline;
+			if (pipeline_changed) {
+				if (VK_NULL_HANDLE != cb) {
+					vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, item.pipeline);
+				}
+				bound_pipeline = item.pipeline;
+				++stats.pipelineBinds;
+			}
+			// The new pipeline's layout is not known here => rebind the set after every pipeline change:
+			if (VK_NULL_HANDLE != item.descriptorSet && (pipeline_changed || item.descriptorSet != bound_descriptor_set
+				|| (VK_NULL_HANDLE != item.pipelineLayout && item.dynamicOffset != bound_dynamic_offset))) {
+				if (VK_NULL_HANDLE != cb) {
+					if (VK_NULL_HANDLE != item.pipelineLayout) {
+						vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, item.pipelineLayout, 0u, 1u, &item.descriptorSet, 1u, &item.dynamicOffset);
+					}
+					else {
+						vklBindDescriptorSetToPipeline(item.descriptorSet, item.pipeline);
+					}
+				}
+				bound_descriptor_set = item.descriptorSet;
+				bound_dynamic_offset = item.dynamicOffset;
+				++stats.descriptorSetBinds;
+			}
+
+			const VkBuffer vertex_buffers[3] = { geometry.positionsBuffer, geometry.normalsBuffer, geometry.textureCoordinatesBuffer };
+			for (uint32_t binding = 0; binding < 3; ++binding) {
+				if (VK_NULL_HANDLE != vertex_buffers[binding] && vertex_buffers[binding] != bound_vertex_buffers[binding]) {
+					if (VK_NULL_HANDLE != cb) {
+						const VkDeviceSize offset = 0;
+						vkCmdBindVertexBuffers(cb, binding, 1u, &vertex_buffers[binding], &offset);
+					}
+					bound_vertex_buffers[binding] = vertex_buffers[binding];
+					++stats.vertexBufferBinds;
+				}
+			}
+			if (geometry.indicesBuffer != bound_index_buffer || geometry.indexType != bound_index_type) {
+				if (VK_NULL_HANDLE != cb) {
+					vkCmdBindIndexBuffer(cb, geometry.indicesBuffer, 0, geometry.indexType);
+				}
+				bound_index_buffer = geometry.indicesBuffer;
+				bound_index_type = geometry.indexType;
+				++stats.indexBufferBinds;
+			}
+
+			if (VK_NULL_HANDLE != cb) {
+				if (nullptr != item.pushConstants) {
+					vkCmdPushConstants(cb, item.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0u, item.pushConstantsSize, item.pushConstants);
+				}
+				const uint32_t index_count = 0u == item.indexCount ? geometry.numberOfIndices : item.indexCount;
+				vkCmdDrawIndexed(cb, index_count, 1u, item.firstIndex, 0, 0u);
+			}
+			++stats.drawCount;
+
+			// Binding everything for every draw: pipeline, positions, indices, plus descriptor set, normals, and texture coordinates if present
+			stats.naiveBinds += 3u + (VK_NULL_HANDLE != item.descriptorSet ? 1u : 0u)
+				+ (VK_NULL_HANDLE != geometry.normalsBuffer ? 1u : 0u) + (VK_NULL_HANDLE != geometry.textureCoordinatesBuffer ? 1u : 0u);
+		}
+
+		return stats;
+	}
+}
+
+/* --------------------------------------------- */
+// Draw Queue Function Definitions
+/* --------------------------------------------- */
+
+uint64_t drawMakeSortKey(uint32_t pipeline_index, uint32_t descriptor_set_index, uint32_t mesh_index, float view_depth, float max_depth)
+{
+	assert(pipeline_index < (1u << 10));
+	assert(descriptor_set_index < (1u << 14));
+	assert(mesh_index < (1u << 16));
+	constexpr uint32_t kMaxDepth = (1u << 24) - 1u;
+	const float normalized_depth = max_depth > 0.0f ? std::min(std::max(view_depth / max_depth, 0.0f), 1.0f) : 0.0f;
+	const uint64_t depth = static_cast<uint64_t>(normalized_depth * static_cast<float>(kMaxDepth));
+	return (static_cast<uint64_t>(pipeline_index) << 54)
+		| (static_cast<uint64_t>(descriptor_set_index) << 40)
+		| (static_cast<uint64_t>(mesh_index) << 24)
+		| std::min<uint64_t>(depth, kMaxDepth);
+}
+
+void drawQueuePush(DrawQueue& queue, const DrawItem& item)
+{
+	queue.items.push_back(item);
+}
+
+void drawQueueSort(DrawQueue& queue)
+{
+	const uint32_t count = static_cast<uint32_t>(queue.items.size());
+	queue.order.resize(count);
+	queue.scratch.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		queue.order[i] = i;
+	}
+	if (count < 2) {
+		return;
+	}
+
+	// Histograms of all eight digits in one pass over the keys:
+	uint32_t histograms[8][256] = {};
+	for (const DrawItem& item : queue.items) {
+		for (int digit = 0; digit < 8; ++digit) {
+			++histograms[digit][(item.sortKey >> (8 * digit)) & 0xFF];
+		}
+	}
+
+	for (int digit = 0; digit < 8; ++digit) {
+		uint32_t* histogram = histograms[digit];
+		// All keys share this digit => the pass would not change the order:
+		if (count == histogram[(queue.items[0].sortKey >> (8 * digit)) & 0xFF]) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; ++bucket) {
+			const uint32_t bucket_count = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucket_count;
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			const uint32_t index = queue.order[i];
+			queue.scratch[histogram[(queue.items[index].sortKey >> (8 * digit)) & 0xFF]++] = index;
+		}
+		queue.order.swap(queue.scratch);
+	}
+}
+
+DrawQueueStats drawQueueRecord(DrawQueue& queue)
+{
+	if (!vklFrameworkInitialized()) {
+		VKL_EXIT_WITH_ERROR("Framework not initialized. Ensure to invoke vklFrameworkInitialized beforehand!");
+	}
+	if (queue.order.size() != queue.items.size()) {
+		VKL_EXIT_WITH_ERROR("Draw queue has not been sorted. Ensure to invoke drawQueueSort beforehand!");
+	}
+
+	const DrawQueueStats stats = processQueue(queue, vklGetCurrentCommandBuffer());
+	queue.items.clear();
+	queue.order.clear();
+	return stats;
+}
+
+DrawQueueStats drawQueueCountBinds(const DrawQueue& queue)
+{
+	if (queue.order.size() != queue.items.size()) {
+		VKL_EXIT_WITH_ERROR("Draw queue has not been sorted. Ensure to invoke drawQueueSort beforehand!");
+	}
+	return processQueue(queue, VK_NULL_HANDLE);
+}
+
+void drawLogQueueStats(const DrawQueueStats& stats)
+{
+	const uint32_t binds = stats.pipelineBinds + stats.descriptorSetBinds + stats.vertexBufferBinds + stats.indexBufferBinds;
+	VKL_LOG(stats.drawCount << " draws recorded with " << binds << " bind calls (" << stats.pipelineBinds << " pipelines, "
+		<< stats.descriptorSetBinds << " descriptor sets, " << stats.vertexBufferBinds << " vertex buffers, "
+		<< stats.indexBufferBinds << " index buffers) instead of " << stats.naiveBinds);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include <vector>
+
+/* --------------------------------------------- */
+// Draw Queue Struct Definitions
+// As a convention, their names start with `Draw`.
+/* --------------------------------------------- */
+
+/*!
+ * One draw call as pushed into a DrawQueue.
+ */
+struct DrawItem {
+	//! Determines the recording order; see drawMakeSortKey
+	uint64_t sortKey;
+
+	VkPipeline pipeline;
+
+	//! Bound to set 0, through vklBindDescriptorSetToPipeline unless pipelineLayout is given; may be VK_NULL_HANDLE.
+	VkDescriptorSet descriptorSet;
+
+	//! Positions are bound to binding 0, normals (if any) to binding 1, texture coordinates (if any) to binding 2.
+	//! Must stay valid until the queue has been recorded.
+	const HlpGeometryHandles* geometry;
+
+	//! Range of indices to draw, e.g., one level of a LodChain. An indexCount of 0 draws all of geometry's indices.
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	//! If not VK_NULL_HANDLE, descriptorSet contains one dynamic buffer (e.g., a RingBuffer, see ringWriteDescriptorSet)
+	//! and is bound with vkCmdBindDescriptorSets and dynamicOffset, so that one set serves all draws.
+	VkPipelineLayout pipelineLayout;
+	uint32_t dynamicOffset;
+
+	//! If not null, pushConstantsSize bytes are pushed to the vertex stage at offset 0 of pipelineLayout before the draw,
+	//! e.g., the clipFromObject matrix of the depth pre-pass's draw (see occRegisterMainPassPipeline).
+	//! Must stay valid until the queue has been recorded.
+	const void* pushConstants;
+	uint32_t pushConstantsSize;
+};
+
+/*!
+ * Counts of state changes recorded for one frame. The "naive" count is what binding everything for every draw
+ * (like teapotDraw(pipeline, descriptor_set) does) would have cost.
+ */
+struct DrawQueueStats {
+	uint32_t drawCount;
+	uint32_t pipelineBinds;
+	uint32_t descriptorSetBinds;
+	uint32_t vertexBufferBinds;
+	uint32_t indexBufferBinds;
+	uint32_t naiveBinds;
+};
+
+/*!
+ * Collects draws for one frame, sorts them by their keys, and records them with as few binds as possible.
+ * All buffers are kept between frames, so that pushing does not allocate in the steady state.
+ */
+struct DrawQueue {
+	std::vector<DrawItem> items;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> scratch;
+};
+
+/* --------------------------------------------- */
+// Draw Queue Function Definitions
+// As a convention, their names start with `draw`.
+/* --------------------------------------------- */
+
+/*!
+ *	Builds a 64-bit sort key. Sorting by it groups draws by pipeline first, then by descriptor set, then by mesh,
+ *	and orders draws which share all of them front to back. Bits from most to least significant:
+ *	[63..54] pipeline index, [53..40] descriptor set index, [39..24] mesh index, [23..0] depth.
+ *	@param	pipeline_index			Index of the pipeline, e.g., in the application's list of pipelines; < 1024
+ *	@param	descriptor_set_index	Index of the descriptor set or material; < 16384
+ *	@param	mesh_index				Index of the mesh; < 65536
+ *	@param	view_depth				Distance from the camera; values beyond max_depth are clamped.
+ *	@param	max_depth				Distance which maps to the largest depth value, e.g., the far plane
+ */
+uint64_t drawMakeSortKey(uint32_t pipeline_index, uint32_t descriptor_set_index, uint32_t mesh_index, float view_depth, float max_depth);
+
+/*!
+ *	Appends a draw to the queue.
+ */
+void drawQueuePush(DrawQueue& queue, const DrawItem& item);
+
+/*!
+ *	Sorts the queue's draws by their keys with an LSD radix sort (8 bits per pass; passes in which all keys have
+ *	the same digit are skipped). The sort is stable, i.e., draws with equal keys are recorded in push order.
+ */
+void drawQueueSort(DrawQueue& queue);
+
+/*!
+ *	Records all draws in sorted order (invoke drawQueueSort beforehand) into the current command buffer.
+ *	Pipelines, descriptor sets, vertex buffers, and index buffers are only bound if they differ from the
+ *	previous draw's. Afterwards, the queue is empty.
+ *	@return	Counts of draws and binds
+ */
+DrawQueueStats drawQueueRecord(DrawQueue& queue);
+
+/*!
+ *	Returns the counts which drawQueueRecord would produce for the sorted queue, without recording anything and
+ *	without emptying the queue, e.g., for measuring the effect of sort keys without a GPU.
+ */
+DrawQueueStats drawQueueCountBinds(const DrawQueue& queue);
+
+/*!
+ *	Logs the given statistics, comparing the recorded binds against binding everything for every draw.
+ */
+void drawLogQueueStats(const DrawQueueStats& stats);
@@ -0,0 +1,592 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "GeometryCodec.h"
+#include "VertexKey.h"
+#include "MemoryRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CODEC_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* --------------------------------------------- */
+// Internal definitions of the encoded format
+/* --------------------------------------------- */
+
+namespace {
+
+	// Vertices are processed in chunks, so that a chunk's lane-major intermediate data stays in the L1 cache:
+	constexpr size_t kGroupSize       = 16;
+	constexpr size_t kChunkSize       = 256;
+	constexpr size_t kGroupsPerChunk  = kChunkSize / kGroupSize;
+	constexpr size_t kMaxVertexStride = 64;
+
+	// 2 bit per group of deltas:
+	constexpr uint8_t kGroupModeZero   = 0; // All deltas are zero, no data stored
+	constexpr uint8_t kGroupModeNibble = 1; // 4 bit per delta, 8 bytes of data
+	constexpr uint8_t kGroupModeByte   = 2; // 8 bit per delta, 16 bytes of data
+
+	constexpr char     kMagic[4] = { 'V', 'L', 'G', 'C' };
+	constexpr uint32_t kVersion  = 1u;
+
+	constexpr uint32_t kHasNormals            = 0x1;
+	constexpr uint32_t kHasTextureCoordinates = 0x2;
+
+	// All members are 4 bytes in size => no padding, can be memcpy'd to/from the blob.
+	struct CodecHeader {
+		char     magic[4];
+		uint32_t version;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t filters;
+		uint32_t attributes;
+		float    positionMin[3];
+		float    positionScale[3];
+		//! Encoded sizes of positions, normals, texture coordinates, and indices, stored in this order after the header.
+		uint32_t sectionSizes[4];
+	};
+
+	uint8_t zigzag8(uint8_t delta) {
+		return static_cast<uint8_t>((delta << 1) ^ static_cast<uint8_t>(static_cast<int8_t>(delta) >> 7));
+	}
+
+	uint32_t zigzag32(uint32_t delta) {
+		return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+	}
+
+	uint32_t unzigzag32(uint32_t v) {
+		return (v >> 1) ^ (0u - (v & 1u));
+	}
+
+	// Decodes one group of 16 deltas of one byte lane into 16 absolute values. Returns the last value.
+	uint8_t decodeGroup(uint8_t mode, const uint8_t* data, uint8_t previous, uint8_t* out) {
+#if CODEC_USE_SSE2
+		__m128i v;
+		if (kGroupModeNibble == mode) {
+			const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			const __m128i mask   = _mm_set1_epi8(0x0F);
+			const __m128i lo     = _mm_and_si128(packed, mask);
+			const __m128i hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+			v = _mm_unpacklo_epi8(lo, hi);
+		}
+		else if (kGroupModeByte == mode) {
+			v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		}
+		else {
+			v = _mm_setzero_si128();
+		}
+
+		// Undo zigzag: (v >> 1) ^ -(v & 1)
+		const __m128i shifted = _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7F));
+		const __m128i sign    = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+		v = _mm_xor_si128(shifted, sign);
+
+		// Inclusive prefix sum over the 16 deltas, then add the previous group's last value:
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+		v = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(previous)));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+		return out[kGroupSize - 1];
+#else
+		for (size_t i = 0; i < kGroupSize; ++i) {
+			uint8_t zz = 0;
+			if (kGroupModeNibble == mode) {
+				zz = (i & 1) ? (data[i / 2] >> 4) : (data[i / 2] & 0x0F);
+			}
+			else if (kGroupModeByte == mode) {
+				zz = data[i];
+			}
+			previous = static_cast<uint8_t>(previous + ((zz >> 1) ^ (0u - (zz & 1u))));
+			out[i] = previous;
+		}
+		return previous;
+#endif
+	}
+
+	// Decodes all chunks of a vertex stream. For every chunk, on_chunk(first_vertex, vertex_count, lanes)
+	// is invoked, where `lanes` contains the chunk's bytes in lane-major order (kChunkSize bytes per lane).
+	template <typename F>
+	bool decodeChunks(const uint8_t* data, size_t size, size_t vertex_count, size_t vertex_stride, F on_chunk) {
+		if (vertex_stride == 0 || vertex_stride > kMaxVertexStride) {
+			return false;
+		}
+
+		alignas(16) uint8_t lanes[kMaxVertexStride * kChunkSize];
+		uint8_t previous[kMaxVertexStride] = {};
+		const uint8_t* const end = data + size;
+
+		for (size_t first = 0; first < vertex_count; first += kChunkSize) {
+			const size_t n = std::min(kChunkSize, vertex_count - first);
+			const size_t groups = (n + kGroupSize - 1) / kGroupSize;
+			const size_t header_size = (groups + 3) / 4;
+
+			for (size_t lane = 0; lane < vertex_stride; ++lane) {
+				if (static_cast<size_t>(end - data) < header_size) {
+					return false;
+				}
+				const uint8_t* header = data;
+				data += header_size;
+
+				for (size_t g = 0; g < groups; ++g) {
+					const uint8_t mode = (header[g / 4] >> (2 * (g % 4))) & 0x3;
+					const size_t data_size = kGroupModeByte == mode ? 16 : (kGroupModeNibble == mode ? 8 : 0);
+					// The SSE2 path reads 8 resp. 16 bytes at once, which is exactly the group's data size:
+					if (static_cast<size_t>(end - data) < data_size) {
+						return false;
+					}
+					previous[lane] = decodeGroup(mode, data, previous[lane], &lanes[lane * kChunkSize + g * kGroupSize]);
+					data += data_size;
+				}
+			}
+
+			on_chunk(first, n, lanes);
+		}
+		return true;
+	}
+
+	// Transposes a chunk from lane-major to vertex-major order:
+	void transposeChunk(const uint8_t* lanes, size_t n, size_t vertex_stride, uint8_t* out) {
+		size_t lane = 0;
+#if CODEC_USE_SSE2
+		// Interleave four lanes at a time, so that every 32 bit word holds four consecutive bytes of one vertex:
+		for (; lane + 4 <= vertex_stride; lane += 4) {
+			const uint8_t* src = lanes + lane * kChunkSize;
+			uint8_t* dst = out + lane;
+			size_t i = 0;
+			for (; i + kGroupSize <= n; i += kGroupSize) {
+				const __m128i l0 = _mm_load_si128(reinterpret_cast<const __m128i*>(src + 0 * kChunkSize + i));
+				const __m128i l1 = _mm_load_si128(reinterpret_cast<const __m128i*>(src + 1 * kChunkSize + i));
+				const __m128i l2 = _mm_load_si128(reinterpret_cast<const __m128i*>(src + 2 * kChunkSize + i));
+				const __m128i l3 = _mm_load_si128(reinterpret_cast<const __m128i*>(src + 3 * kChunkSize + i));
+				const __m128i l01lo = _mm_unpacklo_epi8(l0, l1), l01hi = _mm_unpackhi_epi8(l0, l1);
+				const __m128i l23lo = _mm_unpacklo_epi8(l2, l3), l23hi = _mm_unpackhi_epi8(l2, l3);
+				const __m128i words[4] = {
+					_mm_unpacklo_epi16(l01lo, l23lo), _mm_unpackhi_epi16(l01lo, l23lo),
+					_mm_unpacklo_epi16(l01hi, l23hi), _mm_unpackhi_epi16(l01hi, l23hi)
+				};
+				for (int w = 0; w < 4; ++w) {
+					alignas(16) uint32_t vertex_words[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(vertex_words), words[w]);
+					for (int k = 0; k < 4; ++k) {
+						memcpy(dst + (i + 4 * w + k) * vertex_stride, &vertex_words[k], 4);
+					}
+				}
+			}
+			for (; i < n; ++i) {
+				for (size_t k = 0; k < 4; ++k) {
+					dst[i * vertex_stride + k] = src[k * kChunkSize + i];
+				}
+			}
+		}
+#endif
+		for (; lane < vertex_stride; ++lane) {
+			const uint8_t* src = lanes + lane * kChunkSize;
+			uint8_t* dst = out + lane;
+			for (size_t i = 0; i < n; ++i) {
+				dst[i * vertex_stride] = src[i];
+			}
+		}
+	}
+
+	int8_t toSnorm8(float v) {
+		return static_cast<int8_t>(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f));
+	}
+
+	// Octahedral mapping of a unit vector onto two components in [-1, 1]:
+	void encodeOctahedral(glm::vec3 n, int8_t* out) {
+		n /= std::max(std::abs(n.x) + std::abs(n.y) + std::abs(n.z), 1e-20f);
+		float x = n.x, y = n.y;
+		if (n.z < 0.0f) {
+			x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		out[0] = toSnorm8(x);
+		out[1] = toSnorm8(y);
+	}
+
+	glm::vec3 decodeOctahedral(const int8_t* in) {
+		glm::vec3 n(static_cast<float>(in[0]) / 127.0f, static_cast<float>(in[1]) / 127.0f, 0.0f);
+		n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+		const float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	void appendSection(std::vector<uint8_t>& blob, CodecHeader& header, int section, const std::vector<uint8_t>& bytes) {
+		header.sectionSizes[section] = static_cast<uint32_t>(bytes.size());
+		blob.insert(blob.end(), bytes.begin(), bytes.end());
+	}
+
+	void* createMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory, const char* name) {
+		const auto device = vklGetDevice();
+
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = usage;
+		VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &buffer);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		VkMemoryRequirements memory_requirements = {};
+		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
+		memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, name, MEM_CATEGORY_GEOMETRY);
+		result = vkBindBufferMemory(device, buffer, memory, 0);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		void* mapped_memory = nullptr;
+		result = vkMapMemory(device, memory, 0, size, 0, &mapped_memory);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return mapped_memory;
+	}
+}
+
+/* --------------------------------------------- */
+// Geometry Codec Function Definitions
+/* --------------------------------------------- */
+
+std::vector<uint8_t> codecEncodeIndices(const uint32_t* indices, size_t index_count)
+{
+	std::vector<uint8_t> out;
+	out.reserve(index_count * 2);
+
+	uint32_t previous = 0u;
+	for (size_t i = 0; i < index_count; ++i) {
+		uint32_t v = zigzag32(indices[i] - previous);
+		previous = indices[i];
+		// Variable-length encoding, 7 bits per byte, high bit set if more bytes follow:
+		while (v >= 0x80u) {
+			out.push_back(static_cast<uint8_t>(v | 0x80u));
+			v >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(v));
+	}
+	return out;
+}
+
+bool codecDecodeIndices(const uint8_t* data, size_t size, uint32_t* destination, size_t index_count)
+{
+	const uint8_t* const end = data + size;
+	uint32_t previous = 0u;
+	for (size_t i = 0; i < index_count; ++i) {
+		uint32_t v = 0u;
+		for (uint32_t shift = 0u; ; shift += 7u) {
+			if (data == end || shift > 28u) {
+				return false;
+			}
+			const uint8_t byte = *data++;
+			v |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+			if (0 == (byte & 0x80u)) {
+				break;
+			}
+		}
+		previous += unzigzag32(v);
+		destination[i] = previous;
+	}
+	return true;
+}
+
+std::vector<uint8_t> codecEncodeVertexStream(const void* vertices, size_t vertex_count, size_t vertex_stride)
+{
+	if (vertex_stride == 0 || vertex_stride > kMaxVertexStride) {
+		VKL_EXIT_WITH_ERROR("Vertex stride " << vertex_stride << " is not supported by codecEncodeVertexStream.");
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+	std::vector<uint8_t> out;
+	out.reserve(vertex_count * vertex_stride / 2);
+
+	uint8_t previous[kMaxVertexStride] = {};
+	for (size_t first = 0; first < vertex_count; first += kChunkSize) {
+		const size_t n = std::min(kChunkSize, vertex_count - first);
+		const size_t groups = (n + kGroupSize - 1) / kGroupSize;
+
+		for (size_t lane = 0; lane < vertex_stride; ++lane) {
+			const size_t header_offset = out.size();
+			out.resize(out.size() + (groups + 3) / 4, 0);
+
+			for (size_t g = 0; g < groups; ++g) {
+				uint8_t zz[kGroupSize];
+				uint8_t max_zz = 0;
+				for (size_t i = 0; i < kGroupSize; ++i) {
+					const size_t vertex = g * kGroupSize + i;
+					// Pad the last group by repeating the last value, i.e., with zero deltas:
+					const uint8_t value = vertex < n ? bytes[(first + vertex) * vertex_stride + lane] : previous[lane];
+					zz[i] = zigzag8(static_cast<uint8_t>(value - previous[lane]));
+					previous[lane] = value;
+					max_zz = std::max(max_zz, zz[i]);
+				}
+
+				const uint8_t mode = 0 == max_zz ? kGroupModeZero : (max_zz < 16 ? kGroupModeNibble : kGroupModeByte);
+				out[header_offset + g / 4] |= static_cast<uint8_t>(mode << (2 * (g % 4)));
+				if (kGroupModeNibble == mode) {
+					for (size_t i = 0; i < kGroupSize; i += 2) {
+						out.push_back(static_cast<uint8_t>(zz[i] | (zz[i + 1] << 4)));
+					}
+				}
+				else if (kGroupModeByte == mode) {
+					out.insert(out.end(), zz, zz + kGroupSize);
+				}
+			}
+		}
+	}
+	return out;
+}
+
+bool codecDecodeVertexStream(const uint8_t* data, size_t size, void* destination, size_t vertex_count, size_t vertex_stride)
+{
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	return decodeChunks(data, size, vertex_count, vertex_stride, [&](size_t first, size_t n, const uint8_t* lanes) {
+		transposeChunk(lanes, n, vertex_stride, out + first * vertex_stride);
+	});
+}
+
+std::vector<uint8_t> codecEncodeGeometry(
+	const std::vector<glm::vec3>& input_positions,
+	const std::vector<glm::vec3>& input_normals,
+	const std::vector<glm::vec2>& input_texture_coordinates,
+	const std::vector<uint32_t>&  input_indices,
+	uint32_t                      filters)
+{
+	// Weld vertices with identical attributes and order them by their first use in the index data.
+	// Besides removing duplicates (loaders often emit one vertex per face corner), this makes consecutive
+	// vertices similar and index deltas small, which is what the encodings below benefit from.
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texture_coordinates;
+	std::vector<uint32_t> indices(input_indices.size());
+	{
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> remap;
+		remap.reserve(input_positions.size());
+		for (size_t i = 0; i < input_indices.size(); ++i) {
+			const uint32_t index = input_indices[i];
+			VertexKey key = {};
+			key.position = input_positions[index];
+			key.normal = input_normals.empty() ? glm::vec3(0.0f) : input_normals[index];
+			key.textureCoordinate = input_texture_coordinates.empty() ? glm::vec2(0.0f) : input_texture_coordinates[index];
+			const auto inserted = remap.emplace(key, static_cast<uint32_t>(positions.size()));
+			if (inserted.second) {
+				positions.push_back(key.position);
+				if (!input_normals.empty()) {
+					normals.push_back(key.normal);
+				}
+				if (!input_texture_coordinates.empty()) {
+					texture_coordinates.push_back(key.textureCoordinate);
+				}
+			}
+			indices[i] = inserted.first->second;
+		}
+	}
+
+	CodecHeader header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.vertexCount = static_cast<uint32_t>(positions.size());
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.filters = filters;
+	header.attributes = (normals.empty() ? 0u : kHasNormals) | (texture_coordinates.empty() ? 0u : kHasTextureCoordinates);
+
+	std::vector<uint8_t> blob(sizeof(CodecHeader));
+
+	// Positions:
+	if (0 != (filters & CODEC_FILTER_QUANTIZE_POSITIONS)) {
+		glm::vec3 min_corner(std::numeric_limits<float>::max()), max_corner(-std::numeric_limits<float>::max());
+		for (const glm::vec3& p : positions) {
+			min_corner = glm::min(min_corner, p);
+			max_corner = glm::max(max_corner, p);
+		}
+		std::vector<uint16_t> quantized(positions.size() * 3);
+		for (int c = 0; c < 3; ++c) {
+			const float extent = positions.empty() ? 0.0f : max_corner[c] - min_corner[c];
+			header.positionMin[c] = positions.empty() ? 0.0f : min_corner[c];
+			header.positionScale[c] = extent / 65535.0f;
+			for (size_t i = 0; i < positions.size(); ++i) {
+				const float t = extent > 0.0f ? (positions[i][c] - min_corner[c]) / extent : 0.0f;
+				quantized[3 * i + c] = static_cast<uint16_t>(std::lround(t * 65535.0f));
+			}
+		}
+		appendSection(blob, header, 0, codecEncodeVertexStream(quantized.data(), positions.size(), 3 * sizeof(uint16_t)));
+	}
+	else {
+		appendSection(blob, header, 0, codecEncodeVertexStream(positions.data(), positions.size(), sizeof(glm::vec3)));
+	}
+
+	// Normals:
+	if (!normals.empty()) {
+		if (0 != (filters & CODEC_FILTER_OCTAHEDRAL_NORMALS)) {
+			std::vector<int8_t> octahedral(normals.size() * 2);
+			for (size_t i = 0; i < normals.size(); ++i) {
+				encodeOctahedral(normals[i], &octahedral[2 * i]);
+			}
+			appendSection(blob, header, 1, codecEncodeVertexStream(octahedral.data(), normals.size(), 2));
+		}
+		else {
+			appendSection(blob, header, 1, codecEncodeVertexStream(normals.data(), normals.size(), sizeof(glm::vec3)));
+		}
+	}
+
+	// Texture coordinates:
+	if (!texture_coordinates.empty()) {
+		appendSection(blob, header, 2, codecEncodeVertexStream(texture_coordinates.data(), texture_coordinates.size(), sizeof(glm::vec2)));
+	}
+
+	// Indices:
+	appendSection(blob, header, 3, codecEncodeIndices(indices.data(), indices.size()));
+
+	memcpy(blob.data(), &header, sizeof(CodecHeader));
+	return blob;
+}
+
+bool codecGetGeometryInfo(const uint8_t* data, size_t size, CodecGeometryInfo& info)
+{
+	CodecHeader header;
+	if (size < sizeof(CodecHeader)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(CodecHeader));
+	if (0 != memcmp(header.magic, kMagic, sizeof(kMagic)) || kVersion != header.version) {
+		return false;
+	}
+
+	info.vertexCount = header.vertexCount;
+	info.indexCount = header.indexCount;
+	info.hasNormals = 0 != (header.attributes & kHasNormals);
+	info.hasTextureCoordinates = 0 != (header.attributes & kHasTextureCoordinates);
+	return true;
+}
+
+bool codecDecodeGeometry(const uint8_t* data, size_t size, glm::vec3* positions, glm::vec3* normals, glm::vec2* texture_coordinates, uint32_t* indices)
+{
+	CodecGeometryInfo info;
+	if (!codecGetGeometryInfo(data, size, info)) {
+		return false;
+	}
+	CodecHeader header;
+	memcpy(&header, data, sizeof(CodecHeader));
+
+	// Locate the sections:
+	const uint8_t* sections[4];
+	size_t offset = sizeof(CodecHeader);
+	for (int s = 0; s < 4; ++s) {
+		if (header.sectionSizes[s] > size - offset) {
+			return false;
+		}
+		sections[s] = data + offset;
+		offset += header.sectionSizes[s];
+	}
+	const size_t vertex_count = header.vertexCount;
+
+	// Positions:
+	bool success;
+	if (0 != (header.filters & CODEC_FILTER_QUANTIZE_POSITIONS)) {
+		constexpr size_t stride = 3 * sizeof(uint16_t);
+		alignas(16) uint8_t vertices[kChunkSize * stride];
+		success = decodeChunks(sections[0], header.sectionSizes[0], vertex_count, stride, [&](size_t first, size_t n, const uint8_t* lanes) {
+			transposeChunk(lanes, n, stride, vertices);
+			for (size_t i = 0; i < n; ++i) {
+				uint16_t q[3];
+				memcpy(q, &vertices[i * stride], stride);
+				positions[first + i] = glm::vec3(
+					header.positionMin[0] + static_cast<float>(q[0]) * header.positionScale[0],
+					header.positionMin[1] + static_cast<float>(q[1]) * header.positionScale[1],
+					header.positionMin[2] + static_cast<float>(q[2]) * header.positionScale[2]);
+			}
+		});
+	}
+	else {
+		success = codecDecodeVertexStream(sections[0], header.sectionSizes[0], positions, vertex_count, sizeof(glm::vec3));
+	}
+
+	// Normals:
+	if (success && info.hasNormals && nullptr != normals) {
+		if (0 != (header.filters & CODEC_FILTER_OCTAHEDRAL_NORMALS)) {
+			constexpr size_t stride = 2;
+			alignas(16) uint8_t vertices[kChunkSize * stride];
+			success = decodeChunks(sections[1], header.sectionSizes[1], vertex_count, stride, [&](size_t first, size_t n, const uint8_t* lanes) {
+				transposeChunk(lanes, n, stride, vertices);
+				for (size_t i = 0; i < n; ++i) {
+					normals[first + i] = decodeOctahedral(reinterpret_cast<const int8_t*>(&vertices[i * stride]));
+				}
+			});
+		}
+		else {
+			success = codecDecodeVertexStream(sections[1], header.sectionSizes[1], normals, vertex_count, sizeof(glm::vec3));
+		}
+	}
+
+	// Texture coordinates:
+	if (success && info.hasTextureCoordinates && nullptr != texture_coordinates) {
+		success = codecDecodeVertexStream(sections[2], header.sectionSizes[2], texture_coordinates, vertex_count, sizeof(glm::vec2));
+	}
+
+	// Indices:
+	return success && codecDecodeIndices(sections[3], header.sectionSizes[3], indices, header.indexCount);
+}
+
+CodecGeometryBuffers codecCreateGeometryAndBuffers(const uint8_t* data, size_t size)
+{
+	CodecGeometryInfo info;
+	if (!codecGetGeometryInfo(data, size, info)) {
+		VKL_EXIT_WITH_ERROR("Invalid encoded geometry passed to codecCreateGeometryAndBuffers.");
+	}
+
+	CodecGeometryBuffers buffers = {};
+	HlpGeometryHandles& handles = buffers.handles;
+	handles.numberOfIndices = info.indexCount;
+	handles.indexType = VK_INDEX_TYPE_UINT32;
+
+	handles.positionsBufferSize = sizeof(glm::vec3) * info.vertexCount;
+	void* positions = createMappedBuffer(handles.positionsBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, handles.positionsBuffer, buffers.memories[0], "Decoded positions");
+
+	void* normals = nullptr;
+	if (info.hasNormals) {
+		handles.normalsBufferSize = sizeof(glm::vec3) * info.vertexCount;
+		normals = createMappedBuffer(handles.normalsBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, handles.normalsBuffer, buffers.memories[1], "Decoded normals");
+	}
+
+	void* texture_coordinates = nullptr;
+	if (info.hasTextureCoordinates) {
+		handles.textureCoordinatesBufferSize = sizeof(glm::vec2) * info.vertexCount;
+		texture_coordinates = createMappedBuffer(handles.textureCoordinatesBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, handles.textureCoordinatesBuffer, buffers.memories[2], "Decoded texture coordinates");
+	}
+
+	handles.indicesBufferSize = sizeof(uint32_t) * info.indexCount;
+	void* indices = createMappedBuffer(handles.indicesBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, handles.indicesBuffer, buffers.memories[3], "Decoded indices");
+
+	// Decode directly into the mapped memory:
+	const bool success = codecDecodeGeometry(data, size,
+		static_cast<glm::vec3*>(positions), static_cast<glm::vec3*>(normals),
+		static_cast<glm::vec2*>(texture_coordinates), static_cast<uint32_t*>(indices));
+
+	const auto device = vklGetDevice();
+	for (VkDeviceMemory memory : buffers.memories) {
+		if (VK_NULL_HANDLE != memory) {
+			vkUnmapMemory(device, memory);
+		}
+	}
+
+	if (!success) {
+		VKL_EXIT_WITH_ERROR("Failed to decode geometry in codecCreateGeometryAndBuffers: data is truncated.");
+	}
+	return buffers;
+}
+
+void codecDestroyBuffers(const CodecGeometryBuffers& buffers)
+{
+	const auto device = vklGetDevice();
+	const VkBuffer handles[4] = { buffers.handles.positionsBuffer, buffers.handles.normalsBuffer, buffers.handles.textureCoordinatesBuffer, buffers.handles.indicesBuffer };
+	for (int i = 0; i < 4; ++i) {
+		if (VK_NULL_HANDLE != handles[i]) {
+			vkDestroyBuffer(device, handles[i], nullptr);
+			memFree(buffers.memories[i]);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include <vector>
+
+/* --------------------------------------------- */
+// Geometry Codec Struct Definitions
+// As a convention, their names start with `Codec`.
+/* --------------------------------------------- */
+
+/*!
+ * Optional, lossy filters which are applied to vertex attributes before encoding them.
+ * They reduce the size of the encoded data considerably, while the decoded data still has
+ * the original (float) format, i.e., no changes to vertex input states are required.
+ */
+enum CodecFilterFlagBits {
+	CODEC_FILTER_NONE                = 0x0,
+	//! Positions are quantized to 16 bit per component within the mesh's bounding box.
+	CODEC_FILTER_QUANTIZE_POSITIONS  = 0x1,
+	//! Normals are stored as octahedral-mapped 2 x 8 bit.
+	CODEC_FILTER_OCTAHEDRAL_NORMALS  = 0x2,
+};
+
+/*!
+ * Information about encoded geometry which is needed to size the destination memory for decoding.
+ */
+struct CodecGeometryInfo {
+	//! The number of vertices, i.e., the number of elements of each of the vertex attributes
+	uint32_t vertexCount;
+
+	//! The number of (uint32_t) indices
+	uint32_t indexCount;
+
+	//! Whether or not the encoded data contains normals
+	bool hasNormals;
+
+	//! Whether or not the encoded data contains texture coordinates
+	bool hasTextureCoordinates;
+};
+
+/*!
+ * Host-coherent buffers which encoded geometry has been decoded into, together with their backing memory.
+ */
+struct CodecGeometryBuffers {
+	//! Buffer handles and sizes of the decoded geometry
+	HlpGeometryHandles handles;
+
+	//! Backing memory of positions, normals, texture coordinates, and indices buffers (in this order)
+	VkDeviceMemory memories[4];
+};
+
+/* --------------------------------------------- */
+// Geometry Codec Function Definitions
+// As a convention, their names start with `codec`.
+/* --------------------------------------------- */
+
+/*!
+ *	Encodes indices by storing the zigzag-encoded difference to the previous index in a variable number of bytes.
+ *	@param		indices		Pointer to the indices to be encoded
+ *	@param		index_count	The number of indices
+ *	@return		The encoded bytes
+ */
+std::vector<uint8_t> codecEncodeIndices(const uint32_t* indices, size_t index_count);
+
+/*!
+ *	Decodes indices which were encoded with codecEncodeIndices.
+ *	@param		data			The encoded bytes
+ *	@param		size			The number of encoded bytes
+ *	@param		destination		Memory for index_count indices, e.g., mapped memory of a staging buffer.
+ *	@param		index_count		The number of indices to decode
+ *	@return		True on success, false if the data is truncated.
+ */
+bool codecDecodeIndices(const uint8_t* data, size_t size, uint32_t* destination, size_t index_count);
+
+/*!
+ *	Encodes a stream of vertices with the given stride. Every byte of a vertex is delta-encoded against the
+ *	same byte of the previous vertex. Deltas are zigzag-encoded and stored in groups of 16, using 0, 4, or
+ *	8 bits per delta, whichever is the smallest that fits the whole group.
+ *	@param		vertices		Pointer to the vertex data
+ *	@param		vertex_count	The number of vertices
+ *	@param		vertex_stride	The size of one vertex in bytes; must be at most 64.
+ *	@return		The encoded bytes
+ */
+std::vector<uint8_t> codecEncodeVertexStream(const void* vertices, size_t vertex_count, size_t vertex_stride);
+
+/*!
+ *	Decodes a stream of vertices which was encoded with codecEncodeVertexStream. Uses SSE2 if available.
+ *	@param		data			The encoded bytes
+ *	@param		size			The number of encoded bytes
+ *	@param		destination		Memory for vertex_count * vertex_stride bytes, e.g., mapped memory of a staging buffer.
+ *	@param		vertex_count	The number of vertices to decode
+ *	@param		vertex_stride	The size of one vertex in bytes; must match the one used for encoding.
+ *	@return		True on success, false if the data is truncated.
+ */
+bool codecDecodeVertexStream(const uint8_t* data, size_t size, void* destination, size_t vertex_count, size_t vertex_stride);
+
+/*!
+ *	Encodes a whole mesh (all of its attributes and indices) into one compact blob.
+ *	Vertices with identical attributes are welded and vertices are reordered by their first use,
+ *	i.e., the decoded vertex and index data are not identical to the input, but describe the same triangles.
+ *	@param		positions				Vertex positions
+ *	@param		normals					Vertex normals; can be empty.
+ *	@param		texture_coordinates		Vertex texture coordinates; can be empty.
+ *	@param		indices					Triangle list indices
+ *	@param		filters					A combination of CodecFilterFlagBits
+ *	@return		The encoded bytes, which can be written to disk as they are.
+ */
+std::vector<uint8_t> codecEncodeGeometry(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texture_coordinates,
+	const std::vector<uint32_t>&  indices,
+	uint32_t                      filters = CODEC_FILTER_NONE);
+
+/*!
+ *	Reads the header of a blob which was created with codecEncodeGeometry.
+ *	@return		True if the data is a valid blob, false otherwise.
+ */
+bool codecGetGeometryInfo(const uint8_t* data, size_t size, CodecGeometryInfo& info);
+
+/*!
+ *	Decodes a blob which was created with codecEncodeGeometry into the given destinations.
+ *	@param		positions				Memory for CodecGeometryInfo::vertexCount positions
+ *	@param		normals					Memory for CodecGeometryInfo::vertexCount normals, or nullptr to skip them.
+ *	@param		texture_coordinates		Memory for CodecGeometryInfo::vertexCount texture coordinates, or nullptr to skip them.
+ *	@param		indices					Memory for CodecGeometryInfo::indexCount indices
+ *	@return		True on success, false if the data is invalid or truncated.
+ */
+bool codecDecodeGeometry(const uint8_t* data, size_t size, glm::vec3* positions, glm::vec3* normals, glm::vec2* texture_coordinates, uint32_t* indices);
+
+/*!
+ *	Creates host-coherent buffers for a blob which was created with codecEncodeGeometry, and decodes the
+ *	blob directly into their mapped memory (i.e., without intermediate copies).
+ *	@return		Buffers containing the decoded geometry.
+ */
+CodecGeometryBuffers codecCreateGeometryAndBuffers(const uint8_t* data, size_t size);
+
+/*!
+ *	Destroys buffers which were previously created with codecCreateGeometryAndBuffers.
+ */
+void codecDestroyBuffers(const CodecGeometryBuffers& buffers);
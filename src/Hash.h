@@ -0,0 +1,31 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/* --------------------------------------------- */
+// Hash Function Definitions
+// As a convention, their names start with `hash`.
+/* --------------------------------------------- */
+
+//! Initial value of a 64-bit FNV-1a hash, see hashFnv1a
+constexpr uint64_t kHashFnv1aSeed = 14695981039346656037ull;
+
+/*!
+ *	Computes a 64-bit FNV-1a hash of the given bytes. It is not cryptographically secure, but cheap and stable
+ *	across platforms and runs, i.e., suitable for cache keys which are stored on disk and for checksums.
+ *	@param	data	Bytes to be hashed
+ *	@param	size	Number of bytes
+ *	@param	hash	Hash to continue from, which allows to hash several ranges as if they were one
+ *	@return	The hash of all bytes hashed so far
+ */
+inline uint64_t hashFnv1a(const void* data, size_t size, uint64_t hash = kHashFnv1aSeed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
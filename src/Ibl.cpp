@@ -0,0 +1,911 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Ibl.h"
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "MemoryRegistry.h"
+#include "ShaderManager.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IBL_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Increment whenever the results change, so that stale cache files are not used anymore:
+	constexpr uint32_t kVersion = 1u;
+	constexpr char     kMagic[4] = { 'V', 'L', 'I', 'B' };
+
+	const char* const kPrefilterShaderPath = "assets/shaders/ibl_prefilter.comp";
+	constexpr uint32_t kPrefilterWorkgroupSize = 64u;
+
+	// Wide lobes are integrated over a coarser level of the source, but never coarser than this:
+	constexpr uint32_t kMinPrefilterSourceSize = 8u;
+
+	constexpr float kPi = 3.14159265358979f;
+
+	// One level of the source cubemap, with the direction and solid angle of every texel, as structure of arrays.
+	// The arrays are padded to a multiple of 4 texels with a solid angle of 0, i.e., padding does not contribute.
+	struct SourceLevel {
+		uint32_t size;
+		uint32_t texelCount;
+		std::vector<float> x, y, z, solidAngle;
+		std::vector<float> r, g, b;
+	};
+
+	// Must match the push constants of kPrefilterShaderPath
+	struct PrefilterPushConstants {
+		uint32_t sourceOffset;
+		uint32_t sourceCount;
+		uint32_t outputOffset;
+		uint32_t faceSize;
+		float    alpha;
+	};
+
+	// Must match the source texels of kPrefilterShaderPath
+	struct GpuSourceTexel {
+		float directionAndSolidAngle[4];
+		float radiance[4];
+	};
+
+	VkQueue               mComputeQueue = VK_NULL_HANDLE;
+	VkCommandPool         mCommandPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout      mPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline            mPipeline = VK_NULL_HANDLE;
+	VkDescriptorPool      mDescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet       mDescriptorSet = VK_NULL_HANDLE;
+	VkFence               mFence = VK_NULL_HANDLE;
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Direction through the texel at (u, v) in [-1, 1]^2 of a face, following Vulkan's cubemap face selection
+	glm::vec3 cubeDirection(uint32_t face, float u, float v)
+	{
+		switch (face) {
+		case 0: return glm::vec3( 1.0f,    -v,    -u);
+		case 1: return glm::vec3(-1.0f,    -v,     u);
+		case 2: return glm::vec3(    u,  1.0f,     v);
+		case 3: return glm::vec3(    u, -1.0f,    -v);
+		case 4: return glm::vec3(    u,    -v,  1.0f);
+		default: return glm::vec3(  -u,    -v, -1.0f);
+		}
+	}
+
+	// Solid angle of the area from the face's center to (x, y), see "Cubemap Texel Solid Angle" by Rory Driscoll
+	float areaElement(float x, float y)
+	{
+		return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+	}
+
+	float srgbToLinear(uint8_t value)
+	{
+		const float c = value / 255.0f;
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	// Decodes the faces' first mip levels and box-filters them down to settings.sourceSize, in linear space
+	bool decodeFaces(const std::vector<uint8_t> face_files[6], const IblSettings& settings, std::vector<glm::vec3>& texels)
+	{
+		BcRgbaTexture faces[6];
+		bool decoded[6] = {};
+		jobParallelFor(6, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t face = begin; face < end; ++face) {
+				decoded[face] = bcDecodeDds(face_files[face].data(), face_files[face].size(), faces[face]);
+			}
+		});
+		for (uint32_t face = 0; face < 6; ++face) {
+			if (!decoded[face] || faces[face].width != faces[face].height || faces[face].width != faces[0].width) {
+				VKL_LOG("The cubemap's faces must be decodable squares of the same size.");
+				return false;
+			}
+		}
+		const uint32_t face_size = faces[0].width;
+		if (0 == settings.sourceSize || settings.sourceSize > face_size || 0 != face_size % settings.sourceSize) {
+			VKL_LOG("IBL source size " << settings.sourceSize << " must divide the cubemap's face size " << face_size << ".");
+			return false;
+		}
+
+		float to_linear[256];
+		for (uint32_t value = 0; value < 256; ++value) {
+			to_linear[value] = settings.srgbSource ? srgbToLinear(static_cast<uint8_t>(value)) : value / 255.0f;
+		}
+		const uint32_t size = settings.sourceSize;
+		const uint32_t factor = face_size / size;
+		texels.assign(static_cast<size_t>(6) * size * size, glm::vec3(0.0f));
+		jobParallelFor(6 * size, 8, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t row = begin; row < end; ++row) {
+				const uint32_t face = row / size;
+				const uint32_t y = row % size;
+				const uint8_t* rgba = faces[face].texels.data() + faces[face].subresources[0].offset;
+				for (uint32_t x = 0; x < size; ++x) {
+					glm::vec3 sum(0.0f);
+					for (uint32_t sy = y * factor; sy < (y + 1) * factor; ++sy) {
+						for (uint32_t sx = x * factor; sx < (x + 1) * factor; ++sx) {
+							const uint8_t* texel = rgba + (static_cast<size_t>(sy) * face_size + sx) * 4;
+							sum += glm::vec3(to_linear[texel[0]], to_linear[texel[1]], to_linear[texel[2]]);
+						}
+					}
+					texels[static_cast<size_t>(row) * size + x] = sum / static_cast<float>(factor * factor);
+				}
+			}
+		});
+		return true;
+	}
+
+	SourceLevel createSourceLevel(const std::vector<glm::vec3>& texels, uint32_t size)
+	{
+		SourceLevel level;
+		level.size = size;
+		level.texelCount = 6 * size * size;
+		const size_t padded_count = (static_cast<size_t>(level.texelCount) + 3) / 4 * 4;
+		for (std::vector<float>* values : { &level.x, &level.y, &level.z, &level.solidAngle, &level.r, &level.g, &level.b }) {
+			values->assign(padded_count, 0.0f);
+		}
+		const float texel_size = 2.0f / size;
+		for (uint32_t face = 0; face < 6; ++face) {
+			for (uint32_t y = 0; y < size; ++y) {
+				for (uint32_t x = 0; x < size; ++x) {
+					const size_t i = (static_cast<size_t>(face) * size + y) * size + x;
+					const float u0 = x * texel_size - 1.0f, v0 = y * texel_size - 1.0f;
+					const float u1 = u0 + texel_size, v1 = v0 + texel_size;
+					const glm::vec3 direction = glm::normalize(cubeDirection(face, u0 + 0.5f * texel_size, v0 + 0.5f * texel_size));
+					level.x[i] = direction.x;
+					level.y[i] = direction.y;
+					level.z[i] = direction.z;
+					level.solidAngle[i] = areaElement(u0, v0) - areaElement(u0, v1) - areaElement(u1, v0) + areaElement(u1, v1);
+					level.r[i] = texels[i].x;
+					level.g[i] = texels[i].y;
+					level.b[i] = texels[i].z;
+				}
+			}
+		}
+		return level;
+	}
+
+	// 2x2 box filter of all faces
+	std::vector<glm::vec3> downsample(const std::vector<glm::vec3>& texels, uint32_t size)
+	{
+		const uint32_t half_size = size / 2;
+		std::vector<glm::vec3> result(static_cast<size_t>(6) * half_size * half_size);
+		for (uint32_t face = 0; face < 6; ++face) {
+			for (uint32_t y = 0; y < half_size; ++y) {
+				for (uint32_t x = 0; x < half_size; ++x) {
+					const size_t source = (static_cast<size_t>(face) * size + 2 * y) * size + 2 * x;
+					result[(static_cast<size_t>(face) * half_size + y) * half_size + x] =
+						(texels[source] + texels[source + 1] + texels[source + size] + texels[source + size + 1]) * 0.25f;
+				}
+			}
+		}
+		return result;
+	}
+
+	// Accumulates radiance * Y_i(direction) * solid angle for the 9 basis functions of bands 0-2 over the texels [begin, end)
+	void accumulateSh(const SourceLevel& level, size_t begin, size_t end, float sums[9][3])
+	{
+		size_t i = begin;
+#if IBL_USE_SSE2
+		__m128 accumulators[9][3];
+		for (uint32_t k = 0; k < 9; ++k) {
+			accumulators[k][0] = accumulators[k][1] = accumulators[k][2] = _mm_setzero_ps();
+		}
+		for (; i + 4 <= end; i += 4) {
+			const __m128 x = _mm_loadu_ps(&level.x[i]);
+			const __m128 y = _mm_loadu_ps(&level.y[i]);
+			const __m128 z = _mm_loadu_ps(&level.z[i]);
+			const __m128 weight = _mm_loadu_ps(&level.solidAngle[i]);
+			const __m128 radiance[3] = {
+				_mm_mul_ps(_mm_loadu_ps(&level.r[i]), weight),
+				_mm_mul_ps(_mm_loadu_ps(&level.g[i]), weight),
+				_mm_mul_ps(_mm_loadu_ps(&level.b[i]), weight)
+			};
+			const __m128 basis[9] = {
+				_mm_set1_ps(0.282095f),
+				_mm_mul_ps(_mm_set1_ps(0.488603f), y),
+				_mm_mul_ps(_mm_set1_ps(0.488603f), z),
+				_mm_mul_ps(_mm_set1_ps(0.488603f), x),
+				_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(x, y)),
+				_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(y, z)),
+				_mm_mul_ps(_mm_set1_ps(0.315392f), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(z, z)), _mm_set1_ps(1.0f))),
+				_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(x, z)),
+				_mm_mul_ps(_mm_set1_ps(0.546274f), _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)))
+			};
+			for (uint32_t k = 0; k < 9; ++k) {
+				for (uint32_t c = 0; c < 3; ++c) {
+					accumulators[k][c] = _mm_add_ps(accumulators[k][c], _mm_mul_ps(basis[k], radiance[c]));
+				}
+			}
+		}
+		for (uint32_t k = 0; k < 9; ++k) {
+			for (uint32_t c = 0; c < 3; ++c) {
+				alignas(16) float lanes[4];
+				_mm_store_ps(lanes, accumulators[k][c]);
+				sums[k][c] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			}
+		}
+#endif
+		for (; i < end; ++i) {
+			const float x = level.x[i], y = level.y[i], z = level.z[i];
+			const float basis[9] = {
+				0.282095f, 0.488603f * y, 0.488603f * z, 0.488603f * x,
+				1.092548f * x * y, 1.092548f * y * z, 0.315392f * (3.0f * z * z - 1.0f), 1.092548f * x * z, 0.546274f * (x * x - y * y)
+			};
+			const float radiance[3] = { level.r[i] * level.solidAngle[i], level.g[i] * level.solidAngle[i], level.b[i] * level.solidAngle[i] };
+			for (uint32_t k = 0; k < 9; ++k) {
+				for (uint32_t c = 0; c < 3; ++c) {
+					sums[k][c] += basis[k] * radiance[c];
+				}
+			}
+		}
+	}
+
+	void projectIrradianceSh(const SourceLevel& level, IblResults& results)
+	{
+		// Every face row is summed up separately, and the rows in a fixed order, so that the results are deterministic:
+		const uint32_t row_count = 6 * level.size;
+		std::vector<std::array<std::array<float, 3>, 9>> row_sums(row_count);
+		jobParallelFor(row_count, 8, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t row = begin; row < end; ++row) {
+				float sums[9][3] = {};
+				accumulateSh(level, static_cast<size_t>(row) * level.size, static_cast<size_t>(row + 1) * level.size, sums);
+				for (uint32_t k = 0; k < 9; ++k) {
+					for (uint32_t c = 0; c < 3; ++c) {
+						row_sums[row][k][c] = sums[k][c];
+					}
+				}
+			}
+		});
+
+		// Convolution with the clamped cosine lobe scales band l by A_l:
+		const float band_scales[9] = { kPi, 2.0f * kPi / 3.0f, 2.0f * kPi / 3.0f, 2.0f * kPi / 3.0f, kPi / 4.0f, kPi / 4.0f, kPi / 4.0f, kPi / 4.0f, kPi / 4.0f };
+		for (uint32_t k = 0; k < 9; ++k) {
+			glm::vec3 sum(0.0f);
+			for (const auto& row : row_sums) {
+				sum += glm::vec3(row[k][0], row[k][1], row[k][2]);
+			}
+			results.irradianceSh[k] = sum * band_scales[k];
+		}
+	}
+
+	// Integrates the source's radiance, weighted by the GGX distribution of the half vector between normal and light
+	// direction, and n·l. Like in the split-sum approximation, the view direction is assumed to equal the normal.
+	glm::vec3 prefilter(const SourceLevel& level, const glm::vec3& normal, float alpha)
+	{
+		const float alpha2_minus_1 = alpha * alpha - 1.0f;
+		float sums[4] = {};
+		size_t i = 0;
+#if IBL_USE_SSE2
+		const __m128 nx = _mm_set1_ps(normal.x), ny = _mm_set1_ps(normal.y), nz = _mm_set1_ps(normal.z);
+		const __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), a = _mm_set1_ps(alpha2_minus_1);
+		__m128 sum_r = _mm_setzero_ps(), sum_g = _mm_setzero_ps(), sum_b = _mm_setzero_ps(), sum_weight = _mm_setzero_ps();
+		for (; i < level.x.size(); i += 4) {
+			const __m128 n_dot_l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(&level.x[i])), _mm_mul_ps(ny, _mm_loadu_ps(&level.y[i]))), _mm_mul_ps(nz, _mm_loadu_ps(&level.z[i])));
+			// n·h^2 = (1 + n·l) / 2 for h = normalize(n + l); D(h) is proportional to 1 / (n·h^2 (alpha^2 - 1) + 1)^2:
+			const __m128 denominator = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(one, n_dot_l), half), a), one);
+			const __m128 weight = _mm_div_ps(_mm_mul_ps(_mm_max_ps(n_dot_l, _mm_setzero_ps()), _mm_loadu_ps(&level.solidAngle[i])), _mm_mul_ps(denominator, denominator));
+			sum_r = _mm_add_ps(sum_r, _mm_mul_ps(weight, _mm_loadu_ps(&level.r[i])));
+			sum_g = _mm_add_ps(sum_g, _mm_mul_ps(weight, _mm_loadu_ps(&level.g[i])));
+			sum_b = _mm_add_ps(sum_b, _mm_mul_ps(weight, _mm_loadu_ps(&level.b[i])));
+			sum_weight = _mm_add_ps(sum_weight, weight);
+		}
+		const __m128 lanes[4] = { sum_r, sum_g, sum_b, sum_weight };
+		for (uint32_t c = 0; c < 4; ++c) {
+			alignas(16) float values[4];
+			_mm_store_ps(values, lanes[c]);
+			sums[c] = values[0] + values[1] + values[2] + values[3];
+		}
+#endif
+		for (; i < level.x.size(); ++i) {
+			const float n_dot_l = normal.x * level.x[i] + normal.y * level.y[i] + normal.z * level.z[i];
+			const float denominator = (1.0f + n_dot_l) * 0.5f * alpha2_minus_1 + 1.0f;
+			const float weight = std::max(n_dot_l, 0.0f) * level.solidAngle[i] / (denominator * denominator);
+			sums[0] += weight * level.r[i];
+			sums[1] += weight * level.g[i];
+			sums[2] += weight * level.b[i];
+			sums[3] += weight;
+		}
+		return sums[3] > 0.0f ? glm::vec3(sums[0], sums[1], sums[2]) / sums[3] : glm::vec3(0.0f);
+	}
+
+	// Index of the source level which mip level `level` of the specular cubemap is computed from
+	uint32_t sourceLevelIndex(const std::vector<SourceLevel>& levels, const IblSettings& settings, uint32_t level)
+	{
+		if (0 == level) {
+			uint32_t index = 0;
+			while (levels[index].size > settings.specularSize) {
+				++index;
+			}
+			return index;
+		}
+		// The lobe widens with the roughness, hence coarser source levels suffice for higher mip levels:
+		uint32_t index = level - 1;
+		while (index > 0 && (index >= levels.size() || levels[index].size < kMinPrefilterSourceSize)) {
+			--index;
+		}
+		return index;
+	}
+
+	float alphaOfMipLevel(const IblSettings& settings, uint32_t level)
+	{
+		const float roughness = settings.specularMipLevelCount > 1 ? static_cast<float>(level) / (settings.specularMipLevelCount - 1) : 0.0f;
+		return roughness * roughness;
+	}
+
+	glm::vec4& specularTexel(IblResults& results, uint32_t face, uint32_t level, size_t texel)
+	{
+		const DdsSubresource& subresource = results.specularSubresources[static_cast<size_t>(face) * results.specularMipLevelCount + level];
+		return results.specularTexels[subresource.offset / sizeof(glm::vec4) + texel];
+	}
+
+	void prefilterSpecularOnCpu(const std::vector<SourceLevel>& levels, const IblSettings& settings, IblResults& results)
+	{
+		struct Row {
+			uint32_t level;
+			uint32_t face;
+			uint32_t y;
+		};
+		std::vector<Row> rows;
+		for (uint32_t level = 1; level < results.specularMipLevelCount; ++level) {
+			const uint32_t size = std::max(1u, results.specularSize >> level);
+			for (uint32_t face = 0; face < 6; ++face) {
+				for (uint32_t y = 0; y < size; ++y) {
+					rows.push_back(Row{ level, face, y });
+				}
+			}
+		}
+		jobParallelFor(static_cast<uint32_t>(rows.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				const Row& row = rows[i];
+				const SourceLevel& source = levels[sourceLevelIndex(levels, settings, row.level)];
+				const float alpha = alphaOfMipLevel(settings, row.level);
+				const uint32_t size = std::max(1u, results.specularSize >> row.level);
+				for (uint32_t x = 0; x < size; ++x) {
+					const glm::vec3 normal = glm::normalize(cubeDirection(row.face, (x + 0.5f) * 2.0f / size - 1.0f, (row.y + 0.5f) * 2.0f / size - 1.0f));
+					specularTexel(results, row.face, row.level, static_cast<size_t>(row.y) * size + x) = glm::vec4(prefilter(source, normal, alpha), 1.0f);
+				}
+			}
+		});
+	}
+
+	void* createMappedBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory, const char* name)
+	{
+		const auto device = vklGetDevice();
+
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &buffer);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		VkMemoryRequirements memory_requirements = {};
+		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
+		memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, name, MEM_CATEGORY_OTHER);
+		result = vkBindBufferMemory(device, buffer, memory, 0);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		void* mapped_memory = nullptr;
+		result = vkMapMemory(device, memory, 0, size, 0, &mapped_memory);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return mapped_memory;
+	}
+
+	// Same computation as prefilterSpecularOnCpu with kPrefilterShaderPath: one dispatch per mip level, whose
+	// invocations each compute one texel of all faces. Sources and results are exchanged through host-coherent buffers.
+	void prefilterSpecularOnGpu(const std::vector<SourceLevel>& levels, const IblSettings& settings, IblResults& results)
+	{
+		const auto device = vklGetDevice();
+
+		// Upload every source level which is used, and assign every mip level's results a range of the output buffer:
+		std::vector<uint32_t> source_offsets(levels.size(), UINT32_MAX);
+		std::vector<PrefilterPushConstants> dispatches;
+		uint32_t source_count = 0, output_count = 0;
+		for (uint32_t level = 1; level < results.specularMipLevelCount; ++level) {
+			const uint32_t source_index = sourceLevelIndex(levels, settings, level);
+			if (UINT32_MAX == source_offsets[source_index]) {
+				source_offsets[source_index] = source_count;
+				source_count += levels[source_index].texelCount;
+			}
+			const uint32_t size = std::max(1u, results.specularSize >> level);
+			dispatches.push_back(PrefilterPushConstants{ source_offsets[source_index], levels[source_index].texelCount, output_count, size, alphaOfMipLevel(settings, level) });
+			output_count += 6 * size * size;
+		}
+		if (dispatches.empty()) {
+			return;
+		}
+
+		VkBuffer source_buffer, output_buffer;
+		VkDeviceMemory source_memory, output_memory;
+		GpuSourceTexel* source_texels = static_cast<GpuSourceTexel*>(createMappedBuffer(sizeof(GpuSourceTexel) * source_count, source_buffer, source_memory, "IBL prefilter source"));
+		const glm::vec4* output_texels = static_cast<const glm::vec4*>(createMappedBuffer(sizeof(glm::vec4) * output_count, output_buffer, output_memory, "IBL prefilter output"));
+		for (size_t index = 0; index < levels.size(); ++index) {
+			if (UINT32_MAX == source_offsets[index]) {
+				continue;
+			}
+			const SourceLevel& level = levels[index];
+			for (uint32_t i = 0; i < level.texelCount; ++i) {
+				source_texels[source_offsets[index] + i] = GpuSourceTexel{ { level.x[i], level.y[i], level.z[i], level.solidAngle[i] }, { level.r[i], level.g[i], level.b[i], 1.0f } };
+			}
+		}
+
+		VkDescriptorBufferInfo buffer_infos[2] = {};
+		buffer_infos[0].buffer = source_buffer;
+		buffer_infos[0].range = VK_WHOLE_SIZE;
+		buffer_infos[1].buffer = output_buffer;
+		buffer_infos[1].range = VK_WHOLE_SIZE;
+		VkWriteDescriptorSet writes[2] = {};
+		for (uint32_t binding = 0; binding < 2; ++binding) {
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = mDescriptorSet;
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[binding].pBufferInfo = &buffer_infos[binding];
+		}
+		vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.commandPool = mCommandPool;
+		allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocate_info.commandBufferCount = 1;
+		VkCommandBuffer command_buffer;
+		VkResult result = vkAllocateCommandBuffers(device, &allocate_info, &command_buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to allocate IBL command buffer with error: ") + std::to_string(result));
+		}
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSet, 0, nullptr);
+		for (const PrefilterPushConstants& dispatch : dispatches) {
+			vkCmdPushConstants(command_buffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(dispatch), &dispatch);
+			vkCmdDispatch(command_buffer, (6 * dispatch.faceSize * dispatch.faceSize + kPrefilterWorkgroupSize - 1) / kPrefilterWorkgroupSize, 1, 1);
+		}
+		// Make the results visible to the host:
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		result = vkEndCommandBuffer(command_buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to record IBL command buffer with error: ") + std::to_string(result));
+		}
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &command_buffer;
+		result = vkQueueSubmit(mComputeQueue, 1, &submit_info, mFence);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to submit IBL prefiltering with error: ") + std::to_string(result));
+		}
+		result = vkWaitForFences(device, 1, &mFence, VK_TRUE, UINT64_MAX);
+		VKL_CHECK_VULKAN_RESULT(result);
+		result = vkResetFences(device, 1, &mFence);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		for (uint32_t level = 1; level < results.specularMipLevelCount; ++level) {
+			const PrefilterPushConstants& dispatch = dispatches[level - 1];
+			const size_t texels_per_face = static_cast<size_t>(dispatch.faceSize) * dispatch.faceSize;
+			for (uint32_t face = 0; face < 6; ++face) {
+				std::memcpy(&specularTexel(results, face, level, 0), output_texels + dispatch.outputOffset + face * texels_per_face, sizeof(glm::vec4) * texels_per_face);
+			}
+		}
+
+		vkFreeCommandBuffers(device, mCommandPool, 1, &command_buffer);
+		vkDestroyBuffer(device, source_buffer, nullptr);
+		vkDestroyBuffer(device, output_buffer, nullptr);
+		memFree(source_memory);
+		memFree(output_memory);
+	}
+
+	// Radical inverse of i in base 2, see "Hammersley Points on the Hemisphere" by Holger Dammertz
+	float radicalInverse(uint32_t i)
+	{
+		i = (i << 16u) | (i >> 16u);
+		i = ((i & 0x55555555u) << 1u) | ((i & 0xAAAAAAAAu) >> 1u);
+		i = ((i & 0x33333333u) << 2u) | ((i & 0xCCCCCCCCu) >> 2u);
+		i = ((i & 0x0F0F0F0Fu) << 4u) | ((i & 0xF0F0F0F0u) >> 4u);
+		i = ((i & 0x00FF00FFu) << 8u) | ((i & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(i) * 2.3283064365386963e-10f;
+	}
+
+	// Integrates the split-sum BRDF term for one n·v and roughness with importance-sampled half vectors h,
+	// whose components are given as structure of arrays (padded with h = 0, which does not contribute)
+	glm::vec2 integrateBrdf(float n_dot_v, float alpha, const std::vector<float>& hx, const std::vector<float>& hz, uint32_t sample_count)
+	{
+		const float vx = std::sqrt(1.0f - n_dot_v * n_dot_v), vz = n_dot_v;
+		// Schlick-Smith geometry term with k = alpha / 2 for image-based lighting:
+		const float k = alpha * 0.5f;
+		const float g1_v = n_dot_v / (n_dot_v * (1.0f - k) + k);
+		float sums[2] = {};
+		size_t i = 0;
+#if IBL_USE_SSE2
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		const __m128 k4 = _mm_set1_ps(k), one_minus_k = _mm_set1_ps(1.0f - k), g1_v4 = _mm_set1_ps(g1_v / n_dot_v);
+		__m128 sum_scale = zero, sum_bias = zero;
+		for (; i < hx.size(); i += 4) {
+			const __m128 x = _mm_loadu_ps(&hx[i]), z = _mm_loadu_ps(&hz[i]);
+			const __m128 v_dot_h = _mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(vx), x), _mm_mul_ps(_mm_set1_ps(vz), z)), zero);
+			const __m128 n_dot_l = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, v_dot_h), z), _mm_set1_ps(vz));
+			const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(n_dot_l, zero), _mm_cmpgt_ps(z, zero));
+			const __m128 g1_l = _mm_div_ps(n_dot_l, _mm_add_ps(_mm_mul_ps(n_dot_l, one_minus_k), k4));
+			const __m128 g_visibility = _mm_and_ps(valid, _mm_div_ps(_mm_mul_ps(_mm_mul_ps(g1_v4, g1_l), v_dot_h), z));
+			const __m128 c = _mm_sub_ps(one, v_dot_h);
+			const __m128 c2 = _mm_mul_ps(c, c);
+			const __m128 fresnel = _mm_mul_ps(_mm_mul_ps(c2, c2), c);
+			sum_scale = _mm_add_ps(sum_scale, _mm_mul_ps(_mm_sub_ps(one, fresnel), g_visibility));
+			sum_bias = _mm_add_ps(sum_bias, _mm_mul_ps(fresnel, g_visibility));
+		}
+		alignas(16) float lanes[2][4];
+		_mm_store_ps(lanes[0], sum_scale);
+		_mm_store_ps(lanes[1], sum_bias);
+		for (uint32_t c = 0; c < 2; ++c) {
+			sums[c] = lanes[c][0] + lanes[c][1] + lanes[c][2] + lanes[c][3];
+		}
+#endif
+		for (; i < hx.size(); ++i) {
+			const float v_dot_h = std::max(vx * hx[i] + vz * hz[i], 0.0f);
+			const float n_dot_l = 2.0f * v_dot_h * hz[i] - vz;
+			if (n_dot_l <= 0.0f || hz[i] <= 0.0f) {
+				continue;
+			}
+			const float g1_l = n_dot_l / (n_dot_l * (1.0f - k) + k);
+			const float g_visibility = g1_v * g1_l * v_dot_h / (hz[i] * n_dot_v);
+			const float fresnel = std::pow(1.0f - v_dot_h, 5.0f);
+			sums[0] += (1.0f - fresnel) * g_visibility;
+			sums[1] += fresnel * g_visibility;
+		}
+		return glm::vec2(sums[0], sums[1]) / static_cast<float>(sample_count);
+	}
+
+	void computeBrdfLut(const IblSettings& settings, IblResults& results)
+	{
+		const uint32_t size = settings.brdfLutSize;
+		const uint32_t sample_count = std::max(1u, settings.brdfSampleCount);
+		results.brdfLutSize = size;
+		results.brdfLut.assign(static_cast<size_t>(size) * size, glm::vec2(0.0f));
+		jobParallelFor(size, 1, [&](uint32_t begin, uint32_t end) {
+			std::vector<float> hx((sample_count + 3) / 4 * 4, 0.0f), hz(hx.size(), 0.0f);
+			for (uint32_t row = begin; row < end; ++row) {
+				const float roughness = (row + 0.5f) / size;
+				const float alpha = roughness * roughness;
+				// GGX importance sampling of h; by symmetry around n, only h's x and z components matter for v = (sin, 0, cos):
+				for (uint32_t i = 0; i < sample_count; ++i) {
+					const float phi = 2.0f * kPi * (i + 0.5f) / sample_count;
+					const float xi = radicalInverse(i);
+					const float cos_theta = std::sqrt((1.0f - xi) / (1.0f + (alpha * alpha - 1.0f) * xi));
+					hx[i] = std::sqrt(1.0f - cos_theta * cos_theta) * std::cos(phi);
+					hz[i] = cos_theta;
+				}
+				for (uint32_t column = 0; column < size; ++column) {
+					results.brdfLut[static_cast<size_t>(row) * size + column] = integrateBrdf((column + 0.5f) / size, alpha, hx, hz, sample_count);
+				}
+			}
+		});
+	}
+
+	void settingsToArray(const IblSettings& settings, uint32_t values[6])
+	{
+		values[0] = settings.sourceSize;
+		values[1] = settings.specularSize;
+		values[2] = settings.specularMipLevelCount;
+		values[3] = settings.brdfLutSize;
+		values[4] = settings.brdfSampleCount;
+		values[5] = settings.srgbSource ? 1u : 0u;
+	}
+
+	// Cache files consist of the magic number, the version, the settings, the SH coefficients, the specular texels, and the BRDF lookup table.
+	bool readCacheFile(const std::filesystem::path& path, const IblSettings& settings, IblResults& results)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream) {
+			return false;
+		}
+		const std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		uint32_t expected[8] = { 0, kVersion };
+		std::memcpy(expected, kMagic, sizeof(kMagic));
+		settingsToArray(settings, expected + 2);
+		const size_t specular_size = results.specularTexels.size() * sizeof(glm::vec4);
+		const size_t lut_size = results.brdfLut.size() * sizeof(glm::vec2);
+		if (data.size() != sizeof(expected) + sizeof(results.irradianceSh) + specular_size + lut_size || 0 != std::memcmp(data.data(), expected, sizeof(expected))) {
+			VKL_LOG("WARNING: Ignoring invalid cache file \"" << path.string() << "\".");
+			return false;
+		}
+		size_t offset = sizeof(expected);
+		std::memcpy(results.irradianceSh, data.data() + offset, sizeof(results.irradianceSh));
+		offset += sizeof(results.irradianceSh);
+		std::memcpy(results.specularTexels.data(), data.data() + offset, specular_size);
+		offset += specular_size;
+		std::memcpy(results.brdfLut.data(), data.data() + offset, lut_size);
+		return true;
+	}
+
+	void writeCacheFile(const std::filesystem::path& path, const IblSettings& settings, const IblResults& results)
+	{
+		uint32_t header[8] = { 0, kVersion };
+		std::memcpy(header, kMagic, sizeof(kMagic));
+		settingsToArray(settings, header + 2);
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(results.irradianceSh), sizeof(results.irradianceSh));
+		stream.write(reinterpret_cast<const char*>(results.specularTexels.data()), static_cast<std::streamsize>(results.specularTexels.size() * sizeof(glm::vec4)));
+		stream.write(reinterpret_cast<const char*>(results.brdfLut.data()), static_cast<std::streamsize>(results.brdfLut.size() * sizeof(glm::vec2)));
+		if (!stream) {
+			VKL_LOG("WARNING: Failed to write cache file \"" << path.string() << "\".");
+		}
+	}
+
+	// Sizes the results' arrays according to the settings, and computes the subresources' locations
+	bool allocateResults(const IblSettings& settings, IblResults& results)
+	{
+		if (0 == settings.specularSize || settings.specularSize > settings.sourceSize || 0 != (settings.specularSize & (settings.specularSize - 1))
+			|| 0 != (settings.sourceSize & (settings.sourceSize - 1)) || 0 == settings.brdfLutSize) {
+			VKL_LOG("IBL source and specular sizes must be powers of two, with the specular size at most the source size.");
+			return false;
+		}
+		results = IblResults{};
+		results.specularSize = settings.specularSize;
+		results.specularMipLevelCount = 1;
+		while (results.specularMipLevelCount < settings.specularMipLevelCount && (settings.specularSize >> results.specularMipLevelCount) > 0) {
+			++results.specularMipLevelCount;
+		}
+		size_t offset = 0;
+		for (uint32_t face = 0; face < 6; ++face) {
+			for (uint32_t level = 0; level < results.specularMipLevelCount; ++level) {
+				const uint32_t size = std::max(1u, settings.specularSize >> level);
+				results.specularSubresources.push_back(DdsSubresource{ size, size, offset, sizeof(glm::vec4) * size * size });
+				offset += results.specularSubresources.back().size;
+			}
+		}
+		results.specularTexels.resize(offset / sizeof(glm::vec4));
+		results.brdfLutSize = settings.brdfLutSize;
+		results.brdfLut.resize(static_cast<size_t>(settings.brdfLutSize) * settings.brdfLutSize);
+		return true;
+	}
+}
+
+/* --------------------------------------------- */
+// Image-Based Lighting Function Definitions
+/* --------------------------------------------- */
+
+void iblInitComputePath(VkQueue queue, uint32_t queue_family_index)
+{
+	if (VK_NULL_HANDLE != mComputeQueue) {
+		VKL_EXIT_WITH_ERROR("IBL compute path already initialized.");
+	}
+	const auto device = vklGetDevice();
+
+	VkCommandPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex = queue_family_index;
+	VkResult result = vkCreateCommandPool(device, &pool_create_info, nullptr, &mCommandPool);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create IBL command pool with error: ") + std::to_string(result));
+	}
+
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	for (uint32_t binding = 0; binding < 2; ++binding) {
+		bindings[binding].binding = binding;
+		bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[binding].descriptorCount = 1;
+		bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = 2;
+	layout_create_info.pBindings = bindings;
+	result = vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &mDescriptorSetLayout);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_range.size = sizeof(PrefilterPushConstants);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &mDescriptorSetLayout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	result = vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &mPipelineLayout);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	VkComputePipelineCreateInfo pipeline_create_info = {};
+	pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_create_info.stage.module = shaderCreateModule(kPrefilterShaderPath);
+	pipeline_create_info.stage.pName = "main";
+	pipeline_create_info.layout = mPipelineLayout;
+	result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &mPipeline);
+	vkDestroyShaderModule(device, pipeline_create_info.stage.module, nullptr);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create IBL prefilter pipeline with error: ") + std::to_string(result));
+	}
+
+	VkDescriptorPoolSize pool_size = {};
+	pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_size.descriptorCount = 2;
+	VkDescriptorPoolCreateInfo descriptor_pool_create_info = {};
+	descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptor_pool_create_info.maxSets = 1;
+	descriptor_pool_create_info.poolSizeCount = 1;
+	descriptor_pool_create_info.pPoolSizes = &pool_size;
+	result = vkCreateDescriptorPool(device, &descriptor_pool_create_info, nullptr, &mDescriptorPool);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	VkDescriptorSetAllocateInfo set_allocate_info = {};
+	set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_allocate_info.descriptorPool = mDescriptorPool;
+	set_allocate_info.descriptorSetCount = 1;
+	set_allocate_info.pSetLayouts = &mDescriptorSetLayout;
+	result = vkAllocateDescriptorSets(device, &set_allocate_info, &mDescriptorSet);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	VkFenceCreateInfo fence_create_info = {};
+	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	result = vkCreateFence(device, &fence_create_info, nullptr, &mFence);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	mComputeQueue = queue;
+}
+
+void iblDestroyComputePath()
+{
+	if (VK_NULL_HANDLE == mComputeQueue) {
+		return;
+	}
+	const auto device = vklGetDevice();
+	vkDestroyFence(device, mFence, nullptr);
+	vkDestroyDescriptorPool(device, mDescriptorPool, nullptr);
+	vkDestroyPipeline(device, mPipeline, nullptr);
+	vkDestroyPipelineLayout(device, mPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, mDescriptorSetLayout, nullptr);
+	vkDestroyCommandPool(device, mCommandPool, nullptr);
+	mFence = VK_NULL_HANDLE;
+	mDescriptorSet = VK_NULL_HANDLE;
+	mDescriptorPool = VK_NULL_HANDLE;
+	mPipeline = VK_NULL_HANDLE;
+	mPipelineLayout = VK_NULL_HANDLE;
+	mDescriptorSetLayout = VK_NULL_HANDLE;
+	mCommandPool = VK_NULL_HANDLE;
+	mComputeQueue = VK_NULL_HANDLE;
+}
+
+bool iblPrecompute(const std::vector<uint8_t> face_files[6], const IblSettings& settings, IblResults& results, IblStats* stats)
+{
+	const auto start = std::chrono::steady_clock::now();
+	IblStats local_stats = {};
+	if (!allocateResults(settings, results)) {
+		return false;
+	}
+
+	auto stage_start = std::chrono::steady_clock::now();
+	std::vector<glm::vec3> texels;
+	if (!decodeFaces(face_files, settings, texels)) {
+		return false;
+	}
+	// The source and all of its box-filtered levels down to 1x1:
+	std::vector<SourceLevel> levels;
+	for (uint32_t size = settings.sourceSize; size > 0; size /= 2) {
+		levels.push_back(createSourceLevel(texels, size));
+		if (size > 1) {
+			texels = downsample(texels, size);
+		}
+	}
+	local_stats.decodeMilliseconds = millisecondsSince(stage_start);
+
+	stage_start = std::chrono::steady_clock::now();
+	projectIrradianceSh(levels[0], results);
+	local_stats.shMilliseconds = millisecondsSince(stage_start);
+
+	stage_start = std::chrono::steady_clock::now();
+	// Roughness 0 is a perfect mirror, i.e., the first mip level is the source at the specular size:
+	const SourceLevel& mirror = levels[sourceLevelIndex(levels, settings, 0)];
+	for (uint32_t face = 0; face < 6; ++face) {
+		for (size_t texel = 0; texel < static_cast<size_t>(mirror.size) * mirror.size; ++texel) {
+			const size_t i = static_cast<size_t>(face) * mirror.size * mirror.size + texel;
+			specularTexel(results, face, 0, texel) = glm::vec4(mirror.r[i], mirror.g[i], mirror.b[i], 1.0f);
+		}
+	}
+	local_stats.computeShader = VK_NULL_HANDLE != mComputeQueue;
+	if (local_stats.computeShader) {
+		prefilterSpecularOnGpu(levels, settings, results);
+	}
+	else {
+		prefilterSpecularOnCpu(levels, settings, results);
+	}
+	local_stats.specularMilliseconds = millisecondsSince(stage_start);
+
+	stage_start = std::chrono::steady_clock::now();
+	computeBrdfLut(settings, results);
+	local_stats.brdfLutMilliseconds = millisecondsSince(stage_start);
+
+	local_stats.totalMilliseconds = millisecondsSince(start);
+	if (nullptr != stats) {
+		*stats = local_stats;
+	}
+	return true;
+}
+
+bool iblPrecomputeCached(const std::vector<uint8_t> face_files[6], const IblSettings& settings, const std::string& cache_directory, IblResults& results, IblStats* stats)
+{
+	const auto start = std::chrono::steady_clock::now();
+	uint32_t parameters[7] = { kVersion };
+	settingsToArray(settings, parameters + 1);
+	uint64_t hash = hashFnv1a(parameters, sizeof(parameters));
+	for (uint32_t face = 0; face < 6; ++face) {
+		const uint64_t size = face_files[face].size();
+		hash = hashFnv1a(face_files[face].data(), face_files[face].size(), hashFnv1a(&size, sizeof(size), hash));
+	}
+	std::ostringstream file_name;
+	file_name << std::hex << std::setw(16) << std::setfill('0') << hash << ".ibl";
+	const std::filesystem::path path = std::filesystem::path(cache_directory) / file_name.str();
+
+	if (!allocateResults(settings, results)) {
+		return false;
+	}
+	if (readCacheFile(path, settings, results)) {
+		if (nullptr != stats) {
+			*stats = IblStats{};
+			stats->cacheHit = true;
+			stats->totalMilliseconds = millisecondsSince(start);
+		}
+		return true;
+	}
+
+	if (!iblPrecompute(face_files, settings, results, stats)) {
+		return false;
+	}
+	writeCacheFile(path, settings, results);
+	return true;
+}
+
+glm::vec3 iblEvaluateIrradiance(const IblResults& results, const glm::vec3& normal)
+{
+	const float x = normal.x, y = normal.y, z = normal.z;
+	const float basis[9] = {
+		0.282095f, 0.488603f * y, 0.488603f * z, 0.488603f * x,
+		1.092548f * x * y, 1.092548f * y * z, 0.315392f * (3.0f * z * z - 1.0f), 1.092548f * x * z, 0.546274f * (x * x - y * y)
+	};
+	glm::vec3 irradiance(0.0f);
+	for (uint32_t k = 0; k < 9; ++k) {
+		irradiance += results.irradianceSh[k] * basis[k];
+	}
+	return glm::max(irradiance, glm::vec3(0.0f));
+}
+
+void iblLogStats(const IblStats& stats)
+{
+	if (stats.cacheHit) {
+		VKL_LOG("IBL loaded from cache in " << stats.totalMilliseconds << " ms");
+		return;
+	}
+	VKL_LOG("IBL precomputed in " << stats.totalMilliseconds << " ms using " << jobGetWorkerCount() << " workers: decode " << stats.decodeMilliseconds
+		<< " ms, SH " << stats.shMilliseconds << " ms, specular " << stats.specularMilliseconds << " ms (" << (stats.computeShader ? "compute shader" : "CPU")
+		<< "), BRDF LUT " << stats.brdfLutMilliseconds << " ms");
+}
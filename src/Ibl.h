@@ -0,0 +1,120 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "DdsImage.h"
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Image-Based Lighting Struct Definitions
+// As a convention, their names start with `Ibl`.
+/* --------------------------------------------- */
+
+/*!
+ * Parameters of the precomputation. They are part of the cache key.
+ */
+struct IblSettings {
+	//! Face size which the cubemap is box-filtered down to before integrating over it; must divide the faces' size
+	uint32_t sourceSize;
+
+	//! Face size of the specular cubemap's first mip level; at most sourceSize
+	uint32_t specularSize;
+
+	//! Number of mip levels of the specular cubemap. Level i is prefiltered for roughness i / (specularMipLevelCount - 1).
+	uint32_t specularMipLevelCount;
+
+	//! Width and height of the BRDF lookup table, and the number of GGX samples per entry
+	uint32_t brdfLutSize;
+	uint32_t brdfSampleCount;
+
+	//! Whether the faces store sRGB-encoded colors, which are converted to linear before integrating
+	bool srgbSource;
+};
+
+/*!
+ * Precomputed image-based lighting.
+ */
+struct IblResults {
+	//! Irradiance as spherical harmonics of bands 0-2, see iblEvaluateIrradiance
+	glm::vec3 irradianceSh[9];
+
+	//! GGX-prefiltered radiance in linear RGB (alpha = 1), to be uploaded as VK_FORMAT_R32G32B32A32_SFLOAT cubemap
+	uint32_t specularSize;
+	uint32_t specularMipLevelCount;
+	std::vector<glm::vec4> specularTexels;
+
+	//! Locations of all mip levels of the first face, followed by all mip levels of the next face, and so on.
+	//! Offsets are in bytes from the start of specularTexels.
+	std::vector<DdsSubresource> specularSubresources;
+
+	//! Scale and bias of F0 for the split-sum approximation, indexed by n·v (along x) and roughness (along y);
+	//! to be uploaded as VK_FORMAT_R32G32_SFLOAT image
+	uint32_t brdfLutSize;
+	std::vector<glm::vec2> brdfLut;
+};
+
+/*!
+ * Timings of one invocation of iblPrecompute or iblPrecomputeCached.
+ */
+struct IblStats {
+	//! Whether the results have been loaded from the disk cache. If so, only totalMilliseconds is measured.
+	bool cacheHit;
+
+	//! Whether the specular cubemap has been prefiltered with the compute shader (see iblInitComputePath)
+	bool computeShader;
+
+	double decodeMilliseconds;
+	double shMilliseconds;
+	double specularMilliseconds;
+	double brdfLutMilliseconds;
+	double totalMilliseconds;
+};
+
+/* --------------------------------------------- */
+// Image-Based Lighting Function Definitions
+// As a convention, their names start with `ibl`.
+/* --------------------------------------------- */
+
+/*!
+ *	Enables the compute shader path: afterwards, iblPrecompute prefilters the specular cubemap on the GPU with
+ *	assets/shaders/ibl_prefilter.comp (compiled through the shader manager, see shaderInitManager) instead of on the CPU.
+ *	Spherical harmonics and the BRDF lookup table are always computed on the CPU, since they are cheap.
+ *	@param	queue				A queue which supports compute
+ *	@param	queue_family_index	The queue's family
+ */
+void iblInitComputePath(VkQueue queue, uint32_t queue_family_index);
+
+/*!
+ *	Destroys the compute shader path's resources. Afterwards, iblPrecompute runs on the CPU again.
+ */
+void iblDestroyComputePath();
+
+/*!
+ *	Computes diffuse and specular image-based lighting from a cubemap. The work is split across the job system's
+ *	workers (see jobInitSystem), and the inner loops are vectorized with SSE2 where available.
+ *	@param	face_files	DDS files of the faces in the order +x, -x, +y, -y, +z, -z (BC1-BC3 or RGBA8, see bcDecodeDds)
+ *	@param	stats		Optionally receives timings
+ *	@return	True on success, false if a face could not be decoded or the faces do not match the settings.
+ */
+bool iblPrecompute(const std::vector<uint8_t> face_files[6], const IblSettings& settings, IblResults& results, IblStats* stats = nullptr);
+
+/*!
+ *	Like iblPrecompute, but looks up the results in a cache directory first. Cache files are named after a hash of
+ *	the face files, the settings, and the implementation's version, and are written after computing.
+ *	@param	cache_directory	Directory of the cache files; it is created if it does not exist.
+ */
+bool iblPrecomputeCached(const std::vector<uint8_t> face_files[6], const IblSettings& settings, const std::string& cache_directory, IblResults& results, IblStats* stats = nullptr);
+
+/*!
+ *	Evaluates the irradiance arriving at a surface with the given normal, i.e., the cosine-weighted integral of the
+ *	cubemap's radiance. Multiply by albedo / pi to get the outgoing radiance of a Lambertian surface.
+ */
+glm::vec3 iblEvaluateIrradiance(const IblResults& results, const glm::vec3& normal);
+
+/*!
+ *	Logs the timings of the precomputation's stages.
+ */
+void iblLogStats(const IblStats& stats);
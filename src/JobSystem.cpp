@@ -0,0 +1,349 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* --------------------------------------------- */
+// Internal job system state
+/* --------------------------------------------- */
+
+struct Job {
+	//! The function to execute
+	std::function<void()> work;
+
+	//! Number of unfinished dependencies, plus one while the job is being submitted
+	std::atomic<int32_t> pendingDependencies{ 1 };
+
+	//! Set once `work` has returned
+	std::atomic<bool> finished{ false };
+
+	//! Guards `finished` (for writers) and `continuations`
+	std::mutex mutex;
+
+	//! Jobs which depend on this one
+	std::vector<JobHandle> continuations;
+
+	//! Keeps the job alive while it is queued or running; deques only store raw pointers.
+	JobHandle self;
+};
+
+namespace {
+
+	/*
+	 * Work-stealing deque after Chase and Lev, with the memory orderings from
+	 * Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+	 * Only the owning worker may push() and pop(); any thread may steal().
+	 * The capacity is fixed; push() fails when the deque is full.
+	 */
+	class ChaseLevDeque {
+	public:
+		static constexpr int64_t kCapacity = 4096;
+
+		bool push(Job* job) {
+			const int64_t b = mBottom.load(std::memory_order_relaxed);
+			const int64_t t = mTop.load(std::memory_order_acquire);
+			if (b - t >= kCapacity) {
+				return false;
+			}
+			mBuffer[b & (kCapacity - 1)].store(job, std::memory_order_release);
+			std::atomic_thread_fence(std::memory_order_release);
+			mBottom.store(b + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		Job* pop() {
+			const int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+			mBottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = mTop.load(std::memory_order_relaxed);
+			if (t > b) {
+				// Empty:
+				mBottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			Job* job = mBuffer[b & (kCapacity - 1)].load(std::memory_order_acquire);
+			if (t == b) {
+				// Last element => race against thieves:
+				if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					job = nullptr;
+				}
+				mBottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* steal() {
+			int64_t t = mTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = mBottom.load(std::memory_order_acquire);
+			if (t >= b) {
+				return nullptr;
+			}
+			Job* job = mBuffer[t & (kCapacity - 1)].load(std::memory_order_acquire);
+			if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return nullptr; // Lost the race against the owner or another thief
+			}
+			return job;
+		}
+
+	private:
+		alignas(64) std::atomic<int64_t> mTop{ 0 };
+		alignas(64) std::atomic<int64_t> mBottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]> mBuffer{ new std::atomic<Job*>[kCapacity] };
+	};
+
+	struct Worker {
+		ChaseLevDeque deque;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+
+	// Jobs submitted from threads which are not workers (or whose deque is full):
+	std::mutex mInjectionMutex;
+	std::deque<Job*> mInjectionQueue;
+
+	// Idle workers sleep until the wake generation changes:
+	std::mutex mSleepMutex;
+	std::condition_variable mSleepCondition;
+	std::atomic<uint64_t> mWakeGeneration{ 0 };
+	std::atomic<uint32_t> mSleepingCount{ 0 };
+	std::atomic<bool> mStop{ false };
+
+	// Number of submitted but not yet finished jobs:
+	std::atomic<uint64_t> mUnfinishedJobCount{ 0 };
+
+	thread_local int32_t tWorkerIndex = -1;
+
+	void wakeOneWorker() {
+		if (mSleepingCount.load(std::memory_order_seq_cst) > 0) {
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mWakeGeneration.fetch_add(1, std::memory_order_seq_cst);
+			mSleepCondition.notify_one();
+		}
+	}
+
+	void enqueue(Job* job) {
+		if (tWorkerIndex < 0 || !mWorkers[tWorkerIndex]->deque.push(job)) {
+			std::lock_guard<std::mutex> lock(mInjectionMutex);
+			mInjectionQueue.push_back(job);
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		wakeOneWorker();
+	}
+
+	Job* findJob() {
+		const int32_t worker_count = static_cast<int32_t>(mWorkers.size());
+		if (tWorkerIndex >= 0) {
+			if (Job* job = mWorkers[tWorkerIndex]->deque.pop()) {
+				return job;
+			}
+		}
+
+		// Try to steal, starting at a different victim for every worker to spread contention:
+		thread_local uint32_t victim_seed = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		victim_seed = victim_seed * 1664525u + 1013904223u;
+		const int32_t first_victim = static_cast<int32_t>(victim_seed % static_cast<uint32_t>(worker_count));
+		for (int32_t i = 0; i < worker_count; ++i) {
+			const int32_t victim = (first_victim + i) % worker_count;
+			if (victim == tWorkerIndex) {
+				continue;
+			}
+			if (Job* job = mWorkers[victim]->deque.steal()) {
+				return job;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mInjectionMutex);
+		if (!mInjectionQueue.empty()) {
+			Job* job = mInjectionQueue.front();
+			mInjectionQueue.pop_front();
+			return job;
+		}
+		return nullptr;
+	}
+
+	void execute(Job* job) {
+		const JobHandle keep_alive = std::move(job->self);
+		job->work();
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			job->finished.store(true, std::memory_order_release);
+			continuations.swap(job->continuations);
+		}
+		for (const JobHandle& continuation : continuations) {
+			if (1 == continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel)) {
+				enqueue(continuation.get());
+			}
+		}
+		mUnfinishedJobCount.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	void workerMain(int32_t worker_index) {
+		tWorkerIndex = worker_index;
+		while (!mStop.load(std::memory_order_acquire)) {
+			if (Job* job = findJob()) {
+				execute(job);
+				continue;
+			}
+
+			// Announce that we are about to sleep, then check once more. Any job enqueued after this
+			// check sees mSleepingCount > 0 and bumps the generation, so the wait below won't miss it.
+			mSleepingCount.fetch_add(1, std::memory_order_seq_cst);
+			const uint64_t generation = mWakeGeneration.load(std::memory_order_seq_cst);
+			if (Job* job = findJob()) {
+				mSleepingCount.fetch_sub(1, std::memory_order_seq_cst);
+				execute(job);
+				continue;
+			}
+			{
+				std::unique_lock<std::mutex> lock(mSleepMutex);
+				mSleepCondition.wait(lock, [generation] {
+					return mWakeGeneration.load(std::memory_order_seq_cst) != generation || mStop.load(std::memory_order_acquire);
+				});
+			}
+			mSleepingCount.fetch_sub(1, std::memory_order_seq_cst);
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// Job System Function Definitions
+/* --------------------------------------------- */
+
+void jobInitSystem(uint32_t worker_count)
+{
+	if (!mWorkers.empty()) {
+		return;
+	}
+	if (0u == worker_count) {
+		worker_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	mStop.store(false);
+	for (uint32_t i = 0; i < worker_count; ++i) {
+		mWorkers.push_back(std::make_unique<Worker>());
+	}
+
+	// The calling thread is worker 0; it runs jobs while waiting in jobWait.
+	tWorkerIndex = 0;
+	for (uint32_t i = 1; i < worker_count; ++i) {
+		mWorkers[i]->thread = std::thread(workerMain, static_cast<int32_t>(i));
+	}
+}
+
+void jobDestroySystem()
+{
+	if (mWorkers.empty()) {
+		return;
+	}
+
+	// Help finishing all outstanding jobs:
+	while (mUnfinishedJobCount.load(std::memory_order_acquire) > 0) {
+		if (Job* job = findJob()) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStop.store(true, std::memory_order_release);
+		mSleepCondition.notify_all();
+	}
+	for (auto& worker : mWorkers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+	mWorkers.clear();
+	tWorkerIndex = -1;
+}
+
+uint32_t jobGetWorkerCount()
+{
+	return static_cast<uint32_t>(mWorkers.size());
+}
+
+JobHandle jobSubmit(std::function<void()> work, const JobHandle* dependencies, uint32_t dependency_count)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->work = std::move(work);
+	job->pendingDependencies.store(static_cast<int32_t>(dependency_count) + 1);
+
+	// Without running workers, jobs are executed right away (dependencies have finished by then):
+	if (mWorkers.empty()) {
+		job->work();
+		job->finished.store(true);
+		return job;
+	}
+
+	job->self = job;
+	mUnfinishedJobCount.fetch_add(1, std::memory_order_acq_rel);
+
+	for (uint32_t i = 0; i < dependency_count; ++i) {
+		Job& dependency = *dependencies[i];
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (dependency.finished.load(std::memory_order_acquire)) {
+			job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel);
+		}
+		else {
+			dependency.continuations.push_back(job);
+		}
+	}
+
+	// Drop the submission reference; if all dependencies are done already, the job is ready:
+	if (1 == job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel)) {
+		enqueue(job.get());
+	}
+	return job;
+}
+
+void jobWait(const JobHandle& job)
+{
+	while (!job->finished.load(std::memory_order_acquire)) {
+		if (Job* other = findJob()) {
+			execute(other);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool jobIsFinished(const JobHandle& job)
+{
+	return job->finished.load(std::memory_order_acquire);
+}
+
+void jobParallelFor(uint32_t count, uint32_t grain_size, const std::function<void(uint32_t begin, uint32_t end)>& body)
+{
+	grain_size = std::max(1u, grain_size);
+	if (count <= grain_size || mWorkers.size() <= 1) {
+		if (count > 0) {
+			body(0u, count);
+		}
+		return;
+	}
+
+	std::vector<JobHandle> chunks;
+	chunks.reserve((count + grain_size - 1) / grain_size);
+	for (uint32_t begin = 0; begin < count; begin += grain_size) {
+		const uint32_t end = std::min(count, begin + grain_size);
+		chunks.push_back(jobSubmit([&body, begin, end] { body(begin, end); }));
+	}
+	for (const JobHandle& chunk : chunks) {
+		jobWait(chunk);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/* --------------------------------------------- */
+// Job System Struct Definitions
+// As a convention, their names start with `Job`.
+/* --------------------------------------------- */
+
+struct Job;
+
+/*!
+ * A handle to a submitted job. It can be waited on and be used as a dependency of other jobs.
+ * The job's state stays alive as long as there are handles to it.
+ */
+using JobHandle = std::shared_ptr<Job>;
+
+/* --------------------------------------------- */
+// Job System Function Definitions
+// As a convention, their names start with `job`.
+/* --------------------------------------------- */
+
+/*!
+ *	Starts the work-stealing job system. The calling thread becomes worker 0, i.e., it executes jobs
+ *	whenever it waits for them; all other workers get their own threads. Every worker owns a
+ *	Chase-Lev deque: it pushes and pops jobs at the bottom, idle workers steal from the top.
+ *	@param	worker_count	The total number of workers including the calling thread.
+ *							0 means one worker per hardware thread.
+ */
+void jobInitSystem(uint32_t worker_count = 0);
+
+/*!
+ *	Waits for all submitted jobs to finish and stops all worker threads.
+ */
+void jobDestroySystem();
+
+/*!
+ *	Returns the total number of workers (including the thread that invoked jobInitSystem).
+ */
+uint32_t jobGetWorkerCount();
+
+/*!
+ *	Submits a job, which will run as soon as all of its dependencies have finished.
+ *	Can be invoked from any thread, including from within jobs.
+ *	@param	work				The function to execute
+ *	@param	dependencies		Pointer to handles of jobs which have to finish before this one starts; can be nullptr.
+ *	@param	dependency_count	The number of handles pointed to by `dependencies`
+ *	@return	A handle to the submitted job
+ */
+JobHandle jobSubmit(std::function<void()> work, const JobHandle* dependencies = nullptr, uint32_t dependency_count = 0);
+
+/*!
+ *	Blocks until the given job has finished. While waiting, the calling thread executes other jobs.
+ */
+void jobWait(const JobHandle& job);
+
+/*!
+ *	Returns true if the given job has finished.
+ */
+bool jobIsFinished(const JobHandle& job);
+
+/*!
+ *	Splits the range [0, count) into chunks of (at most) grain_size elements, executes body(begin, end)
+ *	for every chunk in parallel, and returns once all chunks have been processed.
+ *	@param	count		The number of elements
+ *	@param	grain_size	The number of elements per job; should be large enough to amortize scheduling costs.
+ *	@param	body		Function that processes the elements in [begin, end)
+ */
+void jobParallelFor(uint32_t count, uint32_t grain_size, const std::function<void(uint32_t begin, uint32_t end)>& body);
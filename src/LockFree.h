@@ -0,0 +1,90 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* --------------------------------------------- */
+// Lock-free containers for handing data from one
+// thread to another.
+/* --------------------------------------------- */
+
+/*!
+ * Bounded single-producer/single-consumer queue. Exactly one thread may push() and exactly one
+ * (other) thread may pop(). Neither operation blocks; push() fails if the queue is full.
+ * @tparam	T			Element type; should be cheap to copy.
+ * @tparam	Capacity	Maximum number of elements; must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	//! Appends an element. Returns false (and drops the element) if the queue is full.
+	bool push(const T& element) {
+		const size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+		mElements[tail & (Capacity - 1)] = element;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//! Removes the oldest element and writes it to `element`. Returns false if the queue is empty.
+	bool pop(T& element) {
+		const size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		element = mElements[head & (Capacity - 1)];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Head and tail on separate cache lines, so that producer and consumer don't invalidate each other's line:
+	alignas(64) std::atomic<size_t> mHead{ 0 };
+	alignas(64) std::atomic<size_t> mTail{ 0 };
+	alignas(64) T mElements[Capacity];
+};
+
+/*!
+ * Triple buffer which hands the most recent version of a value from one writer thread to one reader thread.
+ * The writer never waits for the reader and vice versa; the reader always gets the newest complete value,
+ * intermediate values may be skipped.
+ * @tparam	T	The type of the value
+ */
+template <typename T>
+class TripleBuffer {
+public:
+	//! The writer's slot; fill it, then invoke publish().
+	T& back() {
+		return mSlots[mBackIndex];
+	}
+
+	//! Makes the back slot available to the reader and switches the writer to another slot.
+	void publish() {
+		mBackIndex = mShared.exchange(static_cast<uint8_t>(mBackIndex | kDirtyBit), std::memory_order_acq_rel) & kIndexMask;
+	}
+
+	//! Switches the reader to the newest published value (if there is a new one) and returns it.
+	const T& acquire() {
+		if (0 != (mShared.load(std::memory_order_relaxed) & kDirtyBit)) {
+			mFrontIndex = mShared.exchange(mFrontIndex, std::memory_order_acq_rel) & kIndexMask;
+		}
+		return mSlots[mFrontIndex];
+	}
+
+private:
+	static constexpr uint8_t kIndexMask = 0x3;
+	static constexpr uint8_t kDirtyBit  = 0x4;
+
+	T mSlots[3] = {};
+	// Slot indices: the reader owns mFrontIndex, the writer owns mBackIndex, mShared holds the third one.
+	alignas(64) uint8_t mFrontIndex = 0;
+	alignas(64) uint8_t mBackIndex = 1;
+	alignas(64) std::atomic<uint8_t> mShared{ 2 };
+};
@@ -9,11 +9,32 @@
 // Include some local helper functions:
 #include "VulkanHelpers.h"
 #include "Teapot.h"
+#include "JobSystem.h"
+#include "Simulation.h"
+#include "MemoryRegistry.h"
+#include "Ibl.h"
+#include "OcclusionCulling.h"
+#include "Capture.h"
+#include "Swapchain.h"
+#include "ObjectCache.h"
+#include "MeshLod.h"
+#include "DrawQueue.h"
+#include "ShaderManager.h"
+#include "UniformRing.h"
+#include "DescriptorAllocator.h"
+#include "TransferStream.h"
+#include "Residency.h"
+#include "AssetPack.h"
+#include "GeometryCodec.h"
 
 // Include functionality from the standard library:
 #include <vector>
-#include <unordered_map>
+#include <array>
 #include <limits>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <cstring>
 
 /* ------------------------------------------------ */
 // Some more little helpers directly declared here:
@@ -31,6 +52,12 @@ void errorCallbackFromGlfw(int error, const char* description);
  */
 void handleGlfwKeyCallback(GLFWwindow* glfw_window, int key, int scancode, int action, int mods);
 
+/*!
+ *	Function that is invoked by GLFW whenever the window's framebuffer has been resized.
+ *	Requests the swapchain to be recreated at the start of the next frame.
+ */
+void handleGlfwFramebufferSizeCallback(GLFWwindow* glfw_window, int width, int height);
+
 /*!
  *	Function that can be used to query whether or not currently, i.e. NOW, a certain button 
  *  is pressed down, or not. 
@@ -60,6 +87,74 @@ std::vector<const char*> getRequiredInstanceExtensions();
  */
 uint32_t selectQueueFamilyIndex(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
 
+/*!
+ *	Gathers the swapchain config as required by the framework: one framebuffer per swapchain image, each with
+ *	the swapchain image as color attachment and its depth buffer (see occCreateDepthBuffers) as depth attachment.
+ *	@param	swapchain				The swapchain which the images belong to
+ *	@param	swapchain_create_info	The create info which the swapchain has been created with
+ *	@param	swap_chain_images		The swapchain's images
+ *	@return	The config, to be passed to vklInitFramework
+ */
+VklSwapchainConfig createSwapchainConfig(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& swapchain_create_info, const std::vector<VkImage>& swap_chain_images);
+
+/*!
+ *	CPU-side data of all assets that are used by the scene.
+ */
+struct SceneAssets {
+	VklGeometryData vespa;
+	VklGeometryData sphere;
+	VklGeometryData cube;
+	//! The DDS files of the cubemap's faces in the order +x, -x, +y, -y, +z, -z
+	std::vector<uint8_t> cubemapFaces[6];
+};
+
+/*!
+ *	Loads all meshes and cubemap faces of the scene concurrently, using the job system. They are taken from the
+ *	archive "assets.pack" if it exists (see VulkanLaunchpadCooker), or from the files below "assets/" otherwise.
+ *	Requires jobInitSystem to have been invoked before.
+ *	@return		The loaded assets' CPU-side data
+ */
+SceneAssets loadSceneAssets();
+
+/*!
+ *	GPU-side data of a mesh of the scene, its levels of detail, and its object space bounding box for culling.
+ */
+struct SceneMesh {
+	//! The index buffer contains the indices of all levels of detail
+	HlpGeometryHandles geometry;
+	//! Only the sphere and the vespa are simplified; the other meshes have a single level.
+	LodChain lods;
+	glm::vec3 aabbMin;
+	glm::vec3 aabbMax;
+};
+
+/*!
+ *	An instance of a mesh of the scene, which is culled every frame before it is drawn.
+ */
+struct SceneInstance {
+	//! Index into the scene's meshes (see createSceneMeshes); recorded as CapDraw::meshId
+	uint32_t meshIndex;
+	glm::mat4 modelMatrix;
+};
+
+/*!
+ *	Creates the buffers of the teapot (see teapotCreateGeometryAndBuffers) and of the loaded meshes, after generating
+ *	levels of detail for the sphere and the vespa concurrently. Requires jobInitSystem to have been invoked before.
+ *	@return		The meshes in the order teapot, sphere, vespa, cube
+ */
+std::vector<SceneMesh> createSceneMeshes(const SceneAssets& assets);
+
+/*!
+ *	Destroys the buffers which have been created by createSceneMeshes.
+ */
+void destroySceneMeshes(const std::vector<SceneMesh>& meshes);
+
+/*!
+ *	Places a grid of teapots behind a wall, which hides most of them from the initial camera position,
+ *	and the sphere and the vespa to its sides.
+ */
+std::vector<SceneInstance> createSceneInstances();
+
 /* ------------------------------------------------ */
 // Main
 /* ------------------------------------------------ */
@@ -92,7 +187,7 @@ int main(int argc, char** argv)
 
 	// Set some window settings before creating the window:
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // No need to create a graphics context for Vulkan
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE); // The swapchain is recreated whenever the window is resized
 
 	// TODO: Get a valid window handle and assign to window:
 	GLFWwindow* window = nullptr;
@@ -107,6 +202,8 @@ int main(int argc, char** argv)
 
 	// Set up a key callback via GLFW here to handle keyboard user input:
 	glfwSetKeyCallback(window, handleGlfwKeyCallback);
+	// ...and a callback which is invoked when the window is resized:
+	glfwSetFramebufferSizeCallback(window, handleGlfwFramebufferSizeCallback);
 
 	/* --------------------------------------------- */
 	// Task 1.2: Create a Vulkan Instance
@@ -199,6 +296,9 @@ int main(int argc, char** argv)
 	/* --------------------------------------------- */
 	VkDevice vk_device = VK_NULL_HANDLE;
 	VkQueue  vk_queue  = VK_NULL_HANDLE;
+	// Optional queue for the transfer stream (see --stream-test and --residency-test), preferably of a dedicated transfer queue family:
+	VkQueue  vk_transfer_queue = VK_NULL_HANDLE;
+	const uint32_t transfer_queue_family_index = streamFindTransferQueueFamily(vk_physical_device, selected_queue_family_index);
 	
 	constexpr float queue_priority = 1.0f;
 
@@ -207,11 +307,24 @@ int main(int argc, char** argv)
 	queue_create_info.queueFamilyIndex = selected_queue_family_index;
 	queue_create_info.queueCount = 1;
 	queue_create_info.pQueuePriorities = &queue_priority;
+
+	// Overdraw is measured with pipeline statistics queries if the device supports them (see occInitCulling):
+	VkPhysicalDeviceFeatures enabled_device_features = {};
+	enabled_device_features.pipelineStatisticsQuery = occIsPipelineStatisticsSupported(vk_physical_device) ? VK_TRUE : VK_FALSE;
+	// Heap budgets and usage are reported by the driver if the device supports VK_EXT_memory_budget (see memInit):
+	const bool memory_budget_enabled = memIsBudgetExtensionSupported(vk_physical_device);
+	// The transfer stream tracks the completion of uploads with a timeline semaphore:
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features = streamGetDeviceFeatures();
 	
 	// TODO: Create an instance of VkDeviceCreateInfo and use it to create one queue!
 	//        - Hook in queue_create_info at the right place!
 	//        - Use VkDeviceCreateInfo::enabledExtensionCount and VkDeviceCreateInfo::ppEnabledExtensionNames
 	//         to enable the VK_KHR_SWAPCHAIN_EXTENSION_NAME device extension!
+	//        - If memory_budget_enabled is true, also enable the VK_EXT_MEMORY_BUDGET_EXTENSION_NAME device extension!
+	//        - Hook in enabled_device_features as VkDeviceCreateInfo::pEnabledFeatures!
+	//        - Optionally, for the transfer stream, also create a queue of transfer_queue_family_index (a second one if it is
+	//         the same family as selected_queue_family_index), enable the VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME device
+	//         extension, and hook in timeline_semaphore_features as VkDeviceCreateInfo::pNext!
 	//        - The other parameters are not required (ensure that they are zero-initialized).
 	//       Finally, use vkCreateDevice to create the device and assign its handle to vk_device!
 	result = VK_ERROR_INITIALIZATION_FAILED;
@@ -223,6 +336,7 @@ int main(int argc, char** argv)
 	
 	// TODO: After device creation, use vkGetDeviceQueue to get the one and only created queue!
 	//       Assign its handle to vk_queue!
+	//       If a queue has been created for the transfer stream, assign its handle to vk_transfer_queue!
 	
 	if (!vk_queue) {
 		VKL_EXIT_WITH_ERROR("No VkQueue selected or handle not assigned.");
@@ -277,47 +391,348 @@ int main(int argc, char** argv)
 	/* --------------------------------------------- */
 	// Task 1.8: Initialize Vulkan Launchpad
 	/* --------------------------------------------- */
+	// Track device memory allocations, against the driver's budgets if VK_EXT_MEMORY_BUDGET_EXTENSION_NAME has been enabled:
+	memInit(vk_physical_device, vk_device, memory_budget_enabled);
 
-	// Gather swapchain config as required by the framework:
-	VklSwapchainConfig swapchain_config = {};
-	swapchain_config.imageExtent = swapchain_create_info.imageExtent;
-	swapchain_config.swapchainHandle = vk_swapchain;
-	for (VkImage vk_image : swap_chain_images) {
-		VklSwapchainFramebufferComposition framebufferData;
-		// TODO: Fill the data for the color attachment:
-		//  - VklSwapchainImageDetails::imageHandle
-		//  - VklSwapchainImageDetails::imageFormat
-		//  - VklSwapchainImageDetails::imageUsage
-		//  - VklSwapchainImageDetails::clearValue
-		framebufferData.colorAttachmentImageDetails.imageHandle = VK_NULL_HANDLE;
-		
-		// We don't need the depth attachment now, but keep it in mind for later!
-		framebufferData.depthAttachmentImageDetails.imageHandle = VK_NULL_HANDLE;
-		
-		// Add it to the vector:
-		swapchain_config.swapchainImages.push_back(framebufferData);
-	}
+	// Create one depth buffer per swap chain image; they are also read for hierarchical-Z occlusion culling:
+	const VkFormat depth_format = occSelectDepthFormat(vk_physical_device);
+	occCreateDepthBuffers(vk_device, swapchain_create_info.imageExtent, depth_format, static_cast<uint32_t>(swap_chain_images.size()));
+
+	// Gather swapchain config as required by the framework (see createSwapchainConfig):
+	VklSwapchainConfig swapchain_config = createSwapchainConfig(vk_swapchain, swapchain_create_info, swap_chain_images);
 	
 	// Init the framework:
 	if (!vklInitFramework(vk_instance, vk_surface, vk_physical_device, vk_device, vk_queue, swapchain_config)) {
 		VKL_EXIT_WITH_ERROR("Failed to init Vulkan Launchpad");
 	}
+	// Compile shaders into an on-disk SPIR-V cache and rebuild registered pipelines when their shader files change:
+	shaderInitManager(vklGetNumFramebuffers(), "shader_cache");
+	// Depth pre-pass and hierarchical-Z occlusion culling, which measures overdraw if pipeline statistics have been enabled:
+	occInitCulling(vk_queue, selected_queue_family_index, swapchain_create_info.imageFormat, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE,
+		VK_TRUE == enabled_device_features.pipelineStatisticsQuery);
+	// The scene's pipeline draws the same geometry as the depth pre-pass and only shades the surfaces which it has left in the depth buffer.
+	// Every instance's model matrix is written into a uniform ring, and one descriptor set with a dynamic offset serves all draws:
+	VkDescriptorSetLayoutBinding ring_binding = {};
+	ring_binding.binding = 0;
+	ring_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	ring_binding.descriptorCount = 1;
+	ring_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	VkDescriptorSetLayoutCreateInfo ring_set_layout_create_info = {};
+	ring_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	ring_set_layout_create_info.bindingCount = 1;
+	ring_set_layout_create_info.pBindings = &ring_binding;
+	VkDescriptorSetLayout ring_set_layout = VK_NULL_HANDLE;
+	result = vkCreateDescriptorSetLayout(vk_device, &ring_set_layout_create_info, nullptr, &ring_set_layout);
+	VKL_CHECK_VULKAN_RESULT(result);
+	RingBuffer instance_ring = ringCreate(vk_physical_device, 64 * 1024);
+	// Per-frame descriptor sets are allocated from pools per swapchain image, which descBeginFrame resets once that image's
+	// previous frame has completed, i.e., without freeing sets one by one:
+	const std::vector<DescPoolSizeRatio> frame_descriptor_ratios = { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f } };
+	DescAllocator frame_descriptor_allocator = descCreateAllocator(frame_descriptor_ratios, 16, vklGetNumFramebuffers());
+
+	VkPushConstantRange scene_push_constant_range = {};
+	scene_push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	scene_push_constant_range.size = sizeof(glm::mat4);
+	VkPipelineLayoutCreateInfo scene_pipeline_layout_create_info = {};
+	scene_pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	scene_pipeline_layout_create_info.setLayoutCount = 1;
+	scene_pipeline_layout_create_info.pSetLayouts = &ring_set_layout;
+	scene_pipeline_layout_create_info.pushConstantRangeCount = 1;
+	scene_pipeline_layout_create_info.pPushConstantRanges = &scene_push_constant_range;
+	VkPipelineLayout scene_pipeline_layout = VK_NULL_HANDLE;
+	result = vkCreatePipelineLayout(vk_device, &scene_pipeline_layout_create_info, nullptr, &scene_pipeline_layout);
+	VKL_CHECK_VULKAN_RESULT(result);
+	const uint32_t scene_pipeline_id = occRegisterMainPassPipeline("assets/shaders/scene.vert", "assets/shaders/scene.frag", scene_pipeline_layout);
 	VKL_LOG("Task 1.8 done.");
 
+	/* --------------------------------------------- */
+	// Load Assets
+	/* --------------------------------------------- */
+	// Start the job system; the main thread becomes one of its workers:
+	jobInitSystem();
+	SceneAssets scene_assets = loadSceneAssets();
+
+	// Pass --precompute-ibl <cache directory> to precompute image-based lighting from the cubemap into the cache, e.g., to measure
+	// it (see iblLogStats). Nothing is rendered with it yet, hence it does not run by default and its failure is not fatal.
+	// The specular cubemap is prefiltered on the CPU unless iblInitComputePath has been invoked before:
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (0 != strcmp(argv[i], "--precompute-ibl")) {
+			continue;
+		}
+		IblSettings ibl_settings = {};
+		ibl_settings.sourceSize = 64;
+		ibl_settings.specularSize = 64;
+		ibl_settings.specularMipLevelCount = 7;
+		ibl_settings.brdfLutSize = 64;
+		ibl_settings.brdfSampleCount = 256;
+		ibl_settings.srgbSource = true;
+		IblResults ibl_results;
+		IblStats ibl_stats;
+		if (iblPrecomputeCached(scene_assets.cubemapFaces, ibl_settings, argv[i + 1], ibl_results, &ibl_stats)) {
+			iblLogStats(ibl_stats);
+		}
+		else {
+			VKL_LOG("Warning: Failed to precompute image-based lighting from the cubemap into \"" << argv[i + 1] << "\".");
+		}
+	}
+
+	// Pass --stream-test to upload the vespa over and over through the transfer stream, and to log the upload bandwidth and
+	// the frame times while streaming compared to while idle (see streamLogStats). The streamed copies are not drawn.
+	// Pass --residency-test to split the vespa into cells which are only resident while the camera is close to them, within
+	// a budget of half of its geometry, and to log budget usage, evictions, and pop-in latencies (see residencyLogStats).
+	// Fly towards the vespa to load its cells; they are not drawn either. Both modes upload through the transfer stream:
+	bool stream_test = false, residency_test = false;
+	for (int i = 1; i < argc; ++i) {
+		stream_test = stream_test || 0 == strcmp(argv[i], "--stream-test");
+		residency_test = residency_test || 0 == strcmp(argv[i], "--residency-test");
+	}
+	const bool stream_initialized = stream_test || residency_test;
+	StreamGeometryBuffers streamed_vespa = {};
+	bool streamed_vespa_ready = false;
+	uint64_t streamed_vespa_ready_frame = 0;
+	if (stream_initialized) {
+		if (VK_NULL_HANDLE == vk_transfer_queue) {
+			VKL_EXIT_WITH_ERROR("No transfer queue for --stream-test or --residency-test. Create one during device creation and assign it to vk_transfer_queue!");
+		}
+		streamInit(vk_transfer_queue, transfer_queue_family_index, selected_queue_family_index);
+	}
+	if (stream_test) {
+		streamed_vespa = streamCreateGeometryAndBuffers(scene_assets.vespa);
+	}
+	if (residency_test) {
+		const VklGeometryData& vespa = scene_assets.vespa;
+		glm::vec3 bounds_min(std::numeric_limits<float>::max()), bounds_max(-std::numeric_limits<float>::max());
+		for (const glm::vec3& position : vespa.positions) {
+			bounds_min = glm::min(bounds_min, position);
+			bounds_max = glm::max(bounds_max, position);
+		}
+		const glm::vec3 bounds_size = bounds_max - bounds_min;
+		const float vespa_size = std::max(bounds_size.x, std::max(bounds_size.y, bounds_size.z));
+		const VkDeviceSize vespa_bytes = vespa.positions.size() * sizeof(glm::vec3) + vespa.normals.size() * sizeof(glm::vec3)
+			+ vespa.textureCoordinates.size() * sizeof(glm::vec2) + vespa.indices.size() * sizeof(uint32_t);
+
+		ResidencyConfig residency_config = {};
+		residency_config.loadDistance = vespa_size;
+		residency_config.hysteresis = 0.2f;
+		residency_config.memoryBudget = vespa_bytes / 2;
+		residency_config.maxConcurrentLoads = 4;
+		residency_config.framesInFlight = vklGetNumFramebuffers();
+		residencyInit(residency_config, residencySplitIntoCells(vespa, 0.25f * vespa_size));
+	}
+
+	// Pass --record <file> to record every frame's camera, draws, and input for replaying them later (see capReplay):
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (0 == strcmp(argv[i], "--record") && !capBeginRecording(argv[i + 1])) {
+			VKL_EXIT_WITH_ERROR("Failed to open \"" << argv[i + 1] << "\" for recording.");
+		}
+	}
+
+	// Upload the scene's meshes; every instance is culled against the view frustum and the depth pyramid before it is drawn:
+	const std::vector<SceneMesh> scene_meshes = createSceneMeshes(scene_assets);
+	const std::vector<SceneInstance> scene_instances = createSceneInstances();
+	std::vector<OccInstance> occ_instances(scene_instances.size());
+	std::vector<uint8_t> instance_visible(scene_instances.size());
+	std::vector<OccPrepassDraw> prepass_draws;
+	std::vector<CapDraw> captured_draws;
+	DrawQueue draw_queue;
+	uint64_t frame_count = 0;
+	// The residency test's cells are in the vespa's object space (see --residency-test):
+	glm::mat4 vespa_object_from_world(1.0f);
+	for (const SceneInstance& instance : scene_instances) {
+		if (2u == instance.meshIndex) {
+			vespa_object_from_world = glm::inverse(instance.modelMatrix);
+		}
+	}
+
 	/* --------------------------------------------- */
 	// Task 1.9:  Implement the Render Loop
 	/* --------------------------------------------- */
+	// The world is advanced by its own thread at a fixed rate, independent of the frame rate:
+	simStart();
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents(); // Handle user input
-		
+
+		// Recreate the swapchain if the window has been resized, or if acquiring or presenting has reported that it
+		// is out of date (see swapCheckResult). Only size-dependent resources are rebuilt, but the framework owns the
+		// framebuffers and can only rebuild them by being initialized again, which destroys its command buffers and
+		// synchronization objects. Frames in flight may still use those, so the queue has to become idle first, which is
+		// the bulk of the hitch; avoiding it requires the framework to rebuild only its framebuffers:
+		if (swapIsRecreationRequired()) {
+			int framebuffer_width = 0, framebuffer_height = 0;
+			glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+			const VkExtent2D framebuffer_extent = { static_cast<uint32_t>(framebuffer_width), static_cast<uint32_t>(framebuffer_height) };
+			result = vkQueueWaitIdle(vk_queue);
+			VKL_CHECK_VULKAN_RESULT(result);
+			std::vector<VkImage> new_swap_chain_images;
+			const VkSwapchainKHR new_swapchain = swapRecreateSwapchain(vk_physical_device, vk_device, swapchain_create_info, vk_swapchain, framebuffer_extent, new_swap_chain_images);
+			if (VK_NULL_HANDLE == new_swapchain) {
+				glfwWaitEvents(); // The window is minimized; wait until it is restored
+				continue;
+			}
+
+			// Nothing uses the old swapchain, its framebuffers, or the old depth buffers anymore after the wait above:
+			vklDestroyFramework();
+			vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
+			vk_swapchain = new_swapchain;
+			swap_chain_images = std::move(new_swap_chain_images);
+			occRecreateDepthBuffers(vk_device, swapchain_create_info.imageExtent, static_cast<uint32_t>(swap_chain_images.size()));
+			swapchain_config = createSwapchainConfig(vk_swapchain, swapchain_create_info, swap_chain_images);
+			if (!vklInitFramework(vk_instance, vk_surface, vk_physical_device, vk_device, vk_queue, swapchain_config)) {
+				VKL_EXIT_WITH_ERROR("Failed to init Vulkan Launchpad after recreating the swapchain");
+			}
+			// The new swapchain may have a different number of images, and thus of frame slots:
+			descDestroyAllocator(frame_descriptor_allocator);
+			frame_descriptor_allocator = descCreateAllocator(frame_descriptor_ratios, 16, vklGetNumFramebuffers());
+			swapEndRecreation();
+		}
+		// Swap in pipelines which have been rebuilt after shader changes:
+		shaderBeginFrame();
+		// Allocations during the frame are checked against the budget queried here, instead of querying it for every allocation:
+		memUpdateBudget();
+
+		// Get the newest state of the world that the simulation thread has published:
+		const SimWorldState& world_state = simAcquireLatestState();
+
+		vklWaitForNextSwapchainImage();
+		const uint32_t swapchain_image_index = vklGetCurrentSwapChainImageIndex();
+		// The ring's memory from the last frame which used this image is free again:
+		ringBeginFrame(instance_ring, swapchain_image_index);
+		descBeginFrame(frame_descriptor_allocator, swapchain_image_index);
+		const VkDescriptorSet ring_set = descAllocateSet(frame_descriptor_allocator, ring_set_layout);
+		ringWriteDescriptorSet(instance_ring, ring_set, 0, sizeof(glm::mat4));
+
+		// The camera follows the simulated position:
+		CapCamera camera;
+		camera.viewMatrix = glm::translate(glm::mat4(1.0f), -world_state.cameraPosition);
+		// The aspect ratio follows the swapchain's current size, which has a height of zero only while the window is minimized:
+		const VkExtent2D image_extent = swapchain_create_info.imageExtent;
+		const float aspect_ratio = 0u == image_extent.height ? 1.0f : static_cast<float>(image_extent.width) / static_cast<float>(image_extent.height);
+		const float vertical_fov = glm::radians(60.0f);
+		camera.projectionMatrix = glm::perspectiveRH_ZO(vertical_fov, aspect_ratio, 0.1f, 100.0f);
+		camera.projectionMatrix[1][1] *= -1.0f;
+
+		// Cull against the newest depth pyramid, which stems from one of the previous frames:
+		const glm::mat4 clip_from_world = camera.projectionMatrix * camera.viewMatrix;
+		for (size_t i = 0; i < scene_instances.size(); ++i) {
+			const SceneMesh& mesh = scene_meshes[scene_instances[i].meshIndex];
+			occ_instances[i].clipFromObject = clip_from_world * scene_instances[i].modelMatrix;
+			occ_instances[i].aabbMin = mesh.aabbMin;
+			occ_instances[i].aabbMax = mesh.aabbMax;
+		}
+		OccDepthPyramid depth_pyramid;
+		const bool depth_pyramid_available = occGetLatestDepthPyramid(depth_pyramid);
+		const OccCullStats cull_stats = occCullInstances(depth_pyramid_available ? &depth_pyramid : nullptr,
+			occ_instances.data(), static_cast<uint32_t>(occ_instances.size()), instance_visible.data());
+
+		// Only visible instances are drawn, front to back, with the same clipFromObject matrices and levels of detail in the pre-pass and
+		// the main pass. The level is selected by the instance's view depth, such that its error stays below one pixel (the instances are not scaled):
+		const VkPipeline scene_pipeline = shaderGetPipeline(scene_pipeline_id);
+		prepass_draws.clear();
+		captured_draws.clear();
+		for (size_t i = 0; i < scene_instances.size(); ++i) {
+			if (!instance_visible[i]) {
+				continue;
+			}
+			const SceneInstance& instance = scene_instances[i];
+			const SceneMesh& mesh = scene_meshes[instance.meshIndex];
+			const float view_depth = -(camera.viewMatrix * instance.modelMatrix[3]).z;
+			const LodLevel& level = mesh.lods.levels[lodSelectLevel(mesh.lods, std::max(view_depth, 0.1f), vertical_fov, static_cast<float>(image_extent.height))];
+			prepass_draws.push_back({ &mesh.geometry, level.firstIndex, level.indexCount, occ_instances[i].clipFromObject });
+			const RingAllocation instance_data = ringAllocate(instance_ring, sizeof(glm::mat4));
+			memcpy(instance_data.data, &instance.modelMatrix, sizeof(glm::mat4));
+			drawQueuePush(draw_queue, { drawMakeSortKey(0u, 0u, instance.meshIndex, view_depth, 100.0f), scene_pipeline, ring_set, &mesh.geometry, level.firstIndex, level.indexCount,
+				scene_pipeline_layout, instance_data.offset, &occ_instances[i].clipFromObject, static_cast<uint32_t>(sizeof(glm::mat4)) });
+			captured_draws.push_back({ instance.meshIndex, 0u, instance.modelMatrix });
+		}
+		drawQueueSort(draw_queue);
+
+		vklStartRecordingCommands();
+		if (stream_initialized) {
+			// Acquires the completed uploads on the graphics queue:
+			streamBeginFrame(vklGetCurrentCommandBuffer());
+		}
+		if (stream_test) {
+			// A copy is replaced once no frame in flight can use it anymore, i.e., frames in flight after the frame which has acquired it:
+			if (!streamed_vespa_ready && streamIsReady(streamed_vespa.ticket)) {
+				streamed_vespa_ready = true;
+				streamed_vespa_ready_frame = frame_count;
+			}
+			if (streamed_vespa_ready && frame_count - streamed_vespa_ready_frame > vklGetNumFramebuffers()) {
+				streamDestroyBuffers(streamed_vespa);
+				streamed_vespa = streamCreateGeometryAndBuffers(scene_assets.vespa);
+				streamed_vespa_ready = false;
+			}
+		}
+		if (residency_test) {
+			residencyUpdate(glm::vec3(vespa_object_from_world * glm::vec4(world_state.cameraPosition, 1.0f)));
+		}
+		occRecordDepthPrepass(prepass_draws.data(), static_cast<uint32_t>(prepass_draws.size()));
+		occBeginOverdrawQuery();
+		const DrawQueueStats draw_stats = drawQueueRecord(draw_queue);
+		occEndOverdrawQuery();
+		vklEndRecordingCommands();
+		vklPresentCurrentSwapchainImage();
+		ringEndFrame(instance_ring, vk_queue);
+
+		// The frame's commands have been submitted; build the pyramid from its depth buffer for culling in one of the next frames:
+		occBuildDepthPyramid(swapchain_image_index);
+		if (0 == ++frame_count % 600) {
+			occLogStats(cull_stats);
+			drawLogQueueStats(draw_stats);
+			ringLogStats(instance_ring);
+			descLogAllocatorStats(frame_descriptor_allocator);
+			if (stream_test) {
+				streamLogStats();
+			}
+			if (residency_test) {
+				residencyLogStats();
+			}
+		}
+		capRecordDraws(captured_draws.data(), static_cast<uint32_t>(captured_draws.size()));
+
+		// After presenting a frame that shows world_state, record how long its input took to get on screen:
+		simRecordPresent(world_state);
+		capEndFrame(camera);
+	}
+	simStop();
+	if (capIsRecording()) {
+		capEndRecording();
 	}
 
 	// Wait for all GPU work to finish before cleaning up:
 	vkDeviceWaitIdle(vk_device);
+	jobDestroySystem();
 
 	/* --------------------------------------------- */
 	// Task 1.10: Cleanup
 	/* --------------------------------------------- */
+	memLogHeapUsage();
+	swapLogStats();
+	if (stream_test) {
+		streamLogStats();
+		streamDestroyBuffers(streamed_vespa);
+	}
+	if (residency_test) {
+		residencyLogStats();
+		residencyDestroy();
+	}
+	if (stream_initialized) {
+		streamDestroy();
+	}
+	destroySceneMeshes(scene_meshes);
+	shaderLogStats();
+	// Destroys all registered pipelines, including the ones of occInitCulling:
+	shaderDestroyManager();
+	vkDestroyPipelineLayout(vk_device, scene_pipeline_layout, nullptr);
+	ringDestroy(instance_ring);
+	descDestroyAllocator(frame_descriptor_allocator);
+	vkDestroyDescriptorSetLayout(vk_device, ring_set_layout, nullptr);
+	occDestroyCulling();
+	occDestroyDepthBuffers(vk_device);
+	// Samplers and image views which have been looked up in the cache (e.g., through hlpCreateSampler), but not released:
+	cacheDestroyAll();
+	// Reports allocations which have not been released:
+	memDestroy();
 	vklDestroyFramework();
 
 	return EXIT_SUCCESS;
@@ -331,10 +746,16 @@ void errorCallbackFromGlfw(int error, const char* description) {
 	std::cout << "GLFW error " << error << ": " << description << std::endl;
 }
 
-std::unordered_map<int, bool> g_isGlfwKeyDown;
+// Indexed by GLFW key code; only accessed from the thread that polls GLFW events:
+std::array<bool, GLFW_KEY_LAST + 1> g_isGlfwKeyDown = {};
 
 void handleGlfwKeyCallback(GLFWwindow* glfw_window, int key, int scancode, int action, int mods) 
 {
+	// GLFW_KEY_UNKNOWN (-1) is reported for keys without a key code:
+	if (key < 0 || key > GLFW_KEY_LAST) {
+		return;
+	}
+
 	if (action == GLFW_PRESS) {
 		g_isGlfwKeyDown[key] = true;
 	}
@@ -343,15 +764,29 @@ void handleGlfwKeyCallback(GLFWwindow* glfw_window, int key, int scancode, int a
 		g_isGlfwKeyDown[key] = false;
 	}
 
+	// Forward the event to the simulation thread, and to the recording if there is one:
+	simPushInputEvent(key, action);
+	capRecordInputEvent(key, action);
+
+	// Log the memory heaps' usage vs. their budgets, including every allocation, if M is pressed:
+	if (action == GLFW_RELEASE && key == GLFW_KEY_M) {
+		memLogHeapUsage(true);
+	}
+
 	// We mark the window that it should close if ESC is pressed:
 	if (action == GLFW_RELEASE && key == GLFW_KEY_ESCAPE) { 
 		glfwSetWindowShouldClose(glfw_window, true); 
 	}
 }
 
+void handleGlfwFramebufferSizeCallback(GLFWwindow* glfw_window, int width, int height)
+{
+	swapRequestRecreation();
+}
+
 bool isKeyDown(int glfw_key_code)
 {
-	return g_isGlfwKeyDown[glfw_key_code];
+	return glfw_key_code >= 0 && glfw_key_code <= GLFW_KEY_LAST && g_isGlfwKeyDown[glfw_key_code];
 }
 
 std::vector<const char*> getRequiredInstanceExtensions()
@@ -393,3 +828,188 @@ uint32_t selectQueueFamilyIndex(VkPhysicalDevice physical_device, VkSurfaceKHR s
 	
 	VKL_EXIT_WITH_ERROR("Unable to find a suitable queue family that supports graphics and presentation on the same queue.");
 }
+
+VklSwapchainConfig createSwapchainConfig(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& swapchain_create_info, const std::vector<VkImage>& swap_chain_images)
+{
+	VklSwapchainConfig swapchain_config = {};
+	swapchain_config.imageExtent = swapchain_create_info.imageExtent;
+	swapchain_config.swapchainHandle = swapchain;
+	for (uint32_t image_index = 0; image_index < static_cast<uint32_t>(swap_chain_images.size()); ++image_index) {
+		VkImage vk_image = swap_chain_images[image_index];
+		VklSwapchainFramebufferComposition framebufferData;
+		// TODO: Fill the data for the color attachment:
+		//  - VklSwapchainImageDetails::imageHandle
+		//  - VklSwapchainImageDetails::imageFormat
+		//  - VklSwapchainImageDetails::imageUsage
+		//  - VklSwapchainImageDetails::clearValue
+		framebufferData.colorAttachmentImageDetails.imageHandle = VK_NULL_HANDLE;
+
+		// Depth buffers are cleared to 1 at the start of every frame:
+		framebufferData.depthAttachmentImageDetails = occGetDepthAttachmentDetails(image_index);
+
+		// Add it to the vector:
+		swapchain_config.swapchainImages.push_back(framebufferData);
+	}
+	return swapchain_config;
+}
+
+SceneAssets loadSceneAssets()
+{
+	const auto start = std::chrono::steady_clock::now();
+	SceneAssets assets;
+
+	// Names of the assets relative to the assets directory, which are also their names inside the archive:
+	const char* mesh_names[3] = { "vespa/vespa.obj", "sphere/sphere.obj", "cube/cube.obj" };
+	VklGeometryData* meshes[3] = { &assets.vespa, &assets.sphere, &assets.cube };
+	const char* face_names[6] = {
+		"cubemap/posx.dds", "cubemap/negx.dds",
+		"cubemap/posy.dds", "cubemap/negy.dds",
+		"cubemap/posz.dds", "cubemap/negz.dds"
+	};
+
+	// The archive is mapped at once; its entries are looked up in constant time and read straight from the mapping:
+	PackArchive archive = {};
+	const bool from_archive = packOpenArchive("assets.pack", archive);
+	const auto find_entry = [&archive](const char* name, PackEntryType type) {
+		const PackSpan span = packFind(archive, name);
+		if (nullptr == span.data || type != span.type) {
+			VKL_EXIT_WITH_ERROR("No entry \"" << name << "\" of type " << type << " in \"assets.pack\". Ensure to cook it with VulkanLaunchpadCooker!");
+		}
+		return span;
+	};
+
+	// Every asset is loaded by its own job, so that they are loaded concurrently:
+	std::vector<JobHandle> jobs;
+	for (int mesh = 0; mesh < 3; ++mesh) {
+		jobs.push_back(jobSubmit([&, mesh] {
+			const std::string path = std::string("assets/") + mesh_names[mesh];
+			if (!from_archive) {
+				*meshes[mesh] = vklLoadModelGeometry(path);
+				return;
+			}
+			const PackSpan span = find_entry(mesh_names[mesh], PACK_ENTRY_GEOMETRY);
+			CodecGeometryInfo info = {};
+			if (!codecGetGeometryInfo(span.data, span.size, info)) {
+				VKL_EXIT_WITH_ERROR("Invalid geometry \"" << mesh_names[mesh] << "\" in \"assets.pack\".");
+			}
+			VklGeometryData& geometry = *meshes[mesh];
+			geometry.positions.resize(info.vertexCount);
+			geometry.normals.resize(info.hasNormals ? info.vertexCount : 0);
+			geometry.textureCoordinates.resize(info.hasTextureCoordinates ? info.vertexCount : 0);
+			geometry.indices.resize(info.indexCount);
+			if (!codecDecodeGeometry(span.data, span.size, geometry.positions.data(),
+				info.hasNormals ? geometry.normals.data() : nullptr,
+				info.hasTextureCoordinates ? geometry.textureCoordinates.data() : nullptr,
+				geometry.indices.data())) {
+				VKL_EXIT_WITH_ERROR("Invalid geometry \"" << mesh_names[mesh] << "\" in \"assets.pack\".");
+			}
+		}));
+	}
+	for (int face = 0; face < 6; ++face) {
+		jobs.push_back(jobSubmit([&, face] {
+			if (from_archive) {
+				const PackSpan span = find_entry(face_names[face], PACK_ENTRY_DDS);
+				assets.cubemapFaces[face].assign(span.data, span.data + span.size);
+				return;
+			}
+			const std::string path = std::string("assets/") + face_names[face];
+			std::ifstream stream(path, std::ios::binary);
+			if (!stream) {
+				VKL_EXIT_WITH_ERROR("Unable to open \"" << path << "\".");
+			}
+			assets.cubemapFaces[face].assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}));
+	}
+
+	for (const JobHandle& job : jobs) {
+		jobWait(job);
+	}
+	if (from_archive) {
+		packCloseArchive(archive);
+	}
+
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	VKL_LOG("Loaded " << jobs.size() << " assets from " << (from_archive ? "\"assets.pack\"" : "\"assets/\"") << " in "
+		<< milliseconds << " ms using " << jobGetWorkerCount() << " workers.");
+	return assets;
+}
+
+std::vector<SceneMesh> createSceneMeshes(const SceneAssets& assets)
+{
+	const auto compute_bounds = [](const std::vector<glm::vec3>& positions, SceneMesh& mesh) {
+		mesh.aabbMin = glm::vec3(std::numeric_limits<float>::max());
+		mesh.aabbMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (const glm::vec3& position : positions) {
+			mesh.aabbMin = glm::min(mesh.aabbMin, position);
+			mesh.aabbMax = glm::max(mesh.aabbMax, position);
+		}
+	};
+
+	std::vector<SceneMesh> meshes(4);
+
+	// The teapot's buffers are owned by Teapot.cpp:
+	std::vector<glm::vec3> teapot_positions;
+	std::vector<uint32_t> teapot_indices;
+	teapotGetGeometryData(teapot_positions, teapot_indices);
+	teapotCreateGeometryAndBuffers();
+	meshes[0].geometry.positionsBufferSize = sizeof(glm::vec3) * teapot_positions.size();
+	meshes[0].geometry.positionsBuffer = teapotGetPositionsBuffer();
+	meshes[0].geometry.indicesBufferSize = sizeof(uint32_t) * teapot_indices.size();
+	meshes[0].geometry.indicesBuffer = teapotGetIndicesBuffer();
+	meshes[0].geometry.numberOfIndices = teapotGetNumIndices();
+	meshes[0].geometry.indexType = VK_INDEX_TYPE_UINT32;
+	meshes[0].lods.levels.push_back({ 0u, teapotGetNumIndices(), 0.0f });
+	compute_bounds(teapot_positions, meshes[0]);
+
+	// The sphere and the vespa get levels of detail, each generated by its own job; the cube is uploaded as it is:
+	const VklGeometryData* geometries[3] = { &assets.sphere, &assets.vespa, &assets.cube };
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<JobHandle> jobs;
+	for (uint32_t i = 0; i < 2; ++i) {
+		jobs.push_back(jobSubmit([&meshes, &geometries, i] {
+			meshes[i + 1].lods = lodGenerateChain(geometries[i]->positions, geometries[i]->normals, geometries[i]->textureCoordinates, geometries[i]->indices);
+		}));
+	}
+	for (const JobHandle& job : jobs) {
+		jobWait(job);
+	}
+	meshes[3].lods.indices = assets.cube.indices;
+	meshes[3].lods.levels.push_back({ 0u, static_cast<uint32_t>(assets.cube.indices.size()), 0.0f });
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	VKL_LOG("Generated " << meshes[1].lods.levels.size() << " levels of detail for the sphere and " << meshes[2].lods.levels.size()
+		<< " for the vespa in " << milliseconds << " ms.");
+
+	for (uint32_t i = 0; i < 3; ++i) {
+		meshes[i + 1].geometry = lodCreateGeometryAndBuffers(meshes[i + 1].lods, geometries[i]->positions, geometries[i]->normals, geometries[i]->textureCoordinates);
+		compute_bounds(geometries[i]->positions, meshes[i + 1]);
+	}
+	return meshes;
+}
+
+void destroySceneMeshes(const std::vector<SceneMesh>& meshes)
+{
+	teapotDestroyBuffers();
+	for (size_t i = 1; i < meshes.size(); ++i) {
+		lodDestroyBuffers(meshes[i].geometry);
+	}
+}
+
+std::vector<SceneInstance> createSceneInstances()
+{
+	std::vector<SceneInstance> instances;
+
+	// A wall made of the cube, in front of the teapots:
+	instances.push_back({ 3u, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f)), glm::vec3(2.5f, 1.0f, 0.1f)) });
+
+	// 5x4 teapots behind the wall, of which only the outer ones can be seen from the initial camera position:
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 5; ++column) {
+			const glm::vec3 position(static_cast<float>(column - 2) * 1.5f, -0.5f, -5.0f - static_cast<float>(row) * 1.5f);
+			instances.push_back({ 0u, glm::translate(glm::mat4(1.0f), position) });
+		}
+	}
+
+	instances.push_back({ 1u, glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, 0.0f, -4.0f)) });
+	instances.push_back({ 2u, glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, -0.5f, -4.0f)) });
+	return instances;
+}
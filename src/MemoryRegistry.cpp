@@ -0,0 +1,371 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "MemoryRegistry.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	const char* const kCategoryNames[MEM_CATEGORY_COUNT] = { "geometry", "texture", "uniform", "staging", "render target", "other" };
+	const char* const kUnnamed = "<unnamed>";
+
+	//! Non-dispatchable handles of different types may have the same value => allocations are keyed by type and handle
+	struct AllocationKey {
+		VkObjectType type;
+		uint64_t handle;
+
+		bool operator==(const AllocationKey& o) const { return type == o.type && handle == o.handle; }
+	};
+
+	struct AllocationKeyHash {
+		size_t operator()(const AllocationKey& k) const {
+			return std::hash<uint64_t>{}(k.handle ^ (static_cast<uint64_t>(k.type) << 56));
+		}
+	};
+
+	struct Allocation {
+		std::string name;
+		MemCategory category;
+		VkDeviceSize size;
+		uint32_t heapIndex;
+		//! Whether the memory has been allocated by memAllocate (or only registered via memTrack*)
+		bool owned;
+	};
+
+	VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+	VkDevice mDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+	bool mBudgetExtensionEnabled = false;
+	float mWarningThreshold = 0.9f;
+
+	std::mutex mMutex;
+	//! Tracked allocations by their VkDeviceMemory, VkBuffer, or VkImage handle
+	std::unordered_map<AllocationKey, Allocation, AllocationKeyHash> mAllocations;
+	VkDeviceSize mTrackedBytesPerHeap[VK_MAX_MEMORY_HEAPS] = {};
+	//! Budget and usage from the last memUpdateBudget, and the tracked bytes at that time
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT mBudgetProperties = {};
+	VkDeviceSize mTrackedBytesPerHeapAtBudgetUpdate[VK_MAX_MEMORY_HEAPS] = {};
+	//! Whether a heap is currently above the warning threshold, so that the warning is only logged when it gets there
+	bool mHeapAboveThreshold[VK_MAX_MEMORY_HEAPS] = {};
+
+	double toMiB(VkDeviceSize bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+
+	double toKiB(VkDeviceSize bytes)
+	{
+		return static_cast<double>(bytes) / 1024.0;
+	}
+
+	// Non-dispatchable handles are 64 bit integers on 32 bit platforms, i.e., handle types cannot be told apart by overloads:
+	template <typename Handle>
+	AllocationKey keyOf(VkObjectType type, Handle handle)
+	{
+		return AllocationKey{ type, (uint64_t)handle };
+	}
+
+	const char* nameOrPlaceholder(const char* name)
+	{
+		return nullptr == name ? kUnnamed : name;
+	}
+
+	void ensureInitialized()
+	{
+		if (VK_NULL_HANDLE == mPhysicalDevice) {
+			VKL_EXIT_WITH_ERROR("Memory registry not initialized. Ensure to invoke memInit beforehand!");
+		}
+	}
+
+	// Returns the index of the first memory type which is allowed by `memory_type_bits` and has all of `memory_properties`,
+	// or VK_MAX_MEMORY_TYPES if there is none.
+	uint32_t findMemoryTypeIndex(uint32_t memory_type_bits, VkMemoryPropertyFlags memory_properties)
+	{
+		for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; ++i) {
+			if ((memory_type_bits & (1u << i)) && (mMemoryProperties.memoryTypes[i].propertyFlags & memory_properties) == memory_properties) {
+				return i;
+			}
+		}
+		return VK_MAX_MEMORY_TYPES;
+	}
+
+	uint32_t heapIndexOf(VkMemoryPropertyFlags memory_properties)
+	{
+		const uint32_t type_index = findMemoryTypeIndex(~0u, memory_properties);
+		return VK_MAX_MEMORY_TYPES == type_index ? 0u : mMemoryProperties.memoryTypes[type_index].heapIndex;
+	}
+
+	// Requires VK_EXT_memory_budget to be enabled. Does not require mMutex to be locked, and should not be invoked with it locked.
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT queryBudgetProperties()
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+		budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 memory_properties = {};
+		memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memory_properties.pNext = &budget_properties;
+		vkGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memory_properties);
+		return budget_properties;
+	}
+
+	// Requires mMutex to be locked. The budget is the one from the last memUpdateBudget, and the usage reported then is
+	// adjusted by the tracked allocations since, so that the driver does not need to be queried on every allocation.
+	void getBudgetAndUsage(uint32_t heap_index, VkDeviceSize& budget, VkDeviceSize& usage)
+	{
+		if (!mBudgetExtensionEnabled) {
+			budget = mMemoryProperties.memoryHeaps[heap_index].size;
+			usage = mTrackedBytesPerHeap[heap_index];
+			return;
+		}
+		budget = mBudgetProperties.heapBudget[heap_index];
+		usage = mBudgetProperties.heapUsage[heap_index];
+		const VkDeviceSize tracked = mTrackedBytesPerHeap[heap_index];
+		const VkDeviceSize tracked_at_update = mTrackedBytesPerHeapAtBudgetUpdate[heap_index];
+		usage = tracked >= tracked_at_update ? usage + (tracked - tracked_at_update) : usage - std::min(usage, tracked_at_update - tracked);
+	}
+
+	// Requires mMutex to be locked
+	std::vector<MemHeapUsage> queryHeapUsage()
+	{
+		std::vector<MemHeapUsage> heaps(mMemoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < mMemoryProperties.memoryHeapCount; ++i) {
+			heaps[i].flags = mMemoryProperties.memoryHeaps[i].flags;
+			heaps[i].size = mMemoryProperties.memoryHeaps[i].size;
+			heaps[i].trackedBytes = mTrackedBytesPerHeap[i];
+			getBudgetAndUsage(i, heaps[i].budget, heaps[i].usage);
+		}
+		for (const auto& entry : mAllocations) {
+			heaps[entry.second.heapIndex].trackedBytesPerCategory[entry.second.category] += entry.second.size;
+			++heaps[entry.second.heapIndex].trackedAllocations;
+		}
+		return heaps;
+	}
+
+	// Requires mMutex to be locked
+	void checkBudget(uint32_t heap_index, const char* allocation_name)
+	{
+		VkDeviceSize budget, usage;
+		getBudgetAndUsage(heap_index, budget, usage);
+
+		const bool above_threshold = static_cast<double>(usage) > mWarningThreshold * static_cast<double>(budget);
+		if (above_threshold && !mHeapAboveThreshold[heap_index]) {
+			VKL_LOG("WARNING: Memory heap " << heap_index << " is close to its budget after allocating \"" << allocation_name << "\": "
+				<< toMiB(usage) << " of " << toMiB(budget) << " MiB used.");
+		}
+		mHeapAboveThreshold[heap_index] = above_threshold;
+	}
+
+	void track(const AllocationKey& key, VkDeviceSize size, uint32_t heap_index, const char* name, MemCategory category, bool owned)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const auto inserted = mAllocations.emplace(key, Allocation{});
+		if (!inserted.second) {
+			VKL_EXIT_WITH_ERROR("\"" << name << "\" is already registered in the memory registry as \"" << inserted.first->second.name << "\".");
+		}
+		Allocation& allocation = inserted.first->second;
+		allocation.name = name;
+		allocation.category = category;
+		allocation.size = size;
+		allocation.heapIndex = heap_index;
+		allocation.owned = owned;
+		mTrackedBytesPerHeap[heap_index] += size;
+		checkBudget(heap_index, allocation.name.c_str());
+	}
+
+	void untrack(const AllocationKey& key)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const auto it = mAllocations.find(key);
+		if (mAllocations.end() == it) {
+			VKL_EXIT_WITH_ERROR("Tried to release memory which is not registered in the memory registry.");
+		}
+		mTrackedBytesPerHeap[it->second.heapIndex] -= it->second.size;
+		mAllocations.erase(it);
+	}
+
+	void logAllocation(const Allocation& allocation)
+	{
+		VKL_LOG("    \"" << allocation.name << "\" (" << kCategoryNames[allocation.category] << "): " << toKiB(allocation.size)
+			<< " KiB in heap " << allocation.heapIndex << (allocation.owned ? "" : ", tracked"));
+	}
+
+	// Largest allocations first
+	std::vector<const Allocation*> sortedAllocations()
+	{
+		std::vector<const Allocation*> allocations;
+		allocations.reserve(mAllocations.size());
+		for (const auto& entry : mAllocations) {
+			allocations.push_back(&entry.second);
+		}
+		std::sort(allocations.begin(), allocations.end(), [](const Allocation* a, const Allocation* b) { return a->size > b->size; });
+		return allocations;
+	}
+}
+
+/* --------------------------------------------- */
+// Memory Registry Function Definitions
+/* --------------------------------------------- */
+
+bool memIsBudgetExtensionSupported(VkPhysicalDevice physical_device)
+{
+	uint32_t extension_count = 0;
+	VkResult result = vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+	VKL_CHECK_VULKAN_RESULT(result);
+	std::vector<VkExtensionProperties> extensions(extension_count);
+	result = vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+	VKL_CHECK_VULKAN_RESULT(result);
+	for (const VkExtensionProperties& extension : extensions) {
+		if (0 == strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void memInit(VkPhysicalDevice physical_device, VkDevice device, bool budget_extension_enabled, float warning_threshold)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPhysicalDevice = physical_device;
+		mDevice = device;
+		vkGetPhysicalDeviceMemoryProperties(physical_device, &mMemoryProperties);
+		mBudgetExtensionEnabled = budget_extension_enabled;
+		mWarningThreshold = warning_threshold;
+		mAllocations.clear();
+		std::fill(std::begin(mTrackedBytesPerHeap), std::end(mTrackedBytesPerHeap), 0);
+		std::fill(std::begin(mHeapAboveThreshold), std::end(mHeapAboveThreshold), false);
+	}
+	memUpdateBudget();
+	VKL_LOG("Memory registry: " << mMemoryProperties.memoryHeapCount << " heaps, "
+		<< (budget_extension_enabled ? "budgets from VK_EXT_memory_budget" : "budgets are the heap sizes (VK_EXT_memory_budget not enabled)"));
+}
+
+void memUpdateBudget()
+{
+	ensureInitialized();
+	if (!mBudgetExtensionEnabled) {
+		return;
+	}
+	// Query the driver without holding the lock, so that allocations on other threads do not wait for it:
+	const VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = queryBudgetProperties();
+	std::lock_guard<std::mutex> lock(mMutex);
+	mBudgetProperties = budget_properties;
+	std::copy(std::begin(mTrackedBytesPerHeap), std::end(mTrackedBytesPerHeap), std::begin(mTrackedBytesPerHeapAtBudgetUpdate));
+}
+
+void memDestroy()
+{
+	memReportLeaks();
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAllocations.clear();
+	mPhysicalDevice = VK_NULL_HANDLE;
+	mDevice = VK_NULL_HANDLE;
+}
+
+VkDeviceMemory memAllocate(const VkMemoryRequirements& memory_requirements, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category)
+{
+	ensureInitialized();
+	name = nameOrPlaceholder(name);
+	const uint32_t type_index = findMemoryTypeIndex(memory_requirements.memoryTypeBits, memory_properties);
+	if (VK_MAX_MEMORY_TYPES == type_index) {
+		VKL_EXIT_WITH_ERROR(std::string("No suitable memory type for \"") + name + "\".");
+	}
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = memory_requirements.size;
+	allocate_info.memoryTypeIndex = type_index;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	const VkResult result = vkAllocateMemory(mDevice, &allocate_info, nullptr, &memory);
+	if (VK_SUCCESS != result) {
+		memLogHeapUsage(true);
+		VKL_EXIT_WITH_ERROR(std::string("Failed to allocate ") + std::to_string(memory_requirements.size) + " bytes for \"" + name + "\" with error: " + std::to_string(result));
+	}
+
+	track(keyOf(VK_OBJECT_TYPE_DEVICE_MEMORY, memory), memory_requirements.size, mMemoryProperties.memoryTypes[type_index].heapIndex, name, category, true);
+	return memory;
+}
+
+void memFree(VkDeviceMemory memory)
+{
+	if (VK_NULL_HANDLE == memory) {
+		return;
+	}
+	untrack(keyOf(VK_OBJECT_TYPE_DEVICE_MEMORY, memory));
+	vkFreeMemory(mDevice, memory, nullptr);
+}
+
+void memTrackBuffer(VkBuffer buffer, VkDeviceSize size, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category)
+{
+	ensureInitialized();
+	track(keyOf(VK_OBJECT_TYPE_BUFFER, buffer), size, heapIndexOf(memory_properties), nameOrPlaceholder(name), category, false);
+}
+
+void memUntrackBuffer(VkBuffer buffer)
+{
+	untrack(keyOf(VK_OBJECT_TYPE_BUFFER, buffer));
+}
+
+void memTrackImage(VkImage image, VkDeviceSize size, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category)
+{
+	ensureInitialized();
+	track(keyOf(VK_OBJECT_TYPE_IMAGE, image), size, heapIndexOf(memory_properties), nameOrPlaceholder(name), category, false);
+}
+
+void memUntrackImage(VkImage image)
+{
+	untrack(keyOf(VK_OBJECT_TYPE_IMAGE, image));
+}
+
+std::vector<MemHeapUsage> memGetHeapUsage()
+{
+	memUpdateBudget();
+	std::lock_guard<std::mutex> lock(mMutex);
+	return queryHeapUsage();
+}
+
+void memLogHeapUsage(bool log_allocations)
+{
+	memUpdateBudget();
+	std::lock_guard<std::mutex> lock(mMutex);
+	const std::vector<MemHeapUsage> heaps = queryHeapUsage();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(heaps.size()); ++i) {
+		const MemHeapUsage& heap = heaps[i];
+		VKL_LOG("Memory heap " << i << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device-local)" : " (host)") << ": "
+			<< toMiB(heap.usage) << " of " << toMiB(heap.budget) << " MiB budget used ("
+			<< (heap.budget > 0 ? 100.0 * static_cast<double>(heap.usage) / static_cast<double>(heap.budget) : 0.0) << " %), heap size "
+			<< toMiB(heap.size) << " MiB, " << toMiB(heap.trackedBytes) << " MiB in " << heap.trackedAllocations << " tracked allocations");
+		for (int category = 0; category < MEM_CATEGORY_COUNT; ++category) {
+			if (heap.trackedBytesPerCategory[category] > 0) {
+				VKL_LOG("  " << kCategoryNames[category] << ": " << toKiB(heap.trackedBytesPerCategory[category]) << " KiB");
+			}
+		}
+	}
+	if (log_allocations) {
+		for (const Allocation* allocation : sortedAllocations()) {
+			logAllocation(*allocation);
+		}
+	}
+}
+
+uint32_t memReportLeaks()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mAllocations.empty()) {
+		VKL_LOG("Memory registry: no leaks.");
+		return 0;
+	}
+
+	VkDeviceSize leaked_bytes = 0;
+	for (const auto& entry : mAllocations) {
+		leaked_bytes += entry.second.size;
+	}
+	VKL_LOG("WARNING: Memory registry: " << mAllocations.size() << " allocations with " << toKiB(leaked_bytes) << " KiB have not been released:");
+	for (const Allocation* allocation : sortedAllocations()) {
+		logAllocation(*allocation);
+	}
+	return static_cast<uint32_t>(mAllocations.size());
+}
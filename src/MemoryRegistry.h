@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// Memory Registry Struct Definitions
+// As a convention, their names start with `Mem`.
+/* --------------------------------------------- */
+
+/*!
+ * What an allocation is used for. Usage per heap is also reported per category.
+ */
+enum MemCategory {
+	MEM_CATEGORY_GEOMETRY = 0,
+	MEM_CATEGORY_TEXTURE = 1,
+	MEM_CATEGORY_UNIFORM = 2,
+	//! Host-visible buffers which are only used as sources of uploads
+	MEM_CATEGORY_STAGING = 3,
+	MEM_CATEGORY_RENDER_TARGET = 4,
+	MEM_CATEGORY_OTHER = 5,
+	MEM_CATEGORY_COUNT = 6,
+};
+
+/*!
+ * Usage of one memory heap.
+ */
+struct MemHeapUsage {
+	VkMemoryHeapFlags flags;
+
+	//! Size of the heap
+	VkDeviceSize size;
+
+	//! How much of the heap the application can use without degrading performance, as reported by
+	//! VK_EXT_memory_budget. Without the extension, this is the size of the heap.
+	VkDeviceSize budget;
+
+	//! Usage of the heap by the whole process (including allocations which are not tracked, e.g., by the framework
+	//! or the driver), as reported by VK_EXT_memory_budget. Without the extension, this equals trackedBytes.
+	VkDeviceSize usage;
+
+	//! Sizes of the tracked allocations in this heap, in total and per MemCategory
+	VkDeviceSize trackedBytes;
+	VkDeviceSize trackedBytesPerCategory[MEM_CATEGORY_COUNT];
+	uint32_t trackedAllocations;
+};
+
+/* --------------------------------------------- */
+// Memory Registry Function Definitions
+// As a convention, their names start with `mem`.
+/* --------------------------------------------- */
+
+/*!
+ *	Returns true if the physical device supports VK_EXT_MEMORY_BUDGET_EXTENSION_NAME. If so, enable it during device
+ *	creation to get the actual budget and usage of each heap from the driver.
+ */
+bool memIsBudgetExtensionSupported(VkPhysicalDevice physical_device);
+
+/*!
+ *	Initializes the memory registry. Must be invoked before any of the other mem* functions, and before creating
+ *	resources with modules which allocate through the registry (e.g., teapotCreateGeometryAndBuffers or ringCreate).
+ *	@param	physical_device				The physical device which the device has been created from
+ *	@param	device						The device to allocate from; the framework does not need to be initialized yet,
+ *										e.g., to allocate attachments which are passed to vklInitFramework.
+ *	@param	budget_extension_enabled	Whether VK_EXT_MEMORY_BUDGET_EXTENSION_NAME has been enabled for the device
+ *	@param	warning_threshold			A warning is logged whenever the usage of a heap exceeds this fraction of its budget.
+ */
+void memInit(VkPhysicalDevice physical_device, VkDevice device, bool budget_extension_enabled, float warning_threshold = 0.9f);
+
+/*!
+ *	Queries the budget and usage of every heap from the driver if VK_EXT_memory_budget is enabled. Allocations are checked
+ *	against this budget, with the usage adjusted by the tracked allocations since, until the next update, since querying
+ *	the driver on every allocation would be costly. Invoke it once per frame; memGetHeapUsage and memLogHeapUsage invoke it, too.
+ */
+void memUpdateBudget();
+
+/*!
+ *	Reports leaks (see memReportLeaks) and clears the registry. Invoke it after all resources have been destroyed.
+ */
+void memDestroy();
+
+/*!
+ *	Allocates device memory from the first memory type which matches the requirements and properties, and registers it.
+ *	May be invoked from any thread.
+ *	@param	name		Describes the resource which the memory is bound to; it is shown in heap dumps and leak reports. Can be nullptr.
+ *	@return	The allocated memory; release it with memFree.
+ */
+VkDeviceMemory memAllocate(const VkMemoryRequirements& memory_requirements, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category);
+
+/*!
+ *	Frees memory which has been allocated with memAllocate and removes it from the registry.
+ */
+void memFree(VkDeviceMemory memory);
+
+/*!
+ *	Registers a buffer whose memory has been allocated elsewhere, e.g., by vklCreateHostCoherentBufferAndUploadData.
+ *	@param	memory_properties	Properties which the memory has been allocated with, used to determine its heap
+ */
+void memTrackBuffer(VkBuffer buffer, VkDeviceSize size, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category);
+
+/*!
+ *	Removes a buffer which has been registered with memTrackBuffer. Invoke it when the buffer is destroyed.
+ */
+void memUntrackBuffer(VkBuffer buffer);
+
+/*!
+ *	Registers an image whose memory has been allocated elsewhere. See memTrackBuffer.
+ */
+void memTrackImage(VkImage image, VkDeviceSize size, VkMemoryPropertyFlags memory_properties, const char* name, MemCategory category);
+
+/*!
+ *	Removes an image which has been registered with memTrackImage. Invoke it when the image is destroyed.
+ */
+void memUntrackImage(VkImage image);
+
+/*!
+ *	Returns the current usage and budget of every memory heap (indexed like VkPhysicalDeviceMemoryProperties::memoryHeaps).
+ */
+std::vector<MemHeapUsage> memGetHeapUsage();
+
+/*!
+ *	Logs usage vs. budget of every memory heap, broken down by category, and optionally every tracked allocation.
+ */
+void memLogHeapUsage(bool log_allocations = false);
+
+/*!
+ *	Logs every allocation which is still registered, i.e., which has not been released with memFree or memUntrack*.
+ *	@return	The number of leaked allocations
+ */
+uint32_t memReportLeaks();
@@ -0,0 +1,369 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "MeshLod.h"
+#include "VertexKey.h"
+#include "MemoryRegistry.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+/* --------------------------------------------- */
+// Internal helpers for the simplifier
+/* --------------------------------------------- */
+
+namespace {
+
+	// Symmetric 4x4 matrix, storing only the upper triangle:
+	// | a00 a01 a02 a03 |
+	// |     a11 a12 a13 |
+	// |         a22 a23 |
+	// |             a33 |
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+
+		void addPlane(double a, double b, double c, double d) {
+			a00 += a * a; a01 += a * b; a02 += a * c; a03 += a * d;
+			a11 += b * b; a12 += b * c; a13 += b * d;
+			a22 += c * c; a23 += c * d;
+			a33 += d * d;
+		}
+
+		void add(const Quadric& o) {
+			a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+			a11 += o.a11; a12 += o.a12; a13 += o.a13;
+			a22 += o.a22; a23 += o.a23;
+			a33 += o.a33;
+		}
+
+		// Sum of squared distances of p to all planes accumulated in this quadric:
+		double evaluate(const glm::vec3& p) const {
+			const double x = p.x, y = p.y, z = p.z;
+			return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+			     + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+			     + a22 * z * z + 2.0 * a23 * z
+			     + a33;
+		}
+	};
+
+	struct Collapse {
+		double   cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromStamp;
+		uint32_t toStamp;
+
+		bool operator>(const Collapse& o) const { return cost > o.cost; }
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		return glm::cross(b - a, c - a);
+	}
+}
+
+/* --------------------------------------------- */
+// Level-of-Detail Function Definitions
+/* --------------------------------------------- */
+
+LodChain lodGenerateChain(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texture_coordinates,
+	const std::vector<uint32_t>&  indices,
+	const std::vector<float>&     target_ratios)
+{
+	const uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+	const uint32_t input_triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+	LodChain chain;
+	chain.indices = indices;
+	chain.levels.push_back(LodLevel{ 0u, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	// 1. Weld vertices which are identical in all attributes. Loaders often emit one vertex per
+	//    face corner; without welding, every edge would look like a border to the simplifier.
+	//    The canonical vertex of a group is its first occurrence, so that canonical ids can
+	//    directly be used as indices into the original vertex data.
+	std::vector<uint32_t> canonical(vertex_count);
+	{
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> first_occurrence;
+		first_occurrence.reserve(vertex_count);
+		for (uint32_t i = 0; i < vertex_count; ++i) {
+			VertexKey key = {};
+			key.position = positions[i];
+			key.normal = i < normals.size() ? normals[i] : glm::vec3(0.0f);
+			key.textureCoordinate = i < texture_coordinates.size() ? texture_coordinates[i] : glm::vec2(0.0f);
+			canonical[i] = first_occurrence.emplace(key, i).first->second;
+		}
+	}
+
+	// 2. Build triangles in terms of canonical vertices and drop degenerate ones:
+	std::vector<uint32_t> triangles;
+	triangles.reserve(indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const uint32_t a = canonical[indices[i]], b = canonical[indices[i + 1]], c = canonical[indices[i + 2]];
+		if (a == b || b == c || c == a) {
+			continue;
+		}
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+	const uint32_t triangle_count = static_cast<uint32_t>(triangles.size() / 3);
+
+	// 3. Lock every vertex on an edge which is not shared by exactly two triangles. This covers open
+	//    borders, non-manifold edges and also UV/normal seams, because vertices with different
+	//    attributes have not been welded above => seams appear as open edges between canonical vertices.
+	std::vector<bool> locked(vertex_count, false);
+	{
+		std::unordered_map<uint64_t, uint32_t> edge_use_count;
+		edge_use_count.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+			for (int e = 0; e < 3; ++e) {
+				++edge_use_count[edgeKey(triangles[i + e], triangles[i + (e + 1) % 3])];
+			}
+		}
+		for (const auto& entry : edge_use_count) {
+			if (entry.second != 2u) {
+				locked[static_cast<uint32_t>(entry.first >> 32)] = true;
+				locked[static_cast<uint32_t>(entry.first & 0xFFFFFFFFu)] = true;
+			}
+		}
+	}
+
+	// 4. Vertex -> triangle adjacency and per-vertex error quadrics:
+	std::vector<std::vector<uint32_t>> vertex_triangles(vertex_count);
+	std::vector<Quadric> quadrics(vertex_count);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		const glm::vec3& p0 = positions[triangles[3 * t]];
+		glm::vec3 n = triangleNormal(p0, positions[triangles[3 * t + 1]], positions[triangles[3 * t + 2]]);
+		const float len = glm::length(n);
+		if (len > 0.0f) {
+			n /= len;
+		}
+		Quadric q;
+		q.addPlane(n.x, n.y, n.z, -glm::dot(n, p0));
+		for (int c = 0; c < 3; ++c) {
+			const uint32_t v = triangles[3 * t + c];
+			vertex_triangles[v].push_back(t);
+			quadrics[v].add(q);
+		}
+	}
+
+	// 5. Seed the priority queue with all half-edge collapses of unlocked vertices:
+	std::vector<bool> triangle_removed(triangle_count, false);
+	std::vector<uint32_t> stamps(vertex_count, 0u);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+	auto push_collapse = [&](uint32_t from, uint32_t to) {
+		if (locked[from]) {
+			return;
+		}
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		heap.push(Collapse{ std::max(0.0, q.evaluate(positions[to])), from, to, stamps[from], stamps[to] });
+	};
+
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		for (int e = 0; e < 3; ++e) {
+			const uint32_t a = triangles[3 * t + e], b = triangles[3 * t + (e + 1) % 3];
+			push_collapse(a, b);
+			push_collapse(b, a);
+		}
+	}
+
+	// Tests if moving `from` onto `to` keeps all remaining triangles around `from` intact (no flips, no slivers):
+	auto is_collapse_valid = [&](uint32_t from, uint32_t to) {
+		for (uint32_t t : vertex_triangles[from]) {
+			if (triangle_removed[t]) {
+				continue;
+			}
+			const uint32_t* tri = &triangles[3 * t];
+			if (tri[0] == to || tri[1] == to || tri[2] == to) {
+				continue; // This one will collapse away
+			}
+			glm::vec3 corners[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+			const glm::vec3 n_before = triangleNormal(corners[0], corners[1], corners[2]);
+			for (int c = 0; c < 3; ++c) {
+				if (tri[c] == from) {
+					corners[c] = positions[to];
+				}
+			}
+			const glm::vec3 n_after = triangleNormal(corners[0], corners[1], corners[2]);
+			const float len_before = glm::length(n_before), len_after = glm::length(n_after);
+			if (len_after <= 1e-12f || glm::dot(n_before, n_after) < 0.25f * len_before * len_after) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// 6. Collapse edges in the order of increasing error, taking a snapshot whenever a target is reached:
+	uint32_t live_triangle_count = triangle_count;
+	double max_error = 0.0;
+	for (float ratio : target_ratios) {
+		const uint32_t target = static_cast<uint32_t>(static_cast<double>(input_triangle_count) * ratio);
+		const uint32_t live_before = live_triangle_count;
+
+		while (live_triangle_count > target && !heap.empty()) {
+			const Collapse c = heap.top();
+			heap.pop();
+			if (c.fromStamp != stamps[c.from] || c.toStamp != stamps[c.to]) {
+				continue; // Outdated entry; a newer one has been pushed (or the vertex is gone)
+			}
+			if (!is_collapse_valid(c.from, c.to)) {
+				continue;
+			}
+
+			for (uint32_t t : vertex_triangles[c.from]) {
+				if (triangle_removed[t]) {
+					continue;
+				}
+				uint32_t* tri = &triangles[3 * t];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					triangle_removed[t] = true;
+					--live_triangle_count;
+					continue;
+				}
+				for (int k = 0; k < 3; ++k) {
+					if (tri[k] == c.from) {
+						tri[k] = c.to;
+					}
+				}
+				vertex_triangles[c.to].push_back(t);
+			}
+			vertex_triangles[c.from].clear();
+			quadrics[c.to].add(quadrics[c.from]);
+			stamps[c.from] = std::numeric_limits<uint32_t>::max(); // Invalidates all its pending collapses
+			++stamps[c.to];
+			max_error = std::max(max_error, c.cost);
+
+			// Compact the adjacency and re-evaluate the collapses around the surviving vertex:
+			auto& around = vertex_triangles[c.to];
+			around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return triangle_removed[t]; }), around.end());
+			for (uint32_t t : around) {
+				for (int k = 0; k < 3; ++k) {
+					const uint32_t w = triangles[3 * t + k];
+					if (w != c.to) {
+						push_collapse(w, c.to);
+						push_collapse(c.to, w);
+					}
+				}
+			}
+		}
+
+		if (live_triangle_count == live_before) {
+			break; // Cannot simplify any further => further levels would be identical
+		}
+
+		LodLevel level;
+		level.firstIndex = static_cast<uint32_t>(chain.indices.size());
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			if (!triangle_removed[t]) {
+				chain.indices.insert(chain.indices.end(), &triangles[3 * t], &triangles[3 * t] + 3);
+			}
+		}
+		level.indexCount = static_cast<uint32_t>(chain.indices.size()) - level.firstIndex;
+		level.error = static_cast<float>(std::sqrt(max_error));
+		chain.levels.push_back(level);
+	}
+
+	return chain;
+}
+
+uint32_t lodSelectLevel(const LodChain& chain, float distance, float vertical_fov, float viewport_height, float max_pixel_error)
+{
+	if (distance <= 0.0f) {
+		return 0u;
+	}
+
+	// Pixels per object-space unit at the given distance:
+	const float pixels_per_unit = viewport_height / (2.0f * distance * std::tan(0.5f * vertical_fov));
+
+	uint32_t selected = 0u;
+	for (uint32_t i = 1; i < static_cast<uint32_t>(chain.levels.size()); ++i) {
+		if (chain.levels[i].error * pixels_per_unit > max_pixel_error) {
+			break;
+		}
+		selected = i;
+	}
+	return selected;
+}
+
+HlpGeometryHandles lodCreateGeometryAndBuffers(
+	const LodChain&               chain,
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texture_coordinates)
+{
+	HlpGeometryHandles geometry = {};
+
+	geometry.positionsBufferSize = sizeof(positions[0]) * positions.size();
+	geometry.positionsBuffer = vklCreateHostCoherentBufferAndUploadData(positions.data(), geometry.positionsBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	memTrackBuffer(geometry.positionsBuffer, geometry.positionsBufferSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "LOD positions", MEM_CATEGORY_GEOMETRY);
+
+	if (!normals.empty()) {
+		geometry.normalsBufferSize = sizeof(normals[0]) * normals.size();
+		geometry.normalsBuffer = vklCreateHostCoherentBufferAndUploadData(normals.data(), geometry.normalsBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		memTrackBuffer(geometry.normalsBuffer, geometry.normalsBufferSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "LOD normals", MEM_CATEGORY_GEOMETRY);
+	}
+
+	if (!texture_coordinates.empty()) {
+		geometry.textureCoordinatesBufferSize = sizeof(texture_coordinates[0]) * texture_coordinates.size();
+		geometry.textureCoordinatesBuffer = vklCreateHostCoherentBufferAndUploadData(texture_coordinates.data(), geometry.textureCoordinatesBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		memTrackBuffer(geometry.textureCoordinatesBuffer, geometry.textureCoordinatesBufferSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "LOD texture coordinates", MEM_CATEGORY_GEOMETRY);
+	}
+
+	// One index buffer for all levels; they are selected at draw time via firstIndex/indexCount:
+	geometry.numberOfIndices = static_cast<uint32_t>(chain.indices.size());
+	geometry.indexType = VK_INDEX_TYPE_UINT32;
+	geometry.indicesBufferSize = sizeof(chain.indices[0]) * chain.indices.size();
+	geometry.indicesBuffer = vklCreateHostCoherentBufferAndUploadData(chain.indices.data(), geometry.indicesBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	memTrackBuffer(geometry.indicesBuffer, geometry.indicesBufferSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "LOD indices", MEM_CATEGORY_GEOMETRY);
+
+	return geometry;
+}
+
+void lodDestroyBuffers(const HlpGeometryHandles& geometry)
+{
+	for (VkBuffer buffer : { geometry.positionsBuffer, geometry.normalsBuffer, geometry.textureCoordinatesBuffer, geometry.indicesBuffer }) {
+		if (VK_NULL_HANDLE != buffer) {
+			memUntrackBuffer(buffer);
+			vklDestroyHostCoherentBufferAndItsBackingMemory(buffer);
+		}
+	}
+}
+
+void lodDraw(VkPipeline pipeline, const HlpGeometryHandles& geometry, const LodChain& chain, uint32_t level)
+{
+	if (!vklFrameworkInitialized()) {
+		VKL_EXIT_WITH_ERROR("Framework not initialized. Ensure to invoke vklFrameworkInitialized beforehand!");
+	}
+	assert(level < chain.levels.size());
+
+	VkCommandBuffer cb = vklGetCurrentCommandBuffer();
+	vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cb, 0u, 1u, &geometry.positionsBuffer, &offset);
+	if (VK_NULL_HANDLE != geometry.normalsBuffer) {
+		vkCmdBindVertexBuffers(cb, 1u, 1u, &geometry.normalsBuffer, &offset);
+	}
+	if (VK_NULL_HANDLE != geometry.textureCoordinatesBuffer) {
+		vkCmdBindVertexBuffers(cb, 2u, 1u, &geometry.textureCoordinatesBuffer, &offset);
+	}
+	vkCmdBindIndexBuffer(cb, geometry.indicesBuffer, 0, geometry.indexType);
+
+	const LodLevel& lod = chain.levels[level];
+	vkCmdDrawIndexed(cb, lod.indexCount, 1u, lod.firstIndex, 0, 0u);
+}
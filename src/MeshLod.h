@@ -0,0 +1,105 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include <vector>
+
+/* --------------------------------------------- */
+// Level-of-Detail Struct Definitions
+// As a convention, their names start with `Lod`.
+/* --------------------------------------------- */
+
+/*!
+ * Describes one level of detail within a LodChain, i.e., a range in the chain's index data.
+ */
+struct LodLevel {
+	//! The offset of this level's first index in LodChain::indices (and in the index buffer).
+	uint32_t firstIndex;
+
+	//! The number of indices of this level, starting at `firstIndex`.
+	uint32_t indexCount;
+
+	//! Object-space geometric error of this level, i.e., how far (at most) its surface deviates
+	//! from the full resolution mesh. Level 0 always has an error of 0.
+	float error;
+};
+
+/*!
+ * A chain of levels of detail of a mesh. All levels reference the same (unmodified) vertices,
+ * so that they can share one vertex buffer. Their indices are stored back to back in `indices`,
+ * the finest level first.
+ */
+struct LodChain {
+	//! The indices of all levels, concatenated. Every level occupies the range given by its LodLevel.
+	std::vector<uint32_t> indices;
+
+	//! All levels of detail, ordered from the finest (index 0) to the coarsest.
+	std::vector<LodLevel> levels;
+};
+
+/* --------------------------------------------- */
+// Level-of-Detail Function Definitions
+// As a convention, their names start with `lod`.
+/* --------------------------------------------- */
+
+/*!
+ *	Builds a chain of levels of detail for the given indexed triangle mesh using quadric error metric
+ *	edge collapses. Vertices are never moved or created, only removed, which means that all levels
+ *	can be drawn from the original vertex data.
+ *	Vertices on UV or normal seams (i.e., positions that are shared by vertices with different
+ *	attributes) and on open borders are never collapsed, so that seams stay intact.
+ *	@param		positions				Vertex positions
+ *	@param		normals					Vertex normals; can be empty.
+ *	@param		texture_coordinates		Vertex texture coordinates; can be empty.
+ *	@param		indices					Triangle list indices into the vertex data.
+ *	@param		target_ratios			Triangle count of each additional level relative to the input's triangle count,
+ *										in decreasing order. Generation stops early if the mesh cannot be simplified any further.
+ *	@return		A chain containing the input as level 0, followed by one level per reached target ratio.
+ */
+LodChain lodGenerateChain(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texture_coordinates,
+	const std::vector<uint32_t>&  indices,
+	const std::vector<float>&     target_ratios = { 0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f });
+
+/*!
+ *	Selects the coarsest level of the given chain whose geometric error, projected onto the screen, stays
+ *	below the given pixel threshold.
+ *	@param		chain				The chain to select a level from
+ *	@param		distance			Distance from the camera to the (closest point of the) instance, in the mesh's object-space units
+ *	@param		vertical_fov		The camera's vertical field of view in radians
+ *	@param		viewport_height		The viewport's height in pixels
+ *	@param		max_pixel_error		Maximum tolerated screen-space error in pixels
+ *	@return		The index of the selected level in LodChain::levels
+ */
+uint32_t lodSelectLevel(const LodChain& chain, float distance, float vertical_fov, float viewport_height, float max_pixel_error = 1.0f);
+
+/*!
+ *	Creates host-coherent buffers for the given vertex data and one index buffer which contains all
+ *	levels of the given chain.
+ *	@return		The geometry handles; `numberOfIndices` refers to the whole index buffer, i.e., all levels.
+ */
+HlpGeometryHandles lodCreateGeometryAndBuffers(
+	const LodChain&               chain,
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texture_coordinates);
+
+/*!
+ *	Destroys buffers which were previously created with lodCreateGeometryAndBuffers.
+ */
+void lodDestroyBuffers(const HlpGeometryHandles& geometry);
+
+/*!
+ *	Draws one level of the given chain into the (Vulkan Launchpad-internally handled) current command buffer.
+ *	Positions are bound to vertex binding 0, normals to binding 1, and texture coordinates to binding 2 (if present).
+ *	@param	pipeline		The pipeline to draw with
+ *	@param	geometry		Buffers created with lodCreateGeometryAndBuffers
+ *	@param	chain			The chain that `geometry` was created from
+ *	@param	level			Index of the level to draw, e.g., as returned by lodSelectLevel
+ */
+void lodDraw(VkPipeline pipeline, const HlpGeometryHandles& geometry, const LodChain& chain, uint32_t level);
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "ObjectCache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	constexpr size_t kShardCount = 16;
+
+	// Serializes create info contents into a byte string which serves as key
+	class KeyWriter
+	{
+	public:
+		template <typename T>
+		void add(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be added to a key.");
+			mBytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		std::string& bytes() { return mBytes; }
+
+	private:
+		std::string mBytes;
+	};
+
+	// Maps keys to objects; split into shards, each guarded by its own reader-writer lock
+	template <typename Handle>
+	class ShardedCache
+	{
+	public:
+		// Returns the object for the given key and adds a reference to it, invoking create() under the shard's exclusive
+		// lock if there is none yet, so that concurrent misses on the same key create only one object.
+		template <typename Create>
+		Handle get(std::string& key, const Create& create)
+		{
+			Shard& shard = mShards[std::hash<std::string>{}(key) % kShardCount];
+			{
+				std::shared_lock<std::shared_mutex> lock(shard.mutex);
+				const auto it = shard.objects.find(key);
+				if (it != shard.objects.end()) {
+					it->second.references.fetch_add(1, std::memory_order_relaxed);
+					mHits.fetch_add(1, std::memory_order_relaxed);
+					return it->second.handle;
+				}
+			}
+
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+			// Another thread might have created it in the meantime:
+			const auto it = shard.objects.find(key);
+			if (it != shard.objects.end()) {
+				it->second.references.fetch_add(1, std::memory_order_relaxed);
+				mHits.fetch_add(1, std::memory_order_relaxed);
+				return it->second.handle;
+			}
+			const Handle object = create();
+			shard.objects.emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(object));
+			mMisses.fetch_add(1, std::memory_order_relaxed);
+			mObjects.fetch_add(1, std::memory_order_relaxed);
+			return object;
+		}
+
+		// Removes one reference from the given object, and destroys and removes it if that was the last one.
+		// Returns false if the object is not in the cache. Searches all shards, since objects are keyed by create info.
+		template <typename Destroy>
+		bool release(Handle handle, const Destroy& destroy)
+		{
+			for (Shard& shard : mShards) {
+				std::unique_lock<std::shared_mutex> lock(shard.mutex);
+				for (auto it = shard.objects.begin(); it != shard.objects.end(); ++it) {
+					if (it->second.handle != handle) {
+						continue;
+					}
+					if (1 == it->second.references.fetch_sub(1, std::memory_order_relaxed)) {
+						destroy(handle);
+						shard.objects.erase(it);
+						mObjects.fetch_sub(1, std::memory_order_relaxed);
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Destroys and removes all objects for which matches(key) returns true
+		template <typename Matches, typename Destroy>
+		void evict(const Matches& matches, const Destroy& destroy)
+		{
+			for (Shard& shard : mShards) {
+				std::unique_lock<std::shared_mutex> lock(shard.mutex);
+				for (auto it = shard.objects.begin(); it != shard.objects.end();) {
+					if (matches(it->first)) {
+						destroy(it->second.handle);
+						it = shard.objects.erase(it);
+						mObjects.fetch_sub(1, std::memory_order_relaxed);
+					}
+					else {
+						++it;
+					}
+				}
+			}
+		}
+
+		CacheCounters counters() const
+		{
+			return CacheCounters{ mHits.load(std::memory_order_relaxed), mMisses.load(std::memory_order_relaxed), mObjects.load(std::memory_order_relaxed) };
+		}
+
+	private:
+		struct Entry {
+			explicit Entry(Handle handle) : handle(handle), references(1) {}
+
+			Handle handle;
+			// Incremented under the shard's shared lock by concurrent hits, hence atomic
+			std::atomic<uint32_t> references;
+		};
+
+		struct Shard {
+			std::shared_mutex mutex;
+			std::unordered_map<std::string, Entry> objects;
+		};
+
+		Shard mShards[kShardCount];
+		std::atomic<uint64_t> mHits{ 0 };
+		std::atomic<uint64_t> mMisses{ 0 };
+		std::atomic<uint64_t> mObjects{ 0 };
+	};
+
+	ShardedCache<VkSampler> mSamplers;
+	ShardedCache<VkImageView> mImageViews;
+	ShardedCache<VkDescriptorSetLayout> mDescriptorSetLayouts;
+	ShardedCache<VkPipelineLayout> mPipelineLayouts;
+
+	void checkNoExtensions(const void* next, const char* create_info_name)
+	{
+		if (nullptr != next) {
+			VKL_EXIT_WITH_ERROR("The object cache does not support pNext structures in " << create_info_name << ".");
+		}
+	}
+
+	bool matchesAll(const std::string&)
+	{
+		return true;
+	}
+
+	void logCounters(const char* name, const CacheCounters& counters)
+	{
+		const uint64_t lookups = counters.hits + counters.misses;
+		VKL_LOG("  " << name << ": " << counters.objects << " objects, " << counters.hits << " hits, " << counters.misses << " misses ("
+			<< (lookups > 0 ? 100.0 * static_cast<double>(counters.hits) / static_cast<double>(lookups) : 0.0) << " % hit rate)");
+	}
+}
+
+/* --------------------------------------------- */
+// Object Cache Function Definitions
+/* --------------------------------------------- */
+
+VkSampler cacheGetSampler(const VkSamplerCreateInfo& create_info)
+{
+	checkNoExtensions(create_info.pNext, "VkSamplerCreateInfo");
+	KeyWriter key;
+	key.add(create_info.flags);
+	key.add(create_info.magFilter);
+	key.add(create_info.minFilter);
+	key.add(create_info.mipmapMode);
+	key.add(create_info.addressModeU);
+	key.add(create_info.addressModeV);
+	key.add(create_info.addressModeW);
+	key.add(create_info.mipLodBias);
+	key.add(create_info.anisotropyEnable);
+	key.add(create_info.maxAnisotropy);
+	key.add(create_info.compareEnable);
+	key.add(create_info.compareOp);
+	key.add(create_info.minLod);
+	key.add(create_info.maxLod);
+	key.add(create_info.borderColor);
+	key.add(create_info.unnormalizedCoordinates);
+
+	return mSamplers.get(key.bytes(), [&create_info] {
+		VkSampler sampler;
+		VkResult result = vkCreateSampler(vklGetDevice(), &create_info, nullptr, &sampler);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return sampler;
+	});
+}
+
+VkImageView cacheGetImageView(const VkImageViewCreateInfo& create_info)
+{
+	checkNoExtensions(create_info.pNext, "VkImageViewCreateInfo");
+	KeyWriter key;
+	// The image comes first, so that cacheEvictImageViews can match keys by their prefix:
+	key.add(create_info.image);
+	key.add(create_info.flags);
+	key.add(create_info.viewType);
+	key.add(create_info.format);
+	key.add(create_info.components.r);
+	key.add(create_info.components.g);
+	key.add(create_info.components.b);
+	key.add(create_info.components.a);
+	key.add(create_info.subresourceRange.aspectMask);
+	key.add(create_info.subresourceRange.baseMipLevel);
+	key.add(create_info.subresourceRange.levelCount);
+	key.add(create_info.subresourceRange.baseArrayLayer);
+	key.add(create_info.subresourceRange.layerCount);
+
+	return mImageViews.get(key.bytes(), [&create_info] {
+		VkImageView image_view;
+		VkResult result = vkCreateImageView(vklGetDevice(), &create_info, nullptr, &image_view);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return image_view;
+	});
+}
+
+bool cacheReleaseSampler(VkSampler sampler)
+{
+	const auto device = vklGetDevice();
+	return mSamplers.release(sampler, [device](VkSampler unused_sampler) { vkDestroySampler(device, unused_sampler, nullptr); });
+}
+
+bool cacheReleaseImageView(VkImageView image_view)
+{
+	const auto device = vklGetDevice();
+	return mImageViews.release(image_view, [device](VkImageView unused_image_view) { vkDestroyImageView(device, unused_image_view, nullptr); });
+}
+
+void cacheEvictImageViews(VkImage image)
+{
+	const auto device = vklGetDevice();
+	mImageViews.evict(
+		[image](const std::string& key) { return 0 == std::memcmp(key.data(), &image, sizeof(VkImage)); },
+		[device](VkImageView image_view) { vkDestroyImageView(device, image_view, nullptr); });
+}
+
+VkDescriptorSetLayout cacheGetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& create_info)
+{
+	const VkDescriptorBindingFlags* binding_flags = nullptr;
+	for (auto next = static_cast<const VkBaseInStructure*>(create_info.pNext); nullptr != next; next = next->pNext) {
+		if (VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT != next->sType) {
+			VKL_EXIT_WITH_ERROR("The object cache only supports VkDescriptorSetLayoutBindingFlagsCreateInfo in VkDescriptorSetLayoutCreateInfo's pNext.");
+		}
+		const auto flags_create_info = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfoEXT*>(next);
+		if (flags_create_info->bindingCount > 0) {
+			binding_flags = flags_create_info->pBindingFlags;
+		}
+	}
+
+	// Sort by binding number, so that the same bindings in a different order map to the same layout:
+	std::vector<uint32_t> order(create_info.bindingCount);
+	for (uint32_t i = 0; i < create_info.bindingCount; ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&create_info](uint32_t a, uint32_t b) { return create_info.pBindings[a].binding < create_info.pBindings[b].binding; });
+
+	KeyWriter key;
+	key.add(create_info.flags);
+	key.add(create_info.bindingCount);
+	for (const uint32_t i : order) {
+		const VkDescriptorSetLayoutBinding& binding = create_info.pBindings[i];
+		key.add(binding.binding);
+		key.add(binding.descriptorType);
+		key.add(binding.descriptorCount);
+		key.add(binding.stageFlags);
+		key.add(nullptr != binding.pImmutableSamplers);
+		if (nullptr != binding.pImmutableSamplers) {
+			for (uint32_t s = 0; s < binding.descriptorCount; ++s) {
+				key.add(binding.pImmutableSamplers[s]);
+			}
+		}
+		key.add(nullptr != binding_flags ? binding_flags[i] : VkDescriptorBindingFlags{ 0 });
+	}
+
+	return mDescriptorSetLayouts.get(key.bytes(), [&create_info] {
+		VkDescriptorSetLayout layout;
+		VkResult result = vkCreateDescriptorSetLayout(vklGetDevice(), &create_info, nullptr, &layout);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return layout;
+	});
+}
+
+VkPipelineLayout cacheGetPipelineLayout(const VkPipelineLayoutCreateInfo& create_info)
+{
+	checkNoExtensions(create_info.pNext, "VkPipelineLayoutCreateInfo");
+	KeyWriter key;
+	key.add(create_info.flags);
+	key.add(create_info.setLayoutCount);
+	for (uint32_t i = 0; i < create_info.setLayoutCount; ++i) {
+		key.add(create_info.pSetLayouts[i]);
+	}
+	key.add(create_info.pushConstantRangeCount);
+	for (uint32_t i = 0; i < create_info.pushConstantRangeCount; ++i) {
+		key.add(create_info.pPushConstantRanges[i].stageFlags);
+		key.add(create_info.pPushConstantRanges[i].offset);
+		key.add(create_info.pPushConstantRanges[i].size);
+	}
+
+	return mPipelineLayouts.get(key.bytes(), [&create_info] {
+		VkPipelineLayout layout;
+		VkResult result = vkCreatePipelineLayout(vklGetDevice(), &create_info, nullptr, &layout);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return layout;
+	});
+}
+
+CacheStats cacheGetStats()
+{
+	return CacheStats{ mSamplers.counters(), mImageViews.counters(), mDescriptorSetLayouts.counters(), mPipelineLayouts.counters() };
+}
+
+void cacheLogStats()
+{
+	const CacheStats stats = cacheGetStats();
+	VKL_LOG("Object cache:");
+	logCounters("Samplers", stats.samplers);
+	logCounters("Image views", stats.imageViews);
+	logCounters("Descriptor set layouts", stats.descriptorSetLayouts);
+	logCounters("Pipeline layouts", stats.pipelineLayouts);
+}
+
+void cacheDestroyAll()
+{
+	const auto device = vklGetDevice();
+	// Pipeline layouts refer to set layouts => destroy them first:
+	mPipelineLayouts.evict(matchesAll, [device](VkPipelineLayout layout) { vkDestroyPipelineLayout(device, layout, nullptr); });
+	mDescriptorSetLayouts.evict(matchesAll, [device](VkDescriptorSetLayout layout) { vkDestroyDescriptorSetLayout(device, layout, nullptr); });
+	mImageViews.evict(matchesAll, [device](VkImageView image_view) { vkDestroyImageView(device, image_view, nullptr); });
+	mSamplers.evict(matchesAll, [device](VkSampler sampler) { vkDestroySampler(device, sampler, nullptr); });
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+
+/* --------------------------------------------- */
+// Object Cache Struct Definitions
+// As a convention, their names start with `Cache`.
+/* --------------------------------------------- */
+
+/*!
+ * Lookup counts of one kind of cached object.
+ */
+struct CacheCounters {
+	//! Lookups which returned an existing object
+	uint64_t hits;
+
+	//! Lookups which created a new object
+	uint64_t misses;
+
+	//! Objects currently in the cache
+	uint64_t objects;
+};
+
+/*!
+ * Lookup counts of all kinds of cached objects.
+ */
+struct CacheStats {
+	CacheCounters samplers;
+	CacheCounters imageViews;
+	CacheCounters descriptorSetLayouts;
+	CacheCounters pipelineLayouts;
+};
+
+/* --------------------------------------------- */
+// Object Cache Function Definitions
+// As a convention, their names start with `cache`.
+/* --------------------------------------------- */
+
+/*
+ * All cacheGet* functions return an object created with exactly the given create info's contents, creating it only
+ * if no such object exists yet. Objects are keyed by the full contents of the create info, including arrays it
+ * points to (e.g., bindings); only pNext structures listed at the respective function are supported.
+ * The functions may be invoked concurrently from multiple threads: the cache is split into shards with
+ * reader-writer locks, so lookups of existing objects only take shared locks.
+ * The cache owns the returned objects: do not destroy them. Every lookup adds a reference, which can be released with
+ * cacheReleaseSampler or cacheReleaseImageView (as hlpDestroySampler and hlpDestroyImageView do); objects are destroyed
+ * once their last reference has been released, or by cacheDestroyAll at shutdown.
+ */
+
+/*!
+ *	Returns a sampler for the given create info, e.g., cacheGetSampler(hlpGetSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR)).
+ *	Unlike hlpCreateSampler, loading many textures does not create many identical samplers, which
+ *	matters because devices limit the number of samplers to maxSamplerAllocationCount.
+ */
+VkSampler cacheGetSampler(const VkSamplerCreateInfo& create_info);
+
+/*!
+ *	Releases one reference to a sampler returned by cacheGetSampler, and destroys it if that was the last one.
+ *	The GPU must not use it anymore then.
+ *	@return	False if the sampler is not in the cache
+ */
+bool cacheReleaseSampler(VkSampler sampler);
+
+/*!
+ *	Returns an image view for the given create info, e.g., cacheGetImageView(hlpGetImageViewCreateInfo(image, format)).
+ *	Views are keyed by the image's handle, too => invoke cacheEvictImageViews before destroying the image.
+ */
+VkImageView cacheGetImageView(const VkImageViewCreateInfo& create_info);
+
+/*!
+ *	Releases one reference to an image view returned by cacheGetImageView, and destroys it if that was the last one.
+ *	The GPU must not use it anymore then.
+ *	@return	False if the image view is not in the cache
+ */
+bool cacheReleaseImageView(VkImageView image_view);
+
+/*!
+ *	Destroys all cached views of the given image, regardless of their references. The GPU must not use them anymore.
+ */
+void cacheEvictImageViews(VkImage image);
+
+/*!
+ *	Returns a descriptor set layout for the given create info. Bindings are compared independently of their order.
+ *	Supports VkDescriptorSetLayoutBindingFlagsCreateInfo in pNext.
+ */
+VkDescriptorSetLayout cacheGetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& create_info);
+
+/*!
+ *	Returns a pipeline layout for the given create info. Since set layouts are compared by handle,
+ *	get them from cacheGetDescriptorSetLayout, so that identical set layouts lead to identical pipeline layouts.
+ */
+VkPipelineLayout cacheGetPipelineLayout(const VkPipelineLayoutCreateInfo& create_info);
+
+/*!
+ *	Returns the current hit, miss, and object counts.
+ */
+CacheStats cacheGetStats();
+
+/*!
+ *	Logs hits, misses, and object counts per kind of object.
+ */
+void cacheLogStats();
+
+/*!
+ *	Destroys all cached objects. The GPU must not use any of them anymore.
+ */
+void cacheDestroyAll();
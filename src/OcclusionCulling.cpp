@@ -0,0 +1,950 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "OcclusionCulling.h"
+#include "ObjectCache.h"
+#include "JobSystem.h"
+#include "MemoryRegistry.h"
+#include "ShaderManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+	const char* const kHiZShaderPath = "assets/shaders/hiz_downsample.comp";
+	const char* const kPrepassShaderPath = "assets/shaders/depth_prepass.vert";
+	constexpr uint32_t kHiZWorkgroupSize = 8u;
+
+	// Instances per job of occCullInstances, and rows of level 0 per job of occBuildDepthPyramidOnCpu:
+	constexpr uint32_t kCullGrainSize = 256u;
+	constexpr uint32_t kPyramidRowGrainSize = 16u;
+
+	// Must match the push constants of kHiZShaderPath
+	struct HiZPushConstants {
+		uint32_t sourceOffset;
+		uint32_t sourceWidth;
+		uint32_t sourceHeight;
+		uint32_t destinationOffset;
+		uint32_t destinationWidth;
+		uint32_t destinationHeight;
+		uint32_t fromDepthBuffer;
+	};
+
+	enum class PyramidState { EMPTY, PENDING, READY };
+
+	// Everything which belongs to one swapchain image: its depth pyramid is built from its depth buffer into its own buffer,
+	// whose fragment shader invocation count (if measured) is copied behind the texels.
+	struct Slot {
+		VkImageView depthView;
+		VkDescriptorSet descriptorSet;
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		const void* mappedMemory;
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+		PyramidState state;
+		uint64_t buildNumber;
+		// Whether a query has been recorded in the current frame, and whether the pyramid's build has fetched its result:
+		bool overdrawQueried;
+		bool overdrawMeasured;
+		// Queries must be reset before their first use, which the slot's first build does:
+		bool queryResetPending;
+	};
+
+	// Depth buffers:
+	std::vector<VkImage> mDepthImages;
+	std::vector<VkDeviceMemory> mDepthMemories;
+	VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
+	VkExtent2D mDepthExtent = {};
+
+	// Depth pre-pass, depth pyramid, and overdraw queries:
+	VkQueue mQueue = VK_NULL_HANDLE;
+	VkCommandPool mCommandPool = VK_NULL_HANDLE;
+	VkRenderPass mCompatibleRenderPass = VK_NULL_HANDLE;
+	VkPipelineLayout mPrepassPipelineLayout = VK_NULL_HANDLE;
+	VkCullModeFlags mCullMode = VK_CULL_MODE_NONE;
+	VkFrontFace mFrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	// Both pipelines are registered with the shader manager, which rebuilds them when their shaders change:
+	uint32_t mPrepassPipelineId = 0;
+	VkDescriptorSetLayout mHiZDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout mHiZPipelineLayout = VK_NULL_HANDLE;
+	uint32_t mHiZPipelineId = 0;
+	VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+	VkSampler mDepthSampler = VK_NULL_HANDLE;
+	VkQueryPool mQueryPool = VK_NULL_HANDLE;
+	bool mPipelineStatisticsEnabled = false;
+	OccDepthPyramid mLayout = {};
+	VkDeviceSize mQueryResultOffset = 0;
+	std::vector<Slot> mSlots;
+	uint64_t mBuildCount = 0;
+
+	// Creates the pre-pass pipeline if fragment_shader_path is empty (depth written with LESS, no color), or a main pass
+	// pipeline otherwise (depth tested with LESS_OR_EQUAL against the pre-pass's depth, not written). Everything that
+	// affects rasterization is the same for both, so that they produce the same depth for the same draws:
+	VkPipeline createDepthTestedPipeline(const std::string& vertex_shader_path, const std::string& fragment_shader_path, VkPipelineLayout pipeline_layout)
+	{
+		const bool prepass = fragment_shader_path.empty();
+		VkPipelineShaderStageCreateInfo stages[2] = {};
+		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = shaderCreateModule(vertex_shader_path);
+		stages[0].pName = "main";
+		if (!prepass) {
+			stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+			stages[1].module = shaderCreateModule(fragment_shader_path);
+			stages[1].pName = "main";
+		}
+
+		VkVertexInputBindingDescription binding = {};
+		binding.binding = 0;
+		binding.stride = sizeof(glm::vec3);
+		binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		VkVertexInputAttributeDescription attribute = {};
+		attribute.location = 0;
+		attribute.binding = 0;
+		attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+		VkPipelineVertexInputStateCreateInfo vertex_input = {};
+		vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertex_input.vertexBindingDescriptionCount = 1;
+		vertex_input.pVertexBindingDescriptions = &binding;
+		vertex_input.vertexAttributeDescriptionCount = 1;
+		vertex_input.pVertexAttributeDescriptions = &attribute;
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
+		input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		// Viewport and scissor are dynamic, so that the pipeline does not depend on the swapchain's size:
+		VkPipelineViewportStateCreateInfo viewport = {};
+		viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewport.viewportCount = 1;
+		viewport.scissorCount = 1;
+		const VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamic = {};
+		dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamic.dynamicStateCount = 2;
+		dynamic.pDynamicStates = dynamic_states;
+
+		VkPipelineRasterizationStateCreateInfo rasterization = {};
+		rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterization.cullMode = mCullMode;
+		rasterization.frontFace = mFrontFace;
+		rasterization.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisample = {};
+		multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineDepthStencilStateCreateInfo depth_stencil = {};
+		depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depth_stencil.depthTestEnable = VK_TRUE;
+		depth_stencil.depthWriteEnable = prepass ? VK_TRUE : VK_FALSE;
+		depth_stencil.depthCompareOp = prepass ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		// The color attachment is part of the subpass, but the pre-pass does not write it:
+		VkPipelineColorBlendAttachmentState blend_attachment = {};
+		blend_attachment.colorWriteMask = prepass ? 0 : (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT);
+		VkPipelineColorBlendStateCreateInfo blend = {};
+		blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		blend.attachmentCount = 1;
+		blend.pAttachments = &blend_attachment;
+
+		VkGraphicsPipelineCreateInfo pipeline_create_info = {};
+		pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipeline_create_info.stageCount = prepass ? 1 : 2;
+		pipeline_create_info.pStages = stages;
+		pipeline_create_info.pVertexInputState = &vertex_input;
+		pipeline_create_info.pInputAssemblyState = &input_assembly;
+		pipeline_create_info.pViewportState = &viewport;
+		pipeline_create_info.pRasterizationState = &rasterization;
+		pipeline_create_info.pMultisampleState = &multisample;
+		pipeline_create_info.pDepthStencilState = &depth_stencil;
+		pipeline_create_info.pColorBlendState = &blend;
+		pipeline_create_info.pDynamicState = &dynamic;
+		pipeline_create_info.layout = pipeline_layout;
+		pipeline_create_info.renderPass = mCompatibleRenderPass;
+		pipeline_create_info.subpass = 0;
+
+		const auto device = vklGetDevice();
+		VkPipeline pipeline;
+		VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline);
+		for (uint32_t i = 0; i < pipeline_create_info.stageCount; ++i) {
+			vkDestroyShaderModule(device, stages[i].module, nullptr);
+		}
+		if (VK_SUCCESS != result) {
+			VKL_LOG("Failed to create " << (prepass ? "depth pre-pass" : "main pass") << " pipeline from " << vertex_shader_path << " with error: " << result);
+			return VK_NULL_HANDLE;
+		}
+		return pipeline;
+	}
+
+	// Pipelines only need to be created for a render pass which is compatible with the one they are used in, i.e.,
+	// which has the same attachment formats and sample counts. This one mirrors the framework's.
+	VkRenderPass createCompatibleRenderPass(VkFormat color_format)
+	{
+		VkAttachmentDescription attachments[2] = {};
+		attachments[0].format = color_format;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachments[1].format = mDepthFormat;
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference color_reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference depth_reference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &color_reference;
+		subpass.pDepthStencilAttachment = &depth_reference;
+
+		VkRenderPassCreateInfo render_pass_create_info = {};
+		render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_create_info.attachmentCount = 2;
+		render_pass_create_info.pAttachments = attachments;
+		render_pass_create_info.subpassCount = 1;
+		render_pass_create_info.pSubpasses = &subpass;
+
+		VkRenderPass render_pass;
+		VkResult result = vkCreateRenderPass(vklGetDevice(), &render_pass_create_info, nullptr, &render_pass);
+		VKL_CHECK_VULKAN_RESULT(result);
+		return render_pass;
+	}
+
+	void createHiZPipelineLayout()
+	{
+		const auto device = vklGetDevice();
+
+		VkDescriptorSetLayoutBinding bindings[2] = {};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+		layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_create_info.bindingCount = 2;
+		layout_create_info.pBindings = bindings;
+		VkResult result = vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &mHiZDescriptorSetLayout);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		VkPushConstantRange push_constant_range = {};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.size = sizeof(HiZPushConstants);
+		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = &mHiZDescriptorSetLayout;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+		result = vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &mHiZPipelineLayout);
+		VKL_CHECK_VULKAN_RESULT(result);
+	}
+
+	VkPipeline createHiZPipeline()
+	{
+		const auto device = vklGetDevice();
+		VkComputePipelineCreateInfo pipeline_create_info = {};
+		pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_create_info.stage.module = shaderCreateModule(kHiZShaderPath);
+		pipeline_create_info.stage.pName = "main";
+		pipeline_create_info.layout = mHiZPipelineLayout;
+		VkPipeline pipeline;
+		VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline);
+		vkDestroyShaderModule(device, pipeline_create_info.stage.module, nullptr);
+		if (VK_SUCCESS != result) {
+			VKL_LOG("Failed to create depth pyramid pipeline with error: " << result);
+			return VK_NULL_HANDLE;
+		}
+		return pipeline;
+	}
+
+	void createSlot(Slot& slot, VkImage depth_image, VkDeviceSize buffer_size)
+	{
+		const auto device = vklGetDevice();
+
+		VkImageViewCreateInfo view_create_info = hlpGetImageViewCreateInfo(depth_image, mDepthFormat);
+		view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		slot.depthView = cacheGetImageView(view_create_info);
+
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = buffer_size;
+		buffer_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &slot.buffer);
+		VKL_CHECK_VULKAN_RESULT(result);
+		VkMemoryRequirements memory_requirements = {};
+		vkGetBufferMemoryRequirements(device, slot.buffer, &memory_requirements);
+		slot.memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Depth pyramid", MEM_CATEGORY_RENDER_TARGET);
+		result = vkBindBufferMemory(device, slot.buffer, slot.memory, 0);
+		VKL_CHECK_VULKAN_RESULT(result);
+		void* mapped_memory = nullptr;
+		result = vkMapMemory(device, slot.memory, 0, buffer_size, 0, &mapped_memory);
+		VKL_CHECK_VULKAN_RESULT(result);
+		slot.mappedMemory = mapped_memory;
+
+		VkDescriptorSetAllocateInfo set_allocate_info = {};
+		set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		set_allocate_info.descriptorPool = mDescriptorPool;
+		set_allocate_info.descriptorSetCount = 1;
+		set_allocate_info.pSetLayouts = &mHiZDescriptorSetLayout;
+		result = vkAllocateDescriptorSets(device, &set_allocate_info, &slot.descriptorSet);
+		VKL_CHECK_VULKAN_RESULT(result);
+		VkDescriptorImageInfo image_info = {};
+		image_info.sampler = mDepthSampler;
+		image_info.imageView = slot.depthView;
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		VkDescriptorBufferInfo buffer_info = {};
+		buffer_info.buffer = slot.buffer;
+		buffer_info.range = VK_WHOLE_SIZE;
+		VkWriteDescriptorSet writes[2] = {};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = slot.descriptorSet;
+		writes[0].dstBinding = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &image_info;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = slot.descriptorSet;
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pBufferInfo = &buffer_info;
+		vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.commandPool = mCommandPool;
+		allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocate_info.commandBufferCount = 1;
+		result = vkAllocateCommandBuffers(device, &allocate_info, &slot.commandBuffer);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		// Signaled, so that the first build does not wait:
+		VkFenceCreateInfo fence_create_info = {};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		result = vkCreateFence(device, &fence_create_info, nullptr, &slot.fence);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		slot.state = PyramidState::EMPTY;
+		slot.buildNumber = 0;
+		slot.overdrawQueried = false;
+		slot.overdrawMeasured = false;
+		slot.queryResetPending = true;
+	}
+
+	// Creates everything that depends on the depth buffers' size and count: one slot per depth buffer,
+	// the descriptor pool which their sets are allocated from, and the query pool.
+	void createSlots()
+	{
+		const auto device = vklGetDevice();
+		const uint32_t slot_count = static_cast<uint32_t>(mDepthImages.size());
+
+		VkDescriptorPoolSize pool_sizes[2] = {};
+		pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pool_sizes[0].descriptorCount = slot_count;
+		pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_sizes[1].descriptorCount = slot_count;
+		VkDescriptorPoolCreateInfo descriptor_pool_create_info = {};
+		descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptor_pool_create_info.maxSets = slot_count;
+		descriptor_pool_create_info.poolSizeCount = 2;
+		descriptor_pool_create_info.pPoolSizes = pool_sizes;
+		VkResult result = vkCreateDescriptorPool(device, &descriptor_pool_create_info, nullptr, &mDescriptorPool);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		// The query result (64 bits) is stored behind the texels:
+		mLayout = occCreateDepthPyramidLayout(mDepthExtent.width, mDepthExtent.height);
+		mQueryResultOffset = (static_cast<VkDeviceSize>(mLayout.texelCount) * sizeof(float) + 7) & ~static_cast<VkDeviceSize>(7);
+		mSlots.resize(slot_count);
+		for (uint32_t i = 0; i < slot_count; ++i) {
+			createSlot(mSlots[i], mDepthImages[i], mQueryResultOffset + sizeof(uint64_t));
+		}
+
+		// Overdraw queries, one per swapchain image:
+		mQueryPool = VK_NULL_HANDLE;
+		if (mPipelineStatisticsEnabled) {
+			VkQueryPoolCreateInfo query_pool_create_info = {};
+			query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			query_pool_create_info.queryCount = slot_count;
+			query_pool_create_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+			result = vkCreateQueryPool(device, &query_pool_create_info, nullptr, &mQueryPool);
+			VKL_CHECK_VULKAN_RESULT(result);
+		}
+	}
+
+	// Destroys slots created by createSlots, along with their pools; their builds must have been submitted before.
+	void destroySlots(VkDevice device, std::vector<Slot>& slots, VkDescriptorPool descriptor_pool, VkQueryPool query_pool)
+	{
+		for (Slot& slot : slots) {
+			VkResult result = vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+			VKL_CHECK_VULKAN_RESULT(result);
+			vkDestroyFence(device, slot.fence, nullptr);
+			vkFreeCommandBuffers(device, mCommandPool, 1, &slot.commandBuffer);
+			vkDestroyBuffer(device, slot.buffer, nullptr);
+			memFree(slot.memory);
+			cacheReleaseImageView(slot.depthView);
+		}
+		slots.clear();
+		if (VK_NULL_HANDLE != query_pool) {
+			vkDestroyQueryPool(device, query_pool, nullptr);
+		}
+		vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+	}
+
+	void destroyDepthImages(VkDevice device, const std::vector<VkImage>& images, const std::vector<VkDeviceMemory>& memories)
+	{
+		for (size_t i = 0; i < images.size(); ++i) {
+			vkDestroyImage(device, images[i], nullptr);
+			memFree(memories[i]);
+		}
+	}
+
+	void recordDepthBarrier(VkCommandBuffer command_buffer, VkImage image, VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask,
+		VkAccessFlags src_access_mask, VkAccessFlags dst_access_mask, VkImageLayout old_layout, VkImageLayout new_layout)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access_mask;
+		barrier.dstAccessMask = dst_access_mask;
+		barrier.oldLayout = old_layout;
+		barrier.newLayout = new_layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+		vkCmdPipelineBarrier(command_buffer, src_stage_mask, dst_stage_mask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	// Farthest depth of the pixels (x, y) to (x + 1, y + 1) of a level, clamped to its borders
+	float farthestDepth(const float* level, uint32_t width, uint32_t height, uint32_t x, uint32_t y)
+	{
+		const uint32_t x1 = std::min(x + 1, width - 1);
+		const uint32_t y1 = std::min(y + 1, height - 1);
+		const float* row0 = level + static_cast<size_t>(y) * width;
+		const float* row1 = level + static_cast<size_t>(y1) * width;
+		return std::max(std::max(row0[x], row0[x1]), std::max(row1[x], row1[x1]));
+	}
+}
+
+/* --------------------------------------------- */
+// Occlusion Culling Function Definitions
+/* --------------------------------------------- */
+
+VkFormat occSelectDepthFormat(VkPhysicalDevice physical_device)
+{
+	const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+	const VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	for (const VkFormat format : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+		if ((properties.optimalTilingFeatures & required_features) == required_features) {
+			return format;
+		}
+	}
+	VKL_EXIT_WITH_ERROR("No depth format supports being used as both depth attachment and sampled image.");
+}
+
+bool occIsPipelineStatisticsSupported(VkPhysicalDevice physical_device)
+{
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(physical_device, &features);
+	return VK_TRUE == features.pipelineStatisticsQuery;
+}
+
+void occCreateDepthBuffers(VkDevice device, VkExtent2D extent, VkFormat format, uint32_t count)
+{
+	if (!mDepthImages.empty()) {
+		VKL_EXIT_WITH_ERROR("Depth buffers already created. Ensure to invoke occDestroyDepthBuffers beforehand!");
+	}
+	mDepthFormat = format;
+	mDepthExtent = extent;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		VkImageCreateInfo image_create_info = {};
+		image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_create_info.imageType = VK_IMAGE_TYPE_2D;
+		image_create_info.format = format;
+		image_create_info.extent = { extent.width, extent.height, 1 };
+		image_create_info.mipLevels = 1;
+		image_create_info.arrayLayers = 1;
+		image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_create_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImage image;
+		VkResult result = vkCreateImage(device, &image_create_info, nullptr, &image);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		VkMemoryRequirements memory_requirements;
+		vkGetImageMemoryRequirements(device, image, &memory_requirements);
+		const VkDeviceMemory memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Depth buffer", MEM_CATEGORY_RENDER_TARGET);
+		result = vkBindImageMemory(device, image, memory, 0);
+		VKL_CHECK_VULKAN_RESULT(result);
+
+		mDepthImages.push_back(image);
+		mDepthMemories.push_back(memory);
+	}
+}
+
+VklSwapchainImageDetails occGetDepthAttachmentDetails(uint32_t index)
+{
+	if (index >= mDepthImages.size()) {
+		VKL_EXIT_WITH_ERROR("No depth buffer for swapchain image " << index << ". Ensure to invoke occCreateDepthBuffers beforehand!");
+	}
+	VklSwapchainImageDetails details = {};
+	details.imageHandle = mDepthImages[index];
+	details.imageFormat = mDepthFormat;
+	details.imageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	details.clearValue.depthStencil.depth = 1.0f;
+	details.clearValue.depthStencil.stencil = 0;
+	return details;
+}
+
+void occDestroyDepthBuffers(VkDevice device)
+{
+	destroyDepthImages(device, mDepthImages, mDepthMemories);
+	mDepthImages.clear();
+	mDepthMemories.clear();
+}
+
+void occRecreateDepthBuffers(VkDevice device, VkExtent2D extent, uint32_t count)
+{
+	if (mDepthImages.empty()) {
+		VKL_EXIT_WITH_ERROR("No depth buffers created. Ensure to invoke occCreateDepthBuffers beforehand!");
+	}
+
+	const bool culling_initialized = VK_NULL_HANDLE != mQueue;
+	if (culling_initialized) {
+		destroySlots(device, mSlots, mDescriptorPool, mQueryPool);
+	}
+	occDestroyDepthBuffers(device);
+
+	occCreateDepthBuffers(device, extent, mDepthFormat, count);
+	if (culling_initialized) {
+		createSlots();
+	}
+}
+
+void occInitCulling(VkQueue queue, uint32_t queue_family_index, VkFormat color_format, VkCullModeFlags cull_mode, VkFrontFace front_face, bool pipeline_statistics_enabled)
+{
+	if (VK_NULL_HANDLE != mQueue) {
+		VKL_EXIT_WITH_ERROR("Occlusion culling already initialized.");
+	}
+	if (mDepthImages.empty()) {
+		VKL_EXIT_WITH_ERROR("No depth buffers created. Ensure to invoke occCreateDepthBuffers beforehand!");
+	}
+	const auto device = vklGetDevice();
+	const uint32_t slot_count = static_cast<uint32_t>(mDepthImages.size());
+
+	VkCommandPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_info.queueFamilyIndex = queue_family_index;
+	VkResult result = vkCreateCommandPool(device, &pool_create_info, nullptr, &mCommandPool);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create occlusion culling command pool with error: ") + std::to_string(result));
+	}
+
+	// Depth pre-pass:
+	mCompatibleRenderPass = createCompatibleRenderPass(color_format);
+	VkPushConstantRange prepass_push_constant_range = {};
+	prepass_push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	prepass_push_constant_range.size = sizeof(glm::mat4);
+	VkPipelineLayoutCreateInfo prepass_layout_create_info = {};
+	prepass_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	prepass_layout_create_info.pushConstantRangeCount = 1;
+	prepass_layout_create_info.pPushConstantRanges = &prepass_push_constant_range;
+	result = vkCreatePipelineLayout(device, &prepass_layout_create_info, nullptr, &mPrepassPipelineLayout);
+	VKL_CHECK_VULKAN_RESULT(result);
+	mCullMode = cull_mode;
+	mFrontFace = front_face;
+	mPrepassPipelineId = shaderRegisterPipeline({ kPrepassShaderPath }, []() { return createDepthTestedPipeline(kPrepassShaderPath, "", mPrepassPipelineLayout); });
+
+	// Depth pyramid and overdraw queries:
+	createHiZPipelineLayout();
+	mHiZPipelineId = shaderRegisterPipeline({ kHiZShaderPath }, createHiZPipeline);
+	mDepthSampler = cacheGetSampler(hlpGetSamplerCreateInfo(VK_FILTER_NEAREST, VK_FILTER_NEAREST));
+	mPipelineStatisticsEnabled = pipeline_statistics_enabled;
+	createSlots();
+
+	mQueue = queue;
+	mBuildCount = 0;
+	VKL_LOG("Occlusion culling: " << slot_count << " depth pyramids of " << mLayout.levelWidths.size() << " levels, "
+		<< (VK_NULL_HANDLE != mQueryPool ? "overdraw measured with pipeline statistics" : "overdraw not measured (pipeline statistics not enabled)"));
+}
+
+void occDestroyCulling()
+{
+	if (VK_NULL_HANDLE == mQueue) {
+		return;
+	}
+	const auto device = vklGetDevice();
+	destroySlots(device, mSlots, mDescriptorPool, mQueryPool);
+	cacheReleaseSampler(mDepthSampler);
+	vkDestroyPipelineLayout(device, mHiZPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, mHiZDescriptorSetLayout, nullptr);
+	vkDestroyPipelineLayout(device, mPrepassPipelineLayout, nullptr);
+	vkDestroyRenderPass(device, mCompatibleRenderPass, nullptr);
+	vkDestroyCommandPool(device, mCommandPool, nullptr);
+	mQueryPool = VK_NULL_HANDLE;
+	mDepthSampler = VK_NULL_HANDLE;
+	mDescriptorPool = VK_NULL_HANDLE;
+	mHiZPipelineLayout = VK_NULL_HANDLE;
+	mHiZDescriptorSetLayout = VK_NULL_HANDLE;
+	mPrepassPipelineLayout = VK_NULL_HANDLE;
+	mCompatibleRenderPass = VK_NULL_HANDLE;
+	mCommandPool = VK_NULL_HANDLE;
+	mQueue = VK_NULL_HANDLE;
+}
+
+uint32_t occRegisterMainPassPipeline(const std::string& vertex_shader_path, const std::string& fragment_shader_path, VkPipelineLayout pipeline_layout)
+{
+	if (VK_NULL_HANDLE == mQueue) {
+		VKL_EXIT_WITH_ERROR("Occlusion culling not initialized. Ensure to invoke occInitCulling beforehand!");
+	}
+	if (fragment_shader_path.empty()) {
+		VKL_EXIT_WITH_ERROR("A main pass pipeline requires a fragment shader.");
+	}
+	return shaderRegisterPipeline({ vertex_shader_path, fragment_shader_path }, [vertex_shader_path, fragment_shader_path, pipeline_layout]() {
+		return createDepthTestedPipeline(vertex_shader_path, fragment_shader_path, pipeline_layout);
+	});
+}
+
+void occRecordDepthPrepass(const OccPrepassDraw* draws, uint32_t draw_count)
+{
+	if (VK_NULL_HANDLE == mQueue) {
+		VKL_EXIT_WITH_ERROR("Occlusion culling not initialized. Ensure to invoke occInitCulling beforehand!");
+	}
+	VkCommandBuffer cb = vklGetCurrentCommandBuffer();
+	vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, shaderGetPipeline(mPrepassPipelineId));
+	VkViewport viewport = {};
+	viewport.width = static_cast<float>(mDepthExtent.width);
+	viewport.height = static_cast<float>(mDepthExtent.height);
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(cb, 0, 1, &viewport);
+	VkRect2D scissor = {};
+	scissor.extent = mDepthExtent;
+	vkCmdSetScissor(cb, 0, 1, &scissor);
+
+	VkBuffer bound_positions = VK_NULL_HANDLE;
+	VkBuffer bound_indices = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < draw_count; ++i) {
+		const OccPrepassDraw& draw = draws[i];
+		const HlpGeometryHandles& geometry = *draw.geometry;
+		if (geometry.positionsBuffer != bound_positions) {
+			const VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(cb, 0, 1, &geometry.positionsBuffer, &offset);
+			bound_positions = geometry.positionsBuffer;
+		}
+		if (geometry.indicesBuffer != bound_indices) {
+			vkCmdBindIndexBuffer(cb, geometry.indicesBuffer, 0, geometry.indexType);
+			bound_indices = geometry.indicesBuffer;
+		}
+		vkCmdPushConstants(cb, mPrepassPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &draw.clipFromObject);
+		const uint32_t index_count = 0u == draw.indexCount ? geometry.numberOfIndices : draw.indexCount;
+		vkCmdDrawIndexed(cb, index_count, 1u, draw.firstIndex, 0, 0u);
+	}
+}
+
+void occBeginOverdrawQuery()
+{
+	const uint32_t index = vklGetCurrentSwapChainImageIndex();
+	if (VK_NULL_HANDLE == mQueryPool || index >= mSlots.size() || mSlots[index].queryResetPending) {
+		return;
+	}
+	vkCmdBeginQuery(vklGetCurrentCommandBuffer(), mQueryPool, index, 0);
+}
+
+void occEndOverdrawQuery()
+{
+	const uint32_t index = vklGetCurrentSwapChainImageIndex();
+	if (VK_NULL_HANDLE == mQueryPool || index >= mSlots.size() || mSlots[index].queryResetPending) {
+		return;
+	}
+	vkCmdEndQuery(vklGetCurrentCommandBuffer(), mQueryPool, index);
+	mSlots[index].overdrawQueried = true;
+}
+
+void occBuildDepthPyramid(uint32_t swapchain_image_index)
+{
+	if (VK_NULL_HANDLE == mQueue) {
+		VKL_EXIT_WITH_ERROR("Occlusion culling not initialized. Ensure to invoke occInitCulling beforehand!");
+	}
+	if (swapchain_image_index >= mSlots.size()) {
+		VKL_EXIT_WITH_ERROR("Invalid swapchain image index " << swapchain_image_index << " for building a depth pyramid.");
+	}
+	const auto device = vklGetDevice();
+	Slot& slot = mSlots[swapchain_image_index];
+	const VkImage depth_image = mDepthImages[swapchain_image_index];
+
+	// The previous build into this slot has been submitted one swapchain cycle ago, i.e., it has usually finished:
+	VkResult result = vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+	VKL_CHECK_VULKAN_RESULT(result);
+	result = vkResetFences(device, 1, &slot.fence);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VkCommandBuffer cb = slot.commandBuffer;
+	vkBeginCommandBuffer(cb, &begin_info);
+	if (VK_NULL_HANDLE != mQueryPool && slot.queryResetPending) {
+		vkCmdResetQueryPool(cb, mQueryPool, swapchain_image_index, 1);
+	}
+	slot.queryResetPending = false;
+
+	// Wait for the frame's depth writes, which have been submitted before:
+	recordDepthBarrier(cb, depth_image, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// One dispatch per level, each reading the previous level (or the depth buffer):
+	vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, shaderGetPipeline(mHiZPipelineId));
+	vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mHiZPipelineLayout, 0, 1, &slot.descriptorSet, 0, nullptr);
+	const uint32_t level_count = static_cast<uint32_t>(mLayout.levelWidths.size());
+	for (uint32_t level = 0; level < level_count; ++level) {
+		HiZPushConstants push_constants = {};
+		push_constants.sourceOffset = 0 == level ? 0 : mLayout.levelOffsets[level - 1];
+		push_constants.sourceWidth = 0 == level ? mLayout.depthWidth : mLayout.levelWidths[level - 1];
+		push_constants.sourceHeight = 0 == level ? mLayout.depthHeight : mLayout.levelHeights[level - 1];
+		push_constants.destinationOffset = mLayout.levelOffsets[level];
+		push_constants.destinationWidth = mLayout.levelWidths[level];
+		push_constants.destinationHeight = mLayout.levelHeights[level];
+		push_constants.fromDepthBuffer = 0 == level ? 1u : 0u;
+		if (level > 0) {
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+		vkCmdPushConstants(cb, mHiZPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+		vkCmdDispatch(cb, (push_constants.destinationWidth + kHiZWorkgroupSize - 1) / kHiZWorkgroupSize,
+			(push_constants.destinationHeight + kHiZWorkgroupSize - 1) / kHiZWorkgroupSize, 1);
+	}
+
+	// Fetch this frame's overdraw query and reset it for its next use:
+	const bool overdraw_queried = slot.overdrawQueried;
+	if (overdraw_queried) {
+		vkCmdCopyQueryPoolResults(cb, mQueryPool, swapchain_image_index, 1, slot.buffer, mQueryResultOffset, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+		vkCmdResetQueryPool(cb, mQueryPool, swapchain_image_index, 1);
+		slot.overdrawQueried = false;
+	}
+
+	// Hand the depth buffer back to the next frame's render pass, and make the results visible to the host:
+	recordDepthBarrier(cb, depth_image, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	VkMemoryBarrier host_barrier = {};
+	host_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	host_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
+	result = vkEndCommandBuffer(cb);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to record depth pyramid command buffer with error: ") + std::to_string(result));
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &cb;
+	result = vkQueueSubmit(mQueue, 1, &submit_info, slot.fence);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to submit depth pyramid with error: ") + std::to_string(result));
+	}
+	slot.state = PyramidState::PENDING;
+	slot.buildNumber = ++mBuildCount;
+	slot.overdrawMeasured = overdraw_queried;
+}
+
+bool occGetLatestDepthPyramid(OccDepthPyramid& pyramid)
+{
+	if (VK_NULL_HANDLE == mQueue) {
+		return false;
+	}
+	const auto device = vklGetDevice();
+	const Slot* latest = nullptr;
+	for (Slot& slot : mSlots) {
+		if (PyramidState::PENDING == slot.state && VK_SUCCESS == vkGetFenceStatus(device, slot.fence)) {
+			slot.state = PyramidState::READY;
+		}
+		if (PyramidState::READY == slot.state && (nullptr == latest || slot.buildNumber > latest->buildNumber)) {
+			latest = &slot;
+		}
+	}
+	if (nullptr == latest) {
+		return false;
+	}
+
+	pyramid = mLayout;
+	pyramid.texels = static_cast<const float*>(latest->mappedMemory);
+	pyramid.overdraw = 0.0;
+	if (!latest->overdrawMeasured) {
+		return true;
+	}
+	const uint64_t fragment_shader_invocations = *reinterpret_cast<const uint64_t*>(static_cast<const uint8_t*>(latest->mappedMemory) + mQueryResultOffset);
+	pyramid.overdraw = static_cast<double>(fragment_shader_invocations) / (static_cast<double>(mLayout.depthWidth) * mLayout.depthHeight);
+	return true;
+}
+
+OccDepthPyramid occCreateDepthPyramidLayout(uint32_t depth_width, uint32_t depth_height)
+{
+	OccDepthPyramid pyramid = {};
+	pyramid.depthWidth = depth_width;
+	pyramid.depthHeight = depth_height;
+	uint32_t width = depth_width, height = depth_height;
+	do {
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		pyramid.levelWidths.push_back(width);
+		pyramid.levelHeights.push_back(height);
+		pyramid.levelOffsets.push_back(pyramid.texelCount);
+		pyramid.texelCount += width * height;
+	} while (width > 1 || height > 1);
+	return pyramid;
+}
+
+void occBuildDepthPyramidOnCpu(const float* depth, uint32_t depth_width, uint32_t depth_height, OccDepthPyramid& pyramid, std::vector<float>& texels)
+{
+	pyramid = occCreateDepthPyramidLayout(depth_width, depth_height);
+	texels.resize(pyramid.texelCount);
+	pyramid.texels = texels.data();
+
+	const uint32_t level_count = static_cast<uint32_t>(pyramid.levelWidths.size());
+	for (uint32_t level = 0; level < level_count; ++level) {
+		const float* source = 0 == level ? depth : texels.data() + pyramid.levelOffsets[level - 1];
+		const uint32_t source_width = 0 == level ? depth_width : pyramid.levelWidths[level - 1];
+		const uint32_t source_height = 0 == level ? depth_height : pyramid.levelHeights[level - 1];
+		float* destination = texels.data() + pyramid.levelOffsets[level];
+		const uint32_t width = pyramid.levelWidths[level];
+		jobParallelFor(pyramid.levelHeights[level], kPyramidRowGrainSize, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t y = begin; y < end; ++y) {
+				for (uint32_t x = 0; x < width; ++x) {
+					destination[static_cast<size_t>(y) * width + x] = farthestDepth(source, source_width, source_height, 2 * x, 2 * y);
+				}
+			}
+		});
+	}
+}
+
+OccVisibility occTestAabb(const OccDepthPyramid* pyramid, const glm::mat4& clip_from_object, const glm::vec3& aabb_min, const glm::vec3& aabb_max)
+{
+	// Project all eight corners. The box is outside the frustum if all of them are outside the same plane:
+	uint32_t outside_all_corners = 0x3F;
+	bool crosses_near_plane = false;
+	float min_x = std::numeric_limits<float>::max(), min_y = min_x, nearest_depth = min_x;
+	float max_x = -min_x, max_y = -min_x;
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		const glm::vec4 clip = clip_from_object * glm::vec4(
+			(corner & 1) ? aabb_max.x : aabb_min.x,
+			(corner & 2) ? aabb_max.y : aabb_min.y,
+			(corner & 4) ? aabb_max.z : aabb_min.z, 1.0f);
+		const uint32_t outside = (clip.x < -clip.w ? 0x1 : 0) | (clip.x > clip.w ? 0x2 : 0) | (clip.y < -clip.w ? 0x4 : 0)
+			| (clip.y > clip.w ? 0x8 : 0) | (clip.z < 0.0f ? 0x10 : 0) | (clip.z > clip.w ? 0x20 : 0);
+		outside_all_corners &= outside;
+		if (clip.z < 0.0f || clip.w <= 0.0f) {
+			crosses_near_plane = true;
+			continue;
+		}
+		const float inverse_w = 1.0f / clip.w;
+		min_x = std::min(min_x, clip.x * inverse_w);
+		max_x = std::max(max_x, clip.x * inverse_w);
+		min_y = std::min(min_y, clip.y * inverse_w);
+		max_y = std::max(max_y, clip.y * inverse_w);
+		nearest_depth = std::min(nearest_depth, clip.z * inverse_w);
+	}
+	if (0 != outside_all_corners) {
+		return OCC_VISIBILITY_OUTSIDE_FRUSTUM;
+	}
+	if (nullptr == pyramid || crosses_near_plane) {
+		return OCC_VISIBILITY_VISIBLE;
+	}
+
+	// Screen rectangle in pixels (y points down in Vulkan's normalized device coordinates, like rows in the depth buffer):
+	const float width = static_cast<float>(pyramid->depthWidth);
+	const float height = static_cast<float>(pyramid->depthHeight);
+	const uint32_t x0 = static_cast<uint32_t>(std::min(std::max((min_x * 0.5f + 0.5f) * width, 0.0f), width - 1.0f));
+	const uint32_t x1 = static_cast<uint32_t>(std::min(std::max((max_x * 0.5f + 0.5f) * width, 0.0f), width - 1.0f));
+	const uint32_t y0 = static_cast<uint32_t>(std::min(std::max((min_y * 0.5f + 0.5f) * height, 0.0f), height - 1.0f));
+	const uint32_t y1 = static_cast<uint32_t>(std::min(std::max((max_y * 0.5f + 0.5f) * height, 0.0f), height - 1.0f));
+
+	// The finest level at which the rectangle spans at most 2x2 texels; texels of level l are 2^(l+1) pixels wide:
+	const uint32_t level_count = static_cast<uint32_t>(pyramid->levelWidths.size());
+	uint32_t level = 0;
+	while (level + 1 < level_count && (((x1 >> (level + 1)) - (x0 >> (level + 1)) > 1) || ((y1 >> (level + 1)) - (y0 >> (level + 1)) > 1))) {
+		++level;
+	}
+	const uint32_t level_width = pyramid->levelWidths[level];
+	const float* texels = pyramid->texels + pyramid->levelOffsets[level];
+	float farthest_depth = 0.0f;
+	for (uint32_t y = y0 >> (level + 1); y <= (y1 >> (level + 1)); ++y) {
+		for (uint32_t x = x0 >> (level + 1); x <= (x1 >> (level + 1)); ++x) {
+			farthest_depth = std::max(farthest_depth, texels[static_cast<size_t>(y) * level_width + x]);
+		}
+	}
+	return nearest_depth > farthest_depth ? OCC_VISIBILITY_OCCLUDED : OCC_VISIBILITY_VISIBLE;
+}
+
+OccCullStats occCullInstances(const OccDepthPyramid* pyramid, const OccInstance* instances, uint32_t instance_count, uint8_t* visible)
+{
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<uint32_t> outside_frustum_count(0), occluded_count(0);
+	jobParallelFor(instance_count, kCullGrainSize, [&](uint32_t begin, uint32_t end) {
+		uint32_t outside_frustum = 0, occluded = 0;
+		for (uint32_t i = begin; i < end; ++i) {
+			const OccVisibility visibility = occTestAabb(pyramid, instances[i].clipFromObject, instances[i].aabbMin, instances[i].aabbMax);
+			outside_frustum += OCC_VISIBILITY_OUTSIDE_FRUSTUM == visibility ? 1 : 0;
+			occluded += OCC_VISIBILITY_OCCLUDED == visibility ? 1 : 0;
+			visible[i] = OCC_VISIBILITY_VISIBLE == visibility ? 1 : 0;
+		}
+		outside_frustum_count += outside_frustum;
+		occluded_count += occluded;
+	});
+
+	OccCullStats stats = {};
+	stats.instanceCount = instance_count;
+	stats.outsideFrustumCount = outside_frustum_count;
+	stats.occludedCount = occluded_count;
+	stats.depthPyramidAvailable = nullptr != pyramid;
+	stats.overdraw = nullptr != pyramid ? pyramid->overdraw : 0.0;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+void occLogStats(const OccCullStats& stats)
+{
+	const uint32_t drawn = stats.instanceCount - stats.outsideFrustumCount - stats.occludedCount;
+	VKL_LOG("Occlusion culling: " << drawn << " of " << stats.instanceCount << " instances drawn, " << stats.outsideFrustumCount
+		<< " outside the view frustum, " << stats.occludedCount << " occluded"
+		<< (stats.depthPyramidAvailable ? "" : " (no depth pyramid available yet)") << ", " << stats.milliseconds << " ms");
+	if (stats.overdraw > 0.0) {
+		VKL_LOG("  Overdraw: " << stats.overdraw << " fragment shader invocations per pixel");
+	}
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Occlusion Culling Struct Definitions
+// As a convention, their names start with `Occ`.
+/* --------------------------------------------- */
+
+/*!
+ * Hierarchical-Z pyramid of a depth buffer: every texel stores the farthest depth of the pixels it covers, so that
+ * anything behind it is hidden (with a VK_COMPARE_OP_LESS or VK_COMPARE_OP_LESS_OR_EQUAL depth test).
+ * Level 0 has half the depth buffer's size (rounded up), and every further level half of the previous one's, down to 1x1.
+ * Texel (x, y) of level l covers the pixels [x * 2^(l+1), (x + 1) * 2^(l+1)) x [y * 2^(l+1), (y + 1) * 2^(l+1)).
+ */
+struct OccDepthPyramid {
+	//! Size of the depth buffer which the pyramid has been built from
+	uint32_t depthWidth;
+	uint32_t depthHeight;
+
+	//! Per level: its size and the index of its first texel in texels; every level is stored row by row, starting at the top
+	std::vector<uint32_t> levelWidths;
+	std::vector<uint32_t> levelHeights;
+	std::vector<uint32_t> levelOffsets;
+	uint32_t texelCount;
+
+	//! The texels of all levels; points to memory which is owned by whoever has built the pyramid
+	const float* texels;
+
+	//! Fragment shader invocations per pixel in the frame whose depth buffer the pyramid has been built from;
+	//! 0 if they have not been measured (see occBeginOverdrawQuery)
+	double overdraw;
+};
+
+/*!
+ * An instance to be culled: the bounding box of its mesh, and the matrix which transforms it into clip space.
+ */
+struct OccInstance {
+	//! Projection matrix times view matrix times model matrix, following Vulkan's conventions (clip space z in [0, w])
+	glm::mat4 clipFromObject;
+
+	//! Object space bounding box
+	glm::vec3 aabbMin;
+	glm::vec3 aabbMax;
+};
+
+/*!
+ * Result of testing an instance's bounding box.
+ */
+enum OccVisibility {
+	OCC_VISIBILITY_VISIBLE = 0,
+	OCC_VISIBILITY_OUTSIDE_FRUSTUM = 1,
+	//! Inside the view frustum, but entirely behind the depth pyramid
+	OCC_VISIBILITY_OCCLUDED = 2,
+};
+
+/*!
+ * A draw of the depth-only pre-pass, see occRecordDepthPrepass.
+ */
+struct OccPrepassDraw {
+	//! Only positions (bound to binding 0) and indices are used. Must stay valid until the draw has been recorded.
+	const HlpGeometryHandles* geometry;
+
+	//! Range of indices to draw; an indexCount of 0 draws all of geometry's indices.
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	//! Projection matrix times view matrix times model matrix; passed to the vertex shader as push constant
+	glm::mat4 clipFromObject;
+};
+
+/*!
+ * Statistics of one invocation of occCullInstances.
+ */
+struct OccCullStats {
+	uint32_t instanceCount;
+	uint32_t outsideFrustumCount;
+	uint32_t occludedCount;
+
+	//! Whether a depth pyramid has been available; if not, instances have only been culled against the view frustum.
+	bool depthPyramidAvailable;
+
+	//! Overdraw of the frame whose depth buffer the pyramid has been built from, see OccDepthPyramid::overdraw
+	double overdraw;
+
+	double milliseconds;
+};
+
+/* --------------------------------------------- */
+// Occlusion Culling Function Definitions
+// As a convention, their names start with `occ`.
+/* --------------------------------------------- */
+
+/*!
+ *	Selects a depth format which can be used both as depth attachment and as sampled image (for building the depth pyramid).
+ *	Prefers VK_FORMAT_D32_SFLOAT.
+ */
+VkFormat occSelectDepthFormat(VkPhysicalDevice physical_device);
+
+/*!
+ *	Returns true if the physical device supports the pipelineStatisticsQuery feature. If so, enable it during device
+ *	creation to measure overdraw (see occBeginOverdrawQuery).
+ */
+bool occIsPipelineStatisticsSupported(VkPhysicalDevice physical_device);
+
+/*!
+ *	Creates one depth buffer per swapchain image, which can be passed to the framework through
+ *	occGetDepthAttachmentDetails. Their memory is allocated through the memory registry, which must have been
+ *	initialized before (see memInit); the framework does not need to be, which is why the device is passed explicitly.
+ *	@param	extent	The swapchain images' size
+ *	@param	format	Depth format, e.g., from occSelectDepthFormat
+ *	@param	count	Number of swapchain images
+ */
+void occCreateDepthBuffers(VkDevice device, VkExtent2D extent, VkFormat format, uint32_t count);
+
+/*!
+ *	Returns the details of a depth buffer for VklSwapchainFramebufferComposition::depthAttachmentImageDetails.
+ *	It is cleared to a depth of 1.
+ *	@param	index	Index of the swapchain image which the depth buffer belongs to
+ */
+VklSwapchainImageDetails occGetDepthAttachmentDetails(uint32_t index);
+
+/*!
+ *	Destroys the depth buffers. Invoke occDestroyCulling beforehand if it has been initialized.
+ */
+void occDestroyDepthBuffers(VkDevice device);
+
+/*!
+ *	Replaces the depth buffers after the swapchain has been recreated, e.g., because the window has been resized, along
+ *	with the depth pyramids' resources if culling has been initialized. The old ones are destroyed immediately, so the GPU
+ *	must not use them anymore, e.g., wait for the queue to become idle before. Pyramids of the new size are available after
+ *	the next builds (see occGetLatestDepthPyramid).
+ *	@param	extent	The new swapchain images' size
+ *	@param	count	Number of new swapchain images
+ */
+void occRecreateDepthBuffers(VkDevice device, VkExtent2D extent, uint32_t count);
+
+/*!
+ *	Creates the resources of the depth pre-pass, of the depth pyramid (whose compute shader is
+ *	assets/shaders/hiz_downsample.comp), and of the overdraw queries. Invoke it after vklInitFramework, occCreateDepthBuffers,
+ *	and shaderInitManager: both pipelines are registered with the shader manager, i.e., they are rebuilt when their shaders
+ *	change and destroyed by shaderDestroyManager.
+ *	Overdraw queries are reset by the first pyramid build of every swapchain image, i.e., measuring starts with the next frame.
+ *	@param	queue							The queue which the framework submits to; it must support compute.
+ *	@param	queue_family_index				The queue's family
+ *	@param	color_format					The swapchain images' format, for creating a pipeline which is compatible with the framework's render pass
+ *	@param	cull_mode						Face culling of the pre-pass; must match the main pass's so that both produce the same depth.
+ *	@param	front_face						Front face orientation of the pre-pass; must match the main pass's.
+ *	@param	pipeline_statistics_enabled		True if the pipelineStatisticsQuery feature has been enabled during device creation
+ *											(see occIsPipelineStatisticsSupported). Otherwise, overdraw is not measured.
+ */
+void occInitCulling(VkQueue queue, uint32_t queue_family_index, VkFormat color_format, VkCullModeFlags cull_mode, VkFrontFace front_face, bool pipeline_statistics_enabled);
+
+/*!
+ *	Waits for all depth pyramids that are being built and destroys the resources created by occInitCulling,
+ *	except for the pipelines, which shaderDestroyManager destroys.
+ */
+void occDestroyCulling();
+
+/*!
+ *	Records the optional depth-only pre-pass into the current command buffer, at the start of the framework's render pass:
+ *	the draws only write depth, without a fragment shader. Afterwards, every pixel is shaded only once if the main pass
+ *	tests depth with VK_COMPARE_OP_LESS_OR_EQUAL (or VK_COMPARE_OP_EQUAL) and the same geometry and matrices.
+ *	Pays off for scenes with much overdraw and expensive fragment shaders.
+ */
+void occRecordDepthPrepass(const OccPrepassDraw* draws, uint32_t draw_count);
+
+/*!
+ *	Registers a pipeline for the main pass which shades exactly the surfaces the depth pre-pass has left in the depth buffer:
+ *	it has the pre-pass's vertex input (positions at binding 0), rasterization state, and dynamic viewport and scissor
+ *	(set by occRecordDepthPrepass), tests depth with VK_COMPARE_OP_LESS_OR_EQUAL, and does not write depth.
+ *	Invoke it after occInitCulling; shaderDestroyManager destroys the pipeline.
+ *	@param	vertex_shader_path		Must compute gl_Position like assets/shaders/depth_prepass.vert, i.e., from the same
+ *									clipFromObject push constant and declared invariant, e.g., assets/shaders/scene.vert.
+ *	@param	fragment_shader_path	The fragment shader, e.g., assets/shaders/scene.frag
+ *	@param	pipeline_layout			Must contain a push constant range for the vertex stage with the glm::mat4 clipFromObject at offset 0
+ *	@return	An identifier to get the pipeline's current version with shaderGetPipeline
+ */
+uint32_t occRegisterMainPassPipeline(const std::string& vertex_shader_path, const std::string& fragment_shader_path, VkPipelineLayout pipeline_layout);
+
+/*!
+ *	Starts counting fragment shader invocations in the current command buffer, within the framework's render pass.
+ *	Invoke occEndOverdrawQuery before the render pass ends. The count, divided by the number of pixels, ends up in
+ *	OccDepthPyramid::overdraw of the pyramid which is built from this frame's depth buffer.
+ *	Does nothing unless pipeline statistics have been enabled (see occInitCulling).
+ */
+void occBeginOverdrawQuery();
+
+/*!
+ *	Stops counting fragment shader invocations, see occBeginOverdrawQuery.
+ */
+void occEndOverdrawQuery();
+
+/*!
+ *	Builds the depth pyramid of a swapchain image's depth buffer with a compute shader, into host-visible memory.
+ *	Invoke it after the frame's commands have been submitted; it is submitted to the same queue, after them.
+ *	Building happens asynchronously, i.e., the result is available through occGetLatestDepthPyramid in one of the next frames.
+ *	Expects the framework's render pass to leave the depth buffer in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+ *	@param	swapchain_image_index	Index of the swapchain image which has just been rendered
+ */
+void occBuildDepthPyramid(uint32_t swapchain_image_index);
+
+/*!
+ *	Returns the most recently built depth pyramid whose computation has finished on the GPU, without waiting.
+ *	Its texels stay valid until occBuildDepthPyramid is invoked for the same swapchain image again.
+ *	@return	False if no pyramid is available yet
+ */
+bool occGetLatestDepthPyramid(OccDepthPyramid& pyramid);
+
+/*!
+ *	Computes the layout of the depth pyramid of a depth buffer with the given size. Texels are not assigned.
+ */
+OccDepthPyramid occCreateDepthPyramidLayout(uint32_t depth_width, uint32_t depth_height);
+
+/*!
+ *	Builds a depth pyramid on the CPU, e.g., from the depth buffer of the software rasterizer (see RasterTarget).
+ *	Produces the same texels as the compute shader. The rows of level 0 are spread across the job system's workers.
+ *	@param	depth		Depth values in [0, 1], row by row starting at the top
+ *	@param	pyramid		Receives the pyramid, whose texels point into texels
+ *	@param	texels		Storage for the texels, resized as necessary
+ */
+void occBuildDepthPyramidOnCpu(const float* depth, uint32_t depth_width, uint32_t depth_height, OccDepthPyramid& pyramid, std::vector<float>& texels);
+
+/*!
+ *	Tests a bounding box against the view frustum and, conservatively, against a depth pyramid: the box is projected
+ *	onto the screen, and its nearest depth is compared against the up to 2x2 texels of the finest level at which
+ *	its screen rectangle spans at most two texels per axis. Boxes which cross the near plane are always visible.
+ *	@param	pyramid		May be nullptr, in which case only the view frustum is tested.
+ */
+OccVisibility occTestAabb(const OccDepthPyramid* pyramid, const glm::mat4& clip_from_object, const glm::vec3& aabb_min, const glm::vec3& aabb_max);
+
+/*!
+ *	Tests many instances with occTestAabb, spread across the job system's workers.
+ *	Since the pyramid stems from a previous frame, instances which have just become visible may be culled for a frame
+ *	or two; instances which have just become hidden are drawn until the pyramid catches up.
+ *	@param	pyramid		May be nullptr, e.g., if occGetLatestDepthPyramid has failed.
+ *	@param	visible		Receives 1 per instance which needs to be drawn, 0 otherwise
+ *	@return	Counts of culled instances
+ */
+OccCullStats occCullInstances(const OccDepthPyramid* pyramid, const OccInstance* instances, uint32_t instance_count, uint8_t* visible);
+
+/*!
+ *	Logs the given statistics.
+ */
+void occLogStats(const OccCullStats& stats);
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Residency.h"
+#include "JobSystem.h"
+#include "TransferStream.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+	enum class CellState {
+		Unloaded,
+		//! A job loads the mesh file into host memory.
+		Loading,
+		//! In host memory, waiting for budget to be uploaded
+		Loaded,
+		//! The transfer stream uploads the buffers.
+		Uploading,
+		Resident
+	};
+
+	struct Cell {
+		ResidencyCellDesc desc;
+		CellState state;
+		JobHandle loadJob;
+		//! Geometry loaded from desc.meshPath
+		VklGeometryData loadedGeometry;
+		StreamGeometryBuffers buffers;
+		VkDeviceSize bytes;
+		uint64_t lastUsedFrame;
+		//! When the cell was first requested since it has last been unloaded, for measuring pop-in latency
+		std::chrono::steady_clock::time_point requestTime;
+		uint64_t lastRequestedFrame;
+	};
+
+	ResidencyConfig mConfig = {};
+	std::vector<Cell> mCells;
+	std::vector<std::pair<StreamGeometryBuffers, uint64_t>> mRetiredBuffers;
+	uint64_t mFrameIndex = 0;
+	ResidencyStats mStats = {};
+
+	const VklGeometryData& geometryOf(const Cell& cell)
+	{
+		return cell.desc.meshPath.empty() ? cell.desc.geometry : cell.loadedGeometry;
+	}
+
+	VkDeviceSize bytesOf(const VklGeometryData& geometry)
+	{
+		return sizeof(glm::vec3) * (geometry.positions.size() + geometry.normals.size())
+			+ sizeof(glm::vec2) * geometry.textureCoordinates.size() + sizeof(uint32_t) * geometry.indices.size();
+	}
+
+	float distanceToBounds(const glm::vec3& position, const Cell& cell)
+	{
+		const glm::vec3 closest = glm::max(cell.desc.boundsMin, glm::min(position, cell.desc.boundsMax));
+		return glm::distance(position, closest);
+	}
+
+	void evict(Cell& cell)
+	{
+		// Frames in flight might still draw the cell => destroy its buffers later:
+		mRetiredBuffers.emplace_back(cell.buffers, mFrameIndex);
+		cell.buffers = StreamGeometryBuffers{};
+		mStats.usedBytes -= cell.bytes;
+		cell.bytes = 0;
+		if (!cell.desc.meshPath.empty()) {
+			cell.loadedGeometry = VklGeometryData{};
+		}
+		cell.state = CellState::Unloaded;
+		++mStats.evictions;
+	}
+
+	// Evicts least recently used cells which are not in use this frame until `bytes` more fit into the budget
+	bool makeRoom(VkDeviceSize bytes)
+	{
+		while (mStats.usedBytes + bytes > mConfig.memoryBudget) {
+			Cell* victim = nullptr;
+			for (Cell& cell : mCells) {
+				if (CellState::Resident == cell.state && cell.lastUsedFrame < mFrameIndex
+					&& (nullptr == victim || cell.lastUsedFrame < victim->lastUsedFrame)) {
+					victim = &cell;
+				}
+			}
+			if (nullptr == victim) {
+				++mStats.budgetDeferrals;
+				return false;
+			}
+			evict(*victim);
+		}
+		return true;
+	}
+
+	bool startUpload(Cell& cell)
+	{
+		const VkDeviceSize bytes = bytesOf(geometryOf(cell));
+		if (!makeRoom(bytes)) {
+			return false;
+		}
+		cell.buffers = streamCreateGeometryAndBuffers(geometryOf(cell));
+		cell.bytes = bytes;
+		mStats.usedBytes += bytes;
+		cell.state = CellState::Uploading;
+		return true;
+	}
+}
+
+/* --------------------------------------------- */
+// Residency Function Definitions
+/* --------------------------------------------- */
+
+std::vector<ResidencyCellDesc> residencySplitIntoCells(const VklGeometryData& scene, float cell_size)
+{
+	if (!(cell_size > 0.0f)) {
+		VKL_EXIT_WITH_ERROR("Cell size must be positive.");
+	}
+
+	// Cells by their grid coordinates, each with a map from scene vertex indices to cell vertex indices:
+	std::map<std::tuple<int, int, int>, std::pair<ResidencyCellDesc, std::unordered_map<uint32_t, uint32_t>>> cells;
+	for (size_t t = 0; t + 2 < scene.indices.size(); t += 3) {
+		const glm::vec3 centroid = (scene.positions[scene.indices[t]] + scene.positions[scene.indices[t + 1]] + scene.positions[scene.indices[t + 2]]) / 3.0f;
+		const auto coordinates = std::make_tuple(
+			static_cast<int>(std::floor(centroid.x / cell_size)),
+			static_cast<int>(std::floor(centroid.y / cell_size)),
+			static_cast<int>(std::floor(centroid.z / cell_size)));
+
+		auto inserted = cells.emplace(coordinates, std::pair<ResidencyCellDesc, std::unordered_map<uint32_t, uint32_t>>{});
+		ResidencyCellDesc& cell = inserted.first->second.first;
+		std::unordered_map<uint32_t, uint32_t>& remap = inserted.first->second.second;
+		if (inserted.second) {
+			cell.boundsMin = scene.positions[scene.indices[t]];
+			cell.boundsMax = cell.boundsMin;
+		}
+
+		for (size_t corner = t; corner < t + 3; ++corner) {
+			const uint32_t index = scene.indices[corner];
+			const auto mapped = remap.emplace(index, static_cast<uint32_t>(cell.geometry.positions.size()));
+			if (mapped.second) {
+				const glm::vec3& position = scene.positions[index];
+				cell.geometry.positions.push_back(position);
+				cell.boundsMin = glm::min(cell.boundsMin, position);
+				cell.boundsMax = glm::max(cell.boundsMax, position);
+				if (index < scene.normals.size()) {
+					cell.geometry.normals.push_back(scene.normals[index]);
+				}
+				if (index < scene.textureCoordinates.size()) {
+					cell.geometry.textureCoordinates.push_back(scene.textureCoordinates[index]);
+				}
+			}
+			cell.geometry.indices.push_back(mapped.first->second);
+		}
+	}
+
+	std::vector<ResidencyCellDesc> result;
+	result.reserve(cells.size());
+	for (auto& cell : cells) {
+		result.push_back(std::move(cell.second.first));
+	}
+	return result;
+}
+
+void residencyInit(const ResidencyConfig& config, std::vector<ResidencyCellDesc> cells)
+{
+	mConfig = config;
+	mConfig.maxConcurrentLoads = std::max(mConfig.maxConcurrentLoads, 1u);
+	mFrameIndex = 0;
+	mStats = {};
+	mStats.memoryBudget = config.memoryBudget;
+	mStats.cellCount = static_cast<uint32_t>(cells.size());
+	mCells.clear();
+	mCells.resize(cells.size());
+	for (size_t i = 0; i < cells.size(); ++i) {
+		mCells[i].desc = std::move(cells[i]);
+		mCells[i].state = CellState::Unloaded;
+	}
+}
+
+void residencyDestroy()
+{
+	for (Cell& cell : mCells) {
+		if (CellState::Loading == cell.state) {
+			jobWait(cell.loadJob);
+		}
+		if (CellState::Uploading == cell.state || CellState::Resident == cell.state) {
+			streamDestroyBuffers(cell.buffers);
+		}
+	}
+	for (const auto& retired : mRetiredBuffers) {
+		streamDestroyBuffers(retired.first);
+	}
+	mRetiredBuffers.clear();
+	mCells.clear();
+}
+
+void residencyUpdate(const glm::vec3& camera_position)
+{
+	++mFrameIndex;
+	const auto now = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < mRetiredBuffers.size();) {
+		if (mFrameIndex - mRetiredBuffers[i].second > mConfig.framesInFlight) {
+			streamDestroyBuffers(mRetiredBuffers[i].first);
+			mRetiredBuffers[i] = mRetiredBuffers.back();
+			mRetiredBuffers.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+
+	// Mark cells in use and collect the ones to request:
+	const float keep_distance = mConfig.loadDistance * (1.0f + mConfig.hysteresis);
+	std::vector<std::pair<float, uint32_t>> requested;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mCells.size()); ++i) {
+		Cell& cell = mCells[i];
+		const float distance = distanceToBounds(camera_position, cell);
+		if (CellState::Unloaded == cell.state) {
+			if (distance <= mConfig.loadDistance) {
+				// Requests which have to wait (for budget or a free slot) keep their original request time:
+				if (0 == cell.lastRequestedFrame || cell.lastRequestedFrame + 1 < mFrameIndex) {
+					cell.requestTime = now;
+				}
+				cell.lastRequestedFrame = mFrameIndex;
+				requested.emplace_back(distance, i);
+			}
+		}
+		else if (distance <= keep_distance) {
+			cell.lastUsedFrame = mFrameIndex;
+		}
+	}
+
+	// Advance cells in flight:
+	uint32_t in_flight = 0;
+	for (Cell& cell : mCells) {
+		if (CellState::Loading == cell.state && jobIsFinished(cell.loadJob)) {
+			cell.loadJob.reset();
+			cell.state = CellState::Loaded;
+		}
+		if (CellState::Loaded == cell.state && !startUpload(cell) && cell.lastUsedFrame < mFrameIndex) {
+			// No room, and not needed anymore:
+			cell.loadedGeometry = VklGeometryData{};
+			cell.state = CellState::Unloaded;
+		}
+		if (CellState::Uploading == cell.state && streamIsReady(cell.buffers.ticket)) {
+			cell.state = CellState::Resident;
+			const double pop_in_milliseconds = std::chrono::duration<double, std::milli>(now - cell.requestTime).count();
+			mStats.popInMillisecondsTotal += pop_in_milliseconds;
+			mStats.popInMillisecondsMax = std::max(mStats.popInMillisecondsMax, pop_in_milliseconds);
+			++mStats.loads;
+		}
+		if (CellState::Loading == cell.state || CellState::Loaded == cell.state || CellState::Uploading == cell.state) {
+			++in_flight;
+		}
+	}
+
+	// Request the nearest cells first:
+	std::sort(requested.begin(), requested.end());
+	for (const auto& request : requested) {
+		if (in_flight >= mConfig.maxConcurrentLoads) {
+			break;
+		}
+		Cell& cell = mCells[request.second];
+		cell.lastUsedFrame = mFrameIndex;
+		if (cell.desc.meshPath.empty()) {
+			if (!startUpload(cell)) {
+				break; // Farther cells will not fit either
+			}
+		}
+		else {
+			Cell* cell_pointer = &cell;
+			cell.loadJob = jobSubmit([cell_pointer] { cell_pointer->loadedGeometry = vklLoadModelGeometry(cell_pointer->desc.meshPath); });
+			cell.state = CellState::Loading;
+		}
+		++in_flight;
+	}
+
+	mStats.residentCells = 0;
+	mStats.loadingCells = 0;
+	for (const Cell& cell : mCells) {
+		mStats.residentCells += CellState::Resident == cell.state ? 1u : 0u;
+		mStats.loadingCells += CellState::Loading == cell.state || CellState::Loaded == cell.state || CellState::Uploading == cell.state ? 1u : 0u;
+	}
+}
+
+uint32_t residencyGetCellCount()
+{
+	return static_cast<uint32_t>(mCells.size());
+}
+
+const HlpGeometryHandles* residencyGetGeometry(uint32_t cell_index)
+{
+	const Cell& cell = mCells.at(cell_index);
+	return CellState::Resident == cell.state ? &cell.buffers.handles : nullptr;
+}
+
+ResidencyStats residencyGetStats()
+{
+	return mStats;
+}
+
+void residencyLogStats()
+{
+	VKL_LOG("Residency: " << mStats.usedBytes / (1024 * 1024) << " of " << mStats.memoryBudget / (1024 * 1024) << " MiB used ("
+		<< (mStats.memoryBudget > 0 ? 100.0 * static_cast<double>(mStats.usedBytes) / static_cast<double>(mStats.memoryBudget) : 0.0) << " %), "
+		<< mStats.residentCells << "/" << mStats.cellCount << " cells resident, " << mStats.loadingCells << " loading, "
+		<< mStats.loads << " loads, " << mStats.evictions << " evictions, " << mStats.budgetDeferrals << " deferrals due to the budget");
+	VKL_LOG("  Pop-in latency: " << (mStats.loads > 0 ? mStats.popInMillisecondsTotal / static_cast<double>(mStats.loads) : 0.0)
+		<< " ms average, " << mStats.popInMillisecondsMax << " ms maximum");
+}
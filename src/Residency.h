@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Residency Struct Definitions
+// As a convention, their names start with `Residency`.
+/* --------------------------------------------- */
+
+/*!
+ * One spatial cell of a scene whose geometry is loaded into GPU memory only while the camera is close to it.
+ */
+struct ResidencyCellDesc {
+	//! Axis-aligned bounds of the cell's geometry in world space
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	//! If not empty, the cell's geometry is loaded from this OBJ file by a job whenever the cell becomes
+	//! resident and released from host memory when it is evicted. Otherwise, `geometry` is used.
+	std::string meshPath;
+
+	//! Geometry which stays in host memory and is only uploaded, e.g., from residencySplitIntoCells
+	VklGeometryData geometry;
+};
+
+/*!
+ * Configuration of the residency manager.
+ */
+struct ResidencyConfig {
+	//! Cells closer to the camera than this are loaded.
+	float loadDistance;
+
+	//! Resident cells count as in use until they are farther away than loadDistance * (1 + hysteresis),
+	//! so that cells at the boundary are not loaded and evicted over and over.
+	float hysteresis;
+
+	//! GPU memory for cell geometry. When it is exceeded, the least recently used cells are evicted.
+	VkDeviceSize memoryBudget;
+
+	//! Maximum number of cells being loaded or uploaded at the same time
+	uint32_t maxConcurrentLoads;
+
+	//! Evicted cells' buffers are destroyed after this many residencyUpdate invocations, e.g., vklGetNumFramebuffers().
+	uint32_t framesInFlight;
+};
+
+/*!
+ * Statistics of the residency manager.
+ */
+struct ResidencyStats {
+	VkDeviceSize memoryBudget;
+
+	//! GPU memory of resident cells and of cells being uploaded
+	VkDeviceSize usedBytes;
+
+	uint32_t cellCount;
+	uint32_t residentCells;
+	uint32_t loadingCells;
+
+	uint64_t loads;
+	uint64_t evictions;
+
+	//! Number of times a cell could not be loaded because all resident cells were in use and the budget was exhausted
+	uint64_t budgetDeferrals;
+
+	//! Time from a cell being requested until it became resident
+	double popInMillisecondsTotal;
+	double popInMillisecondsMax;
+};
+
+/* --------------------------------------------- */
+// Residency Function Definitions
+// As a convention, their names start with `residency`.
+/* --------------------------------------------- */
+
+/*!
+ *	Splits a scene's triangles into cells of a regular grid by their centroids. Each cell gets its own
+ *	vertices (only those its triangles reference) and the bounds of its triangles.
+ *	@param	scene		Geometry of the whole scene, e.g., from vklLoadModelGeometry
+ *	@param	cell_size	Edge length of the grid's cubic cells in world units
+ *	@return	The non-empty cells
+ */
+std::vector<ResidencyCellDesc> residencySplitIntoCells(const VklGeometryData& scene, float cell_size);
+
+/*!
+ *	Initializes the residency manager. Requires jobInitSystem (for loading meshes from files) and streamInit
+ *	(for uploading) to have been invoked before. No cell is resident until the first residencyUpdate.
+ */
+void residencyInit(const ResidencyConfig& config, std::vector<ResidencyCellDesc> cells);
+
+/*!
+ *	Waits for loads in flight and destroys all cells' buffers. The GPU must not use them anymore.
+ */
+void residencyDestroy();
+
+/*!
+ *	Invoke once per frame after streamBeginFrame: requests cells close to the camera (nearest first), evicts least
+ *	recently used cells if the budget requires it, starts uploads of loaded cells, and marks uploaded cells resident.
+ */
+void residencyUpdate(const glm::vec3& camera_position);
+
+/*!
+ *	Returns the number of cells.
+ */
+uint32_t residencyGetCellCount();
+
+/*!
+ *	Returns the geometry of a resident cell, or nullptr if the cell is not resident (draw a placeholder or nothing).
+ *	The pointer stays valid until the next residencyUpdate.
+ */
+const HlpGeometryHandles* residencyGetGeometry(uint32_t cell_index);
+
+/*!
+ *	Returns the current statistics.
+ */
+ResidencyStats residencyGetStats();
+
+/*!
+ *	Logs budget usage, resident and loading cells, loads, evictions, and pop-in latencies.
+ */
+void residencyLogStats();
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "ShaderManager.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// Set by CMake if glslc has been found; otherwise it must be on the PATH.
+#ifndef SHADER_GLSLC_EXECUTABLE
+#define SHADER_GLSLC_EXECUTABLE "glslc"
+#endif
+
+namespace
+{
+	constexpr uint32_t kSpirvMagicNumber = 0x07230203u;
+	constexpr auto kWatchInterval = std::chrono::milliseconds(250);
+
+	struct PipelineEntry {
+		std::vector<std::string> shaderPaths;
+		ShaderPipelineBuilder build;
+		ShaderPipelineDestroyer destroy;
+		//! Only accessed by the render thread
+		VkPipeline current;
+	};
+
+	struct RetiredPipeline {
+		VkPipeline pipeline;
+		ShaderPipelineDestroyer destroy;
+		uint64_t retiredInFrame;
+	};
+
+	std::filesystem::path mCacheDirectory;
+	uint32_t mFramesInFlight = 0;
+	uint64_t mFrameIndex = 0;
+
+	//! Guards mPipelines and mPendingPipelines
+	std::mutex mRegistryMutex;
+	std::deque<PipelineEntry> mPipelines;
+	std::vector<std::pair<uint32_t, VkPipeline>> mPendingPipelines;
+	std::vector<RetiredPipeline> mRetiredPipelines;
+
+	std::mutex mStatsMutex;
+	ShaderStats mStats = {};
+
+	std::thread mWatcherThread;
+	std::mutex mWatcherMutex;
+	std::condition_variable mWatcherCondition;
+	bool mStopWatcher = false;
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool readFile(const std::filesystem::path& path, std::string& contents)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream) {
+			return false;
+		}
+		contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Hash of everything that determines the SPIR-V: source, stage (from the extension), and compiler
+	uint64_t hashSource(const std::filesystem::path& glsl_path, const std::string& source)
+	{
+		const std::string extension = glsl_path.extension().string();
+		const char* compiler = SHADER_GLSLC_EXECUTABLE;
+		const uint64_t hash = hashFnv1a(extension.data(), extension.size(), hashFnv1a(source.data(), source.size()));
+		return hashFnv1a(compiler, strlen(compiler), hash);
+	}
+
+	std::string quote(const std::string& s)
+	{
+		return "\"" + s + "\"";
+	}
+
+	std::vector<uint32_t> loadSpirv(const std::filesystem::path& spirv_path)
+	{
+		std::string bytes;
+		if (!readFile(spirv_path, bytes) || bytes.size() < sizeof(uint32_t) || 0 != bytes.size() % sizeof(uint32_t)) {
+			return {};
+		}
+		std::vector<uint32_t> code(bytes.size() / sizeof(uint32_t));
+		std::memcpy(code.data(), bytes.data(), bytes.size());
+		if (kSpirvMagicNumber != code[0]) {
+			return {};
+		}
+		return code;
+	}
+
+	// Recompiles changed shader files and rebuilds the pipelines which use them
+	void watchShaderFiles()
+	{
+		std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+		std::unordered_map<std::string, uint64_t> source_hashes;
+
+		std::unique_lock<std::mutex> watcher_lock(mWatcherMutex);
+		while (!mWatcherCondition.wait_for(watcher_lock, kWatchInterval, [] { return mStopWatcher; })) {
+			std::vector<std::pair<uint32_t, PipelineEntry>> pipelines;
+			{
+				std::lock_guard<std::mutex> lock(mRegistryMutex);
+				for (uint32_t id = 0; id < static_cast<uint32_t>(mPipelines.size()); ++id) {
+					pipelines.emplace_back(id, PipelineEntry{ mPipelines[id].shaderPaths, mPipelines[id].build, mPipelines[id].destroy, VK_NULL_HANDLE });
+				}
+			}
+
+			std::unordered_set<std::string> checked_paths;
+			std::unordered_set<std::string> changed_paths;
+			for (const auto& pipeline : pipelines) {
+				for (const std::string& path : pipeline.second.shaderPaths) {
+					if (!checked_paths.insert(path).second) {
+						continue;
+					}
+					std::error_code error;
+					const auto write_time = std::filesystem::last_write_time(path, error);
+					if (error) {
+						continue; // E.g., while an editor replaces the file
+					}
+					const auto known = write_times.find(path);
+					const bool first_check = known == write_times.end();
+					if (!first_check && known->second == write_time) {
+						continue;
+					}
+					write_times[path] = write_time;
+
+					std::string source;
+					if (!readFile(path, source)) {
+						continue;
+					}
+					const uint64_t source_hash = hashSource(path, source);
+					// Editors may touch files without changing them:
+					const bool unchanged = source_hashes.count(path) > 0 && source_hashes[path] == source_hash;
+					source_hashes[path] = source_hash;
+					if (first_check || unchanged) {
+						continue;
+					}
+
+					VKL_LOG("Shader file " << path << " changed.");
+					if (shaderGetSpirv(path).empty()) {
+						VKL_LOG("Keeping the previous pipelines of " << path << " until it compiles.");
+						continue;
+					}
+					changed_paths.insert(path);
+				}
+			}
+			if (changed_paths.empty()) {
+				continue;
+			}
+
+			for (const auto& pipeline : pipelines) {
+				const std::vector<std::string>& paths = pipeline.second.shaderPaths;
+				if (std::none_of(paths.begin(), paths.end(), [&changed_paths](const std::string& path) { return changed_paths.count(path) > 0; })) {
+					continue;
+				}
+				const auto start = std::chrono::steady_clock::now();
+				const VkPipeline rebuilt = pipeline.second.build();
+				const double milliseconds = millisecondsSince(start);
+				if (VK_NULL_HANDLE == rebuilt) {
+					VKL_LOG("Rebuilding pipeline " << pipeline.first << " failed; keeping the previous one.");
+					continue;
+				}
+				VKL_LOG("Rebuilt pipeline " << pipeline.first << " in " << milliseconds << " ms; swapping it in at the next frame.");
+				{
+					std::lock_guard<std::mutex> lock(mStatsMutex);
+					++mStats.pipelineRebuilds;
+					mStats.rebuildMilliseconds += milliseconds;
+				}
+				std::lock_guard<std::mutex> lock(mRegistryMutex);
+				// A previous rebuild might not have been swapped in yet => replace it right away, no frame can use it:
+				for (auto& pending : mPendingPipelines) {
+					if (pending.first == pipeline.first && VK_NULL_HANDLE != pending.second) {
+						mPipelines[pipeline.first].destroy(pending.second);
+						pending.second = VK_NULL_HANDLE;
+					}
+				}
+				mPendingPipelines.emplace_back(pipeline.first, rebuilt);
+			}
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// Shader Manager Function Definitions
+/* --------------------------------------------- */
+
+void shaderInitManager(uint32_t frames_in_flight, const std::string& cache_directory)
+{
+	if (mWatcherThread.joinable()) {
+		VKL_EXIT_WITH_ERROR("Shader manager already initialized.");
+	}
+	mFramesInFlight = std::max(frames_in_flight, 1u);
+	mFrameIndex = 0;
+	mCacheDirectory = cache_directory;
+	std::error_code error;
+	std::filesystem::create_directories(mCacheDirectory, error);
+	if (error) {
+		VKL_EXIT_WITH_ERROR("Failed to create shader cache directory " << cache_directory << ": " << error.message());
+	}
+	mStats = {};
+	mStopWatcher = false;
+	mWatcherThread = std::thread(watchShaderFiles);
+}
+
+void shaderDestroyManager()
+{
+	{
+		std::lock_guard<std::mutex> lock(mWatcherMutex);
+		mStopWatcher = true;
+	}
+	mWatcherCondition.notify_all();
+	if (mWatcherThread.joinable()) {
+		mWatcherThread.join();
+	}
+
+	for (const RetiredPipeline& retired : mRetiredPipelines) {
+		retired.destroy(retired.pipeline);
+	}
+	mRetiredPipelines.clear();
+	for (const auto& pending : mPendingPipelines) {
+		if (VK_NULL_HANDLE != pending.second) {
+			mPipelines[pending.first].destroy(pending.second);
+		}
+	}
+	mPendingPipelines.clear();
+	for (const PipelineEntry& entry : mPipelines) {
+		entry.destroy(entry.current);
+	}
+	mPipelines.clear();
+}
+
+std::vector<uint32_t> shaderGetSpirv(const std::string& glsl_path)
+{
+	if (mCacheDirectory.empty()) {
+		VKL_EXIT_WITH_ERROR("Shader manager not initialized. Ensure to invoke shaderInitManager beforehand!");
+	}
+	std::string source;
+	if (!readFile(glsl_path, source)) {
+		VKL_LOG("Failed to read shader file " << glsl_path);
+		return {};
+	}
+
+	std::ostringstream file_name;
+	file_name << std::hex << hashSource(glsl_path, source) << ".spv";
+	const std::filesystem::path spirv_path = mCacheDirectory / file_name.str();
+
+	std::vector<uint32_t> code = loadSpirv(spirv_path);
+	if (!code.empty()) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		++mStats.cacheHits;
+		return code;
+	}
+
+	// Compile into a temporary file first, so that concurrent readers never see partial binaries:
+	std::ostringstream temporary_name;
+	temporary_name << file_name.str() << "." << std::this_thread::get_id() << ".tmp";
+	const std::filesystem::path temporary_path = mCacheDirectory / temporary_name.str();
+	std::string command = quote(SHADER_GLSLC_EXECUTABLE) + " " + quote(glsl_path) + " -o " + quote(temporary_path.string());
+#if defined(_WIN32)
+	// cmd.exe strips the outermost quotes:
+	command = quote(command);
+#endif
+
+	const auto start = std::chrono::steady_clock::now();
+	const int exit_code = std::system(command.c_str());
+	const double milliseconds = millisecondsSince(start);
+
+	std::error_code error;
+	if (0 == exit_code) {
+		std::filesystem::rename(temporary_path, spirv_path, error);
+		code = loadSpirv(error ? temporary_path : spirv_path);
+	}
+	std::filesystem::remove(temporary_path, error);
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	if (code.empty()) {
+		++mStats.compileFailures;
+		VKL_LOG("Failed to compile " << glsl_path << " (glslc exit code " << exit_code << ") after " << milliseconds << " ms");
+		return {};
+	}
+	++mStats.compilations;
+	mStats.compileMilliseconds += milliseconds;
+	VKL_LOG("Compiled " << glsl_path << " in " << milliseconds << " ms");
+	return code;
+}
+
+VkShaderModule shaderCreateModule(const std::string& glsl_path)
+{
+	const std::vector<uint32_t> code = shaderGetSpirv(glsl_path);
+	if (code.empty()) {
+		VKL_EXIT_WITH_ERROR("Failed to get SPIR-V code for shader " << glsl_path);
+	}
+
+	VkShaderModuleCreateInfo shader_module_create_info = {};
+	shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shader_module_create_info.codeSize = code.size() * sizeof(uint32_t);
+	shader_module_create_info.pCode = code.data();
+
+	VkShaderModule shader_module;
+	VkResult result = vkCreateShaderModule(vklGetDevice(), &shader_module_create_info, nullptr, &shader_module);
+	VKL_CHECK_VULKAN_RESULT(result);
+	return shader_module;
+}
+
+uint32_t shaderRegisterPipeline(const std::vector<std::string>& shader_paths, ShaderPipelineBuilder build, ShaderPipelineDestroyer destroy)
+{
+	if (!destroy) {
+		destroy = [](VkPipeline pipeline) { vkDestroyPipeline(vklGetDevice(), pipeline, nullptr); };
+	}
+	const VkPipeline pipeline = build();
+	if (VK_NULL_HANDLE == pipeline) {
+		VKL_EXIT_WITH_ERROR("Failed to build pipeline from " << (shader_paths.empty() ? std::string("no shaders") : shader_paths.front()));
+	}
+
+	std::lock_guard<std::mutex> lock(mRegistryMutex);
+	mPipelines.push_back(PipelineEntry{ shader_paths, std::move(build), std::move(destroy), pipeline });
+	return static_cast<uint32_t>(mPipelines.size() - 1);
+}
+
+VkPipeline shaderGetPipeline(uint32_t pipeline_id)
+{
+	std::lock_guard<std::mutex> lock(mRegistryMutex);
+	return mPipelines.at(pipeline_id).current;
+}
+
+void shaderBeginFrame()
+{
+	++mFrameIndex;
+
+	// The frames which might still use a replaced pipeline have all completed after mFramesInFlight frame boundaries:
+	for (size_t i = 0; i < mRetiredPipelines.size();) {
+		if (mFrameIndex - mRetiredPipelines[i].retiredInFrame > mFramesInFlight) {
+			mRetiredPipelines[i].destroy(mRetiredPipelines[i].pipeline);
+			mRetiredPipelines[i] = mRetiredPipelines.back();
+			mRetiredPipelines.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mRegistryMutex);
+	for (const auto& pending : mPendingPipelines) {
+		if (VK_NULL_HANDLE == pending.second) {
+			continue;
+		}
+		PipelineEntry& entry = mPipelines[pending.first];
+		mRetiredPipelines.push_back(RetiredPipeline{ entry.current, entry.destroy, mFrameIndex });
+		entry.current = pending.second;
+	}
+	mPendingPipelines.clear();
+}
+
+void shaderLogStats()
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	VKL_LOG("Shader manager: " << mStats.compilations << " compilations (" << mStats.compileMilliseconds << " ms), "
+		<< mStats.cacheHits << " cache hits, " << mStats.compileFailures << " failures, "
+		<< mStats.pipelineRebuilds << " pipeline rebuilds (" << mStats.rebuildMilliseconds << " ms)");
+}
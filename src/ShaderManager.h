@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* --------------------------------------------- */
+// Shader Manager Struct Definitions
+// As a convention, their names start with `Shader`.
+/* --------------------------------------------- */
+
+/*!
+ * Creates a pipeline, e.g., from modules created with shaderCreateModule. Invoked once when the pipeline is
+ * registered and then on the shader manager's background thread whenever one of its shader files changes,
+ * i.e., it must only use Vulkan functions that may be invoked concurrently with rendering (like vkCreateGraphicsPipelines).
+ * Returning VK_NULL_HANDLE keeps the previous pipeline.
+ */
+typedef std::function<VkPipeline()> ShaderPipelineBuilder;
+
+/*!
+ * Destroys a pipeline created by a ShaderPipelineBuilder; vkDestroyPipeline is used if none is given.
+ */
+typedef std::function<void(VkPipeline)> ShaderPipelineDestroyer;
+
+/*!
+ * Statistics of the shader manager.
+ */
+struct ShaderStats {
+	//! Number of GLSL files compiled to SPIR-V, and the time it took
+	uint32_t compilations;
+	double compileMilliseconds;
+
+	//! Number of SPIR-V binaries found in the on-disk cache
+	uint32_t cacheHits;
+
+	//! Number of compilations which failed
+	uint32_t compileFailures;
+
+	//! Number of pipelines rebuilt after shader changes, and the time it took
+	uint32_t pipelineRebuilds;
+	double rebuildMilliseconds;
+};
+
+/* --------------------------------------------- */
+// Shader Manager Function Definitions
+// As a convention, their names start with `shader`.
+/* --------------------------------------------- */
+
+/*!
+ *	Initializes the shader manager and starts a background thread which watches all registered pipelines' shader files.
+ *	GLSL is compiled with glslc from the Vulkan SDK (found by CMake, or on the PATH).
+ *	@param	frames_in_flight	Number of frames which can be in flight, e.g., vklGetNumFramebuffers(); replaced
+ *								pipelines are destroyed after this many frame boundaries.
+ *	@param	cache_directory		Directory for SPIR-V binaries, which are named after the hash of their source's contents
+ */
+void shaderInitManager(uint32_t frames_in_flight, const std::string& cache_directory = "shader_cache");
+
+/*!
+ *	Stops the watcher thread and destroys all registered pipelines. The GPU must not use them anymore.
+ */
+void shaderDestroyManager();
+
+/*!
+ *	Returns the SPIR-V code for a GLSL file. The stage is derived from the file's extension (.vert, .frag, .comp, ...).
+ *	If the on-disk cache contains a binary for the file's current contents, it is loaded; otherwise the file is compiled
+ *	and the result stored in the cache. Note: files included via #include are not part of the hash.
+ *	@return	The SPIR-V code, or an empty vector if the file could not be read or compiled.
+ */
+std::vector<uint32_t> shaderGetSpirv(const std::string& glsl_path);
+
+/*!
+ *	Creates a shader module from a GLSL file via shaderGetSpirv. Exits if the file cannot be compiled.
+ */
+VkShaderModule shaderCreateModule(const std::string& glsl_path);
+
+/*!
+ *	Builds a pipeline and registers it for hot reloading.
+ *	@param	shader_paths	GLSL files which the pipeline is built from; changes to any of them rebuild it.
+ *	@param	build			Creates the pipeline; see ShaderPipelineBuilder
+ *	@param	destroy			Destroys the pipeline; see ShaderPipelineDestroyer
+ *	@return	An identifier to get the pipeline's current version with shaderGetPipeline
+ */
+uint32_t shaderRegisterPipeline(const std::vector<std::string>& shader_paths, ShaderPipelineBuilder build, ShaderPipelineDestroyer destroy = nullptr);
+
+/*!
+ *	Returns the current version of a registered pipeline. It stays the same between two invocations of shaderBeginFrame.
+ */
+VkPipeline shaderGetPipeline(uint32_t pipeline_id);
+
+/*!
+ *	Swaps in pipelines which have been rebuilt in the background, and destroys replaced pipelines which no frame in
+ *	flight can use anymore. Invoke once per frame, at the start of the frame before any shaderGetPipeline.
+ */
+void shaderBeginFrame();
+
+/*!
+ *	Logs compilations, cache hits, and pipeline rebuilds with their times.
+ */
+void shaderLogStats();
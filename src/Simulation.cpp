@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Simulation.h"
+#include "LockFree.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/* --------------------------------------------- */
+// Internal simulation state
+/* --------------------------------------------- */
+
+namespace {
+
+	// Camera speed in units per second:
+	constexpr float kCameraSpeed = 2.0f;
+
+	// Written by the GLFW thread, read by the simulation thread:
+	SpscQueue<SimInputEvent, 1024> mInputQueue;
+	std::atomic<uint64_t> mDroppedInputEventCount{ 0 };
+
+	// Written by the simulation thread, read by the render thread:
+	TripleBuffer<SimWorldState> mWorldStates;
+
+	std::thread mThread;
+	std::atomic<bool> mRunning{ false };
+
+	// Latency statistics; only accessed by the render thread:
+	int64_t mLastMeasuredInputTimestampNs = 0;
+	uint64_t mLatencySampleCount = 0;
+	int64_t mLatencySumNs = 0;
+	int64_t mLatencyMaxNs = 0;
+
+	int64_t nowNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void simulationMain(double fixed_step_seconds) {
+		// Key states as seen by the simulation, i.e., after applying all events consumed so far:
+		bool is_key_down[GLFW_KEY_LAST + 1] = {};
+		SimWorldState state = {};
+
+		const auto step_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(fixed_step_seconds));
+		auto next_step_time = std::chrono::steady_clock::now();
+		while (mRunning.load(std::memory_order_acquire)) {
+			// Apply all input which has arrived until now:
+			SimInputEvent event;
+			while (mInputQueue.pop(event)) {
+				if (event.key >= 0 && event.key <= GLFW_KEY_LAST) {
+					if (GLFW_PRESS == event.action) {
+						is_key_down[event.key] = true;
+					}
+					else if (GLFW_RELEASE == event.action) {
+						is_key_down[event.key] = false;
+					}
+				}
+				state.newestInputTimestampNs = std::max(state.newestInputTimestampNs, event.timestampNs);
+			}
+
+			// Advance the world by one fixed step:
+			const float distance = kCameraSpeed * static_cast<float>(fixed_step_seconds);
+			glm::vec3 direction(0.0f);
+			if (is_key_down[GLFW_KEY_W]) { direction.z -= 1.0f; }
+			if (is_key_down[GLFW_KEY_S]) { direction.z += 1.0f; }
+			if (is_key_down[GLFW_KEY_A]) { direction.x -= 1.0f; }
+			if (is_key_down[GLFW_KEY_D]) { direction.x += 1.0f; }
+			if (is_key_down[GLFW_KEY_Q]) { direction.y -= 1.0f; }
+			if (is_key_down[GLFW_KEY_E]) { direction.y += 1.0f; }
+			state.cameraPosition += direction * distance;
+			state.tick += 1;
+			state.time = static_cast<double>(state.tick) * fixed_step_seconds;
+
+			mWorldStates.back() = state;
+			mWorldStates.publish();
+
+			// Sleep until the next step is due. If we have fallen far behind (e.g., after a debugger break),
+			// don't try to catch up with a burst of steps:
+			next_step_time += step_duration;
+			const auto now = std::chrono::steady_clock::now();
+			if (next_step_time < now - 4 * step_duration) {
+				next_step_time = now;
+			}
+			std::this_thread::sleep_until(next_step_time);
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// Simulation Function Definitions
+/* --------------------------------------------- */
+
+void simStart(double fixed_step_seconds)
+{
+	if (mRunning.exchange(true)) {
+		return;
+	}
+	mDroppedInputEventCount.store(0);
+	mLastMeasuredInputTimestampNs = 0;
+	mLatencySampleCount = 0;
+	mLatencySumNs = 0;
+	mLatencyMaxNs = 0;
+	mThread = std::thread(simulationMain, fixed_step_seconds);
+}
+
+void simStop()
+{
+	if (!mRunning.exchange(false)) {
+		return;
+	}
+	mThread.join();
+
+	if (mLatencySampleCount > 0) {
+		VKL_LOG("Input-to-present latency over " << mLatencySampleCount << " input events: average "
+			<< (static_cast<double>(mLatencySumNs) / static_cast<double>(mLatencySampleCount) * 1e-6) << " ms, maximum "
+			<< (static_cast<double>(mLatencyMaxNs) * 1e-6) << " ms");
+	}
+	const uint64_t dropped = mDroppedInputEventCount.load();
+	if (dropped > 0) {
+		VKL_LOG("Warning: " << dropped << " input events have been dropped because the input queue was full.");
+	}
+}
+
+void simPushInputEvent(int key, int action)
+{
+	if (!mInputQueue.push(SimInputEvent{ key, action, nowNs() })) {
+		mDroppedInputEventCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+const SimWorldState& simAcquireLatestState()
+{
+	return mWorldStates.acquire();
+}
+
+void simRecordPresent(const SimWorldState& presented_state)
+{
+	if (presented_state.newestInputTimestampNs <= mLastMeasuredInputTimestampNs) {
+		return;
+	}
+	const int64_t latency = nowNs() - presented_state.newestInputTimestampNs;
+	mLastMeasuredInputTimestampNs = presented_state.newestInputTimestampNs;
+	mLatencySampleCount += 1;
+	mLatencySumNs += latency;
+	mLatencyMaxNs = std::max(mLatencyMaxNs, latency);
+}
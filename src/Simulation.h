@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <cstdint>
+
+/* --------------------------------------------- */
+// Simulation Struct Definitions
+// As a convention, their names start with `Sim`.
+/* --------------------------------------------- */
+
+/*!
+ * A keyboard event as recorded by the GLFW key callback.
+ */
+struct SimInputEvent {
+	//! One of the GLFW_KEY_* codes
+	int key;
+
+	//! GLFW_PRESS, GLFW_RELEASE, or GLFW_REPEAT
+	int action;
+
+	//! Time of recording in nanoseconds (steady clock)
+	int64_t timestampNs;
+};
+
+/*!
+ * The state of the world after a simulation step, handed from the simulation thread to the renderer.
+ */
+struct SimWorldState {
+	//! The number of fixed steps simulated so far
+	uint64_t tick;
+
+	//! Simulated time in seconds, i.e., tick * fixed step
+	double time;
+
+	//! Camera position, moved with W/A/S/D (horizontally) and Q/E (vertically)
+	glm::vec3 cameraPosition;
+
+	//! Timestamp of the newest input event that has been applied to this state; 0 if there was none.
+	int64_t newestInputTimestampNs;
+};
+
+/* --------------------------------------------- */
+// Simulation Function Definitions
+// As a convention, their names start with `sim`.
+/* --------------------------------------------- */
+
+/*!
+ *	Starts the simulation thread, which consumes input events and advances the world in fixed steps,
+ *	independently of the render loop's frame rate. Every step's result is published through a triple buffer.
+ *	@param	fixed_step_seconds		Duration of one simulation step
+ */
+void simStart(double fixed_step_seconds = 1.0 / 120.0);
+
+/*!
+ *	Stops the simulation thread and logs input-to-present latency statistics.
+ */
+void simStop();
+
+/*!
+ *	Records an input event with the current time. Must only be invoked from one thread, i.e., the one which
+ *	polls GLFW events. Never blocks; if the simulation thread falls behind by more than the queue's capacity,
+ *	the event is dropped.
+ */
+void simPushInputEvent(int key, int action);
+
+/*!
+ *	Returns the most recently published world state. Must only be invoked from the render thread.
+ *	The returned reference stays valid until the next invocation.
+ */
+const SimWorldState& simAcquireLatestState();
+
+/*!
+ *	Tells the simulation that a frame based on the given state has been presented. If the state contains input
+ *	that has not been measured yet, the time from recording that input until now is added to the latency statistics.
+ */
+void simRecordPresent(const SimWorldState& presented_state);
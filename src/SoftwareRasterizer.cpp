@@ -0,0 +1,524 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define RASTER_USE_SSE2 0
+#endif
+
+/* --------------------------------------------- */
+// Internal software rasterizer state
+/* --------------------------------------------- */
+
+namespace {
+
+	constexpr int32_t kTileSize = 64;
+	constexpr int32_t kSubPixelBits = 8;
+	constexpr int32_t kSubPixelScale = 1 << kSubPixelBits;
+	// Screen coordinates are kept within +-kGuardBandPixels so that edge functions fit into 64-bit integers:
+	constexpr float kGuardBandPixels = 8192.0f;
+	constexpr uint32_t kVerticesPerJob = 4096;
+	constexpr uint32_t kTrianglesPerJob = 2048;
+	constexpr float kAmbient = 0.15f;
+
+	// Output of the vertex stage, in structure-of-arrays layout:
+	struct TransformedMesh {
+		std::vector<float> clip[4];
+		std::vector<float> world[3];
+		std::vector<glm::vec3> colors;
+	};
+
+	// A vertex during clipping:
+	struct ClipVertex {
+		glm::vec4 clip;
+		glm::vec3 color;
+	};
+
+	// A triangle after clipping, culling, and setup; its vertices are ordered such that its area is positive.
+	struct SetupTriangle {
+		int32_t x[3], y[3];
+		float z[3];
+		float invW[3];
+		glm::vec3 color[3];
+		int32_t minX, minY, maxX, maxY;
+		bool flat;
+	};
+
+	// Triangles set up by one job, plus their indices sorted into per-tile bins:
+	struct BinnedChunk {
+		uint32_t mesh;
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+		std::vector<SetupTriangle> triangles;
+		std::vector<uint32_t> binOffsets; // tile_count + 1 entries
+		std::vector<uint32_t> binnedTriangles;
+	};
+
+	// Rounds to the nearest integer; cheaper than std::lround, which is a library call on most compilers:
+	int64_t roundToInt(float value) {
+		return static_cast<int64_t>(value >= 0.0f ? value + 0.5f : value - 0.5f);
+	}
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	 * Transforms points with the given matrix and writes the first `row_count` components of the results
+	 * into separate arrays.
+	 */
+	void transformPoints(const glm::vec3* points, uint32_t begin, uint32_t end, const glm::mat4& m, float* const* out, int row_count) {
+		uint32_t i = begin;
+#if RASTER_USE_SSE2
+		__m128 columns[4][4];
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				columns[row][column] = _mm_set1_ps(m[column][row]);
+			}
+		}
+		const float* data = reinterpret_cast<const float*>(points);
+		for (; i + 4 <= end; i += 4) {
+			// Load four tightly packed vec3s and transpose them into x, y, and z registers:
+			const __m128 a = _mm_loadu_ps(data + 3 * i);     // x0 y0 z0 x1
+			const __m128 b = _mm_loadu_ps(data + 3 * i + 4); // y1 z1 x2 y2
+			const __m128 c = _mm_loadu_ps(data + 3 * i + 8); // z2 x3 y3 z3
+			const __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+			const __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+			for (int row = 0; row < row_count; ++row) {
+				__m128 result = _mm_add_ps(_mm_mul_ps(columns[row][0], x), _mm_mul_ps(columns[row][1], y));
+				result = _mm_add_ps(result, _mm_add_ps(_mm_mul_ps(columns[row][2], z), columns[row][3]));
+				_mm_storeu_ps(out[row] + i, result);
+			}
+		}
+#endif
+		for (; i < end; ++i) {
+			const glm::vec4 result = m * glm::vec4(points[i], 1.0f);
+			for (int row = 0; row < row_count; ++row) {
+				out[row][i] = result[row];
+			}
+		}
+	}
+
+	float lightIntensity(const glm::vec3& normal, const glm::vec3& to_light) {
+		const float length = glm::length(normal);
+		const float n_dot_l = length > 0.0f ? glm::dot(normal, to_light) / length : 0.0f;
+		return kAmbient + (1.0f - kAmbient) * std::max(0.0f, n_dot_l);
+	}
+
+	void transformMesh(const RasterMesh& mesh, const RasterSettings& settings, TransformedMesh& transformed) {
+		const uint32_t count = mesh.vertexCount;
+		for (auto& component : transformed.clip) {
+			component.resize(count);
+		}
+		// Gouraud shading needs lit vertex colors, flat shading needs world space positions for computing face normals:
+		const bool gouraud = RASTER_SHADING_MODE_GOURAUD == settings.shadingMode && nullptr != mesh.normals;
+		if (gouraud) {
+			transformed.colors.resize(count);
+		}
+		else {
+			for (auto& component : transformed.world) {
+				component.resize(count);
+			}
+		}
+
+		const glm::mat4 model_view_projection = settings.viewProjectionMatrix * mesh.modelMatrix;
+		const glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(mesh.modelMatrix)));
+		const glm::vec3 to_light = -glm::normalize(settings.lightDirection);
+		float* const clip_out[4] = { transformed.clip[0].data(), transformed.clip[1].data(), transformed.clip[2].data(), transformed.clip[3].data() };
+		float* const world_out[3] = { transformed.world[0].data(), transformed.world[1].data(), transformed.world[2].data() };
+
+		jobParallelFor(count, kVerticesPerJob, [&](uint32_t begin, uint32_t end) {
+			transformPoints(mesh.positions, begin, end, model_view_projection, clip_out, 4);
+			if (gouraud) {
+				for (uint32_t i = begin; i < end; ++i) {
+					transformed.colors[i] = mesh.color * lightIntensity(normal_matrix * mesh.normals[i], to_light);
+				}
+			}
+			else {
+				transformPoints(mesh.positions, begin, end, mesh.modelMatrix, world_out, 3);
+			}
+		});
+	}
+
+	// Clips a convex polygon against the plane dot(plane, clip) >= 0 (Sutherland-Hodgman):
+	uint32_t clipPolygon(const ClipVertex* in, uint32_t in_count, ClipVertex* out, const glm::vec4& plane) {
+		uint32_t out_count = 0;
+		for (uint32_t i = 0; i < in_count; ++i) {
+			const ClipVertex& current = in[i];
+			const ClipVertex& next = in[(i + 1) % in_count];
+			const float d_current = glm::dot(plane, current.clip);
+			const float d_next = glm::dot(plane, next.clip);
+			if (d_current >= 0.0f) {
+				out[out_count++] = current;
+			}
+			if ((d_current >= 0.0f) != (d_next >= 0.0f)) {
+				const float t = d_current / (d_current - d_next);
+				out[out_count++] = ClipVertex{ current.clip + (next.clip - current.clip) * t, current.color + (next.color - current.color) * t };
+			}
+		}
+		return out_count;
+	}
+
+	// Projects, culls, and sets up one triangle. Returns false if it does not cover any pixel.
+	bool setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, bool flat, const RasterSettings& settings,
+		uint32_t width, uint32_t height, SetupTriangle& triangle) {
+		const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+		int64_t x[3], y[3];
+		for (int i = 0; i < 3; ++i) {
+			const glm::vec4& clip = vertices[i]->clip;
+			const float inv_w = 1.0f / clip.w;
+			x[i] = roundToInt((clip.x * inv_w * 0.5f + 0.5f) * static_cast<float>(width) * kSubPixelScale);
+			y[i] = roundToInt((clip.y * inv_w * 0.5f + 0.5f) * static_cast<float>(height) * kSubPixelScale);
+			triangle.z[i] = clip.z * inv_w;
+			triangle.invW[i] = inv_w;
+			triangle.color[i] = vertices[i]->color;
+		}
+
+		// Twice the signed area as defined by the Vulkan specification (framebuffer coordinates, y down):
+		const int64_t vulkan_area = -((x[0] * y[1] - x[1] * y[0]) + (x[1] * y[2] - x[2] * y[1]) + (x[2] * y[0] - x[0] * y[2]));
+		if (0 == vulkan_area) {
+			return false;
+		}
+		const bool front_facing = VK_FRONT_FACE_COUNTER_CLOCKWISE == settings.frontFace ? vulkan_area > 0 : vulkan_area < 0;
+		if ((front_facing && 0 != (settings.cullMode & VK_CULL_MODE_FRONT_BIT)) || (!front_facing && 0 != (settings.cullMode & VK_CULL_MODE_BACK_BIT))) {
+			return false;
+		}
+
+		// Edge functions are >= 0 inside if the area is negative in Vulkan's definition => swap otherwise:
+		if (vulkan_area > 0) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(triangle.z[1], triangle.z[2]);
+			std::swap(triangle.invW[1], triangle.invW[2]);
+			std::swap(triangle.color[1], triangle.color[2]);
+		}
+
+		// Pixel bounding box (pixel centers at +0.5), clamped to the target:
+		const int64_t half_pixel = kSubPixelScale / 2;
+		const int64_t min_x = std::max<int64_t>(0, (std::min({ x[0], x[1], x[2] }) - half_pixel + kSubPixelScale - 1) >> kSubPixelBits);
+		const int64_t min_y = std::max<int64_t>(0, (std::min({ y[0], y[1], y[2] }) - half_pixel + kSubPixelScale - 1) >> kSubPixelBits);
+		const int64_t max_x = std::min<int64_t>(width - 1, (std::max({ x[0], x[1], x[2] }) - half_pixel) >> kSubPixelBits);
+		const int64_t max_y = std::min<int64_t>(height - 1, (std::max({ y[0], y[1], y[2] }) - half_pixel) >> kSubPixelBits);
+		if (min_x > max_x || min_y > max_y) {
+			return false;
+		}
+
+		for (int i = 0; i < 3; ++i) {
+			triangle.x[i] = static_cast<int32_t>(x[i]);
+			triangle.y[i] = static_cast<int32_t>(y[i]);
+		}
+		triangle.minX = static_cast<int32_t>(min_x);
+		triangle.minY = static_cast<int32_t>(min_y);
+		triangle.maxX = static_cast<int32_t>(max_x);
+		triangle.maxY = static_cast<int32_t>(max_y);
+		triangle.flat = flat;
+		return true;
+	}
+
+	void setupAndBinChunk(BinnedChunk& chunk, const RasterMesh& mesh, const TransformedMesh& transformed, const RasterSettings& settings,
+		uint32_t width, uint32_t height, uint32_t tiles_x, uint32_t tile_count) {
+		const bool gouraud = !transformed.colors.empty();
+		const glm::vec3 to_light = -glm::normalize(settings.lightDirection);
+		// Planes which keep screen coordinates within the guard band, plus near and far plane:
+		const float guard_x = 2.0f * kGuardBandPixels / static_cast<float>(width) - 1.0f;
+		const float guard_y = 2.0f * kGuardBandPixels / static_cast<float>(height) - 1.0f;
+		const glm::vec4 clip_planes[6] = {
+			glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),  // z >= 0
+			glm::vec4(0.0f, 0.0f, -1.0f, 1.0f), // z <= w
+			glm::vec4(1.0f, 0.0f, 0.0f, guard_x), glm::vec4(-1.0f, 0.0f, 0.0f, guard_x),
+			glm::vec4(0.0f, 1.0f, 0.0f, guard_y), glm::vec4(0.0f, -1.0f, 0.0f, guard_y),
+		};
+		// Planes of the view volume, for rejecting triangles which are entirely outside:
+		const glm::vec4 view_planes[6] = {
+			clip_planes[0], clip_planes[1],
+			glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+			glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+		};
+
+		std::vector<uint32_t> tile_counts(tile_count, 0u);
+		chunk.triangles.clear();
+		chunk.triangles.reserve(chunk.triangleCount);
+
+		for (uint32_t t = chunk.firstTriangle; t < chunk.firstTriangle + chunk.triangleCount; ++t) {
+			const uint32_t indices[3] = { mesh.indices[3 * t], mesh.indices[3 * t + 1], mesh.indices[3 * t + 2] };
+			ClipVertex polygon[9];
+			for (int i = 0; i < 3; ++i) {
+				const uint32_t index = indices[i];
+				polygon[i].clip = glm::vec4(transformed.clip[0][index], transformed.clip[1][index], transformed.clip[2][index], transformed.clip[3][index]);
+			}
+
+			// Trivially reject triangles which are entirely outside of one of the view volume's planes:
+			bool outside = false;
+			uint32_t clip_mask = 0;
+			for (int p = 0; p < 6 && !outside; ++p) {
+				int outside_count = 0;
+				for (int i = 0; i < 3; ++i) {
+					outside_count += glm::dot(view_planes[p], polygon[i].clip) < 0.0f ? 1 : 0;
+					clip_mask |= glm::dot(clip_planes[p], polygon[i].clip) < 0.0f ? (1u << p) : 0u;
+				}
+				outside = 3 == outside_count;
+			}
+			if (outside) {
+				continue;
+			}
+
+			bool flat = !gouraud;
+			if (gouraud) {
+				for (int i = 0; i < 3; ++i) {
+					polygon[i].color = transformed.colors[indices[i]];
+				}
+			}
+			else {
+				const glm::vec3 p[3] = {
+					glm::vec3(transformed.world[0][indices[0]], transformed.world[1][indices[0]], transformed.world[2][indices[0]]),
+					glm::vec3(transformed.world[0][indices[1]], transformed.world[1][indices[1]], transformed.world[2][indices[1]]),
+					glm::vec3(transformed.world[0][indices[2]], transformed.world[1][indices[2]], transformed.world[2][indices[2]]),
+				};
+				const glm::vec3 color = mesh.color * lightIntensity(glm::cross(p[1] - p[0], p[2] - p[0]), to_light);
+				polygon[0].color = polygon[1].color = polygon[2].color = color;
+			}
+
+			// Clip only if necessary:
+			uint32_t polygon_count = 3;
+			if (0 != clip_mask) {
+				ClipVertex scratch[9];
+				for (int p = 0; p < 6 && polygon_count >= 3; ++p) {
+					if (0 != (clip_mask & (1u << p))) {
+						polygon_count = clipPolygon(polygon, polygon_count, scratch, clip_planes[p]);
+						std::copy(scratch, scratch + polygon_count, polygon);
+					}
+				}
+			}
+
+			for (uint32_t i = 2; i < polygon_count; ++i) {
+				SetupTriangle triangle;
+				if (!setupTriangle(polygon[0], polygon[i - 1], polygon[i], flat, settings, width, height, triangle)) {
+					continue;
+				}
+				for (int32_t ty = triangle.minY / kTileSize; ty <= triangle.maxY / kTileSize; ++ty) {
+					for (int32_t tx = triangle.minX / kTileSize; tx <= triangle.maxX / kTileSize; ++tx) {
+						++tile_counts[ty * tiles_x + tx];
+					}
+				}
+				chunk.triangles.push_back(triangle);
+			}
+		}
+
+		// Counting sort of the triangles into their tiles' bins:
+		chunk.binOffsets.assign(tile_count + 1, 0u);
+		for (uint32_t tile = 0; tile < tile_count; ++tile) {
+			chunk.binOffsets[tile + 1] = chunk.binOffsets[tile] + tile_counts[tile];
+		}
+		chunk.binnedTriangles.resize(chunk.binOffsets[tile_count]);
+		std::copy(chunk.binOffsets.begin(), chunk.binOffsets.end() - 1, tile_counts.begin());
+		for (uint32_t i = 0; i < static_cast<uint32_t>(chunk.triangles.size()); ++i) {
+			const SetupTriangle& triangle = chunk.triangles[i];
+			for (int32_t ty = triangle.minY / kTileSize; ty <= triangle.maxY / kTileSize; ++ty) {
+				for (int32_t tx = triangle.minX / kTileSize; tx <= triangle.maxX / kTileSize; ++tx) {
+					chunk.binnedTriangles[tile_counts[ty * tiles_x + tx]++] = i;
+				}
+			}
+		}
+	}
+
+	uint32_t packColor(const glm::vec3& color) {
+		const auto to_byte = [](float value) {
+			return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+		};
+		return to_byte(color.x) | (to_byte(color.y) << 8) | (to_byte(color.z) << 16) | (0xFFu << 24);
+	}
+
+	void rasterizeTriangleInTile(const SetupTriangle& triangle, int32_t tile_min_x, int32_t tile_min_y, int32_t tile_max_x, int32_t tile_max_y, RasterTarget& target) {
+		const int32_t min_x = std::max(triangle.minX, tile_min_x);
+		const int32_t min_y = std::max(triangle.minY, tile_min_y);
+		const int32_t max_x = std::min(triangle.maxX, tile_max_x);
+		const int32_t max_y = std::min(triangle.maxY, tile_max_y);
+		if (min_x > max_x || min_y > max_y) {
+			return;
+		}
+
+		// Edge function e_k belongs to the edge opposite of vertex k, so e_k / area is vertex k's barycentric coordinate:
+		int64_t row_edge[3], step_x[3], step_y[3];
+		const int64_t sample_x = (static_cast<int64_t>(min_x) << kSubPixelBits) + kSubPixelScale / 2;
+		const int64_t sample_y = (static_cast<int64_t>(min_y) << kSubPixelBits) + kSubPixelScale / 2;
+		for (int k = 0; k < 3; ++k) {
+			const int i = (k + 1) % 3;
+			const int j = (k + 2) % 3;
+			const int64_t dx = static_cast<int64_t>(triangle.x[j]) - triangle.x[i];
+			const int64_t dy = static_cast<int64_t>(triangle.y[j]) - triangle.y[i];
+			// Top-left fill rule: pixel centers exactly on an edge belong to the triangle only for top and left edges:
+			const bool top_left = (0 == dy && dx > 0) || dy < 0;
+			row_edge[k] = dx * (sample_y - triangle.y[i]) - dy * (sample_x - triangle.x[i]) - (top_left ? 0 : 1);
+			step_x[k] = -dy * kSubPixelScale;
+			step_y[k] = dx * kSubPixelScale;
+		}
+		const int64_t area = (static_cast<int64_t>(triangle.x[1]) - triangle.x[0]) * (static_cast<int64_t>(triangle.y[2]) - triangle.y[0])
+			- (static_cast<int64_t>(triangle.y[1]) - triangle.y[0]) * (static_cast<int64_t>(triangle.x[2]) - triangle.x[0]);
+		const float inv_area = 1.0f / static_cast<float>(area);
+		const uint32_t flat_color = packColor(triangle.color[0]);
+
+		for (int32_t y = min_y; y <= max_y; ++y) {
+			int64_t e0 = row_edge[0], e1 = row_edge[1], e2 = row_edge[2];
+			float* depth_row = target.depth.data() + static_cast<size_t>(y) * target.width;
+			uint32_t* color_row = target.color.data() + static_cast<size_t>(y) * target.width;
+			for (int32_t x = min_x; x <= max_x; ++x) {
+				if ((e0 | e1 | e2) >= 0) {
+					const float b0 = static_cast<float>(e0) * inv_area;
+					const float b1 = static_cast<float>(e1) * inv_area;
+					const float b2 = 1.0f - b0 - b1;
+					const float z = b0 * triangle.z[0] + b1 * triangle.z[1] + b2 * triangle.z[2];
+					if (z < depth_row[x]) {
+						depth_row[x] = z;
+						if (triangle.flat) {
+							color_row[x] = flat_color;
+						}
+						else {
+							// Perspective-correct interpolation:
+							const float w0 = b0 * triangle.invW[0];
+							const float w1 = b1 * triangle.invW[1];
+							const float w2 = b2 * triangle.invW[2];
+							const float inv_sum = 1.0f / (w0 + w1 + w2);
+							color_row[x] = packColor((triangle.color[0] * w0 + triangle.color[1] * w1 + triangle.color[2] * w2) * inv_sum);
+						}
+					}
+				}
+				e0 += step_x[0];
+				e1 += step_x[1];
+				e2 += step_x[2];
+			}
+			for (int k = 0; k < 3; ++k) {
+				row_edge[k] += step_y[k];
+			}
+		}
+	}
+}
+
+/* --------------------------------------------- */
+// Software Rasterizer Function Definitions
+/* --------------------------------------------- */
+
+RasterTarget rasterCreateTarget(uint32_t width, uint32_t height)
+{
+	RasterTarget target;
+	target.width = width;
+	target.height = height;
+	target.color.resize(static_cast<size_t>(width) * height);
+	target.depth.resize(static_cast<size_t>(width) * height);
+	return target;
+}
+
+void rasterClear(RasterTarget& target, const glm::vec4& clear_color, float clear_depth)
+{
+	const uint32_t color = (packColor(glm::vec3(clear_color.x, clear_color.y, clear_color.z)) & 0x00FFFFFFu)
+		| (static_cast<uint32_t>(std::min(std::max(clear_color.w, 0.0f), 1.0f) * 255.0f + 0.5f) << 24);
+	std::fill(target.color.begin(), target.color.end(), color);
+	std::fill(target.depth.begin(), target.depth.end(), clear_depth);
+}
+
+RasterStats rasterDrawMeshes(RasterTarget& target, const RasterMesh* meshes, uint32_t mesh_count, const RasterSettings& settings)
+{
+	RasterStats stats = {};
+	const auto start = std::chrono::steady_clock::now();
+
+	// 1. Vertex stage:
+	std::vector<TransformedMesh> transformed(mesh_count);
+	for (uint32_t m = 0; m < mesh_count; ++m) {
+		transformMesh(meshes[m], settings, transformed[m]);
+	}
+	stats.transformMilliseconds = millisecondsSince(start);
+
+	// 2. Clipping, culling, setup, and binning:
+	const auto binning_start = std::chrono::steady_clock::now();
+	const uint32_t tiles_x = (target.width + kTileSize - 1) / kTileSize;
+	const uint32_t tiles_y = (target.height + kTileSize - 1) / kTileSize;
+	const uint32_t tile_count = tiles_x * tiles_y;
+	std::vector<BinnedChunk> chunks;
+	for (uint32_t m = 0; m < mesh_count; ++m) {
+		const uint32_t triangle_count = meshes[m].indexCount / 3;
+		stats.submittedTriangles += triangle_count;
+		for (uint32_t first = 0; first < triangle_count; first += kTrianglesPerJob) {
+			BinnedChunk chunk;
+			chunk.mesh = m;
+			chunk.firstTriangle = first;
+			chunk.triangleCount = std::min(kTrianglesPerJob, triangle_count - first);
+			chunks.push_back(std::move(chunk));
+		}
+	}
+	jobParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t c = begin; c < end; ++c) {
+			setupAndBinChunk(chunks[c], meshes[chunks[c].mesh], transformed[chunks[c].mesh], settings, target.width, target.height, tiles_x, tile_count);
+		}
+	});
+	for (const BinnedChunk& chunk : chunks) {
+		stats.binnedTriangles += static_cast<uint32_t>(chunk.triangles.size());
+	}
+	stats.binningMilliseconds = millisecondsSince(binning_start);
+
+	// 3. Rasterization of all tiles in parallel; within a tile, triangles are processed in submission order:
+	const auto rasterization_start = std::chrono::steady_clock::now();
+	jobParallelFor(tile_count, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t tile = begin; tile < end; ++tile) {
+			const int32_t tile_min_x = static_cast<int32_t>(tile % tiles_x) * kTileSize;
+			const int32_t tile_min_y = static_cast<int32_t>(tile / tiles_x) * kTileSize;
+			const int32_t tile_max_x = std::min(tile_min_x + kTileSize, static_cast<int32_t>(target.width)) - 1;
+			const int32_t tile_max_y = std::min(tile_min_y + kTileSize, static_cast<int32_t>(target.height)) - 1;
+			for (const BinnedChunk& chunk : chunks) {
+				for (uint32_t i = chunk.binOffsets[tile]; i < chunk.binOffsets[tile + 1]; ++i) {
+					rasterizeTriangleInTile(chunk.triangles[chunk.binnedTriangles[i]], tile_min_x, tile_min_y, tile_max_x, tile_max_y, target);
+				}
+			}
+		}
+	});
+	stats.rasterizationMilliseconds = millisecondsSince(rasterization_start);
+	stats.totalMilliseconds = millisecondsSince(start);
+	return stats;
+}
+
+std::vector<glm::vec3> rasterComputeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+	std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const glm::vec3& p0 = positions[indices[i]];
+		const glm::vec3& p1 = positions[indices[i + 1]];
+		const glm::vec3& p2 = positions[indices[i + 2]];
+		// The cross product's length is twice the triangle's area => area-weighted:
+		const glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+		normals[indices[i]] += face_normal;
+		normals[indices[i + 1]] += face_normal;
+		normals[indices[i + 2]] += face_normal;
+	}
+	for (glm::vec3& normal : normals) {
+		const float length = glm::length(normal);
+		if (length > 0.0f) {
+			normal /= length;
+		}
+	}
+	return normals;
+}
+
+bool rasterWriteImage(const RasterTarget& target, const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (nullptr == file) {
+		return false;
+	}
+	fprintf(file, "P6\n%u %u\n255\n", target.width, target.height);
+	std::vector<uint8_t> rgb(static_cast<size_t>(target.width) * target.height * 3);
+	for (size_t i = 0; i < target.color.size(); ++i) {
+		rgb[3 * i + 0] = static_cast<uint8_t>(target.color[i]);
+		rgb[3 * i + 1] = static_cast<uint8_t>(target.color[i] >> 8);
+		rgb[3 * i + 2] = static_cast<uint8_t>(target.color[i] >> 16);
+	}
+	const bool success = rgb.size() == fwrite(rgb.data(), 1, rgb.size(), file);
+	return 0 == fclose(file) && success;
+}
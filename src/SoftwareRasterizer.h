@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// Software Rasterizer Struct Definitions
+// As a convention, their names start with `Raster`.
+/* --------------------------------------------- */
+
+/*!
+ * Color and depth buffer of the software rasterizer.
+ */
+struct RasterTarget {
+	uint32_t width;
+	uint32_t height;
+
+	//! Pixels in VK_FORMAT_R8G8B8A8_UNORM layout, row by row starting at the top
+	std::vector<uint32_t> color;
+
+	//! Depth values in [0, 1], row by row starting at the top
+	std::vector<float> depth;
+};
+
+/*!
+ * How triangles are shaded: FLAT uses one face normal per triangle,
+ * GOURAUD lights every vertex and interpolates the resulting colors.
+ */
+enum RasterShadingMode {
+	RASTER_SHADING_MODE_FLAT = 0,
+	RASTER_SHADING_MODE_GOURAUD = 1,
+};
+
+/*!
+ * A mesh to be drawn. Positions and indices are the same arrays that are uploaded
+ * into vertex and index buffers for the Vulkan path; they are not copied.
+ */
+struct RasterMesh {
+	const glm::vec3* positions;
+
+	//! Per-vertex normals for Gouraud shading. May be nullptr, in which case the mesh is shaded flat.
+	const glm::vec3* normals;
+
+	uint32_t vertexCount;
+
+	//! Triangle list
+	const uint32_t* indices;
+	uint32_t indexCount;
+
+	glm::mat4 modelMatrix;
+	glm::vec3 color;
+};
+
+/*!
+ * Settings which apply to all meshes of one rasterizer invocation. They follow Vulkan's conventions,
+ * i.e., clip space z is in [0, w], y points down, and culling is specified like in a pipeline's
+ * rasterization state, so that the same matrices and settings produce comparable images on both paths.
+ */
+struct RasterSettings {
+	glm::mat4 viewProjectionMatrix;
+
+	//! World space direction in which the light travels
+	glm::vec3 lightDirection;
+
+	RasterShadingMode shadingMode;
+	VkCullModeFlags cullMode;
+	VkFrontFace frontFace;
+};
+
+/*!
+ * Statistics of one rasterizer invocation.
+ */
+struct RasterStats {
+	//! Triangles of all meshes
+	uint32_t submittedTriangles;
+
+	//! Triangles which survived clipping and culling and have been binned into tiles
+	uint32_t binnedTriangles;
+
+	double transformMilliseconds;
+	double binningMilliseconds;
+	double rasterizationMilliseconds;
+	double totalMilliseconds;
+};
+
+/* --------------------------------------------- */
+// Software Rasterizer Function Definitions
+// As a convention, their names start with `raster`.
+/* --------------------------------------------- */
+
+/*!
+ *	Creates a target with the given dimensions; it needs to be cleared before drawing into it.
+ */
+RasterTarget rasterCreateTarget(uint32_t width, uint32_t height);
+
+/*!
+ *	Clears the color buffer to the given color and the depth buffer to the given depth.
+ */
+void rasterClear(RasterTarget& target, const glm::vec4& clear_color, float clear_depth = 1.0f);
+
+/*!
+ *	Draws meshes into the target using the job system (see jobInitSystem), if it is running:
+ *	 1. Vertices are transformed four at a time with SSE.
+ *	 2. Triangles are clipped, culled, set up, and binned into screen tiles of 64x64 pixels, in parallel chunks.
+ *	 3. Tiles are rasterized in parallel with a depth test (VK_COMPARE_OP_LESS) and flat or Gouraud shading.
+ *	Triangles are rasterized with 8 bits of sub-pixel precision and the top-left fill rule.
+ *	The result does not depend on the number of workers.
+ *	@return	Statistics about this invocation
+ */
+RasterStats rasterDrawMeshes(RasterTarget& target, const RasterMesh* meshes, uint32_t mesh_count, const RasterSettings& settings);
+
+/*!
+ *	Computes smooth per-vertex normals by accumulating the area-weighted face normals of adjacent triangles.
+ *	Can be used for Gouraud shading meshes which come without normals, like the teapot.
+ */
+std::vector<glm::vec3> rasterComputeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+/*!
+ *	Writes the target's color buffer into a binary PPM image file.
+ *	@return	True on success, false if the file could not be written
+ */
+bool rasterWriteImage(const RasterTarget& target, const char* path);
@@ -0,0 +1,277 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+
+// Renders the teapot and OBJ models with the CPU rasterizer, i.e., without requiring a GPU.
+// Writes the image and reports triangle throughput and frame times for increasing numbers of workers.
+// Usage: VulkanLaunchpadSoftwareRenderer [--record <capture file>] [--replay <capture file> [--realtime]] [output image] [width] [height] [OBJ files...]
+//        Defaults to "software_render.ppm", 1280x720, and the sphere and vespa models.
+//        --record additionally renders and records an orbit around the scene; --replay renders a recording instead of
+//        measuring scaling, as fast as possible or, with --realtime, at the recorded timing, and reports frame times.
+
+// Include our framework (for loading OBJ files) and local helpers:
+#include "VulkanLaunchpad.h"
+#include "Teapot.h"
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include "Capture.h"
+
+// Include functionality from the standard library:
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ------------------------------------------------ */
+// Some little helpers directly declared here:
+/* ------------------------------------------------ */
+
+/*!
+ *	A mesh of the scene along with the arrays which its RasterMesh points to.
+ */
+struct SceneMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+	RasterMesh rasterMesh;
+};
+
+/*!
+ *	Points the mesh's RasterMesh to its arrays and sets a model matrix which scales it to
+ *	unit size and places its center at the given position.
+ */
+void initializeRasterMesh(SceneMesh& mesh, const glm::vec3& center, const glm::vec3& color);
+
+/*!
+ *	Renders the given number of frames and returns the average statistics.
+ */
+RasterStats renderFrames(RasterTarget& target, const std::vector<SceneMesh>& scene, const RasterSettings& settings, uint32_t frame_count);
+
+/*!
+ *	Renders the draws of a captured frame: mesh IDs are indices into the scene (modulo its size), and pipeline IDs
+ *	select the shading mode (RasterShadingMode, modulo the number of modes).
+ */
+void renderCapturedFrame(RasterTarget& target, const std::vector<SceneMesh>& scene, RasterSettings settings, const CapCamera& camera, const std::vector<CapDraw>& draws);
+
+/* ------------------------------------------------ */
+// Main
+/* ------------------------------------------------ */
+
+int main(int argc, char** argv)
+{
+	std::string record_path;
+	std::string replay_path;
+	bool replay_at_recorded_timing = false;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; ++i) {
+		const std::string argument = argv[i];
+		if ("--record" == argument && i + 1 < argc) {
+			record_path = argv[++i];
+		}
+		else if ("--replay" == argument && i + 1 < argc) {
+			replay_path = argv[++i];
+		}
+		else if ("--realtime" == argument) {
+			replay_at_recorded_timing = true;
+		}
+		else {
+			arguments.push_back(argument);
+		}
+	}
+
+	const std::string output_path = arguments.size() > 0 ? arguments[0] : "software_render.ppm";
+	const uint32_t width = arguments.size() > 1 ? static_cast<uint32_t>(std::stoul(arguments[1])) : 1280u;
+	const uint32_t height = arguments.size() > 2 ? static_cast<uint32_t>(std::stoul(arguments[2])) : 720u;
+	std::vector<std::string> obj_paths;
+	for (size_t i = 3; i < arguments.size(); ++i) {
+		obj_paths.push_back(arguments[i]);
+	}
+	// By default, the scene's meshes are in the order of Main's scene, so that recorded mesh IDs (teapot 0, sphere 1, vespa 2, cube 3) can be replayed:
+	if (obj_paths.empty()) {
+		obj_paths = { "assets/sphere/sphere.obj", "assets/vespa/vespa.obj", "assets/cube/cube.obj" };
+	}
+
+	// Load the scene: the teapot from its geometry arrays, and all OBJ files via the framework:
+	std::vector<SceneMesh> scene(1 + obj_paths.size());
+	teapotGetGeometryData(scene[0].positions, scene[0].indices);
+	scene[0].normals = rasterComputeVertexNormals(scene[0].positions, scene[0].indices);
+	for (size_t i = 0; i < obj_paths.size(); ++i) {
+		VklGeometryData geometry = vklLoadModelGeometry(obj_paths[i]);
+		scene[i + 1].positions = std::move(geometry.positions);
+		scene[i + 1].normals = std::move(geometry.normals);
+		scene[i + 1].indices = std::move(geometry.indices);
+		if (scene[i + 1].normals.size() != scene[i + 1].positions.size()) {
+			scene[i + 1].normals = rasterComputeVertexNormals(scene[i + 1].positions, scene[i + 1].indices);
+		}
+	}
+	const glm::vec3 colors[] = { glm::vec3(0.9f, 0.6f, 0.2f), glm::vec3(0.3f, 0.6f, 0.9f), glm::vec3(0.5f, 0.8f, 0.4f), glm::vec3(0.8f, 0.4f, 0.7f) };
+	for (size_t i = 0; i < scene.size(); ++i) {
+		const float x = (static_cast<float>(i) - 0.5f * static_cast<float>(scene.size() - 1)) * 1.2f;
+		initializeRasterMesh(scene[i], glm::vec3(x, 0.0f, 0.0f), colors[i % 4]);
+	}
+
+	// Camera and settings follow Vulkan's conventions: clip space z in [0, w] and y pointing down.
+	const float aspect = static_cast<float>(width) / static_cast<float>(height);
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+	projection[1][1] *= -1.0f;
+	const float distance = 0.8f * static_cast<float>(scene.size()) / aspect + 1.5f;
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.6f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	RasterSettings settings = {};
+	settings.viewProjectionMatrix = projection * view;
+	settings.lightDirection = glm::vec3(-0.4f, -1.0f, -0.6f);
+	settings.shadingMode = RASTER_SHADING_MODE_GOURAUD;
+	settings.cullMode = VK_CULL_MODE_NONE;
+	settings.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	RasterTarget target = rasterCreateTarget(width, height);
+	const uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+
+	// Replay a recording with all workers, e.g., to compare frame times of two builds on exactly the same frames:
+	if (!replay_path.empty()) {
+		CapRecording recording;
+		if (!capLoadRecording(replay_path.c_str(), recording)) {
+			VKL_EXIT_WITH_ERROR("Failed to load recording \"" << replay_path << "\".");
+		}
+		jobInitSystem(max_workers);
+		const CapReplayStats stats = capReplay(recording, replay_at_recorded_timing ? CAP_REPLAY_MODE_RECORDED_TIMING : CAP_REPLAY_MODE_AS_FAST_AS_POSSIBLE,
+			[&](const CapFrame& frame, uint32_t) {
+				renderCapturedFrame(target, scene, settings, frame.camera, frame.draws);
+			});
+		jobDestroySystem();
+		capLogReplayStats(stats);
+
+		if (!rasterWriteImage(target, output_path.c_str())) {
+			VKL_EXIT_WITH_ERROR("Failed to write image \"" << output_path << "\".");
+		}
+		VKL_LOG("Wrote the last replayed frame to \"" << output_path << "\"");
+		return EXIT_SUCCESS;
+	}
+
+	constexpr uint32_t kFrameCount = 20;
+	double single_worker_milliseconds = 0.0;
+	for (uint32_t workers = 1; ; workers = std::min(workers * 2, max_workers)) {
+		jobInitSystem(workers);
+		const RasterStats stats = renderFrames(target, scene, settings, kFrameCount);
+		jobDestroySystem();
+
+		if (1u == workers) {
+			single_worker_milliseconds = stats.totalMilliseconds;
+		}
+		VKL_LOG(workers << " worker(s): " << stats.totalMilliseconds << " ms per frame (transform " << stats.transformMilliseconds
+			<< " ms, binning " << stats.binningMilliseconds << " ms, rasterization " << stats.rasterizationMilliseconds << " ms), "
+			<< (static_cast<double>(stats.submittedTriangles) / stats.totalMilliseconds * 1e-3) << " M triangles/s, speedup "
+			<< (single_worker_milliseconds / stats.totalMilliseconds) << "x");
+		if (workers == max_workers) {
+			VKL_LOG(stats.submittedTriangles << " triangles submitted, " << stats.binnedTriangles << " binned after clipping and culling");
+			break;
+		}
+	}
+
+	// Record an orbit around the scene, rendering every frame like a replay would:
+	if (!record_path.empty()) {
+		if (!capBeginRecording(record_path.c_str())) {
+			VKL_EXIT_WITH_ERROR("Failed to open \"" << record_path << "\" for recording.");
+		}
+		jobInitSystem(max_workers);
+		constexpr uint32_t kOrbitFrameCount = 240;
+		std::vector<CapDraw> draws(scene.size());
+		for (uint32_t frame = 0; frame < kOrbitFrameCount; ++frame) {
+			const float angle = glm::radians(360.0f) * static_cast<float>(frame) / static_cast<float>(kOrbitFrameCount);
+			CapCamera camera;
+			camera.viewMatrix = glm::lookAt(glm::vec3(distance * std::sin(angle), 0.6f, distance * std::cos(angle)), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			camera.projectionMatrix = projection;
+			for (size_t i = 0; i < scene.size(); ++i) {
+				draws[i].meshId = static_cast<uint32_t>(i);
+				draws[i].pipelineId = RASTER_SHADING_MODE_GOURAUD;
+				draws[i].modelMatrix = scene[i].rasterMesh.modelMatrix;
+			}
+			capRecordDraws(draws.data(), static_cast<uint32_t>(draws.size()));
+			renderCapturedFrame(target, scene, settings, camera, draws);
+			capEndFrame(camera);
+		}
+		jobDestroySystem();
+		if (!capEndRecording()) {
+			VKL_EXIT_WITH_ERROR("Failed to write recording \"" << record_path << "\".");
+		}
+	}
+
+	if (!rasterWriteImage(target, output_path.c_str())) {
+		VKL_EXIT_WITH_ERROR("Failed to write image \"" << output_path << "\".");
+	}
+	VKL_LOG("Wrote " << width << "x" << height << " image to \"" << output_path << "\"");
+
+	return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------ */
+// Definitions of little helpers defined above main:
+/* ------------------------------------------------ */
+
+void initializeRasterMesh(SceneMesh& mesh, const glm::vec3& center, const glm::vec3& color)
+{
+	glm::vec3 bounds_min(std::numeric_limits<float>::max());
+	glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+	for (const glm::vec3& position : mesh.positions) {
+		bounds_min = glm::min(bounds_min, position);
+		bounds_max = glm::max(bounds_max, position);
+	}
+	const glm::vec3 extent = bounds_max - bounds_min;
+	const float scale = 1.0f / std::max({ extent.x, extent.y, extent.z, 1e-6f });
+
+	mesh.rasterMesh.positions = mesh.positions.data();
+	mesh.rasterMesh.normals = mesh.normals.data();
+	mesh.rasterMesh.vertexCount = static_cast<uint32_t>(mesh.positions.size());
+	mesh.rasterMesh.indices = mesh.indices.data();
+	mesh.rasterMesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	mesh.rasterMesh.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+	mesh.rasterMesh.modelMatrix = glm::translate(mesh.rasterMesh.modelMatrix, -(bounds_min + bounds_max) * 0.5f);
+	mesh.rasterMesh.color = color;
+}
+
+RasterStats renderFrames(RasterTarget& target, const std::vector<SceneMesh>& scene, const RasterSettings& settings, uint32_t frame_count)
+{
+	std::vector<RasterMesh> meshes;
+	for (const SceneMesh& mesh : scene) {
+		meshes.push_back(mesh.rasterMesh);
+	}
+
+	RasterStats sum = {};
+	for (uint32_t frame = 0; frame < frame_count; ++frame) {
+		rasterClear(target, glm::vec4(0.1f, 0.1f, 0.12f, 1.0f));
+		const RasterStats stats = rasterDrawMeshes(target, meshes.data(), static_cast<uint32_t>(meshes.size()), settings);
+		sum.submittedTriangles = stats.submittedTriangles;
+		sum.binnedTriangles = stats.binnedTriangles;
+		sum.transformMilliseconds += stats.transformMilliseconds / frame_count;
+		sum.binningMilliseconds += stats.binningMilliseconds / frame_count;
+		sum.rasterizationMilliseconds += stats.rasterizationMilliseconds / frame_count;
+		sum.totalMilliseconds += stats.totalMilliseconds / frame_count;
+	}
+	return sum;
+}
+
+void renderCapturedFrame(RasterTarget& target, const std::vector<SceneMesh>& scene, RasterSettings settings, const CapCamera& camera, const std::vector<CapDraw>& draws)
+{
+	constexpr uint32_t kShadingModeCount = 2;
+	settings.viewProjectionMatrix = camera.projectionMatrix * camera.viewMatrix;
+	rasterClear(target, glm::vec4(0.1f, 0.1f, 0.12f, 1.0f));
+
+	// Draws are submitted in batches of consecutive draws with the same shading mode:
+	std::vector<RasterMesh> meshes;
+	for (size_t i = 0; i < draws.size(); ++i) {
+		if (draws[i].meshId >= scene.size()) {
+			VKL_EXIT_WITH_ERROR("The recording draws mesh " << draws[i].meshId << ", but the scene only has " << scene.size() << " meshes.");
+		}
+		RasterMesh mesh = scene[draws[i].meshId].rasterMesh;
+		mesh.modelMatrix = draws[i].modelMatrix;
+		meshes.push_back(mesh);
+
+		const uint32_t shading_mode = draws[i].pipelineId % kShadingModeCount;
+		if (i + 1 == draws.size() || draws[i + 1].pipelineId % kShadingModeCount != shading_mode) {
+			settings.shadingMode = static_cast<RasterShadingMode>(shading_mode);
+			rasterDrawMeshes(target, meshes.data(), static_cast<uint32_t>(meshes.size()), settings);
+			meshes.clear();
+		}
+	}
+}
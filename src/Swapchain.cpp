@@ -0,0 +1,116 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "Swapchain.h"
+#include "VulkanHelpers.h"
+#include <algorithm>
+#include <chrono>
+
+/* --------------------------------------------- */
+// Internal state of the swapchain helpers
+/* --------------------------------------------- */
+
+namespace {
+
+	bool mRecreationRequired = false;
+	bool mRecreationInProgress = false;
+	std::chrono::steady_clock::time_point mRecreationStart;
+	SwapRecreationStats mCurrentRecreation = {};
+
+	// Totals over all recreations:
+	uint32_t mRecreationCount = 0;
+	double mRecreationMillisecondsTotal = 0.0;
+	double mRecreationMillisecondsMax = 0.0;
+}
+
+/* --------------------------------------------- */
+// Swapchain Function Definitions
+/* --------------------------------------------- */
+
+void swapLogStats()
+{
+	if (mRecreationCount > 0) {
+		VKL_LOG("Swapchain recreated " << mRecreationCount << " times, hitch " << (mRecreationMillisecondsTotal / mRecreationCount)
+			<< " ms on average, " << mRecreationMillisecondsMax << " ms at most.");
+	}
+}
+
+void swapRequestRecreation()
+{
+	mRecreationRequired = true;
+}
+
+bool swapCheckResult(VkResult result)
+{
+	if (VK_ERROR_OUT_OF_DATE_KHR == result || VK_SUBOPTIMAL_KHR == result) {
+		swapRequestRecreation();
+		return true;
+	}
+	VKL_CHECK_VULKAN_RESULT(result);
+	return false;
+}
+
+bool swapIsRecreationRequired()
+{
+	return mRecreationRequired;
+}
+
+VkSwapchainKHR swapRecreateSwapchain(VkPhysicalDevice physical_device, VkDevice device, VkSwapchainCreateInfoKHR& create_info,
+	VkSwapchainKHR old_swapchain, VkExtent2D framebuffer_extent, std::vector<VkImage>& images)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Surfaces report their size as current extent, unless the swapchain determines it:
+	const VkSurfaceCapabilitiesKHR capabilities = hlpGetPhysicalDeviceSurfaceCapabilities(physical_device, create_info.surface);
+	VkExtent2D extent = capabilities.currentExtent;
+	if (UINT32_MAX == extent.width) {
+		extent.width = std::min(std::max(framebuffer_extent.width, capabilities.minImageExtent.width), capabilities.maxImageExtent.width);
+		extent.height = std::min(std::max(framebuffer_extent.height, capabilities.minImageExtent.height), capabilities.maxImageExtent.height);
+	}
+	if (0 == extent.width || 0 == extent.height) {
+		images.clear();
+		return VK_NULL_HANDLE;
+	}
+
+	mCurrentRecreation = {};
+	mCurrentRecreation.previousExtent = create_info.imageExtent;
+	mCurrentRecreation.extent = extent;
+	create_info.imageExtent = extent;
+	create_info.preTransform = capabilities.currentTransform;
+	create_info.oldSwapchain = old_swapchain;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	VkResult result = vkCreateSwapchainKHR(device, &create_info, nullptr, &swapchain);
+	create_info.oldSwapchain = VK_NULL_HANDLE;
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	uint32_t image_count = 0;
+	result = vkGetSwapchainImagesKHR(device, swapchain, &image_count, nullptr);
+	VKL_CHECK_VULKAN_RESULT(result);
+	images.resize(image_count);
+	result = vkGetSwapchainImagesKHR(device, swapchain, &image_count, images.data());
+	VKL_CHECK_VULKAN_RESULT(result);
+	mCurrentRecreation.imageCount = image_count;
+
+	mRecreationRequired = false;
+	mRecreationInProgress = true;
+	mRecreationStart = start;
+	return swapchain;
+}
+
+SwapRecreationStats swapEndRecreation()
+{
+	if (!mRecreationInProgress) {
+		VKL_EXIT_WITH_ERROR("No swapchain recreation in progress. Ensure to invoke swapRecreateSwapchain beforehand!");
+	}
+	mRecreationInProgress = false;
+	mCurrentRecreation.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mRecreationStart).count();
+
+	mRecreationCount += 1;
+	mRecreationMillisecondsTotal += mCurrentRecreation.milliseconds;
+	mRecreationMillisecondsMax = std::max(mRecreationMillisecondsMax, mCurrentRecreation.milliseconds);
+
+	VKL_LOG("Swapchain recreated: " << mCurrentRecreation.previousExtent.width << "x" << mCurrentRecreation.previousExtent.height << " -> "
+		<< mCurrentRecreation.extent.width << "x" << mCurrentRecreation.extent.height << ", " << mCurrentRecreation.imageCount
+		<< " images, hitch " << mCurrentRecreation.milliseconds << " ms");
+	return mCurrentRecreation;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/* --------------------------------------------- */
+// Swapchain Struct Definitions
+// As a convention, their names start with `Swap`.
+/* --------------------------------------------- */
+
+/*!
+ * Statistics of one swapchain recreation, see swapEndRecreation.
+ */
+struct SwapRecreationStats {
+	VkExtent2D previousExtent;
+	VkExtent2D extent;
+	uint32_t imageCount;
+
+	//! Time from swapRecreateSwapchain until swapEndRecreation, i.e., the hitch which the recreation has caused
+	double milliseconds;
+};
+
+/* --------------------------------------------- */
+// Swapchain Function Definitions
+// As a convention, their names start with `swap`.
+/* --------------------------------------------- */
+
+/*!
+ *	Logs statistics of all recreations, e.g., at shutdown.
+ */
+void swapLogStats();
+
+/*!
+ *	Requests a recreation of the swapchain, e.g., from a GLFW framebuffer size callback.
+ */
+void swapRequestRecreation();
+
+/*!
+ *	Checks the result of vkAcquireNextImageKHR or vkQueuePresentKHR: VK_ERROR_OUT_OF_DATE_KHR and VK_SUBOPTIMAL_KHR
+ *	request a recreation (see swapRequestRecreation), any other error exits.
+ *	@return	True if the swapchain needs to be recreated
+ */
+bool swapCheckResult(VkResult result);
+
+/*!
+ *	Returns true if a recreation has been requested and not been performed yet.
+ */
+bool swapIsRecreationRequired();
+
+/*!
+ *	Creates a new swapchain for the surface's current size, passing the old one as VkSwapchainCreateInfoKHR::oldSwapchain,
+ *	so that the presentation engine can hand over its resources. The old swapchain is retired, but not destroyed: destroy it
+ *	once nothing uses it anymore, i.e., after waiting for the queue to become idle and destroying its framebuffers.
+ *	Starts measuring the hitch, which swapEndRecreation reports once all size-dependent resources have been rebuilt.
+ *	@param	create_info			The create info which the old swapchain has been created with. Its imageExtent and
+ *								preTransform are updated to the surface's current capabilities.
+ *	@param	old_swapchain		The swapchain to be replaced
+ *	@param	framebuffer_extent	The window's framebuffer size, e.g., from glfwGetFramebufferSize; used if the surface
+ *								lets the swapchain determine its size.
+ *	@param	images				Receives the new swapchain's images
+ *	@return	The new swapchain, or VK_NULL_HANDLE if the surface has a size of zero (e.g., the window is minimized),
+ *			in which case the old swapchain stays in use and the recreation remains requested.
+ */
+VkSwapchainKHR swapRecreateSwapchain(VkPhysicalDevice physical_device, VkDevice device, VkSwapchainCreateInfoKHR& create_info,
+	VkSwapchainKHR old_swapchain, VkExtent2D framebuffer_extent, std::vector<VkImage>& images);
+
+/*!
+ *	Stops measuring the hitch of the current recreation and logs it.
+ *	@return	Statistics of the recreation
+ */
+SwapRecreationStats swapEndRecreation();
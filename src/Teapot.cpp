@@ -2,6 +2,7 @@
  * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
  */
 #include "Teapot.h"
+#include "MemoryRegistry.h"
 #include <VulkanLaunchpad.h>
 #include <vulkan/vulkan.hpp>
 
@@ -17,9 +18,9 @@ VkDeviceMemory mTeapotPositionsMemory;
 VkBuffer mTeapotIndices;
 VkDeviceMemory mTeapotIndicesMemory;
 
-void teapotCreateGeometryAndBuffers() 
+void teapotGetGeometryData(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
 {
-	std::vector<glm::vec3> positions = {
+	positions = {
 		glm::vec3(-0.0112664,0.188986,-0.392027), glm::vec3(0.187941,0.188986,-0.339176), glm::vec3(0.327909,0.188986,-0.199208), glm::vec3(0.38076,0.188986,-9.72432e-10),
 		glm::vec3(-0.0112664,0.213487,-0.387619), glm::vec3(0.185702,0.213487,-0.335362), glm::vec3(0.324096,0.213487,-0.196968), glm::vec3(0.376353,0.213487,-9.72432e-10),
 		glm::vec3(-0.0112664,0.213487,-0.401102), glm::vec3(0.192553,0.213487,-0.347027), glm::vec3(0.335761,0.213487,-0.203819), glm::vec3(0.389835,0.213487,-9.72432e-10),
@@ -159,7 +160,7 @@ void teapotCreateGeometryAndBuffers()
 		positions[i] = m * positions[i];
 	}
 
-	std::vector<unsigned int> indices = {
+	indices = {
 		0,5,4, 0,1,5, 1,6,5, 1,2,6, 2,7,6, 2,3,7, 4,9,8, 4,5,9, 5,10,9, 5,6,10,
 		6,11,10, 6,7,11, 8,13,12, 8,9,13, 9,14,13, 9,10,14, 10,15,14, 10,11,15, 16,21,20, 16,17,21,
 		17,22,21, 17,18,22, 18,23,22, 18,19,23, 20,25,24, 20,21,25, 21,26,25, 21,22,26, 22,27,26, 22,23,27,
@@ -219,6 +220,13 @@ void teapotCreateGeometryAndBuffers()
 		497,502,501, 497,498,502, 498,503,502, 498,499,503, 500,505,504, 500,501,505, 501,506,505, 501,502,506, 502,507,506, 502,503,507,
 		504,509,508, 504,505,509, 505,510,509, 505,506,510, 506,511,510, 506,507,511
 	};
+}
+
+void teapotCreateGeometryAndBuffers() 
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	teapotGetGeometryData(positions, indices);
 
 	mNumTeapotIndices = static_cast<uint32_t>(indices.size());
 	const auto device = vklGetDevice();
@@ -236,7 +244,7 @@ void teapotCreateGeometryAndBuffers()
 		}
 		VkMemoryRequirements memoryRequirements {};
 		vkGetBufferMemoryRequirements(device, mTeapotPositions, &memoryRequirements);
-		mTeapotPositionsMemory = vklAllocateMemoryForGivenRequirements(posBufferCreateInfo.size, memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		mTeapotPositionsMemory = memAllocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Teapot positions", MEM_CATEGORY_GEOMETRY);
 		result = vkBindBufferMemory(device, mTeapotPositions, mTeapotPositionsMemory, 0);
 		if(result != VK_SUCCESS) {
 			VKL_EXIT_WITH_ERROR(std::string("Failed to bind the buffer memory for the teapot positions with error: ") + to_string(result));
@@ -262,7 +270,7 @@ void teapotCreateGeometryAndBuffers()
 		}
 		VkMemoryRequirements memoryRequirements{};
 		vkGetBufferMemoryRequirements(device, mTeapotIndices, &memoryRequirements);
-		mTeapotIndicesMemory = vklAllocateMemoryForGivenRequirements(indexBufferCreateInfo.size, memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		mTeapotIndicesMemory = memAllocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Teapot indices", MEM_CATEGORY_GEOMETRY);
 		result = vkBindBufferMemory(device, mTeapotIndices, mTeapotIndicesMemory, 0);
 		if(result != VK_SUCCESS)
 		{
@@ -280,9 +288,9 @@ void teapotCreateGeometryAndBuffers()
 void teapotDestroyBuffers()
 {
 	auto device = vklGetDevice();
-	vkFreeMemory(device, mTeapotIndicesMemory, NULL);
+	memFree(mTeapotIndicesMemory);
 	vkDestroyBuffer(device, mTeapotIndices, NULL);
-	vkFreeMemory(device, mTeapotPositionsMemory, NULL);
+	memFree(mTeapotPositionsMemory);
 	vkDestroyBuffer(device, mTeapotPositions, NULL);
 }
 
@@ -1,7 +1,15 @@
 /*
  * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
  */
+#pragma once
+#include "VulkanLaunchpad.h"
 #include <vulkan/vulkan.h>
+#include <vector>
+
+/*!
+ *	Writes the teapot's vertex positions and triangle list indices into the given vectors, e.g., for processing on the CPU.
+ */
+void teapotGetGeometryData(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices);
 
 void teapotCreateGeometryAndBuffers();
 void teapotDestroyBuffers();
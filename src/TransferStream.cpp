@@ -0,0 +1,523 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "TransferStream.h"
+#include "MemoryRegistry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// One destination of an upload; either a buffer range or an image
+	struct UploadTarget {
+		VkBuffer buffer;
+		VkImage image;
+		VkDeviceSize stagingOffset;
+		VkDeviceSize size;
+		uint32_t imageWidth;
+		uint32_t imageHeight;
+		VkImageLayout finalLayout;
+	};
+
+	// A submitted upload whose staging buffer and command buffer are freed once the timeline reaches its ticket
+	struct PendingUpload {
+		StreamTicket ticket;
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingMemory;
+		VkCommandBuffer commandBuffer;
+		std::vector<UploadTarget> targets;
+		VkDeviceSize bytes;
+	};
+
+	VkQueue mQueue = VK_NULL_HANDLE;
+	uint32_t mTransferQueueFamily = 0;
+	uint32_t mGraphicsQueueFamily = 0;
+	VkCommandPool mCommandPool = VK_NULL_HANDLE;
+	VkSemaphore mTimelineSemaphore = VK_NULL_HANDLE;
+	// Loaded at runtime, since they are not part of Vulkan 1.1:
+	PFN_vkGetSemaphoreCounterValueKHR mGetSemaphoreCounterValue = nullptr;
+	PFN_vkWaitSemaphoresKHR mWaitSemaphores = nullptr;
+
+	//! Guards the queue, the command pool, mPending, mLastSubmittedTicket, and the upload stats
+	std::mutex mMutex;
+	std::deque<PendingUpload> mPending;
+	StreamTicket mLastSubmittedTicket = 0;
+	std::atomic<StreamTicket> mReadyTicket{ 0 };
+
+	StreamStats mStats = {};
+	std::chrono::steady_clock::time_point mBusyStart;
+	std::chrono::steady_clock::time_point mLastFrameStart;
+	bool mFirstFrame = true;
+	bool mStreamingDuringLastFrame = false;
+
+	double millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	void* createStagingBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory)
+	{
+		const auto device = vklGetDevice();
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to create staging buffer with error: ") + std::to_string(result));
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
+		memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Transfer stream staging buffer", MEM_CATEGORY_STAGING);
+		result = vkBindBufferMemory(device, buffer, memory, 0);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to bind staging buffer memory with error: ") + std::to_string(result));
+		}
+
+		void* mapped;
+		result = vkMapMemory(device, memory, 0, size, 0, &mapped);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to map staging buffer memory with error: ") + std::to_string(result));
+		}
+		return mapped;
+	}
+
+	VkBuffer createDeviceLocalBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceMemory& memory, const char* name)
+	{
+		const auto device = vklGetDevice();
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VkBuffer buffer;
+		VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to create device-local buffer with error: ") + std::to_string(result));
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
+		memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, name, MEM_CATEGORY_GEOMETRY);
+		result = vkBindBufferMemory(device, buffer, memory, 0);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to bind device-local buffer memory with error: ") + std::to_string(result));
+		}
+		return buffer;
+	}
+
+	// Records barriers which release (on the transfer queue) or acquire (on the graphics queue) ownership of the targets.
+	// If both queues belong to the same family, no ownership transfer is needed; then, release only transitions image layouts.
+	void recordOwnershipBarriers(VkCommandBuffer command_buffer, const std::vector<UploadTarget>& targets, bool release)
+	{
+		const bool transfer_ownership = mTransferQueueFamily != mGraphicsQueueFamily;
+		std::vector<VkBufferMemoryBarrier> buffer_barriers;
+		std::vector<VkImageMemoryBarrier> image_barriers;
+		for (const UploadTarget& target : targets) {
+			if (VK_NULL_HANDLE != target.buffer && transfer_ownership) {
+				VkBufferMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+				barrier.dstAccessMask = release ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+				barrier.srcQueueFamilyIndex = mTransferQueueFamily;
+				barrier.dstQueueFamilyIndex = mGraphicsQueueFamily;
+				barrier.buffer = target.buffer;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				buffer_barriers.push_back(barrier);
+			}
+			if (VK_NULL_HANDLE != target.image && (transfer_ownership || release)) {
+				// Both halves of an ownership transfer must specify the same layout transition:
+				VkImageMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+				barrier.dstAccessMask = release ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = target.finalLayout;
+				barrier.srcQueueFamilyIndex = transfer_ownership ? mTransferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = transfer_ownership ? mGraphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = target.image;
+				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				barrier.subresourceRange.baseMipLevel = 0;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.baseArrayLayer = 0;
+				barrier.subresourceRange.layerCount = 1;
+				image_barriers.push_back(barrier);
+			}
+		}
+		if (buffer_barriers.empty() && image_barriers.empty()) {
+			return;
+		}
+		vkCmdPipelineBarrier(command_buffer,
+			release ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 0, nullptr,
+			static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+			static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+	}
+
+	// Records the copies from the staging buffer into all targets and submits them to the transfer queue
+	StreamTicket submitUpload(VkBuffer staging_buffer, VkDeviceMemory staging_memory, std::vector<UploadTarget> targets)
+	{
+		if (VK_NULL_HANDLE == mQueue) {
+			VKL_EXIT_WITH_ERROR("Transfer stream not initialized. Ensure to invoke streamInit beforehand!");
+		}
+		const auto device = vklGetDevice();
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.commandPool = mCommandPool;
+		allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocate_info.commandBufferCount = 1;
+		VkCommandBuffer command_buffer;
+		VkResult result = vkAllocateCommandBuffers(device, &allocate_info, &command_buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to allocate transfer command buffer with error: ") + std::to_string(result));
+		}
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+		VkDeviceSize bytes = 0;
+		for (const UploadTarget& target : targets) {
+			if (VK_NULL_HANDLE != target.buffer) {
+				VkBufferCopy region = {};
+				region.srcOffset = target.stagingOffset;
+				region.dstOffset = 0;
+				region.size = target.size;
+				vkCmdCopyBuffer(command_buffer, staging_buffer, target.buffer, 1, &region);
+			}
+			else {
+				hlpRecordPipelineBarrierWithImageLayoutTransition(command_buffer,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+					target.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+				hlpRecordCopyBufferToImage(command_buffer, staging_buffer, target.image, target.imageWidth, target.imageHeight);
+			}
+			bytes += target.size;
+		}
+		recordOwnershipBarriers(command_buffer, targets, true);
+		result = vkEndCommandBuffer(command_buffer);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to record transfer command buffer with error: ") + std::to_string(result));
+		}
+
+		const StreamTicket ticket = mLastSubmittedTicket + 1;
+		VkTimelineSemaphoreSubmitInfoKHR timeline_submit_info = {};
+		timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timeline_submit_info.signalSemaphoreValueCount = 1;
+		timeline_submit_info.pSignalSemaphoreValues = &ticket;
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_submit_info;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &command_buffer;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &mTimelineSemaphore;
+		result = vkQueueSubmit(mQueue, 1, &submit_info, VK_NULL_HANDLE);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to submit upload to the transfer queue with error: ") + std::to_string(result));
+		}
+
+		if (mPending.empty()) {
+			mBusyStart = std::chrono::steady_clock::now();
+		}
+		mPending.push_back(PendingUpload{ ticket, staging_buffer, staging_memory, command_buffer, std::move(targets), bytes });
+		mLastSubmittedTicket = ticket;
+		++mStats.uploadsSubmitted;
+		return ticket;
+	}
+
+	void releasePendingUpload(const PendingUpload& upload)
+	{
+		const auto device = vklGetDevice();
+		vkFreeCommandBuffers(device, mCommandPool, 1, &upload.commandBuffer);
+		vkDestroyBuffer(device, upload.stagingBuffer, nullptr);
+		memFree(upload.stagingMemory);
+	}
+}
+
+/* --------------------------------------------- */
+// Transfer Stream Function Definitions
+/* --------------------------------------------- */
+
+uint32_t streamFindTransferQueueFamily(VkPhysicalDevice physical_device, uint32_t graphics_queue_family)
+{
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+
+	for (uint32_t i = 0; i < queue_family_count; ++i) {
+		const VkQueueFlags flags = queue_families[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			return i;
+		}
+	}
+	return graphics_queue_family;
+}
+
+VkPhysicalDeviceTimelineSemaphoreFeaturesKHR streamGetDeviceFeatures()
+{
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+	timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timeline_features.timelineSemaphore = VK_TRUE;
+	return timeline_features;
+}
+
+void streamInit(VkQueue transfer_queue, uint32_t transfer_queue_family, uint32_t graphics_queue_family)
+{
+	if (VK_NULL_HANDLE != mQueue) {
+		VKL_EXIT_WITH_ERROR("Transfer stream already initialized.");
+	}
+	const auto device = vklGetDevice();
+	mGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+	mWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+	if (nullptr == mGetSemaphoreCounterValue || nullptr == mWaitSemaphores) {
+		// Devices created with Vulkan 1.2 might only expose the core names:
+		mGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue"));
+		mWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphores"));
+	}
+	if (nullptr == mGetSemaphoreCounterValue || nullptr == mWaitSemaphores) {
+		VKL_EXIT_WITH_ERROR("Timeline semaphores are not available. Enable them during device creation (see streamGetDeviceFeatures)!");
+	}
+
+	VkCommandPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex = transfer_queue_family;
+	VkResult result = vkCreateCommandPool(device, &pool_create_info, nullptr, &mCommandPool);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create transfer command pool with error: ") + std::to_string(result));
+	}
+
+	VkSemaphoreTypeCreateInfoKHR semaphore_type_create_info = {};
+	semaphore_type_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	semaphore_type_create_info.initialValue = 0;
+	VkSemaphoreCreateInfo semaphore_create_info = {};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_create_info.pNext = &semaphore_type_create_info;
+	result = vkCreateSemaphore(device, &semaphore_create_info, nullptr, &mTimelineSemaphore);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create timeline semaphore with error: ") + std::to_string(result));
+	}
+
+	mQueue = transfer_queue;
+	mTransferQueueFamily = transfer_queue_family;
+	mGraphicsQueueFamily = graphics_queue_family;
+	mLastSubmittedTicket = 0;
+	mReadyTicket = 0;
+	mStats = {};
+	mFirstFrame = true;
+	mStreamingDuringLastFrame = false;
+	VKL_LOG("Transfer stream initialized on queue family " << transfer_queue_family
+		<< (transfer_queue_family != graphics_queue_family ? " (dedicated transfer queue)" : " (same family as graphics)"));
+}
+
+void streamDestroy()
+{
+	const auto device = vklGetDevice();
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mLastSubmittedTicket > 0) {
+		VkSemaphoreWaitInfoKHR wait_info = {};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &mTimelineSemaphore;
+		wait_info.pValues = &mLastSubmittedTicket;
+		VkResult result = mWaitSemaphores(device, &wait_info, UINT64_MAX);
+		VKL_CHECK_VULKAN_RESULT(result);
+	}
+	for (const PendingUpload& upload : mPending) {
+		releasePendingUpload(upload);
+	}
+	mPending.clear();
+	vkDestroySemaphore(device, mTimelineSemaphore, nullptr);
+	vkDestroyCommandPool(device, mCommandPool, nullptr);
+	mTimelineSemaphore = VK_NULL_HANDLE;
+	mCommandPool = VK_NULL_HANDLE;
+	mQueue = VK_NULL_HANDLE;
+}
+
+StreamTicket streamUploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size)
+{
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_memory;
+	void* mapped = createStagingBuffer(size, staging_buffer, staging_memory);
+	std::memcpy(mapped, data, static_cast<size_t>(size));
+	vkUnmapMemory(vklGetDevice(), staging_memory);
+
+	UploadTarget target = {};
+	target.buffer = buffer;
+	target.size = size;
+	return submitUpload(staging_buffer, staging_memory, { target });
+}
+
+StreamTicket streamUploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, VkImageLayout final_layout)
+{
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_memory;
+	void* mapped = createStagingBuffer(size, staging_buffer, staging_memory);
+	std::memcpy(mapped, data, static_cast<size_t>(size));
+	vkUnmapMemory(vklGetDevice(), staging_memory);
+
+	UploadTarget target = {};
+	target.image = image;
+	target.size = size;
+	target.imageWidth = width;
+	target.imageHeight = height;
+	target.finalLayout = final_layout;
+	return submitUpload(staging_buffer, staging_memory, { target });
+}
+
+StreamGeometryBuffers streamCreateGeometryAndBuffers(const VklGeometryData& geometry_data)
+{
+	StreamGeometryBuffers buffers = {};
+	HlpGeometryHandles& handles = buffers.handles;
+	handles.numberOfIndices = static_cast<uint32_t>(geometry_data.indices.size());
+	handles.indexType = VK_INDEX_TYPE_UINT32;
+	handles.positionsBufferSize = sizeof(glm::vec3) * geometry_data.positions.size();
+	handles.normalsBufferSize = sizeof(glm::vec3) * geometry_data.normals.size();
+	handles.textureCoordinatesBufferSize = sizeof(glm::vec2) * geometry_data.textureCoordinates.size();
+	handles.indicesBufferSize = sizeof(uint32_t) * geometry_data.indices.size();
+
+	const void* sources[4] = { geometry_data.positions.data(), geometry_data.normals.data(), geometry_data.textureCoordinates.data(), geometry_data.indices.data() };
+	const size_t sizes[4] = { handles.positionsBufferSize, handles.normalsBufferSize, handles.textureCoordinatesBufferSize, handles.indicesBufferSize };
+	VkBuffer* destinations[4] = { &handles.positionsBuffer, &handles.normalsBuffer, &handles.textureCoordinatesBuffer, &handles.indicesBuffer };
+	const char* names[4] = { "Streamed positions", "Streamed normals", "Streamed texture coordinates", "Streamed indices" };
+
+	// All streams go into one staging buffer and are copied with one submission:
+	std::vector<UploadTarget> targets;
+	VkDeviceSize staging_size = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (0 == sizes[i]) {
+			continue;
+		}
+		*destinations[i] = createDeviceLocalBuffer(sizes[i], 3 == i ? VK_BUFFER_USAGE_INDEX_BUFFER_BIT : VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, buffers.memories[i], names[i]);
+		UploadTarget target = {};
+		target.buffer = *destinations[i];
+		target.stagingOffset = staging_size;
+		target.size = sizes[i];
+		targets.push_back(target);
+		staging_size += (sizes[i] + 15) / 16 * 16;
+	}
+	if (targets.empty()) {
+		return buffers;
+	}
+
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_memory;
+	uint8_t* mapped = static_cast<uint8_t*>(createStagingBuffer(staging_size, staging_buffer, staging_memory));
+	size_t target_index = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (0 != sizes[i]) {
+			std::memcpy(mapped + targets[target_index++].stagingOffset, sources[i], sizes[i]);
+		}
+	}
+	vkUnmapMemory(vklGetDevice(), staging_memory);
+
+	buffers.ticket = submitUpload(staging_buffer, staging_memory, std::move(targets));
+	return buffers;
+}
+
+void streamDestroyBuffers(const StreamGeometryBuffers& buffers)
+{
+	const auto device = vklGetDevice();
+	const VkBuffer handles[4] = { buffers.handles.positionsBuffer, buffers.handles.normalsBuffer, buffers.handles.textureCoordinatesBuffer, buffers.handles.indicesBuffer };
+	for (int i = 0; i < 4; ++i) {
+		if (VK_NULL_HANDLE != handles[i]) {
+			vkDestroyBuffer(device, handles[i], nullptr);
+			memFree(buffers.memories[i]);
+		}
+	}
+}
+
+void streamBeginFrame(VkCommandBuffer command_buffer)
+{
+	const auto now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (!mFirstFrame) {
+		const double frame_milliseconds = millisecondsBetween(mLastFrameStart, now);
+		if (mStreamingDuringLastFrame) {
+			++mStats.framesWhileStreaming;
+			mStats.frameMillisecondsWhileStreaming += frame_milliseconds;
+			mStats.maxFrameMillisecondsWhileStreaming = std::max(mStats.maxFrameMillisecondsWhileStreaming, frame_milliseconds);
+		}
+		else {
+			++mStats.framesWhileIdle;
+			mStats.frameMillisecondsWhileIdle += frame_milliseconds;
+			mStats.maxFrameMillisecondsWhileIdle = std::max(mStats.maxFrameMillisecondsWhileIdle, frame_milliseconds);
+		}
+	}
+	mFirstFrame = false;
+	mLastFrameStart = now;
+
+	if (mPending.empty()) {
+		mStreamingDuringLastFrame = false;
+		return;
+	}
+
+	uint64_t completed_value = 0;
+	VkResult result = mGetSemaphoreCounterValue(vklGetDevice(), mTimelineSemaphore, &completed_value);
+	VKL_CHECK_VULKAN_RESULT(result);
+
+	bool any_completed = false;
+	while (!mPending.empty() && mPending.front().ticket <= completed_value) {
+		const PendingUpload& upload = mPending.front();
+		// The transfer queue has executed the release barriers, and this command buffer is submitted after
+		// their completion has been observed => acquiring ownership here is ordered after releasing it.
+		recordOwnershipBarriers(command_buffer, upload.targets, false);
+		releasePendingUpload(upload);
+		mReadyTicket = upload.ticket;
+		++mStats.uploadsCompleted;
+		mStats.bytesUploaded += upload.bytes;
+		mPending.pop_front();
+		any_completed = true;
+	}
+	if (any_completed && mTransferQueueFamily == mGraphicsQueueFamily) {
+		// No ownership transfer => make the transfer writes visible with a global memory barrier:
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	if (mPending.empty()) {
+		mStats.busyMilliseconds += millisecondsBetween(mBusyStart, now);
+	}
+	mStreamingDuringLastFrame = true;
+}
+
+bool streamIsReady(StreamTicket ticket)
+{
+	return ticket <= mReadyTicket.load();
+}
+
+StreamStats streamGetStats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+void streamLogStats()
+{
+	const StreamStats stats = streamGetStats();
+	const double megabytes = static_cast<double>(stats.bytesUploaded) / (1024.0 * 1024.0);
+	VKL_LOG("Transfer stream: " << stats.uploadsCompleted << "/" << stats.uploadsSubmitted << " uploads completed, " << megabytes << " MiB in "
+		<< stats.busyMilliseconds << " ms (" << (stats.busyMilliseconds > 0.0 ? megabytes / (stats.busyMilliseconds / 1000.0) : 0.0) << " MiB/s)");
+	VKL_LOG("  Frame times while streaming: " << (stats.framesWhileStreaming > 0 ? stats.frameMillisecondsWhileStreaming / static_cast<double>(stats.framesWhileStreaming) : 0.0)
+		<< " ms average, " << stats.maxFrameMillisecondsWhileStreaming << " ms maximum (" << stats.framesWhileStreaming << " frames)");
+	VKL_LOG("  Frame times while idle:      " << (stats.framesWhileIdle > 0 ? stats.frameMillisecondsWhileIdle / static_cast<double>(stats.framesWhileIdle) : 0.0)
+		<< " ms average, " << stats.maxFrameMillisecondsWhileIdle << " ms maximum (" << stats.framesWhileIdle << " frames)");
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include "VulkanHelpers.h"
+
+/* --------------------------------------------- */
+// Transfer Stream Struct Definitions
+// As a convention, their names start with `Stream`.
+/* --------------------------------------------- */
+
+/*!
+ * Identifies an upload: the value which the transfer stream's timeline semaphore reaches once the upload has completed.
+ */
+typedef uint64_t StreamTicket;
+
+/*!
+ * Device-local geometry buffers which are filled asynchronously. Render a placeholder instead
+ * until streamIsReady(ticket) returns true.
+ */
+struct StreamGeometryBuffers {
+	//! Buffer handles and sizes of the geometry
+	HlpGeometryHandles handles;
+
+	//! Backing memory of positions, normals, texture coordinates, and indices buffers (in this order)
+	VkDeviceMemory memories[4];
+
+	//! The upload which fills the buffers
+	StreamTicket ticket;
+};
+
+/*!
+ * Statistics of the transfer stream.
+ */
+struct StreamStats {
+	uint64_t uploadsSubmitted;
+	uint64_t uploadsCompleted;
+	uint64_t bytesUploaded;
+
+	//! Time during which uploads were in flight, as observed by streamBeginFrame; the bandwidth is bytesUploaded divided by it.
+	double busyMilliseconds;
+
+	//! Frame times (from one streamBeginFrame to the next) while uploads were in flight and while none were
+	uint64_t framesWhileStreaming;
+	double frameMillisecondsWhileStreaming;
+	double maxFrameMillisecondsWhileStreaming;
+	uint64_t framesWhileIdle;
+	double frameMillisecondsWhileIdle;
+	double maxFrameMillisecondsWhileIdle;
+};
+
+/* --------------------------------------------- */
+// Transfer Stream Function Definitions
+// As a convention, their names start with `stream`.
+/* --------------------------------------------- */
+
+/*!
+ *	Returns the index of a queue family which supports transfers but neither graphics nor compute, i.e., which is
+ *	typically backed by dedicated copy engines. If there is none, returns the graphics queue family index.
+ *	Create a queue of the returned family during device creation and pass it to streamInit.
+ */
+uint32_t streamFindTransferQueueFamily(VkPhysicalDevice physical_device, uint32_t graphics_queue_family);
+
+/*!
+ *	Returns the timeline semaphore feature which the transfer stream requires. Chain it into VkDeviceCreateInfo::pNext
+ *	and enable VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME (unless the device is created with Vulkan 1.2 or higher).
+ */
+VkPhysicalDeviceTimelineSemaphoreFeaturesKHR streamGetDeviceFeatures();
+
+/*!
+ *	Initializes the transfer stream: creates a command pool for the transfer queue and a timeline semaphore.
+ *	@param	transfer_queue			Queue which uploads are submitted to; only the transfer stream may use it.
+ *	@param	transfer_queue_family	Its queue family, e.g., from streamFindTransferQueueFamily
+ *	@param	graphics_queue_family	Queue family of the queue which uses the uploaded resources. If it differs from
+ *									transfer_queue_family, ownership of exclusive resources is transferred to it.
+ */
+void streamInit(VkQueue transfer_queue, uint32_t transfer_queue_family, uint32_t graphics_queue_family);
+
+/*!
+ *	Waits for all uploads on the timeline semaphore (no vkDeviceWaitIdle) and destroys the stream's resources.
+ */
+void streamDestroy();
+
+/*!
+ *	Copies data into a staging buffer and submits its upload into the given buffer to the transfer queue.
+ *	May be invoked from any thread, e.g., from jobs which load assets.
+ *	@param	buffer		Destination; must have VK_BUFFER_USAGE_TRANSFER_DST_BIT and VK_SHARING_MODE_EXCLUSIVE.
+ *	@return	A ticket to check for completion with streamIsReady
+ */
+StreamTicket streamUploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size);
+
+/*!
+ *	Like streamUploadBuffer, but uploads into the first mip level and first layer of an image, which is in
+ *	VK_IMAGE_LAYOUT_UNDEFINED before and in final_layout after the upload.
+ *	@param	image	Destination; must have VK_IMAGE_USAGE_TRANSFER_DST_BIT and VK_SHARING_MODE_EXCLUSIVE.
+ */
+StreamTicket streamUploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height,
+	VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+/*!
+ *	Creates device-local buffers for the given geometry and uploads them with one submission.
+ */
+StreamGeometryBuffers streamCreateGeometryAndBuffers(const VklGeometryData& geometry_data);
+
+/*!
+ *	Destroys buffers which were previously created with streamCreateGeometryAndBuffers. The GPU must not use them anymore.
+ */
+void streamDestroyBuffers(const StreamGeometryBuffers& buffers);
+
+/*!
+ *	Invoke once per frame on the render thread, before recording any commands that use uploaded resources.
+ *	Checks which uploads have completed, frees their staging buffers, and records the ownership-acquiring barriers
+ *	for them into the given command buffer. Afterwards, streamIsReady returns true for them.
+ *	Also measures the frame times for StreamStats.
+ *	@param	command_buffer	Command buffer of the graphics queue, e.g., vklGetCurrentCommandBuffer()
+ */
+void streamBeginFrame(VkCommandBuffer command_buffer);
+
+/*!
+ *	Returns true if the upload has completed and the resource can be used from commands recorded after the last
+ *	streamBeginFrame. Until then, use a placeholder.
+ */
+bool streamIsReady(StreamTicket ticket);
+
+/*!
+ *	Returns the current statistics.
+ */
+StreamStats streamGetStats();
+
+/*!
+ *	Logs uploaded bytes, bandwidth, and the average and maximum frame times while streaming compared to while idle.
+ */
+void streamLogStats();
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#include "UniformRing.h"
+#include "MemoryRegistry.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+/* --------------------------------------------- */
+// Internal helpers of the uniform ring
+/* --------------------------------------------- */
+
+namespace {
+
+	// Releases the oldest frame in flight, whose commands must have completed, and its memory:
+	void retireOldestFrame(RingBuffer& ring)
+	{
+		const RingFrame& oldest = ring.framesInFlight.front();
+		ring.tail = oldest.end;
+		if (VK_NULL_HANDLE != oldest.fence) {
+			ring.freeFences.push_back(oldest.fence);
+		}
+		ring.framesInFlight.pop_front();
+	}
+}
+
+/* --------------------------------------------- */
+// Uniform Ring Function Definitions
+/* --------------------------------------------- */
+
+RingBuffer ringCreate(VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	RingBuffer ring = {};
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	ring.alignment = std::max<VkDeviceSize>({ 16, properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment });
+	// Make the size a multiple of the alignment, so that aligned offsets stay aligned after wrapping around:
+	ring.size = (size + ring.alignment - 1) / ring.alignment * ring.alignment;
+
+	const auto device = vklGetDevice();
+	VkBufferCreateInfo buffer_create_info = {};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = ring.size;
+	buffer_create_info.usage = usage;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkResult result = vkCreateBuffer(device, &buffer_create_info, nullptr, &ring.buffer);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to create ring buffer with error: ") + std::to_string(result));
+	}
+
+	VkMemoryRequirements memory_requirements;
+	vkGetBufferMemoryRequirements(device, ring.buffer, &memory_requirements);
+	ring.memory = memAllocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Ring buffer", MEM_CATEGORY_UNIFORM);
+	result = vkBindBufferMemory(device, ring.buffer, ring.memory, 0);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to bind the ring buffer's memory with error: ") + std::to_string(result));
+	}
+
+	// Map once and keep it mapped for the ring's lifetime:
+	void* mapped;
+	result = vkMapMemory(device, ring.memory, 0, ring.size, 0, &mapped);
+	if (VK_SUCCESS != result) {
+		VKL_EXIT_WITH_ERROR(std::string("Failed to map the ring buffer's memory with error: ") + std::to_string(result));
+	}
+	ring.mapped = static_cast<uint8_t*>(mapped);
+	return ring;
+}
+
+void ringDestroy(RingBuffer& ring)
+{
+	const auto device = vklGetDevice();
+	for (const RingFrame& frame : ring.framesInFlight) {
+		if (VK_NULL_HANDLE != frame.fence) {
+			vkDestroyFence(device, frame.fence, nullptr);
+		}
+	}
+	for (VkFence fence : ring.freeFences) {
+		vkDestroyFence(device, fence, nullptr);
+	}
+	vkUnmapMemory(device, ring.memory);
+	memFree(ring.memory);
+	vkDestroyBuffer(device, ring.buffer, nullptr);
+	ring = RingBuffer{};
+}
+
+void ringBeginFrame(RingBuffer& ring, uint32_t frame_slot)
+{
+	// The GPU has finished the last frame that used this slot, and therefore all frames before it:
+	const auto last_with_slot = std::find_if(ring.framesInFlight.rbegin(), ring.framesInFlight.rend(),
+		[frame_slot](const RingFrame& frame) { return frame.slot == frame_slot; });
+	if (last_with_slot != ring.framesInFlight.rend()) {
+		const size_t completed = static_cast<size_t>(ring.framesInFlight.rend() - last_with_slot);
+		for (size_t i = 0; i < completed; ++i) {
+			retireOldestFrame(ring);
+		}
+	}
+
+	ring.frameSlot = frame_slot;
+	ring.frameStart = ring.head;
+	ring.stats.bytesThisFrame = 0;
+	ring.stats.allocationsThisFrame = 0;
+}
+
+RingAllocation ringAllocate(RingBuffer& ring, VkDeviceSize size)
+{
+	const VkDeviceSize aligned_size = (size + ring.alignment - 1) / ring.alignment * ring.alignment;
+	if (aligned_size > ring.size) {
+		VKL_EXIT_WITH_ERROR("Ring allocation of " << size << " bytes exceeds the ring's size of " << ring.size << " bytes.");
+	}
+
+	uint64_t position = ring.head;
+	// A chunk must not straddle the end of the buffer => skip the remainder and continue at the start:
+	if (position % ring.size + aligned_size > ring.size) {
+		position += ring.size - position % ring.size;
+	}
+	// Count every time a chunk starts in a new pass over the buffer, i.e., after the previous chunk ended in the last one:
+	if (ring.head > 0 && position / ring.size != (ring.head - 1) / ring.size) {
+		++ring.stats.wraparounds;
+	}
+
+	if (position + aligned_size - ring.tail > ring.size) {
+		// Would overwrite data of frames the GPU might still be reading => wait for the oldest ones until there is enough space:
+		const auto device = vklGetDevice();
+		const auto start = std::chrono::steady_clock::now();
+		while (position + aligned_size - ring.tail > ring.size && !ring.framesInFlight.empty() && VK_NULL_HANDLE != ring.framesInFlight.front().fence) {
+			const VkResult result = vkWaitForFences(device, 1, &ring.framesInFlight.front().fence, VK_TRUE, UINT64_MAX);
+			if (VK_SUCCESS != result) {
+				VKL_EXIT_WITH_ERROR(std::string("Failed to wait for a frame's fence with error: ") + std::to_string(result));
+			}
+			retireOldestFrame(ring);
+		}
+		// Last resort, if the frames in the way are not tracked by fences:
+		if (position + aligned_size - ring.tail > ring.size && !ring.framesInFlight.empty()) {
+			vkDeviceWaitIdle(device);
+			while (!ring.framesInFlight.empty()) {
+				retireOldestFrame(ring);
+			}
+			++ring.stats.idleStalls;
+		}
+		ring.stats.stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		++ring.stats.stalls;
+		if (position + aligned_size - ring.tail > ring.size) {
+			VKL_EXIT_WITH_ERROR("Ring buffer of " << ring.size << " bytes is too small for the allocations of a single frame.");
+		}
+	}
+
+	ring.stats.bytesThisFrame += position + aligned_size - ring.head;
+	ring.stats.allocationsThisFrame += 1;
+	ring.head = position + aligned_size;
+
+	const VkDeviceSize offset = position % ring.size;
+	return RingAllocation{ ring.mapped + offset, static_cast<uint32_t>(offset) };
+}
+
+void ringEndFrame(RingBuffer& ring, VkQueue queue)
+{
+	VkFence fence = VK_NULL_HANDLE;
+	if (VK_NULL_HANDLE != queue) {
+		const auto device = vklGetDevice();
+		VkResult result;
+		if (ring.freeFences.empty()) {
+			VkFenceCreateInfo fence_create_info = {};
+			fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			result = vkCreateFence(device, &fence_create_info, nullptr, &fence);
+		}
+		else {
+			fence = ring.freeFences.back();
+			ring.freeFences.pop_back();
+			result = vkResetFences(device, 1, &fence);
+		}
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to prepare a frame's fence with error: ") + std::to_string(result));
+		}
+
+		// A submission without any batches signals its fence once all work previously submitted to the queue has completed:
+		result = vkQueueSubmit(queue, 0, nullptr, fence);
+		if (VK_SUCCESS != result) {
+			VKL_EXIT_WITH_ERROR(std::string("Failed to submit a frame's fence with error: ") + std::to_string(result));
+		}
+	}
+	ring.framesInFlight.push_back(RingFrame{ ring.frameSlot, ring.head, fence });
+}
+
+void ringWriteDescriptorSet(const RingBuffer& ring, VkDescriptorSet descriptor_set, uint32_t binding, VkDeviceSize range, VkDescriptorType type)
+{
+	VkDescriptorBufferInfo buffer_info = {};
+	buffer_info.buffer = ring.buffer;
+	buffer_info.offset = 0;
+	buffer_info.range = range;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptor_set;
+	write.dstBinding = binding;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pBufferInfo = &buffer_info;
+	vkUpdateDescriptorSets(vklGetDevice(), 1, &write, 0, nullptr);
+}
+
+void ringBindDescriptorSet(VkPipelineLayout pipeline_layout, uint32_t set_index, VkDescriptorSet descriptor_set, const RingAllocation& allocation)
+{
+	vkCmdBindDescriptorSets(vklGetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, set_index, 1, &descriptor_set, 1, &allocation.offset);
+}
+
+void ringLogStats(const RingBuffer& ring)
+{
+	VKL_LOG("Uniform ring: " << ring.stats.bytesThisFrame << " bytes in " << ring.stats.allocationsThisFrame << " allocations this frame ("
+		<< ring.size << " bytes total, alignment " << ring.alignment << "), " << ring.stats.wraparounds << " wraparounds, "
+		<< ring.stats.stalls << " stalls (" << ring.stats.stallMilliseconds << " ms, " << ring.stats.idleStalls << " of which waited for the device to become idle)");
+}
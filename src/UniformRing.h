@@ -0,0 +1,150 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+
+/* --------------------------------------------- */
+// Uniform Ring Struct Definitions
+// As a convention, their names start with `Ring`.
+/* --------------------------------------------- */
+
+/*!
+ * A chunk of ring memory for one draw (or one frame).
+ */
+struct RingAllocation {
+	//! Persistently mapped pointer to write the data to
+	void* data;
+
+	//! Offset of the chunk within the ring's buffer; pass it as dynamic offset when binding the descriptor set.
+	uint32_t offset;
+};
+
+/*!
+ * Statistics of a ring. Per-frame values are reset in ringBeginFrame.
+ */
+struct RingStats {
+	//! Bytes allocated in the current frame, including alignment padding
+	VkDeviceSize bytesThisFrame;
+
+	//! Number of allocations in the current frame
+	uint32_t allocationsThisFrame;
+
+	//! Total number of times the write position wrapped around to the start of the buffer
+	uint64_t wraparounds;
+
+	//! Total number of times an allocation had to wait for the GPU because the ring was full
+	uint64_t stalls;
+
+	//! Number of those stalls which had to wait for the whole device, since no fence tracked the oldest frame in flight
+	uint64_t idleStalls;
+
+	//! Total time spent in those waits
+	double stallMilliseconds;
+};
+
+/*!
+ * A frame which has been recorded but possibly not executed yet.
+ */
+struct RingFrame {
+	//! The frame's slot, i.e., swapchain image index, see ringBeginFrame
+	uint32_t slot;
+
+	//! Position of the ring's head at the end of the frame
+	uint64_t end;
+
+	//! Signaled once the frame's commands have completed; VK_NULL_HANDLE if ringEndFrame got no queue
+	VkFence fence;
+};
+
+/*!
+ * A host-coherent, persistently mapped buffer from which per-draw uniform or storage data is suballocated.
+ * Memory allocated during a frame is reused once the frame that used the same swapchain image begins again,
+ * i.e., once the GPU has finished with it.
+ */
+struct RingBuffer {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	VkDeviceSize size;
+	VkDeviceSize alignment;
+
+	//! Monotonically increasing positions; the byte offset is position % size.
+	uint64_t head;
+	uint64_t tail;
+	uint64_t frameStart;
+	uint32_t frameSlot;
+
+	//! Frames which have been recorded but possibly not executed yet, oldest first
+	std::deque<RingFrame> framesInFlight;
+
+	//! Fences of completed frames, to be reused by ringEndFrame
+	std::vector<VkFence> freeFences;
+
+	RingStats stats;
+};
+
+/* --------------------------------------------- */
+// Uniform Ring Function Definitions
+// As a convention, their names start with `ring`.
+/* --------------------------------------------- */
+
+/*!
+ *	Creates a ring buffer and maps it persistently. Allocations are aligned to the device's
+ *	minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment.
+ *	@param	physical_device		The physical device the framework has been initialized with
+ *	@param	size				Size of the ring in bytes; should hold the data of all frames in flight.
+ *	@param	usage				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT and/or VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+ */
+RingBuffer ringCreate(VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+/*!
+ *	Unmaps and destroys the ring. The GPU must not use it anymore.
+ */
+void ringDestroy(RingBuffer& ring);
+
+/*!
+ *	Starts a new frame. All memory allocated before the last frame which used the same slot becomes available again.
+ *	@param	frame_slot	The current swapchain image index, i.e., vklGetCurrentSwapChainImageIndex(), after
+ *						the framework has waited for that image's previous commands to complete.
+ */
+void ringBeginFrame(RingBuffer& ring, uint32_t frame_slot);
+
+/*!
+ *	Allocates an aligned chunk for the current frame. If the ring is full, it waits for the oldest frames in flight
+ *	to complete, one at a time, through their fences (counted as a stall). Only if the oldest frame has no fence
+ *	(see ringEndFrame), it waits for the device to become idle as a last resort (counted as an idle stall).
+ *	@param	size	Size in bytes; the descriptor's range must be at least this large.
+ */
+RingAllocation ringAllocate(RingBuffer& ring, VkDeviceSize size);
+
+/*!
+ *	Ends the current frame; its allocations are kept until ringBeginFrame is invoked with the same slot again.
+ *	@param	queue	The queue which the frame's commands have been submitted to; invoke after that submission then.
+ *					An empty submission with a fence is added to it, so that ringAllocate can wait for exactly this
+ *					frame if the ring runs full. If VK_NULL_HANDLE, a full ring waits for the device to become idle.
+ */
+void ringEndFrame(RingBuffer& ring, VkQueue queue = VK_NULL_HANDLE);
+
+/*!
+ *	Writes the ring's buffer into binding `binding` of the given descriptor set as a dynamic uniform buffer
+ *	(or dynamic storage buffer if `type` says so), so that one descriptor set serves all draws.
+ *	@param	range	Size of the data one draw reads, i.e., the size passed to ringAllocate
+ */
+void ringWriteDescriptorSet(const RingBuffer& ring, VkDescriptorSet descriptor_set, uint32_t binding, VkDeviceSize range,
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+
+/*!
+ *	Binds the descriptor set with the given allocation's offset as dynamic offset into the current command buffer.
+ *	@param	pipeline_layout		Layout of the pipeline the set is used with
+ *	@param	set_index			The set number in the shaders
+ */
+void ringBindDescriptorSet(VkPipelineLayout pipeline_layout, uint32_t set_index, VkDescriptorSet descriptor_set, const RingAllocation& allocation);
+
+/*!
+ *	Logs the ring's statistics: bytes written in the current frame, wraparounds, and stalls.
+ */
+void ringLogStats(const RingBuffer& ring);
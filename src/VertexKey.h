@@ -0,0 +1,33 @@
+/*
+ * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
+ */
+#pragma once
+#include "VulkanLaunchpad.h"
+#include "Hash.h"
+#include <cstring>
+
+/* --------------------------------------------- */
+// Key for welding vertices which have exactly
+// the same attributes, e.g., in an unordered_map.
+/* --------------------------------------------- */
+
+/*!
+ * Attributes of one vertex. Keys compare bitwise, i.e., only vertices with exactly the same attribute values are
+ * considered equal. Zero-initialize keys before setting their members, e.g., `VertexKey key = {};`.
+ */
+struct VertexKey {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 textureCoordinate;
+
+	bool operator==(const VertexKey& o) const {
+		return 0 == memcmp(this, &o, sizeof(VertexKey));
+	}
+};
+
+//! Hash functor for VertexKey, e.g., std::unordered_map<VertexKey, uint32_t, VertexKeyHash>
+struct VertexKeyHash {
+	size_t operator()(const VertexKey& k) const {
+		return static_cast<size_t>(hashFnv1a(&k, sizeof(VertexKey)));
+	}
+};
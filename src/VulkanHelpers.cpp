@@ -3,6 +3,17 @@
  */
 #include "VulkanHelpers.h"
 #include "VulkanLaunchpad.h"
+#include "ObjectCache.h"
+
+namespace {
+	// The object cache creates all objects with the device which the framework has been initialized with:
+	void checkCacheDevice(VkDevice device)
+	{
+		if (device != vklGetDevice()) {
+			VKL_EXIT_WITH_ERROR("Image views and samplers are created through the object cache, which requires the device the framework has been initialized with.");
+		}
+	}
+}
 
 /* --------------------------------------------- */
 // Vulkan-Specific Helper Function Definitions
@@ -178,7 +189,7 @@ void hlpRecordCopyBufferToImage(
 	vkCmdCopyBufferToImage(command_buffer, buffer, image, image_layout, 1, &buffer_image_copy_region);
 }
 
-VkImageView hlpCreateImageView(VkDevice device, VkImage image, VkFormat image_format)
+VkImageViewCreateInfo hlpGetImageViewCreateInfo(VkImage image, VkFormat image_format)
 {
 	VkImageViewCreateInfo image_view_create_info = {};
 	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -194,20 +205,49 @@ VkImageView hlpCreateImageView(VkDevice device, VkImage image, VkFormat image_fo
 	image_view_create_info.subresourceRange.levelCount = 1u;
 	image_view_create_info.subresourceRange.baseArrayLayer = 0u;
 	image_view_create_info.subresourceRange.layerCount = 1u;
+	return image_view_create_info;
+}
 
-	VkImageView image_view;
-	VkResult result = vkCreateImageView(device, &image_view_create_info, nullptr, &image_view);
-	VKL_CHECK_VULKAN_RESULT(result);
+VkImageView hlpCreateImageView(VkDevice device, VkImage image, VkFormat image_format)
+{
+	checkCacheDevice(device);
+	return cacheGetImageView(hlpGetImageViewCreateInfo(image, image_format));
+}
 
-	return image_view;
+VkImageViewCreateInfo hlpGetCubeImageViewCreateInfo(VkImage image, VkFormat image_format, uint32_t mip_levels)
+{
+	VkImageViewCreateInfo image_view_create_info = {};
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+	image_view_create_info.format = image_format;
+	image_view_create_info.components.r = VK_COMPONENT_SWIZZLE_R;
+	image_view_create_info.components.g = VK_COMPONENT_SWIZZLE_G;
+	image_view_create_info.components.b = VK_COMPONENT_SWIZZLE_B;
+	image_view_create_info.components.a = VK_COMPONENT_SWIZZLE_A;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0u;
+	image_view_create_info.subresourceRange.levelCount = mip_levels;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0u;
+	image_view_create_info.subresourceRange.layerCount = 6u;
+	return image_view_create_info;
+}
+
+VkImageView hlpCreateCubeImageView(VkDevice device, VkImage image, VkFormat image_format, uint32_t mip_levels)
+{
+	checkCacheDevice(device);
+	return cacheGetImageView(hlpGetCubeImageViewCreateInfo(image, image_format, mip_levels));
 }
 
 void hlpDestroyImageView(VkDevice device, VkImageView image_view)
 {
-	vkDestroyImageView(device, image_view, nullptr);
+	// Views which have not been created through the cache are destroyed directly:
+	if (!cacheReleaseImageView(image_view)) {
+		vkDestroyImageView(device, image_view, nullptr);
+	}
 }
 
-VkSampler hlpCreateSampler(VkDevice device, VkFilter mag_filter, VkFilter min_filter)
+VkSamplerCreateInfo hlpGetSamplerCreateInfo(VkFilter mag_filter, VkFilter min_filter)
 {
 	VkSamplerCreateInfo sampler_create_info = {};
 	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -218,15 +258,19 @@ VkSampler hlpCreateSampler(VkDevice device, VkFilter mag_filter, VkFilter min_fi
 	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
 	sampler_create_info.minLod = 0.0f;
 	sampler_create_info.maxLod = 0.0f;
+	return sampler_create_info;
+}
 
-	VkSampler sampler;
-	VkResult result = vkCreateSampler(device, &sampler_create_info, nullptr, &sampler);
-	VKL_CHECK_VULKAN_RESULT(result);
-
-	return sampler;
+VkSampler hlpCreateSampler(VkDevice device, VkFilter mag_filter, VkFilter min_filter)
+{
+	checkCacheDevice(device);
+	return cacheGetSampler(hlpGetSamplerCreateInfo(mag_filter, min_filter));
 }
 
 void hlpDestroySampler(VkDevice device, VkSampler sampler)
 {
-	vkDestroySampler(device, sampler, nullptr);
+	// Samplers which have not been created through the cache are destroyed directly:
+	if (!cacheReleaseSampler(sampler)) {
+		vkDestroySampler(device, sampler, nullptr);
+	}
 }
@@ -1,6 +1,7 @@
 /*
  * Copyright 2023 TU Wien, Institute of Visual Computing & Human-Centered Technology.
  */
+#pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
 
@@ -150,11 +151,21 @@ void hlpRecordCopyBufferToImage(
 	uint32_t                   image_height,
 	VkImageLayout              image_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
+/*!
+ *  Returns the create info which hlpCreateImageView uses, e.g., for looking up an
+ *  image view in the object cache (see cacheGetImageView) instead of creating a new one.
+ *  @param	image			The image which an image view shall be created for
+ *	@param	image_format	The image's format
+ *  @return	Create info for a 2D view of the image's first layer and first mipmap level
+ */
+VkImageViewCreateInfo hlpGetImageViewCreateInfo(VkImage image, VkFormat image_format);
+
 /*!
  *  Creates an image view for the given image.
  *  Note: This convenience function only creates an image view for the image's 
  *        first layer and for its first mipmap layer. 
- *  @param	device			Device handle
+ *  The view is looked up in the object cache (see cacheGetImageView), i.e., identical requests share one view.
+ *  @param	device			Device handle; must be the one the framework has been initialized with.
  *  @param	image			The image which an image view shall be created for
  *	@param	image_format	The image's format
  *  @return	A handle to a new image view.
@@ -162,16 +173,48 @@ void hlpRecordCopyBufferToImage(
 VkImageView hlpCreateImageView(VkDevice device, VkImage image, VkFormat image_format);
 
 /*!
- *  Destroys an image view which was previously created with hlpCreateImageView
+ *  Returns the create info which hlpCreateCubeImageView uses.
+ *  @param	image			The image which an image view shall be created for
+ *	@param	image_format	The image's format
+ *	@param	mip_levels		The number of mipmap levels the view shall contain
+ *  @return	Create info for a cube view of the image's six layers
+ */
+VkImageViewCreateInfo hlpGetCubeImageViewCreateInfo(VkImage image, VkFormat image_format, uint32_t mip_levels = 1u);
+
+/*!
+ *  Creates a cube image view for the given image, which must have been created with six array layers
+ *  (in the order +x, -x, +y, -y, +z, -z) and VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT.
+ *  Destroy it with hlpDestroyImageView. The view is looked up in the object cache, like with hlpCreateImageView.
+ *  @param	device			Device handle; must be the one the framework has been initialized with.
+ *  @param	image			The image which an image view shall be created for
+ *	@param	image_format	The image's format
+ *	@param	mip_levels		The number of mipmap levels the view shall contain
+ *  @return	A handle to a new image view.
+ */
+VkImageView hlpCreateCubeImageView(VkDevice device, VkImage image, VkFormat image_format, uint32_t mip_levels = 1u);
+
+/*!
+ *  Destroys an image view which was previously created with hlpCreateImageView, once all requests which
+ *  share it have destroyed it (see cacheReleaseImageView). Views not created through the cache are destroyed directly.
  *  @param	device			Device handle
  *  @param	image_view		The image view which shall be destroyed.
  */
 void hlpDestroyImageView(VkDevice device, VkImageView image_view);
 
+/*!
+ *  Returns the create info which hlpCreateSampler uses, e.g., for looking up a
+ *  sampler in the object cache (see cacheGetSampler) instead of creating a new one.
+ *  @param	mag_filter		Specifies how to lookup textures in the magnification case.
+ *  @param	min_filter		Specifies how to lookup textures in the minification case.
+ *  @return	Create info with most configuration properties set to sensible default values
+ */
+VkSamplerCreateInfo hlpGetSamplerCreateInfo(VkFilter mag_filter, VkFilter min_filter);
+
 /*!
  *  Creates a sampler with most its configuration properties set to sensible default values.
  *  Only mag filter and min filter can be configured through the respective parameters.
- *  @param	device			Device handle
+ *  The sampler is looked up in the object cache (see cacheGetSampler), i.e., identical requests share one sampler.
+ *  @param	device			Device handle; must be the one the framework has been initialized with.
  *  @param	mag_filter		Specifies how to lookup textures in the magnification case.
  *  @param	min_filter		Specifies how to lookup textures in the minification case.
  *  @return	A handle to a new sampler.
@@ -179,7 +222,8 @@ void hlpDestroyImageView(VkDevice device, VkImageView image_view);
 VkSampler hlpCreateSampler(VkDevice device, VkFilter mag_filter, VkFilter min_filter);
 
 /*!
- *  Destroys a sampler which was previously created with hlpCreateSampler
+ *  Destroys a sampler which was previously created with hlpCreateSampler, once all requests which
+ *  share it have destroyed it (see cacheReleaseSampler). Samplers not created through the cache are destroyed directly.
  *  @param	device			Device handle
  *  @param	sampler			The sampler which shall be destroyed.
  */